@@ -12,6 +12,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 
 
@@ -28,10 +30,15 @@ enum _UTILERR {
     E_NODATA = -8,
     E_DOESNT_EXIST = -9,        // element doesn't exist
     E_BAD_TYPE = -10,
+    E_FULL = -11,               // fixed capacity object has no room
+    E_IO = -12,                 // file open/read/write failed
+    E_CORRUPT = -13,            // stored data failed validation (header, size or checksum)
 };
 typedef enum _UTILERR UTIL_ERR;
 const char *UTIL_ERR_PRINT(UTIL_ERR);
 
+#define APUTIL_CACHE_LINE 64
+
 
 
 // ########################### VECTORS ###########################
@@ -43,25 +50,50 @@ enum vec_type {
 };
 typedef enum vec_type VECTYPE;
 
+//////////////////// storage ////////////////////
+#define VEC_HUGE_MIN ((size_t)2 << 20)      // bytes, one transparent huge page
+
+// how vector data is allocated, all zero is plain malloc
+typedef struct {
+    size_t align;       // 0 for malloc's alignment or a power of two (e.g. APUTIL_CACHE_LINE), other values make allocation return NULL
+    bool huge;          // data of VEC_HUGE_MIN bytes or more is huge page aligned and madvised
+} Vec_alloc;
+
+// allocate bytes as described by a, release with free(), NULL on failure
+void *vec_data_alloc(const Vec_alloc *a, size_t bytes);
+// grow data to bytes keeping the alignment, the first old_bytes are kept, NULL on failure (data untouched)
+void *vec_data_realloc(const Vec_alloc *a, void *data, size_t old_bytes, size_t bytes);
+
+//////////////////// storage ////////////////////
+
+
 //////////////////// generic vector ////////////////////
 typedef struct {
     void * data;
     size_t size;
     size_t cap;
     size_t elem_size;
+    Vec_alloc alloc;
 } Vector;
 
 // make a new generic vector (element size, starting capacity)
 Vector *vector_new(size_t, size_t);
+// make a new vector whose data is allocated as described by a (kept across growth and copies)
+Vector *vector_new_opts(size_t elem_size, size_t cap, const Vec_alloc *a);
 // free the vector and its data
 void vector_free(Vector*);
 // return a shallow copy of the vector
 // if data contains pointers, only the pointers are copied
 Vector *vector_copy(const Vector *v);
+// make a vector holding a copy of n elements of elem_size bytes at arr (one alloc, one copy)
+Vector *vector_from_array(const void *arr, size_t n, size_t elem_size);
 
 // add an element to the back of the vector (Vector, address of element)
 UTIL_ERR vector_add_back(Vector *v, void *elem);
+// add n elements from arr to the back, capacity is grown at most once
+UTIL_ERR vector_append_array(Vector *v, const void *arr, size_t n);
 // add an element to the front of the vector (Vector, address of element)
+// shifts every element, O(n), use a Deque to build from the front
 UTIL_ERR vector_add_front(Vector *v, void *elem);
 // insert an element at the provided index (shifts others down)
 UTIL_ERR vector_insert(Vector *v, void *elem, size_t idx);
@@ -81,6 +113,8 @@ UTIL_ERR vector_map(Vector *v, void(*mapfunc)(void*));
 Vector *vector_map_new(const Vector *v, void(*mapfunc)(void*), UTIL_ERR *e);
 // return new vector with elements filtered based on passed function pointer
 Vector *vector_filter(const Vector *v, bool(*filter)(void*), UTIL_ERR *e);
+// fold the elements into acc (holding the initial value) with reduce(acc, elem)
+UTIL_ERR vector_reduce(const Vector *v, void *acc, void (*reduce)(void *acc, const void *elem));
 // check for an element in the vector and return idx if found, otherwise -1
 intmax_t vector_in(const Vector *v, void *elem, bool(*equal)(void*, void*), UTIL_ERR *e);
 // swap the two index data
@@ -96,10 +130,13 @@ typedef struct {
     int32_t *data;
     size_t size;
     size_t cap;
+    Vec_alloc alloc;
 } Vec_i32;
 
 // make a new i32 vector (starting capacity)
 Vec_i32 *vec_i32_new(size_t);
+// make a new i32 vector whose data is allocated as described by a
+Vec_i32 *vec_i32_new_opts(size_t cap, const Vec_alloc *a);
 // free the vector and its data
 void vec_i32_free(Vec_i32*);
 // return a copy of the vector
@@ -107,7 +144,10 @@ Vec_i32 *vec_i32_copy(const Vec_i32 *v);
 
 // add an element to the back of the vector (Vector, int32 element)
 UTIL_ERR vec_i32_add_back(Vec_i32 *v, int32_t elem);
+// add n elements from arr to the back, capacity is grown at most once
+UTIL_ERR vec_i32_append_n(Vec_i32 *v, const int32_t *arr, size_t n);
 // add an element to the front of the vector (Vector, int32 element)
+// shifts every element, O(n), use a Deque_i32 to build from the front
 UTIL_ERR vec_i32_add_front(Vec_i32 *v, int32_t elem);
 // insert an element at the provided index (shifts others down)
 UTIL_ERR vec_i32_insert(Vec_i32 *v, int32_t elem, size_t idx);
@@ -152,6 +192,8 @@ Vec_char *vec_char_copy(const Vec_char *v);
 
 // add an element to the back of the vector (Vector, int32 element)
 UTIL_ERR vec_char_add_back(Vec_char *v, char elem);
+// add n chars from arr to the back, capacity is grown at most once
+UTIL_ERR vec_char_append_n(Vec_char *v, const char *arr, size_t n);
 // add an element to the front of the vector (Vector, int32 element)
 UTIL_ERR vec_char_add_front(Vec_char *v, char elem);
 // insert an element at the provided index (shifts others down)
@@ -179,8 +221,263 @@ UTIL_ERR vec_char_swap(Vec_char *v, size_t idx1, size_t idx2);
 UTIL_ERR vec_char_reverse(Vec_char *v);
 
 //////////////////// char vector ////////////////////
+
+
+//////////////////// bit vector ////////////////////
+// one bit per flag (src/bitvec.c), storage is cache line aligned and a whole
+// number of 256-bit chunks, bits from size up are always zero. bulk ops,
+// counting and packing use AVX2 where available
+typedef struct {
+    uint64_t *data;
+    size_t size;        // bits
+    size_t cap;         // bits, a multiple of 256
+} Vec_bit;
+
+// make a new empty bit vector (starting capacity in bits)
+Vec_bit *vec_bit_new(size_t cap);
+// make n bits, all set to value
+Vec_bit *vec_bit_filled(size_t n, bool value);
+void vec_bit_free(Vec_bit*);
+Vec_bit *vec_bit_copy(const Vec_bit *v);
+
+UTIL_ERR vec_bit_add_back(Vec_bit *v, bool bit);
+// grow (new bits are zero) or shrink to n bits
+UTIL_ERR vec_bit_resize(Vec_bit *v, size_t n);
+// set every bit to value
+void vec_bit_fill(Vec_bit *v, bool value);
+// zero the bits and set v->size to 0
+void vec_bit_clear(Vec_bit*);
+
+UTIL_ERR vec_bit_set(Vec_bit *v, size_t idx);
+UTIL_ERR vec_bit_unset(Vec_bit *v, size_t idx);
+UTIL_ERR vec_bit_flip(Vec_bit *v, size_t idx);
+// return the bit at index (errors handled through UTIL_ERR pointer)
+bool vec_bit_get(const Vec_bit *v, size_t idx, UTIL_ERR *e);
+
+// dst = dst op src over whole words, E_OUTOFBOUNDS unless both have the same size
+UTIL_ERR vec_bit_and(Vec_bit *dst, const Vec_bit *src);
+UTIL_ERR vec_bit_or(Vec_bit *dst, const Vec_bit *src);
+UTIL_ERR vec_bit_xor(Vec_bit *dst, const Vec_bit *src);
+// dst &= ~src
+UTIL_ERR vec_bit_andnot(Vec_bit *dst, const Vec_bit *src);
+
+// number of set bits
+size_t vec_bit_count(const Vec_bit *v);
+// index of the first set bit at or after from, -1 if there is none
+intmax_t vec_bit_next_set(const Vec_bit *v, size_t from);
+
+// rank / select directory over a bit vector (rank9 layout: per 512 bits a
+// running count and seven packed 9-bit word counts, about 25% extra), rank is
+// one popcount, select narrows through sampled ones then the block counts.
+// it reads bits but doesn't own it, rebuild after bits change
+#define VEC_BIT_SELECT_SAMPLE 4096
+typedef struct {
+    const Vec_bit *bits;
+    uint64_t *blocks;       // 2 per 512-bit block: ones before it, packed word counts
+    size_t n_blocks;
+    size_t *samples;        // block holding one number i * VEC_BIT_SELECT_SAMPLE
+    size_t n_samples;
+    size_t ones;
+} Vec_bit_rank;
+
+// caller checks NULL
+Vec_bit_rank *vec_bit_rank_new(const Vec_bit *v);
+void vec_bit_rank_free(Vec_bit_rank *r);
+// set bits in [0, idx), idx past the end counts them all
+size_t vec_bit_rank(const Vec_bit_rank *r, size_t idx);
+// index of set bit number k (from 0), -1 if there are k or fewer
+intmax_t vec_bit_select(const Vec_bit_rank *r, size_t k);
+
+// masks: bit i says whether element i passed, what vec_i32_filter keeps
+// bit i = pred(element i)
+Vec_bit *vec_i32_mask(const Vec_i32 *v, bool(*pred)(int32_t), UTIL_ERR *e);
+Vec_bit *vector_mask(const Vector *v, bool(*pred)(void*), UTIL_ERR *e);
+// new vector of the elements whose bit is set (mask size must equal the vector size)
+Vec_i32 *vec_i32_select_mask(const Vec_i32 *v, const Vec_bit *mask, UTIL_ERR *e);
+Vector *vector_select_mask(const Vector *v, const Vec_bit *mask, UTIL_ERR *e);
+// byte per flag (nonzero is set) to bits and back (0 / 1 bytes)
+Vec_bit *vec_bit_from_chars(const Vec_char *flags, UTIL_ERR *e);
+Vec_char *vec_bit_to_chars(const Vec_bit *v, UTIL_ERR *e);
+
+//////////////////// bit vector ////////////////////
+
+//////////////////// unchecked access ////////////////////
+// inline accessors for hot loops: no NULL or error checks, a plain load in
+// normal builds. define APUTIL_BOUNDS_CHECK to abort on an out of range index
+#ifdef APUTIL_BOUNDS_CHECK
+static inline size_t aputil_bounds(size_t idx, size_t size, const char *file, int line) {
+    if (idx >= size) {
+        fprintf(stderr, "%s:%d: index %zu out of bounds (size %zu)\n", file, line, idx, size);
+        abort();
+    }
+    return idx;
+}
+#define APUTIL_IDX(idx, size) aputil_bounds((idx), (size), __FILE__, __LINE__)
+
+// checked accessors are macros so the report names the caller's file and line
+static inline void *aputil_vector_at(const Vector *v, size_t idx, const char *file, int line) {
+    return (char*)v->data + aputil_bounds(idx, v->size, file, line) * v->elem_size;
+}
+static inline int32_t aputil_vec_i32_at(const Vec_i32 *v, size_t idx, const char *file, int line) {
+    return v->data[aputil_bounds(idx, v->size, file, line)];
+}
+static inline char aputil_vec_char_at(const Vec_char *v, size_t idx, const char *file, int line) {
+    return v->data[aputil_bounds(idx, v->size, file, line)];
+}
+static inline bool aputil_vec_bit_test(const Vec_bit *v, size_t idx, const char *file, int line) {
+    idx = aputil_bounds(idx, v->size, file, line);
+    return (v->data[idx / 64] >> (idx % 64)) & 1;
+}
+#define vector_at(v, idx) aputil_vector_at((v), (idx), __FILE__, __LINE__)
+#define vec_i32_at(v, idx) aputil_vec_i32_at((v), (idx), __FILE__, __LINE__)
+#define vec_char_at(v, idx) aputil_vec_char_at((v), (idx), __FILE__, __LINE__)
+#define vec_bit_test(v, idx) aputil_vec_bit_test((v), (idx), __FILE__, __LINE__)
+#else
+#define APUTIL_IDX(idx, size) (idx)
+
+// address of element idx
+static inline void *vector_at(const Vector *v, size_t idx) {
+    return (char*)v->data + idx * v->elem_size;
+}
+static inline int32_t vec_i32_at(const Vec_i32 *v, size_t idx) {
+    return v->data[idx];
+}
+static inline char vec_char_at(const Vec_char *v, size_t idx) {
+    return v->data[idx];
+}
+static inline bool vec_bit_test(const Vec_bit *v, size_t idx) {
+    return (v->data[idx / 64] >> (idx % 64)) & 1;
+}
+#endif
+
+// element idx as an lvalue, the vector expression is evaluated more than once
+#define VECTOR_AT(v, type, idx) (*(type*)vector_at((v), (idx)))
+#define VEC_I32_AT(v, idx) ((v)->data[APUTIL_IDX((idx), (v)->size)])
+#define VEC_CHAR_AT(v, idx) ((v)->data[APUTIL_IDX((idx), (v)->size)])
+
+// loop it (a type pointer) over every element, type must match elem_size
+#define VECTOR_FOREACH(v, type, it) \
+    for (type *it = (type*)(v)->data, *it##_end = it + (v)->size; it < it##_end; it++)
+#define VEC_I32_FOREACH(v, it) \
+    for (int32_t *it = (v)->data, *it##_end = it + (v)->size; it < it##_end; it++)
+#define VEC_CHAR_FOREACH(v, it) \
+    for (char *it = (v)->data, *it##_end = it + (v)->size; it < it##_end; it++)
+
+//////////////////// unchecked access ////////////////////
+
+//////////////////// sorting ////////////////////
 UTIL_ERR vector_sort(void *vec, VECTYPE type, int (*compare)(const void*, const void*));
 
+// stable sort (TimSort: natural runs, galloping merges), same dispatch as vector_sort
+UTIL_ERR vector_stable_sort(void *vec, VECTYPE type, int (*compare)(const void*, const void*));
+// stable sort taking its merge buffer from scratch (grown as needed, reuse across calls)
+UTIL_ERR vector_stable_sort_buf(void *vec, VECTYPE type, int (*compare)(const void*, const void*), Vec_char *scratch);
+
+// permutation (as indices) that stably sorts v, v is untouched
+Vec_i32 *vector_argsort(const Vector *v, int (*compare)(const void*, const void*), UTIL_ERR *e);
+// reorder v so element i becomes the old element perm[i] (single gather pass)
+UTIL_ERR vector_apply_perm(Vector *v, const Vec_i32 *perm);
+// stable radix sort by an unsigned key extracted once per element, records are
+// moved once. for signed keys return (uint32_t)x ^ 0x80000000 (or the 64-bit equivalent)
+UTIL_ERR vector_sort_key32(Vector *v, uint32_t (*key)(const void*));
+UTIL_ERR vector_sort_key64(Vector *v, uint64_t (*key)(const void*));
+// permutation that stably sorts v by the extracted key, v is untouched
+Vec_i32 *vector_argsort_key32(const Vector *v, uint32_t (*key)(const void*), UTIL_ERR *e);
+
+// merge k sorted vectors into a new vector sized for the total (loser tree, stable)
+Vector *vector_merge_k(Vector *const *vs, size_t k, int (*compare)(const void*, const void*), UTIL_ERR *e);
+// merge k sorted i32 vectors, NULL compare uses natural int order
+Vec_i32 *vec_i32_merge_k(Vec_i32 *const *vs, size_t k, int (*compare)(const void*, const void*), UTIL_ERR *e);
+
+// selection (src/sorting.c), "smallest" is relative to compare
+// place the element that would sit at index n after a full sort at index n,
+// smaller elements before it and larger after it, O(n) expected (introselect)
+UTIL_ERR vector_nth_element(Vector *v, size_t n, int (*compare)(const void*, const void*));
+// sort only the first k elements (the k smallest), rest in unspecified order, O(n + k log k)
+UTIL_ERR vector_partial_sort(Vector *v, size_t k, int (*compare)(const void*, const void*));
+// return a new vector of the k smallest elements in sorted order, O(n log k), v is untouched
+Vector *vector_top_k(const Vector *v, size_t k, int (*compare)(const void*, const void*), UTIL_ERR *e);
+// i32 versions, NULL compare uses natural int order
+UTIL_ERR vec_i32_nth_element(Vec_i32 *v, size_t n, int (*compare)(const void*, const void*));
+UTIL_ERR vec_i32_partial_sort(Vec_i32 *v, size_t k, int (*compare)(const void*, const void*));
+Vec_i32 *vec_i32_top_k(const Vec_i32 *v, size_t k, int (*compare)(const void*, const void*), UTIL_ERR *e);
+
+// sorting networks (src/sortnet.c), ascending by value without a compare callback
+// branchless networks for tiny sizes, AVX2 bitonic up to SORTNET_MAX (scalar
+// networks without AVX2), qsort beyond
+enum sortnet_type {
+    sn_i32 = 0,
+    sn_u32 = 1,
+    sn_i64 = 2,
+    sn_u64 = 3,
+};
+typedef enum sortnet_type SNTYPE;
+#define SORTNET_MAX 256
+
+// sort n elements of type at data in place
+UTIL_ERR sortnet_sort(void *data, size_t n, SNTYPE type);
+// sort each segment [bounds[i], bounds[i + 1]) independently, bounds holds nseg + 1 offsets
+UTIL_ERR sortnet_sort_segments(void *data, const size_t *bounds, size_t nseg, SNTYPE type);
+UTIL_ERR vec_i32_sort_net(Vec_i32 *v);
+UTIL_ERR vec_i32_sort_segments(Vec_i32 *v, const size_t *bounds, size_t nseg);
+// 4 and 8 byte elements compared as type, E_BAD_TYPE if elem_size doesn't match
+UTIL_ERR vector_sort_net(Vector *v, SNTYPE type);
+UTIL_ERR vector_sort_segments(Vector *v, SNTYPE type, const size_t *bounds, size_t nseg);
+
+//////////////////// sorting ////////////////////
+
+//////////////////// searching ////////////////////
+// searches over vectors already sorted ascending (src/search.c), branchless:
+// the loop runs a fixed log2(n) steps whatever the keys, each step a
+// conditional add instead of a hard to predict branch, the two possible next
+// probes are prefetched. i32 uses natural int order, generic vectors compare
+
+// first index whose element is not less than key (size when there is none)
+size_t vec_i32_lower_bound(const Vec_i32 *v, int32_t key);
+// first index whose element is greater than key (size when there is none)
+size_t vec_i32_upper_bound(const Vec_i32 *v, int32_t key);
+// index of the first element equal to key, otherwise -1
+intmax_t vec_i32_bsearch(const Vec_i32 *v, int32_t key, UTIL_ERR *e);
+size_t vector_lower_bound(const Vector *v, const void *key, int (*compare)(const void*, const void*));
+size_t vector_upper_bound(const Vector *v, const void *key, int (*compare)(const void*, const void*));
+intmax_t vector_bsearch(const Vector *v, const void *key, int (*compare)(const void*, const void*), UTIL_ERR *e);
+
+// Eytzinger index: a copy of the sorted elements in BFS order (node k has
+// children 2k and 2k + 1), the first levels share a few cache lines and the
+// 16 (i32) descendants four levels down share one, which is prefetched. for
+// searches of large vectors that are bound by cache misses, same answers as
+// the functions above (indices into the sorted vector). the copy doesn't
+// follow later changes to the vector, rebuild after
+typedef struct {
+    int32_t *tree;          // n + 1 slots, tree[0] unused, cache line aligned
+    size_t n;
+    unsigned height;        // levels, the last one possibly partial
+} Eytz_i32;
+
+typedef struct {
+    char *tree;
+    size_t n;
+    unsigned height;
+    size_t elem_size;
+    size_t prefetch;        // levels ahead whose descendants fit a cache line
+    int (*compare)(const void*, const void*);
+} Eytz;
+
+// caller checks NULL
+Eytz_i32 *eytz_i32_new(const Vec_i32 *sorted);
+void eytz_i32_free(Eytz_i32 *t);
+size_t eytz_i32_lower_bound(const Eytz_i32 *t, int32_t key);
+size_t eytz_i32_upper_bound(const Eytz_i32 *t, int32_t key);
+intmax_t eytz_i32_bsearch(const Eytz_i32 *t, int32_t key);
+// caller checks NULL
+Eytz *eytz_new(const Vector *sorted, int (*compare)(const void*, const void*));
+void eytz_free(Eytz *t);
+size_t eytz_lower_bound(const Eytz *t, const void *key);
+size_t eytz_upper_bound(const Eytz *t, const void *key);
+intmax_t eytz_bsearch(const Eytz *t, const void *key);
+
+//////////////////// searching ////////////////////
+
 // ########################### VECTORS ###########################
 
 
@@ -189,6 +486,7 @@ typedef struct aputil_node {
     void *data;
     struct aputil_node *next;
     struct aputil_node *prev;
+    struct aputil_node_slab *slab;      // batch the node was allocated in, NULL if alone
 } APUTIL_Node;
 
 typedef struct {
@@ -216,10 +514,19 @@ UTIL_ERR aputil_llist_push(APUTIL_LList*, void*);
 void *aputil_llist_pop(APUTIL_LList*, UTIL_ERR*);
 // add node to back (new tail)
 UTIL_ERR aputil_llist_push_back(APUTIL_LList*, void*);
+// push n elements to the back, the nodes share one allocation (freed with the last of them)
+UTIL_ERR aputil_llist_push_back_n(APUTIL_LList*, void *const *elems, size_t n);
 // return data from tail node and remove from list
 void *aputil_llist_pop_back(APUTIL_LList*, UTIL_ERR*);
 // delete provded node
 UTIL_ERR aputil_llist_delete(APUTIL_LList*, APUTIL_Node*, bool preserve);
+// O(1) detach of a node known to be in the list, neither node nor data is freed
+UTIL_ERR aputil_llist_unlink(APUTIL_LList*, APUTIL_Node*);
+// link a caller made node in as the new head. the list releases nodes with a NULL slab
+// through free(), so such a node should start a block from malloc
+UTIL_ERR aputil_llist_link_front(APUTIL_LList*, APUTIL_Node*);
+// O(1) move of a node known to be in the list to the head
+UTIL_ERR aputil_llist_move_front(APUTIL_LList*, APUTIL_Node*);
 // shallow copy node and return new node allocation
 APUTIL_Node *aputil_llist_copy_node(const APUTIL_LList *, const APUTIL_Node*, bool deep, UTIL_ERR*);
 // copy list and return new allocation
@@ -246,12 +553,1116 @@ UTIL_ERR aputil_llist_reverse(APUTIL_LList *lst);
 
 // sort the list in-place using iterative merge sort with runs
 void merge_sort(APUTIL_LList *lst);
+// merge k sorted lists by relinking their nodes into a new list (compare from lsts[0])
+// the source lists are left empty but not freed
+APUTIL_LList *aputil_llist_merge_k(APUTIL_LList **lsts, size_t k, UTIL_ERR *e);
 
 // ########################### Linked Lists ###########################
 
+// ########################### Deques ###########################
+/*
+ *  circular buffer deques
+ *      > O(1) amortized push/pop at both ends, O(1) random access
+ *      > data holds up to two contiguous spans, see *_spans
+ *      > conversion to and from vectors moves the buffer, not the elements
+ */
+
+//////////////////// generic deque ////////////////////
+typedef struct {
+    void *data;
+    size_t head;        // slot of the first element
+    size_t size;
+    size_t cap;
+    size_t elem_size;
+} Deque;
+
+// make a new generic deque (element size, starting capacity)
+Deque *deque_new(size_t elem_size, size_t cap);
+// free the deque and its data
+void deque_free(Deque *d);
+
+// add an element to the back of the deque (Deque, address of element)
+UTIL_ERR deque_push_back(Deque *d, const void *elem);
+// add an element to the front of the deque (Deque, address of element)
+UTIL_ERR deque_push_front(Deque *d, const void *elem);
+// remove the back element, copying it to out if not NULL
+UTIL_ERR deque_pop_back(Deque *d, void *out);
+// remove the front element, copying it to out if not NULL
+UTIL_ERR deque_pop_front(Deque *d, void *out);
+// return the address of the element at logical index
+void *deque_get(const Deque *d, size_t idx, UTIL_ERR *e);
+// set size to 0
+UTIL_ERR deque_clear(Deque *d);
+
+// contiguous spans making up the deque in order, returns the number of non-empty spans
+size_t deque_spans(const Deque *d, void **first, size_t *first_len, void **second, size_t *second_len);
+// rotate storage so the front element is at data[0]
+UTIL_ERR deque_make_contiguous(Deque *d);
+// build a deque on the vector's buffer, v is consumed (container freed)
+Deque *deque_from_vector(Vector *v);
+// hand the deque's buffer to a new vector, d is consumed (container freed)
+Vector *deque_to_vector(Deque *d);
+
+//////////////////// generic deque ////////////////////
+
+
+//////////////////// int32 deque ////////////////////
+typedef struct {
+    int32_t *data;
+    size_t head;
+    size_t size;
+    size_t cap;
+} Deque_i32;
+
+// make a new i32 deque (starting capacity)
+Deque_i32 *deque_i32_new(size_t cap);
+// free the deque and its data
+void deque_i32_free(Deque_i32 *d);
+
+// add an element to the back of the deque
+UTIL_ERR deque_i32_push_back(Deque_i32 *d, int32_t elem);
+// add an element to the front of the deque
+UTIL_ERR deque_i32_push_front(Deque_i32 *d, int32_t elem);
+// remove and return the back element (errors handled through UTIL_ERR pointer)
+int32_t deque_i32_pop_back(Deque_i32 *d, UTIL_ERR *e);
+// remove and return the front element (errors handled through UTIL_ERR pointer)
+int32_t deque_i32_pop_front(Deque_i32 *d, UTIL_ERR *e);
+// return the element at logical index (errors handled through UTIL_ERR pointer)
+int32_t deque_i32_get(const Deque_i32 *d, size_t idx, UTIL_ERR *e);
+// set size to 0
+void deque_i32_clear(Deque_i32 *d);
+
+// contiguous spans making up the deque in order, returns the number of non-empty spans
+size_t deque_i32_spans(const Deque_i32 *d, int32_t **first, size_t *first_len, int32_t **second, size_t *second_len);
+// rotate storage so the front element is at data[0]
+UTIL_ERR deque_i32_make_contiguous(Deque_i32 *d);
+// build a deque on the vector's buffer, v is consumed (container freed)
+Deque_i32 *deque_i32_from_vec(Vec_i32 *v);
+// hand the deque's buffer to a new vector, d is consumed (container freed)
+Vec_i32 *deque_i32_to_vec(Deque_i32 *d);
+
+//////////////////// int32 deque ////////////////////
+
+// ########################### Deques ###########################
+
+// ########################### Heaps ###########################
+/*
+ *  priority queues as implicit d-ary heaps on vector storage
+ *      > min-heap unless max is set (top is the element that sorts first)
+ *      > arity 2 is a binary heap, 4 is shallower and more cache friendly
+ *      > *_from_vec/_vector heapify in O(n) and take ownership of the vector
+ */
+
+//////////////////// generic heap ////////////////////
+typedef struct {
+    Vector *vec;
+    void *tmp;                                  // scratch element used while sifting
+    int (*compare)(const void*, const void*);
+    size_t arity;
+    bool max;
+} Heap;
+
+// make a new heap (element size, starting capacity, compare, max-heap, arity)
+Heap *heap_new(size_t elem_size, size_t cap, int (*compare)(const void*, const void*), bool max, size_t arity);
+// heapify the vector in place and wrap it, v is owned by the heap afterwards
+Heap *heap_from_vector(Vector *v, int (*compare)(const void*, const void*), bool max, size_t arity);
+// free the heap and its vector
+void heap_free(Heap *h);
+
+// restore heap order over the whole vector, O(n)
+UTIL_ERR heap_heapify(Heap *h);
+// copy an element into the heap
+UTIL_ERR heap_push(Heap *h, const void *elem);
+// remove the top element, copying it to out if not NULL
+UTIL_ERR heap_pop(Heap *h, void *out);
+// return the address of the top element
+void *heap_peek(const Heap *h, UTIL_ERR *e);
+// pop the top and push elem in a single sift (out may be NULL)
+UTIL_ERR heap_replace_top(Heap *h, const void *elem, void *out);
+// streaming top-k: keep at most k elements, a full heap only admits elem if it
+// ranks below the top (max-heap keeps the k smallest), E_NOOP when discarded
+UTIL_ERR heap_push_bounded(Heap *h, const void *elem, size_t k);
+// number of elements in the heap
+size_t heap_size(const Heap *h);
+
+//////////////////// generic heap ////////////////////
+
+
+//////////////////// int32 heap ////////////////////
+typedef struct {
+    Vec_i32 *vec;
+    int (*compare)(const void*, const void*);   // NULL for natural int order
+    size_t arity;
+    bool max;
+} Heap_i32;
+
+// make a new i32 heap (starting capacity, optional compare, max-heap, arity)
+Heap_i32 *heap_i32_new(size_t cap, int (*compare)(const void*, const void*), bool max, size_t arity);
+// heapify the vector in place and wrap it, v is owned by the heap afterwards
+Heap_i32 *heap_i32_from_vec(Vec_i32 *v, int (*compare)(const void*, const void*), bool max, size_t arity);
+// free the heap and its vector
+void heap_i32_free(Heap_i32 *h);
+
+// restore heap order over the whole vector, O(n)
+UTIL_ERR heap_i32_heapify(Heap_i32 *h);
+// push an element
+UTIL_ERR heap_i32_push(Heap_i32 *h, int32_t elem);
+// remove and return the top element (errors handled through UTIL_ERR pointer)
+int32_t heap_i32_pop(Heap_i32 *h, UTIL_ERR *e);
+// return the top element (errors handled through UTIL_ERR pointer)
+int32_t heap_i32_peek(const Heap_i32 *h, UTIL_ERR *e);
+// pop the top and push elem in a single sift, returns the old top
+int32_t heap_i32_replace_top(Heap_i32 *h, int32_t elem, UTIL_ERR *e);
+// streaming top-k: keep at most k elements, see heap_push_bounded
+UTIL_ERR heap_i32_push_bounded(Heap_i32 *h, int32_t elem, size_t k);
+// number of elements in the heap
+size_t heap_i32_size(const Heap_i32 *h);
+
+//////////////////// int32 heap ////////////////////
+
+
+//////////////////// indexed heap ////////////////////
+typedef struct {
+    Vec_i32 *heap;      // ids in heap order
+    int32_t *prio;      // priority by id
+    size_t *pos;        // heap position by id (SIZE_MAX when not queued)
+    size_t n_ids;
+    size_t arity;
+    bool max;
+} Heap_idx;
+
+// make a new indexed heap for ids in [0, n_ids)
+Heap_idx *heap_idx_new(size_t n_ids, bool max, size_t arity);
+// free the heap
+void heap_idx_free(Heap_idx *h);
+
+// is the id currently queued
+bool heap_idx_contains(const Heap_idx *h, size_t id);
+// queue id with priority, E_NOOP if already queued
+UTIL_ERR heap_idx_push(Heap_idx *h, size_t id, int32_t prio);
+// remove and return the top id, its priority is written to prio if not NULL
+size_t heap_idx_pop(Heap_idx *h, int32_t *prio, UTIL_ERR *e);
+// return the top id, its priority is written to prio if not NULL
+size_t heap_idx_peek(const Heap_idx *h, int32_t *prio, UTIL_ERR *e);
+// move a queued id toward the top (lower prio for a min-heap), E_NOOP otherwise
+UTIL_ERR heap_idx_decrease_key(Heap_idx *h, size_t id, int32_t prio);
+// set a queued id's priority in either direction
+UTIL_ERR heap_idx_update(Heap_idx *h, size_t id, int32_t prio);
+// remove a queued id
+UTIL_ERR heap_idx_remove(Heap_idx *h, size_t id);
+// number of queued ids
+size_t heap_idx_size(const Heap_idx *h);
+
+//////////////////// indexed heap ////////////////////
+
+// ########################### Heaps ###########################
+
+// ########################### Ring Buffers ###########################
+/*
+ *  single-producer/single-consumer ring buffers
+ *      > one thread pushes, one thread pops, no locks
+ *      > capacity is rounded up to a power of two
+ *      > head and tail live on separate cache lines, each side keeps a
+ *        cached copy of the other side's index to avoid cache line ping-pong
+ */
+
+//////////////////// generic ring ////////////////////
+typedef struct {
+    _Alignas(APUTIL_CACHE_LINE) _Atomic size_t tail;   // producer: next slot to write
+    size_t head_cache;                                  // producer: last seen head
+    _Alignas(APUTIL_CACHE_LINE) _Atomic size_t head;   // consumer: next slot to read
+    size_t tail_cache;                                  // consumer: last seen tail
+    _Alignas(APUTIL_CACHE_LINE) void *data;
+    size_t cap;
+    size_t mask;
+    size_t elem_size;
+} Ring;
+
+// make a new ring (element size, capacity rounded up to a power of two)
+Ring *ring_new(size_t elem_size, size_t cap);
+// free the ring and its data
+void ring_free(Ring *r);
+// number of elements currently in the ring (exact only when both sides are idle)
+size_t ring_size(const Ring *r);
+
+// copy an element into the ring (producer only), E_FULL if no room
+UTIL_ERR ring_push(Ring *r, const void *elem);
+// copy the oldest element out of the ring (consumer only), E_NODATA if empty
+UTIL_ERR ring_pop(Ring *r, void *out);
+// push up to n contiguous elements, returns the number pushed
+size_t ring_push_n(Ring *r, const void *elems, size_t n);
+// pop up to n elements into out, returns the number popped
+size_t ring_pop_n(Ring *r, void *out, size_t n);
+
+//////////////////// generic ring ////////////////////
+
+
+//////////////////// int32 ring ////////////////////
+typedef struct {
+    _Alignas(APUTIL_CACHE_LINE) _Atomic size_t tail;
+    size_t head_cache;
+    _Alignas(APUTIL_CACHE_LINE) _Atomic size_t head;
+    size_t tail_cache;
+    _Alignas(APUTIL_CACHE_LINE) int32_t *data;
+    size_t cap;
+    size_t mask;
+} Ring_i32;
+
+// make a new i32 ring (capacity rounded up to a power of two)
+Ring_i32 *ring_i32_new(size_t cap);
+// free the ring and its data
+void ring_i32_free(Ring_i32 *r);
+// number of elements currently in the ring (exact only when both sides are idle)
+size_t ring_i32_size(const Ring_i32 *r);
+
+// push an element (producer only), E_FULL if no room
+UTIL_ERR ring_i32_push(Ring_i32 *r, int32_t elem);
+// pop the oldest element (consumer only), errors handled through UTIL_ERR pointer
+int32_t ring_i32_pop(Ring_i32 *r, UTIL_ERR *e);
+// push up to n elements, returns the number pushed
+size_t ring_i32_push_n(Ring_i32 *r, const int32_t *elems, size_t n);
+// pop up to n elements into out, returns the number popped
+size_t ring_i32_pop_n(Ring_i32 *r, int32_t *out, size_t n);
+
+//////////////////// int32 ring ////////////////////
+
+// ########################### Ring Buffers ###########################
+
+// ########################### Thread Pool ###########################
+/*
+ *  fixed pthread pool running fork-join batches of indexed tasks
+ *      > the thread calling pool_run is worker 0 and works on the batch too
+ *      > one batch at a time, concurrent pool_run calls are serialized
+ *      > a task calling pool_run or a *_par operation on its own pool runs
+ *        that nested batch inline on its thread (same worker index)
+ *      > *_par vector operations give the same result as their serial versions
+ */
+
+#define POOL_MIN_CHUNK 4096             // bytes, smaller chunks cost more than they save
+#define POOL_CHUNKS_PER_THREAD 4
+
+typedef struct {
+    pthread_t tid;
+    struct APUTIL_Pool *pool;
+    size_t id;
+} APUTIL_Pool_worker;
+
+typedef struct APUTIL_Pool {
+    APUTIL_Pool_worker *workers;
+    size_t n_threads;           // workers including the calling thread
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;     // new batch or stop
+    pthread_cond_t done_cv;     // last worker left the batch
+    pthread_mutex_t run_lock;   // one batch at a time
+    size_t generation;          // batch counter, workers wait for it to move
+    size_t active;              // workers still in the current batch
+    bool stop;
+    void (*task)(void *ctx, size_t idx, size_t worker);
+    void *ctx;
+    size_t n_tasks;
+    _Atomic size_t next;        // next task index to hand out
+} APUTIL_Pool;
+
+// make a pool of n_threads workers (calling thread included), 0 for one per online cpu
+APUTIL_Pool *pool_new(size_t n_threads);
+// stop and join the workers, free the pool
+void pool_free(APUTIL_Pool *p);
+// number of workers including the calling thread
+size_t pool_threads(const APUTIL_Pool *p);
+// run task(ctx, idx, worker) for idx in [0, n_tasks) on the pool, returns when all finished
+// worker is in [0, pool_threads) and unique among concurrently running tasks
+UTIL_ERR pool_run(APUTIL_Pool *p, size_t n_tasks, void (*task)(void *ctx, size_t idx, size_t worker), void *ctx);
+
+// map in place over cache line aligned chunks, mapfunc must be thread safe
+UTIL_ERR vector_map_par(APUTIL_Pool *p, Vector *v, void(*mapfunc)(void*));
+UTIL_ERR vec_i32_map_par(APUTIL_Pool *p, Vec_i32 *v, void(*mapfunc)(int32_t*));
+// filter into a new vector, chunks filter into their own buffers which are joined in order
+Vector *vector_filter_par(APUTIL_Pool *p, const Vector *v, bool(*filter)(void*), UTIL_ERR *e);
+Vec_i32 *vec_i32_filter_par(APUTIL_Pool *p, const Vec_i32 *v, bool(*filter)(int32_t), UTIL_ERR *e);
+// parallel vector_reduce: acc holds the identity on entry and the result on return,
+// each chunk folds into its own copy of it, partials are merged in order with combine(acc, part)
+// so combine only needs to be associative
+UTIL_ERR vector_reduce_par(APUTIL_Pool *p, const Vector *v, void *acc, size_t acc_size,
+                           void (*reduce)(void *acc, const void *elem),
+                           void (*combine)(void *acc, const void *part));
+// grow to n elements (capacity included) zero filled by the pool workers, so pages are
+// first touched, and placed by the kernel, on the nodes of the threads that later work
+// on them instead of all on the caller's node. elements already held are kept
+UTIL_ERR vector_touch_par(APUTIL_Pool *p, Vector *v, size_t n);
+UTIL_ERR vec_i32_touch_par(APUTIL_Pool *p, Vec_i32 *v, size_t n);
+
+// ########################### Thread Pool ###########################
+
+// ########################### Task Scheduler ###########################
+/*
+ *  work-stealing scheduler for recursive fork-join code
+ *      > inside sched_run, sched_spawn queues fn(arg) on the current worker's
+ *        deque where idle workers can steal it, sched_sync waits for every
+ *        task spawned into the group and runs other tasks meanwhile
+ *      > a task must sync the groups it spawned into before returning, arg
+ *        may then live on the spawning task's stack
+ *      > outside of a run, spawn calls fn directly
+ */
+
+typedef struct {
+    _Atomic size_t pending;     // spawned tasks not finished yet
+} APUTIL_Sync;
+#define APUTIL_SYNC_INIT { 0 }
+
+typedef struct APUTIL_Sched {
+    struct sched_worker *workers;   // per worker deque and task records (src/sched.c)
+    size_t n_workers;               // including the thread calling sched_run
+    size_t n_started;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;
+    pthread_mutex_t run_lock;       // one run at a time
+    bool active;
+    bool stop;
+    _Atomic bool running;           // workers steal while set
+} APUTIL_Sched;
+
+// make a scheduler with n_workers (calling thread included), 0 for one per online cpu
+APUTIL_Sched *sched_new(size_t n_workers);
+// stop and join the workers, free the scheduler
+void sched_free(APUTIL_Sched *s);
+// number of workers including the calling thread
+size_t sched_workers(const APUTIL_Sched *s);
+// run fn(arg) as the root task, returns once it (and so everything it synced) finished
+UTIL_ERR sched_run(APUTIL_Sched *s, void (*fn)(void*), void *arg);
+// queue fn(arg) as part of grp
+void sched_spawn(APUTIL_Sync *grp, void (*fn)(void*), void *arg);
+// wait until every task spawned into grp finished, executing queued tasks meanwhile
+void sched_sync(APUTIL_Sync *grp);
+// id of the worker running the caller, in [0, sched_workers), 0 outside a run
+size_t sched_worker_id(void);
+
+// parallel stable merge sort (src/sorting.c), same dispatch as vector_sort, NULL s sorts serially
+UTIL_ERR vector_sort_par(APUTIL_Sched *s, void *vec, VECTYPE type, int (*compare)(const void*, const void*));
+// stable parallel sort of a list by lst->compare, the data pointers are reordered over the nodes
+UTIL_ERR merge_sort_par(APUTIL_Sched *s, APUTIL_LList *lst);
+
+// ########################### Task Scheduler ###########################
+
+// ########################### External Sort ###########################
+/*
+ *  out-of-core merge sort for files of fixed-size records
+ *      > chunks of at most mem_budget bytes are sorted in memory and spilled
+ *        as runs to unlinked temp files in tmp_dir
+ *      > runs are k-way merged with a read-ahead buffer each, in more than
+ *        one pass when the budget can't buffer all of them at once
+ */
+
+#define EXTSORT_DEFAULT_BUDGET ((size_t)64 << 20)
+#define EXTSORT_MIN_READAHEAD ((size_t)64 << 10)   // smallest per-run merge buffer
+
+typedef struct {
+    size_t mem_budget;      // bytes for chunks and merge buffers, 0 for EXTSORT_DEFAULT_BUDGET
+    const char *tmp_dir;    // directory for runs, NULL for $TMPDIR or /tmp
+    bool stable;            // chunks use vector_stable_sort, equal records keep input order
+} Extsort_opts;
+
+// sort the records of in_path into out_path (opts may be NULL)
+// out_path is replaced through a temp file and left as it was on failure, in_path may be out_path
+UTIL_ERR extsort_file(const char *in_path, const char *out_path, size_t rec_size, int (*compare)(const void*, const void*), const Extsort_opts *opts);
+// sort the records from in's position to EOF onto out, E_IO on a trailing partial record
+UTIL_ERR extsort_stream(FILE *in, FILE *out, size_t rec_size, int (*compare)(const void*, const void*), const Extsort_opts *opts);
+
+// ########################### External Sort ###########################
+
+
+// ########################### Serialization ###########################
+/*
+ *  binary save / reload (src/serial.c)
+ *      > files are a 64 byte Serial_header followed by the raw payload,
+ *        host byte order, the payload is covered by serial_checksum
+ *      > loads validate the header and checksum, E_CORRUPT on mismatch,
+ *        E_BAD_TYPE when the file holds a different container
+ */
+
+enum serial_type {
+    ser_vector = 1,
+    ser_vec_i32 = 2,
+    ser_llist = 3,
+    ser_bloom = 4,
+    ser_cuckoo = 5,
+};
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t type;              // enum serial_type
+    uint64_t elem_size;         // bytes per element, 0 for lists
+    uint64_t count;             // elements or list nodes
+    uint64_t data_bytes;        // payload size
+    uint64_t checksum;          // serial_checksum of the payload
+    uint64_t reserved[2];       // pads the header to 64 bytes, payload starts cache line aligned
+} Serial_header;
+
+// 64-bit checksum of n bytes (four lane multiply-rotate, several bytes per cycle)
+uint64_t serial_checksum(const void *data, size_t n);
+
+// write header + data with one writev to a temp file renamed over path, path is left as it was on failure
+UTIL_ERR vector_save(const Vector *v, const char *path);
+UTIL_ERR vec_i32_save(const Vec_i32 *v, const char *path);
+// read a saved vector into new storage sized for it
+Vector *vector_load(const char *path, UTIL_ERR *e);
+Vec_i32 *vec_i32_load(const char *path, UTIL_ERR *e);
+
+// zero-copy load: vec points into a private copy-on-write mapping of the file
+// in place changes (sort, map, ...) work and are never written back, anything
+// that reallocates or frees vec.data must not be used on it
+typedef struct {
+    Vector vec;
+    void *map;
+    size_t map_len;
+} Vector_mapped;
+
+typedef struct {
+    Vec_i32 vec;
+    void *map;
+    size_t map_len;
+} Vec_i32_mapped;
+
+// map a saved vector, verify reads the payload once to check the checksum
+Vector_mapped *vector_mmap(const char *path, bool verify, UTIL_ERR *e);
+void vector_munmap(Vector_mapped*);
+Vec_i32_mapped *vec_i32_mmap(const char *path, bool verify, UTIL_ERR *e);
+void vec_i32_munmap(Vec_i32_mapped*);
+
+// save list data through serialize, which appends the bytes of one element to out
+UTIL_ERR aputil_llist_save(const APUTIL_LList *lst, const char *path, UTIL_ERR (*serialize)(const void *data, Vec_char *out));
+// append the saved elements to lst, deserialize returns new data from len bytes
+// (8 byte aligned), NULL fails the load and frees what was already made (lst->free)
+UTIL_ERR aputil_llist_load(APUTIL_LList *lst, const char *path, void *(*deserialize)(const void *bytes, size_t len));
+
+// ########################### Serialization ###########################
+
+// ########################### Hashing ###########################
+/*
+ *  64-bit non-cryptographic hashes (src/hash.c)
+ *      > byte spans: wyhash (final 4) style, 128-bit multiply folding over 48
+ *        byte stripes in three independent lanes, short keys in a couple of
+ *        loads; well above memory bandwidth for large buffers
+ *      > the streaming state gives the same result as the one-shot call for
+ *        the same bytes, however they are split into updates
+ *      > integer mixers are a few multiply-xorshift steps, for hashing keys
+ *        that are already numbers
+ *      > hash_bytes uses a fixed seed so results are stable between runs,
+ *        tables exposed to untrusted keys should hash with a per-process
+ *        seed from hash_random_seed (HashDoS)
+ *      > not for checksums on disk (serial_checksum) or anything cryptographic
+ */
+
+#define HASH_DEFAULT_SEED 0x243f6a8885a308d3ull
+#define HASH_STRIPE 48                  // bytes per round of the three lanes
+
+// hash of n bytes with seed
+uint64_t hash_bytes_seed(const void *key, size_t n, uint64_t seed);
+// hash_bytes_seed with HASH_DEFAULT_SEED, used wherever a NULL hash callback is given
+uint64_t hash_bytes(const void *key, size_t n);
+// seed from the kernel's random source (time and address mixed when that fails)
+uint64_t hash_random_seed(void);
+
+// integer mixers, bijective for a fixed seed so distinct keys never collide
+uint64_t hash_u64(uint64_t x, uint64_t seed);
+uint64_t hash_i32(int32_t x, uint64_t seed);
+
+// contents of a vector, elements in order
+uint64_t vec_char_hash(const Vec_char *v, uint64_t seed);
+uint64_t vec_i32_hash(const Vec_i32 *v, uint64_t seed);
+uint64_t vector_hash(const Vector *v, uint64_t seed);
+// one element's bytes, 0 when idx is out of bounds
+uint64_t vector_elem_hash(const Vector *v, size_t idx, uint64_t seed);
+
+//////////////////// streaming ////////////////////
+typedef struct {
+    uint64_t seed;                      // as given to hash_init
+    uint64_t lane[3];                   // stripe accumulators
+    uint64_t len;                       // bytes so far
+    size_t n_buf;
+    bool striped;                       // at least one stripe consumed
+    unsigned char buf[HASH_STRIPE];     // held back until more bytes follow it
+    unsigned char last[16];             // end of the last stripe, the tail may read into it
+} Hash_state;
+
+void hash_init(Hash_state *st, uint64_t seed);
+void hash_update(Hash_state *st, const void *data, size_t n);
+// hash of everything passed to update, the state may be updated further
+uint64_t hash_final(const Hash_state *st);
+
+//////////////////// streaming ////////////////////
+
+// ########################### Hashing ###########################
+
 // ########################### Hash Table ###########################
+/*
+ *  hash sets and a concurrent map (src/hashtbl.c)
+ *      > open addressing with Robin Hood linear probing: an insert takes the
+ *        slot of any key sitting closer to its home than the new key would,
+ *        so probe lengths stay short and lookups stop early
+ *      > deletion shifts the following keys back, no tombstones
+ *      > capacity is a power of two, grown before the load passes 7/8
+ *      > iteration order is unspecified
+ */
+
+#define HASHSET_MAX_LOAD_NUM 7
+#define HASHSET_MAX_LOAD_DEN 8
+
+//////////////////// int32 set ////////////////////
+typedef struct {
+    int32_t *keys;
+    uint8_t *dist;              // probe distance + 1, 0 for an empty slot
+    size_t cap;                 // slots, power of two
+    size_t size;
+    unsigned shift;             // 64 - log2(cap), home slot is the top bits of the mixed key
+} HashSet_i32;
+
+// make a set with room for at least n keys (0 for a small default), caller checks NULL
+HashSet_i32 *hashset_i32_new(size_t n);
+void hashset_i32_free(HashSet_i32*);
+// E_SUCCESS when added, E_NOOP when already present
+UTIL_ERR hashset_i32_insert(HashSet_i32 *s, int32_t key);
+bool hashset_i32_contains(const HashSet_i32 *s, int32_t key);
+// E_DOESNT_EXIST when not present
+UTIL_ERR hashset_i32_remove(HashSet_i32 *s, int32_t key);
+// grow so n keys fit without further rehashing
+UTIL_ERR hashset_i32_reserve(HashSet_i32 *s, size_t n);
+void hashset_i32_clear(HashSet_i32 *s);
+// insert every element, reserving once for the worst case (all distinct)
+UTIL_ERR hashset_i32_insert_from_vec(HashSet_i32 *s, const Vec_i32 *v);
+// the keys in slot order
+Vec_i32 *hashset_i32_to_vec(const HashSet_i32 *s, UTIL_ERR *e);
+// distinct elements of v in first occurrence order, O(n) expected
+Vec_i32 *vec_i32_unique(const Vec_i32 *v, UTIL_ERR *e);
+
+//////////////////// int32 set ////////////////////
+
+
+//////////////////// generic set ////////////////////
+typedef struct {
+    char *keys;                 // cap * elem_size, keys are stored inline
+    uint64_t *hashes;           // cached hash per slot, rehash and compare without callbacks
+    uint8_t *dist;              // probe distance + 1, 0 for an empty slot
+    char *tmp;                  // two keys of scratch for displacement
+    size_t cap;
+    size_t size;
+    size_t elem_size;
+    unsigned shift;
+    uint64_t (*hash)(const void*);
+    bool (*equal)(const void*, const void*);
+} HashSet;
+
+// make a set of elem_size byte keys, NULL hash / equal hash and compare the raw bytes
+HashSet *hashset_new(size_t elem_size, size_t n, uint64_t (*hash)(const void*), bool (*equal)(const void*, const void*));
+void hashset_free(HashSet*);
+// copies elem_size bytes from key, E_NOOP when already present
+UTIL_ERR hashset_insert(HashSet *s, const void *key);
+bool hashset_contains(const HashSet *s, const void *key);
+UTIL_ERR hashset_remove(HashSet *s, const void *key);
+UTIL_ERR hashset_reserve(HashSet *s, size_t n);
+void hashset_clear(HashSet *s);
+// v->elem_size must match the set, E_BAD_TYPE otherwise
+UTIL_ERR hashset_insert_from_vec(HashSet *s, const Vector *v);
+Vector *hashset_to_vec(const HashSet *s, UTIL_ERR *e);
+// distinct elements of v in first occurrence order (NULL hash / equal as in hashset_new)
+Vector *vector_unique(const Vector *v, uint64_t (*hash)(const void*), bool (*equal)(const void*, const void*), UTIL_ERR *e);
+
+//////////////////// generic set ////////////////////
+
+
+//////////////////// concurrent map ////////////////////
+/*
+ *  sharded map shared between threads
+ *      > a key's hash picks one of n_shards shards, each a Robin Hood table
+ *        with its own writer lock and sequence counter (seqlock)
+ *      > readers take no lock: they probe while the counter is even and
+ *        retry when a writer moved it, read-mostly loads scale with threads
+ *      > writers to different shards never wait on each other
+ *      > keys compare by their bytes, hash (NULL hashes the bytes) must be
+ *        thread safe
+ *      > a grown shard keeps its old table until the map is freed, so a
+ *        reader still probing it never touches freed memory (tables double,
+ *        the retired ones add up to less than the live one)
+ */
+
+#define CMAP_DEFAULT_SHARDS 64
+
+typedef struct cmap_table cmap_table;      // src/hashtbl.c
+
+typedef struct {
+    _Alignas(APUTIL_CACHE_LINE) _Atomic size_t seq;   // odd while a writer is mid update
+    _Atomic(cmap_table*) table;
+    _Atomic size_t size;
+    pthread_mutex_t lock;                   // serializes writers
+    uint64_t *scratch;                      // writer only: carried, swapped and moved entries
+} cmap_shard;
+
+typedef struct {
+    cmap_shard *shards;
+    size_t n_shards;            // power of two
+    size_t key_size;
+    size_t val_size;
+    size_t key_words;           // 8 byte words per key and value, slots store whole words
+    size_t val_words;
+    uint64_t (*hash)(const void*);
+} ConcMap;
+
+// make a map of key_size byte keys to val_size byte values (0 for a set),
+// n_shards is rounded up to a power of two (0 for CMAP_DEFAULT_SHARDS), caller checks NULL
+ConcMap *cmap_new(size_t key_size, size_t val_size, size_t n_shards, uint64_t (*hash)(const void*));
+// no other thread may use the map any more
+void cmap_free(ConcMap *m);
+// lock free, copies the value to val_out when present (NULL to test only),
+// val_out is undefined when false is returned
+bool cmap_get(const ConcMap *m, const void *key, void *val_out);
+// insert or overwrite, E_NOOP when key was present (its value is replaced)
+UTIL_ERR cmap_put(ConcMap *m, const void *key, const void *val);
+// E_DOESNT_EXIST when not present
+UTIL_ERR cmap_remove(ConcMap *m, const void *key);
+// when key is absent make(key, val, arg) fills a zeroed value which is inserted, anything but
+// E_SUCCESS from make aborts and is returned. the stored value (found or made) is copied to
+// val_out (may be NULL), E_NOOP when key was present. make runs under the shard's writer lock
+UTIL_ERR cmap_compute_if_absent(ConcMap *m, const void *key, UTIL_ERR (*make)(const void *key, void *val, void *arg), void *arg, void *val_out);
+// update(val, present, arg) edits the value in place under the shard's writer lock, val is
+// zeroed when key is absent, the result is stored (inserted when absent)
+UTIL_ERR cmap_upsert(ConcMap *m, const void *key, void (*update)(void *val, bool present, void *arg), void *arg);
+// number of keys, exact only while no writer runs
+size_t cmap_size(const ConcMap *m);
+
+//////////////////// concurrent map ////////////////////
+
 // ########################### Hash Table ###########################
 
+// ########################### Caches ###########################
+/*
+ *  bounded key -> data cache (src/cache.c), get / put / evict in O(1)
+ *      > a chained hash index finds the entry, every entry embeds its
+ *        APUTIL_Node so recency is kept by relinking, never allocating
+ *      > lru: one list, hits move to the head, the tail is evicted
+ *      > lfu: one list per use count, ascending; a hit moves the entry to
+ *        the next count's list, the victim is the least recent entry of the
+ *        lowest count (ties go to recency)
+ *      > limits on entries and / or on the bytes the caller charges per entry
+ *      > the cache owns stored data, evicted, replaced and removed data goes
+ *        to the free hook (the same hook the lists use), NULL leaves it alone
+ *      > not thread safe, APUTIL_Cache_sharded locks per shard
+ */
+
+enum cache_policy {
+    cache_lru = 0,
+    cache_lfu = 1,
+};
+typedef enum cache_policy CACHEPOLICY;
+
+#define CACHE_INDEX_INIT 16             // index buckets, power of two
+
+typedef struct aputil_cache_entry {
+    APUTIL_Node node;                       // first, node.data is the cached data
+    struct aputil_cache_entry *chain;       // next entry in the same index bucket
+    struct aputil_cache_freq *freq;         // use count list holding node
+    uint64_t hash;
+    size_t bytes;
+    char key[];
+} APUTIL_Cache_entry;
+
+typedef struct {
+    APUTIL_Cache_entry **index;
+    size_t n_buckets;                   // power of two
+    unsigned shift;
+    struct aputil_cache_freq *freqs;    // lowest use count first, lru has a single one
+    CACHEPOLICY policy;
+    size_t key_size;
+    size_t cnt;
+    size_t bytes;
+    size_t max_entries;                 // 0 for no limit
+    size_t max_bytes;                   // 0 for no limit
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    void (*free)(void*);
+    void *(*copydata)(const void*);
+    uint64_t (*hash)(const void*);
+    bool (*equal)(const void*, const void*);
+} APUTIL_Cache;
+
+// make a cache of key_size byte keys, NULL hash / equal hash and compare the raw bytes,
+// free and copydata work as for lists (copydata is only needed by the sharded get)
+APUTIL_Cache *aputil_cache_new(CACHEPOLICY policy, size_t key_size, size_t max_entries, size_t max_bytes,
+                               void (*free_data)(void*), void *(*copydata)(const void*),
+                               uint64_t (*hash)(const void*), bool (*equal)(const void*, const void*), UTIL_ERR *e);
+// free the cache and, unless preserve, the data through the free hook
+void aputil_cache_free(APUTIL_Cache *c, bool preserve);
+// data stored for key or NULL, a hit counts as a use
+void *aputil_cache_get(APUTIL_Cache *c, const void *key);
+// same without counting as a use
+void *aputil_cache_peek(const APUTIL_Cache *c, const void *key);
+// store data (not NULL) for key charging bytes, evicting as needed. a present key gets the new
+// data, the old goes to the free hook. E_FULL when bytes alone pass max_bytes (data not taken)
+UTIL_ERR aputil_cache_put(APUTIL_Cache *c, const void *key, void *data, size_t bytes);
+// E_DOESNT_EXIST when not present
+UTIL_ERR aputil_cache_remove(APUTIL_Cache *c, const void *key, bool preserve);
+// evict the policy's victim, E_NODATA when empty
+UTIL_ERR aputil_cache_evict(APUTIL_Cache *c);
+// drop every entry, freeing data unless preserve
+void aputil_cache_clear(APUTIL_Cache *c, bool preserve);
+
+
+//////////////////// sharded cache ////////////////////
+typedef struct {
+    _Alignas(APUTIL_CACHE_LINE) pthread_mutex_t lock;
+    APUTIL_Cache *cache;
+} aputil_cache_shard;
+
+typedef struct {
+    aputil_cache_shard *shards;
+    size_t n_shards;                // power of two
+    uint64_t (*hash)(const void*);
+    size_t key_size;
+} APUTIL_Cache_sharded;
+
+// n_shards caches (rounded up to a power of two, 0 for one per online cpu, fewer when a limit
+// is smaller) splitting the limits exactly, a key always maps to the same shard, so eviction
+// is per shard. copydata is required (E_EMPTY_FUNC)
+APUTIL_Cache_sharded *aputil_cache_sharded_new(size_t n_shards, CACHEPOLICY policy, size_t key_size, size_t max_entries, size_t max_bytes,
+                                               void (*free_data)(void*), void *(*copydata)(const void*),
+                                               uint64_t (*hash)(const void*), bool (*equal)(const void*, const void*), UTIL_ERR *e);
+void aputil_cache_sharded_free(APUTIL_Cache_sharded *c, bool preserve);
+// copy of the data (made by copydata under the shard lock, the stored data may be evicted by
+// another thread right after), NULL with E_DOESNT_EXIST on a miss
+void *aputil_cache_sharded_get(APUTIL_Cache_sharded *c, const void *key, UTIL_ERR *e);
+UTIL_ERR aputil_cache_sharded_put(APUTIL_Cache_sharded *c, const void *key, void *data, size_t bytes);
+UTIL_ERR aputil_cache_sharded_remove(APUTIL_Cache_sharded *c, const void *key, bool preserve);
+
+//////////////////// sharded cache ////////////////////
+
+// ########################### Caches ###########################
+
+// ########################### Filters ###########################
+/*
+ *  approximate membership (src/filter.c), no false negatives, false
+ *  positives at a rate chosen up front; a cheap check before a scan, a
+ *  disk read or a remote call
+ *      > bloom: split block filter, a key sets one bit in each of the 8
+ *        32-bit lanes of one 256-bit block, so a check reads a single cache
+ *        line and is one AVX2 compare where available
+ *      > cuckoo: fingerprints in buckets of CUCKOO_SLOTS, a key lives in one
+ *        of two buckets, supports removal (of keys that were added)
+ *      > keys are hashed with hash_bytes_seed and the filter's seed, the
+ *        *_hash variants take a hash the caller already has (same seed!)
+ *      > save / load (src/serial.c) keep geometry, seed and contents, a loaded
+ *        filter answers exactly like the saved one
+ */
+
+#define BLOOM_LANES 8
+#define CUCKOO_SLOTS 4
+#define CUCKOO_MAX_KICKS 500
+#define CUCKOO_MAX_LOAD 0.95
+
+//////////////////// bloom ////////////////////
+typedef struct {
+    uint32_t *blocks;           // n_blocks * BLOOM_LANES, cache line aligned
+    size_t n_blocks;
+    size_t count;               // adds, repeats included
+    uint64_t seed;
+} BloomFilter;
+
+// expected false positive rate of n_blocks holding n keys
+double bloom_fpp(size_t n_blocks, size_t n);
+// fewest blocks that keep n keys at or below fpp
+size_t bloom_blocks_for(size_t n, double fpp);
+// filter for n keys at fpp (0 < fpp < 1), caller checks NULL
+BloomFilter *bloom_new(size_t n, double fpp, uint64_t seed);
+void bloom_free(BloomFilter *f);
+void bloom_clear(BloomFilter *f);
+UTIL_ERR bloom_add(BloomFilter *f, const void *key, size_t len);
+void bloom_add_hash(BloomFilter *f, uint64_t h);
+// false: certainly never added, true: probably added
+bool bloom_contains(const BloomFilter *f, const void *key, size_t len);
+bool bloom_contains_hash(const BloomFilter *f, uint64_t h);
+// dst |= src, E_BAD_TYPE unless both have the same blocks and seed
+UTIL_ERR bloom_merge(BloomFilter *dst, const BloomFilter *src);
+UTIL_ERR bloom_save(const BloomFilter *f, const char *path);
+BloomFilter *bloom_load(const char *path, UTIL_ERR *e);
+
+//////////////////// bloom ////////////////////
+
+
+//////////////////// cuckoo ////////////////////
+typedef struct {
+    uint16_t *slots;            // n_buckets * CUCKOO_SLOTS fingerprints, 0 is empty
+    size_t n_buckets;           // power of two
+    size_t count;
+    unsigned fp_bits;           // 4..16, false positive rate about 2 * CUCKOO_SLOTS / 2^fp_bits
+    uint64_t seed;
+    uint64_t rng;               // picks the fingerprint to kick
+    bool has_victim;            // one fingerprint left over by a failed kick chain
+    uint16_t victim_fp;
+    size_t victim_idx;
+} CuckooFilter;
+
+// fingerprint bits for fpp, clamped to 4..16 (about 1.2e-4 at best)
+unsigned cuckoo_fp_bits_for(double fpp);
+// buckets (power of two) holding n keys under CUCKOO_MAX_LOAD
+size_t cuckoo_buckets_for(size_t n);
+// filter for n keys at fpp, caller checks NULL
+CuckooFilter *cuckoo_new(size_t n, double fpp, uint64_t seed);
+void cuckoo_free(CuckooFilter *f);
+// E_FULL once a kick chain failed (the filter stays correct, it has no room left)
+UTIL_ERR cuckoo_add(CuckooFilter *f, const void *key, size_t len);
+UTIL_ERR cuckoo_add_hash(CuckooFilter *f, uint64_t h);
+bool cuckoo_contains(const CuckooFilter *f, const void *key, size_t len);
+bool cuckoo_contains_hash(const CuckooFilter *f, uint64_t h);
+// removes one copy of the key's fingerprint, removing a key never added can drop another key
+UTIL_ERR cuckoo_remove(CuckooFilter *f, const void *key, size_t len);
+UTIL_ERR cuckoo_remove_hash(CuckooFilter *f, uint64_t h);
+UTIL_ERR cuckoo_save(const CuckooFilter *f, const char *path);
+CuckooFilter *cuckoo_load(const char *path, UTIL_ERR *e);
+
+//////////////////// cuckoo ////////////////////
+
+// ########################### Filters ###########################
+
+
+// ########################### Ordered Maps ###########################
+/*
+ *  sorted key -> data maps for point lookups and range scans, where a sorted
+ *  list needs aputil_llist_in's O(n) walk
+ *      > btree (src/btree.c): B+-tree, nodes of BTREE_NODE_BYTES (a multiple
+ *        of the cache line) holding keys inline, data only in the leaves,
+ *        leaves linked both ways for range scans
+ *      > keys are key_size bytes ordered by compare, a tree made with
+ *        btree_i32_new has int32_t keys and searches nodes with AVX2
+ *        compares (scalar without AVX2)
+ *      > data pointers work as for lists: freed with free_data unless preserve
+ *      > skiplist (src/skiplist.c): elements ordered by compare like a sorted
+ *        APUTIL_LList, towers of next links give O(log n) search, insert and
+ *        delete, one variant is lock free for many writers
+ *      > art (src/art.c): adaptive radix tree over byte string keys, a
+ *        lookup costs one step per key byte whatever the number of keys
+ */
+
+//////////////////// b+ tree ////////////////////
+#define BTREE_NODE_BYTES 512
+
+struct btree_node;
+
+typedef struct {
+    struct btree_node *root;
+    struct btree_node *first;       // leftmost leaf
+    struct btree_node *spare;       // preallocated nodes, a put never fails half way
+    size_t n_spare;
+    size_t size;
+    size_t height;                  // 1: the root is a leaf
+    size_t key_size;
+    size_t node_keys;               // keys per node (internal nodes have one more child)
+    size_t node_bytes;
+    size_t ptr_off;                 // data / children after the keys
+    int (*compare)(const void*, const void*);  // NULL for int32_t keys
+    void (*free_data)(void*);
+} BTree;
+
+// position in the leaf chain, invalidated by any change to the tree
+typedef struct {
+    const BTree *t;
+    struct btree_node *leaf;
+    size_t idx;
+} BTree_iter;
+
+// make a tree of key_size byte keys, caller checks NULL
+BTree *btree_new(size_t key_size, int (*compare)(const void*, const void*), void (*free_data)(void*));
+// int32_t keys in natural order, SIMD node search
+BTree *btree_i32_new(void (*free_data)(void*));
+// build from strictly ascending keys (elem_size == key_size), data[i] (data may be NULL) goes with key i.
+// leaves and nodes are filled evenly, E_BAD_TYPE when keys are out of order or repeat
+BTree *btree_from_sorted(const Vector *keys, void *const *data, int (*compare)(const void*, const void*),
+                         void (*free_data)(void*), UTIL_ERR *e);
+BTree *btree_i32_from_sorted(const Vec_i32 *keys, void *const *data, void (*free_data)(void*), UTIL_ERR *e);
+// free the tree and, unless preserve, the data through the free hook
+void btree_free(BTree *t, bool preserve);
+
+// insert or overwrite, E_NOOP when key was present (the old data goes to the free hook)
+UTIL_ERR btree_put(BTree *t, const void *key, void *data);
+// data stored for key, NULL when missing (or stored NULL, see btree_contains)
+void *btree_get(const BTree *t, const void *key);
+bool btree_contains(const BTree *t, const void *key);
+// E_DOESNT_EXIST when not present
+UTIL_ERR btree_remove(BTree *t, const void *key, bool preserve);
+// the int32_t versions, E_BAD_TYPE / NULL on a tree with a compare function
+UTIL_ERR btree_i32_put(BTree *t, int32_t key, void *data);
+void *btree_i32_get(const BTree *t, int32_t key);
+UTIL_ERR btree_i32_remove(BTree *t, int32_t key, bool preserve);
+
+// first key not less than key (NULL key: the smallest)
+BTree_iter btree_lower_bound(const BTree *t, const void *key);
+BTree_iter btree_i32_lower_bound(const BTree *t, int32_t key);
+bool btree_iter_valid(const BTree_iter *it);
+// key bytes in the leaf (not necessarily aligned for key_size > 4)
+const void *btree_iter_key(const BTree_iter *it);
+void *btree_iter_data(const BTree_iter *it);
+void btree_iter_next(BTree_iter *it);
+// visit keys in [lo, hi) in order, NULL lo / hi leave that side open, returns the count visited
+size_t btree_range(const BTree *t, const void *lo, const void *hi, void (*visit)(const void *key, void *data, void *arg), void *arg);
+
+//////////////////// b+ tree ////////////////////
+
+
+//////////////////// skip list ////////////////////
+/*
+ *  > a node's tower holds 1 to SKIP_MAX_LEVEL next links, one more level
+ *    with probability 1/4 (about 1.33 links per node)
+ *  > nodes are cut from arena blocks of SKIP_BLOCK_BYTES, neighbours in
+ *    insert order share cache lines and freeing the list frees a few blocks
+ *  > elements compare with compare(elem, key) as for APUTIL_LList, each
+ *    element at most once (an equal one makes insert a no-op)
+ */
+#define SKIP_MAX_LEVEL 32
+#define SKIP_BLOCK_BYTES ((size_t)64 << 10)
+
+struct skip_block;
+
+typedef struct skip_node {
+    void *data;
+    struct skip_node *prev;             // level 0 back link, NULL for the first node
+    uint32_t height;
+    struct skip_node *next[];           // next[0] is the following node
+} Skip_node;
+
+typedef struct {
+    Skip_node *head;                    // sentinel with a full tower, no data
+    size_t cnt;
+    size_t level;                       // tallest tower in use
+    uint64_t rng;
+    Skip_node *spare[SKIP_MAX_LEVEL];   // removed towers by height - 1, reused by inserts
+    _Atomic(struct skip_block*) blocks;
+    void (*free)(void*);                        // data free function
+    int (*compare)(const void*, const void*);   // compare function
+} SkipList;
+
+// make a list ordered by compare (required), caller checks NULL
+SkipList *skip_new(void (*free)(void*), int (*compare)(const void*, const void*));
+// free the list and, unless preserve, the data
+void skip_free(SkipList *s, bool preserve);
+// add data in order, E_NOOP when an equal element is present (the list is unchanged)
+UTIL_ERR skip_insert(SkipList *s, void *data);
+// element comparing equal to key, NULL when missing
+void *skip_find(const SkipList *s, const void *key);
+// E_DOESNT_EXIST when not present
+UTIL_ERR skip_remove(SkipList *s, const void *key, bool preserve);
+// first node not less than key (NULL key: the first node), NULL past the end
+Skip_node *skip_lower_bound(const SkipList *s, const void *key);
+// last node, walk back with node->prev
+Skip_node *skip_last(const SkipList *s);
+
+//////////////////// skip list ////////////////////
+
+
+//////////////////// concurrent skip list ////////////////////
+/*
+ *  lock free (Fraser / Harris): any number of threads insert, remove, find
+ *  and iterate at once
+ *      > a link's low bit marks its node as removed at that level, remove
+ *        marks the tower top down and whoever marks level 0 owns the
+ *        removal, searches unlink marked nodes as they pass them
+ *      > nodes are never freed before the list (removed ones stay in the
+ *        arena), so a thread can always read the node it holds; arena blocks
+ *        are installed with a compare and swap
+ *      > removed data goes back to the caller who must keep it alive while
+ *        other threads may still be reading it, free hooks only run in
+ *        cskip_free
+ */
+
+typedef struct cskip_node {
+    void *data;
+    uint32_t height;
+    _Atomic uintptr_t next[];           // struct cskip_node*, low bit: removed
+} CSkip_node;
+
+typedef struct {
+    CSkip_node *head;
+    _Atomic size_t level;
+    _Atomic size_t cnt;
+    _Atomic(struct skip_block*) blocks;
+    void (*free)(void*);
+    int (*compare)(const void*, const void*);
+} CSkipList;
+
+// make a list ordered by compare (required), caller checks NULL
+CSkipList *cskip_new(void (*free)(void*), int (*compare)(const void*, const void*));
+// no other thread may use the list any more, data is freed unless preserve
+void cskip_free(CSkipList *s, bool preserve);
+// E_NOOP when an equal element is present, data stays the caller's
+UTIL_ERR cskip_insert(CSkipList *s, void *data);
+void *cskip_find(const CSkipList *s, const void *key);
+// unlink the element equal to key, its data to data_out (may be NULL), E_DOESNT_EXIST when
+// not present (or another thread removed it first)
+UTIL_ERR cskip_remove(CSkipList *s, const void *key, void **data_out);
+// first live node not less than key (NULL key: the first), NULL past the end
+CSkip_node *cskip_lower_bound(const CSkipList *s, const void *key);
+// next live node, nodes inserted or removed meanwhile may or may not be seen
+CSkip_node *cskip_next(const CSkip_node *node);
+// number of elements, exact only while no writer runs
+size_t cskip_size(const CSkipList *s);
+
+//////////////////// concurrent skip list ////////////////////
+
+
+//////////////////// radix tree ////////////////////
+/*
+ *  adaptive radix tree (Leis et al.), keys are any bytes of any length
+ *      > inner nodes grow and shrink between 4, 16, 48 and 256 children,
+ *        Node16 finds a byte with one SSE2 compare
+ *      > a chain of single child nodes is folded into the prefix of the
+ *        next node, ART_PREFIX_MAX bytes of it are kept, longer prefixes
+ *        are skipped on lookup and checked against the leaf
+ *      > a key that ends inside the tree (a prefix of longer keys) hangs
+ *        off the node where it ends, keys need no terminator
+ *      > iteration is in byte order (memcmp, shorter first)
+ */
+#define ART_PREFIX_MAX 12
+
+typedef struct {
+    void *root;                 // struct art_node* or a tagged leaf, NULL when empty
+    size_t size;
+    void (*free_data)(void*);
+} Art;
+
+// bytes in use, by kind of node
+typedef struct {
+    size_t nodes[4];            // Node4, Node16, Node48, Node256
+    size_t leaves;
+    size_t node_bytes;
+    size_t leaf_bytes;          // leaves with their keys
+    size_t key_bytes;           // the keys alone
+} Art_mem;
+
+// make an empty tree, caller checks NULL
+Art *art_new(void (*free_data)(void*));
+// free the tree and, unless preserve, the data
+void art_free(Art *t, bool preserve);
+// insert or overwrite a key of len bytes (up to UINT32_MAX), E_NOOP when key was present
+// (the old data goes to the free hook)
+UTIL_ERR art_put(Art *t, const void *key, size_t len, void *data);
+// data stored for key, NULL when missing
+void *art_get(const Art *t, const void *key, size_t len);
+// E_DOESNT_EXIST when not present
+UTIL_ERR art_remove(Art *t, const void *key, size_t len, bool preserve);
+// the same keyed by a char vector's contents
+UTIL_ERR art_put_vec(Art *t, const Vec_char *key, void *data);
+void *art_get_vec(const Art *t, const Vec_char *key);
+UTIL_ERR art_remove_vec(Art *t, const Vec_char *key, bool preserve);
+
+// data of the longest stored key that is a prefix of key (len_out gets its length), NULL if none
+void *art_longest_prefix(const Art *t, const void *key, size_t len, size_t *len_out);
+// visit every key starting with prefix (len 0: all keys) in order, returns the count visited
+size_t art_prefix_iter(const Art *t, const void *prefix, size_t len,
+                       void (*visit)(const void *key, size_t len, void *data, void *arg), void *arg);
+// node and leaf memory of the tree
+Art_mem art_memory(const Art *t);
+
+//////////////////// radix tree ////////////////////
+
+// ########################### Ordered Maps ###########################
+
 
 
 #endif
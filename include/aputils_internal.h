@@ -0,0 +1,26 @@
+/*
+ *    aputils
+ *    helpers shared between the source files, not installed
+ *
+ */
+
+#ifndef _APUTILS_INTERNAL_H
+#define _APUTILS_INTERNAL_H
+
+#include "aputils.h"
+
+
+// ############################# CPU FEATURES #############################
+// true when the running CPU has AVX2, probed once, safe to call from any thread
+bool aputil_have_avx2(void);
+// ############################# CPU FEATURES #############################
+
+// ############################# FILE REPLACE #############################
+// open a new temp file next to path for writing, it gets path's mode (or the umask'd 0666)
+// returns the fd and the temp name in *tmp, -1 on failure
+int aputil_replace_open(const char *path, char **tmp);
+// rename tmp over path when ok, else remove tmp, frees tmp, false if the rename failed
+// the caller has already written, synced and closed the temp file
+bool aputil_replace_finish(char *tmp, const char *path, bool ok);
+// ############################# FILE REPLACE #############################
+#endif
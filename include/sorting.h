@@ -16,13 +16,32 @@ APUTIL_Node *run_stop(APUTIL_Node *n_start, int (*compare)(const void*, const vo
 // produce list of run [lwr - upr)
 APUTIL_LList *make_run_list(APUTIL_Node *lwr, APUTIL_Node *upr, int (*compare)(const void*, const void*));
 // returns a list of list pointers
-APUTIL_LList *partition(APUTIL_LList *lst);
+APUTIL_LList *partition(const APUTIL_LList *lst);
 // merge two lists and priduce a new sorted list
 APUTIL_LList *merge(APUTIL_LList *left_lst, APUTIL_LList *right_lst);
 // merge-sort a list in-place
 void merge_sort(APUTIL_LList *lst);
 // ############################# MERGE SORT #############################
 
+// ############################# K-WAY MERGE #############################
+// loser tree over k sources, less(ctx, a, b) orders the current heads of sources a and b
+// (an exhausted source must lose every match)
+typedef struct {
+    size_t k;
+    size_t *tree;       // losers at internal positions [1, k)
+    size_t winner;      // source holding the smallest head
+    bool (*less)(void *ctx, size_t a, size_t b);
+    void *ctx;
+} loser_tree;
+
+// allocate and play the initial tournament
+bool loser_tree_init(loser_tree *lt, size_t k, bool (*less)(void*, size_t, size_t), void *ctx);
+// call after advancing the winner's source
+void loser_tree_replay(loser_tree *lt);
+// release the tree storage
+void loser_tree_free(loser_tree *lt);
+// ############################# K-WAY MERGE #############################
+
 // ############################# OTHER SORT #############################
 void bubble_sort(APUTIL_LList *lst);
 
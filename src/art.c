@@ -0,0 +1,819 @@
+/*
+ *  adaptive radix tree
+ *  nodes
+ *      > every inner node starts with art_node: child count, the compressed
+ *        path (prefix_len bytes, the first ART_PREFIX_MAX stored) and the
+ *        leaf of a key ending at this node
+ *      > Node4 / Node16 keep key bytes sorted next to their children,
+ *        Node48 maps a byte to one of 48 slots, Node256 is indexed directly
+ *      > leaves hold the whole key and are tagged by the low pointer bit
+ *      > a node grows when full and shrinks at a quarter or so of the next
+ *        size down, a Node4 left with one child is folded into it
+ *
+ *  search
+ *      > lookups skip prefix bytes past ART_PREFIX_MAX (optimistic) and
+ *        compare the whole key at the leaf, inserts and removes that need
+ *        the skipped bytes read them from the node's smallest leaf
+ *
+ *  put / remove
+ *  iteration
+ */
+
+#include <stddef.h>
+#include "../include/aputils.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define ART_SSE2 1
+#else
+#define ART_SSE2 0
+#endif
+
+
+enum { NODE4, NODE16, NODE48, NODE256 };
+
+typedef struct {
+    void *data;
+    uint32_t len;
+    unsigned char key[];
+} art_leaf;
+
+typedef struct art_node {
+    uint8_t type;
+    uint16_t n;                 // children, term not counted
+    uint32_t prefix_len;
+    unsigned char prefix[ART_PREFIX_MAX];
+    art_leaf *term;             // key ending after the prefix
+} art_node;
+
+typedef struct {
+    art_node h;
+    unsigned char keys[4];
+    void *children[4];
+} art_node4;
+
+typedef struct {
+    art_node h;
+    unsigned char keys[16];
+    void *children[16];
+} art_node16;
+
+typedef struct {
+    art_node h;
+    unsigned char index[256];   // slot + 1, 0 for none
+    void *children[48];
+} art_node48;
+
+typedef struct {
+    art_node h;
+    void *children[256];
+} art_node256;
+
+static const size_t node_bytes[] = { sizeof(art_node4), sizeof(art_node16), sizeof(art_node48), sizeof(art_node256) };
+
+
+// ###################### NODES ######################
+
+static inline bool is_leaf(const void *p) {
+    return (uintptr_t)p & 1;
+}
+
+static inline art_leaf *as_leaf(const void *p) {
+    return (art_leaf*)((uintptr_t)p & ~(uintptr_t)1);
+}
+
+static inline void *tag_leaf(const art_leaf *l) {
+    return (void*)((uintptr_t)l | 1);
+}
+
+static inline size_t min_size(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+
+static art_leaf *leaf_new(const unsigned char *key, size_t len, void *data) {
+    art_leaf *l = malloc(sizeof(*l) + len);
+    if (!l) return NULL;
+    l->data = data;
+    l->len = (uint32_t)len;
+    if (len) memcpy(l->key, key, len);
+    return l;
+}
+
+static inline bool leaf_matches(const art_leaf *l, const unsigned char *key, size_t len) {
+    return l->len == len && (!len || memcmp(l->key, key, len) == 0);
+}
+
+
+static art_node *node_new(uint8_t type) {
+    art_node *n = calloc(1, node_bytes[type]);
+    if (n) n->type = type;
+    return n;
+}
+
+static void copy_header(art_node *dst, const art_node *src) {
+    dst->n = src->n;
+    dst->prefix_len = src->prefix_len;
+    memcpy(dst->prefix, src->prefix, ART_PREFIX_MAX);
+    dst->term = src->term;
+}
+
+
+static void free_tree(Art *t, void *n, bool preserve) {
+    if (!n) return;
+    if (is_leaf(n)) {
+        art_leaf *l = as_leaf(n);
+        if (!preserve && t->free_data && l->data) t->free_data(l->data);
+        free(l);
+        return;
+    }
+
+    art_node *x = n;
+    if (x->term) free_tree(t, tag_leaf(x->term), preserve);
+    switch (x->type) {
+    case NODE4:
+        for (size_t i = 0; i < x->n; i++) free_tree(t, ((art_node4*)x)->children[i], preserve);
+        break;
+    case NODE16:
+        for (size_t i = 0; i < x->n; i++) free_tree(t, ((art_node16*)x)->children[i], preserve);
+        break;
+    case NODE48:
+        for (size_t i = 0; i < 48; i++) free_tree(t, ((art_node48*)x)->children[i], preserve);
+        break;
+    case NODE256:
+        for (size_t i = 0; i < 256; i++) free_tree(t, ((art_node256*)x)->children[i], preserve);
+        break;
+    default:
+        break;
+    }
+    free(x);
+}
+
+
+Art *art_new(void (*free_data)(void*)) {
+    Art *t = malloc(sizeof(*t));
+    if (!t) return (Art*)0;  // caller checks NULL
+
+    t->root = NULL;
+    t->size = 0;
+    t->free_data = free_data;
+    return t;
+}
+
+
+void art_free(Art *t, bool preserve) {
+    if (!t) return;
+    free_tree(t, t->root, preserve);
+    free(t);
+}
+
+// ###################### NODES ######################
+
+
+
+// ###################### SEARCH ######################
+
+// bit i set when Node16 key i is c (lt: below c)
+static inline unsigned node16_mask(const art_node16 *x, unsigned char c, bool lt) {
+    unsigned live = (1u << x->h.n) - 1;
+#if ART_SSE2
+    __m128i keys = _mm_loadu_si128((const __m128i*)(const void*)x->keys), k = _mm_set1_epi8((char)c);
+    if (!lt) return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(keys, k)) & live;
+
+    // bytes compare signed, flip the top bit for unsigned order
+    __m128i bias = _mm_set1_epi8((char)0x80);
+    return (unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(_mm_xor_si128(keys, bias), _mm_xor_si128(k, bias))) & live;
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < x->h.n; i++) mask |= (unsigned)(lt ? x->keys[i] < c : x->keys[i] == c) << i;
+    return mask & live;
+#endif
+}
+
+
+// slot of the child under byte c, NULL when there is none
+static void **find_child(art_node *n, unsigned char c) {
+    switch (n->type) {
+    case NODE4: {
+        art_node4 *x = (art_node4*)n;
+        for (size_t i = 0; i < n->n; i++) {
+            if (x->keys[i] == c) return &x->children[i];
+        }
+        return NULL;
+    }
+    case NODE16: {
+        art_node16 *x = (art_node16*)n;
+        unsigned mask = node16_mask(x, c, false);
+        return mask ? &x->children[__builtin_ctz(mask)] : NULL;
+    }
+    case NODE48: {
+        art_node48 *x = (art_node48*)n;
+        return x->index[c] ? &x->children[x->index[c] - 1] : NULL;
+    }
+    case NODE256: {
+        art_node256 *x = (art_node256*)n;
+        return x->children[c] ? &x->children[c] : NULL;
+    }
+    default:
+        return NULL;
+    }
+}
+
+
+// leaf of the smallest key under n (a term leaf is shorter than anything below it)
+static art_leaf *min_leaf(const void *n) {
+    while (n && !is_leaf(n)) {
+        const art_node *x = n;
+        if (x->term) return x->term;
+        switch (x->type) {
+        case NODE4:
+            n = ((const art_node4*)x)->children[0];
+            break;
+        case NODE16:
+            n = ((const art_node16*)x)->children[0];
+            break;
+        case NODE48: {
+            const art_node48 *y = (const art_node48*)x;
+            size_t b = 0;
+            while (!y->index[b]) b++;
+            n = y->children[y->index[b] - 1];
+            break;
+        }
+        case NODE256: {
+            const art_node256 *y = (const art_node256*)x;
+            size_t b = 0;
+            while (!y->children[b]) b++;
+            n = y->children[b];
+            break;
+        }
+        default:
+            return NULL;
+        }
+    }
+    return n ? as_leaf(n) : NULL;
+}
+
+
+// matching bytes of the stored prefix only, the rest is left to the leaf
+static inline size_t check_prefix(const art_node *n, const unsigned char *key, size_t len, size_t depth) {
+    size_t max = min_size(min_size(n->prefix_len, ART_PREFIX_MAX), len - depth), i = 0;
+    while (i < max && n->prefix[i] == key[depth + i]) i++;
+    return i;
+}
+
+// matching bytes of the whole prefix, bytes past the stored ones come from the smallest leaf
+static size_t prefix_mismatch(const art_node *n, const unsigned char *key, size_t len, size_t depth) {
+    size_t i = check_prefix(n, key, len, depth);
+    if (i < ART_PREFIX_MAX || n->prefix_len <= ART_PREFIX_MAX) return i;
+
+    const art_leaf *l = min_leaf(n);
+    size_t max = min_size(n->prefix_len, min_size(l->len, len) - depth);
+    while (i < max && l->key[depth + i] == key[depth + i]) i++;
+    return i;
+}
+
+
+void *art_get(const Art *t, const void *key, size_t len) {
+    if (!t || (!key && len)) return NULL;
+
+    const unsigned char *k = key;
+    void *n = t->root;
+    size_t depth = 0;
+    while (n) {
+        if (is_leaf(n)) return leaf_matches(as_leaf(n), k, len) ? as_leaf(n)->data : NULL;
+
+        art_node *x = n;
+        if (x->prefix_len) {
+            if (check_prefix(x, k, len, depth) != min_size(x->prefix_len, ART_PREFIX_MAX)) return NULL;
+            depth += x->prefix_len;
+            if (depth > len) return NULL;
+        }
+        if (depth == len) return x->term && leaf_matches(x->term, k, len) ? x->term->data : NULL;
+
+        void **child = find_child(x, k[depth++]);
+        n = child ? *child : NULL;
+    }
+    return NULL;
+}
+
+
+void *art_get_vec(const Art *t, const Vec_char *key) {
+    if (!key) return NULL;
+    return art_get(t, key->data, key->size);
+}
+
+
+void *art_longest_prefix(const Art *t, const void *key, size_t len, size_t *len_out) {
+    if (!t || (!key && len)) return NULL;
+
+    // candidates skipped optimistically are confirmed against the key before they count
+    const unsigned char *k = key;
+    const art_leaf *best = NULL;
+    void *n = t->root;
+    size_t depth = 0;
+    while (n) {
+        if (is_leaf(n)) {
+            const art_leaf *l = as_leaf(n);
+            if (l->len <= len && (!l->len || memcmp(l->key, k, l->len) == 0)) best = l;
+            break;
+        }
+
+        art_node *x = n;
+        if (x->prefix_len) {
+            if (check_prefix(x, k, len, depth) != min_size(x->prefix_len, ART_PREFIX_MAX)) break;
+            depth += x->prefix_len;
+            if (depth > len) break;
+        }
+        if (x->term && (!x->term->len || memcmp(x->term->key, k, x->term->len) == 0)) best = x->term;
+        if (depth == len) break;
+
+        void **child = find_child(x, k[depth++]);
+        n = child ? *child : NULL;
+    }
+
+    if (!best) return NULL;
+    if (len_out) *len_out = best->len;
+    return best->data;
+}
+
+// ###################### SEARCH ######################
+
+
+
+// ###################### PUT / REMOVE ######################
+
+// grows n into the next size up when full (*ref follows), fails only on allocation
+static UTIL_ERR add_child(void **ref, art_node *n, unsigned char c, void *child) {
+    switch (n->type) {
+    case NODE4: {
+        art_node4 *x = (art_node4*)n;
+        if (n->n < 4) {
+            size_t i = 0;
+            while (i < n->n && x->keys[i] < c) i++;
+            memmove(x->keys + i + 1, x->keys + i, n->n - i);
+            memmove(x->children + i + 1, x->children + i, (n->n - i) * sizeof(void*));
+            x->keys[i] = c;
+            x->children[i] = child;
+            n->n++;
+            return E_SUCCESS;
+        }
+        art_node16 *g = (art_node16*)node_new(NODE16);
+        if (!g) return E_BAD_ALLOC;
+        copy_header(&g->h, n);
+        memcpy(g->keys, x->keys, 4);
+        memcpy(g->children, x->children, 4 * sizeof(void*));
+        *ref = g;
+        free(n);
+        return add_child(ref, &g->h, c, child);
+    }
+    case NODE16: {
+        art_node16 *x = (art_node16*)n;
+        if (n->n < 16) {
+            size_t i = (size_t)__builtin_popcount(node16_mask(x, c, true));
+            memmove(x->keys + i + 1, x->keys + i, n->n - i);
+            memmove(x->children + i + 1, x->children + i, (n->n - i) * sizeof(void*));
+            x->keys[i] = c;
+            x->children[i] = child;
+            n->n++;
+            return E_SUCCESS;
+        }
+        art_node48 *g = (art_node48*)node_new(NODE48);
+        if (!g) return E_BAD_ALLOC;
+        copy_header(&g->h, n);
+        for (size_t i = 0; i < 16; i++) {
+            g->index[x->keys[i]] = (unsigned char)(i + 1);
+            g->children[i] = x->children[i];
+        }
+        *ref = g;
+        free(n);
+        return add_child(ref, &g->h, c, child);
+    }
+    case NODE48: {
+        art_node48 *x = (art_node48*)n;
+        if (n->n < 48) {
+            size_t pos = 0;
+            while (x->children[pos]) pos++;
+            x->children[pos] = child;
+            x->index[c] = (unsigned char)(pos + 1);
+            n->n++;
+            return E_SUCCESS;
+        }
+        art_node256 *g = (art_node256*)node_new(NODE256);
+        if (!g) return E_BAD_ALLOC;
+        copy_header(&g->h, n);
+        for (size_t b = 0; b < 256; b++) {
+            if (x->index[b]) g->children[b] = x->children[x->index[b] - 1];
+        }
+        *ref = g;
+        free(n);
+        return add_child(ref, &g->h, c, child);
+    }
+    case NODE256: {
+        art_node256 *x = (art_node256*)n;
+        x->children[c] = child;
+        n->n++;
+        return E_SUCCESS;
+    }
+    default:
+        return E_BAD_TYPE;
+    }
+}
+
+
+// a Node4 over two entries: the leaf or node already at *ref and a new leaf, split after common bytes
+static UTIL_ERR split(void **ref, void *old, unsigned char old_byte, bool old_ends,
+                      const unsigned char *key, size_t len, size_t depth, size_t common, void *data) {
+    art_node *n = node_new(NODE4);
+    art_leaf *l = leaf_new(key, len, data);
+    if (!n || !l) {
+        free(n);
+        free(l);
+        return E_BAD_ALLOC;
+    }
+
+    n->prefix_len = (uint32_t)common;
+    memcpy(n->prefix, key + depth, min_size(common, ART_PREFIX_MAX));
+    void *scratch = n;
+    if (old_ends) n->term = as_leaf(old);
+    else add_child(&scratch, n, old_byte, old);
+    if (depth + common == len) n->term = l;
+    else add_child(&scratch, n, key[depth + common], tag_leaf(l));
+    *ref = n;
+    return E_SUCCESS;
+}
+
+
+static UTIL_ERR insert(Art *t, void **ref, const unsigned char *key, size_t len, size_t depth, void *data) {
+    void *n = *ref;
+    if (!n) {
+        art_leaf *l = leaf_new(key, len, data);
+        if (!l) return E_BAD_ALLOC;
+        *ref = tag_leaf(l);
+        return E_SUCCESS;
+    }
+
+    if (is_leaf(n)) {
+        art_leaf *l = as_leaf(n);
+        if (leaf_matches(l, key, len)) {
+            void *old = l->data;
+            l->data = data;
+            if (t->free_data && old && old != data) t->free_data(old);
+            return E_NOOP;
+        }
+        size_t common = 0, max = min_size(l->len, len) - depth;
+        while (common < max && l->key[depth + common] == key[depth + common]) common++;
+        bool ends = l->len == depth + common;
+        return split(ref, n, ends ? 0 : l->key[depth + common], ends, key, len, depth, common, data);
+    }
+
+    art_node *x = n;
+    if (x->prefix_len) {
+        size_t diff = prefix_mismatch(x, key, len, depth);
+        if (diff < x->prefix_len) {
+            // the new node takes the matching part, x keeps what is past its branch byte
+            unsigned char branch, rest[ART_PREFIX_MAX];
+            size_t left = x->prefix_len - diff - 1;
+            if (x->prefix_len <= ART_PREFIX_MAX) {
+                branch = x->prefix[diff];
+                memcpy(rest, x->prefix + diff + 1, left);
+            } else {
+                const art_leaf *l = min_leaf(x);
+                branch = l->key[depth + diff];
+                memcpy(rest, l->key + depth + diff + 1, min_size(left, ART_PREFIX_MAX));
+            }
+
+            // the split node's prefix is the key's, equal to x's up to diff
+            UTIL_ERR err = split(ref, n, branch, false, key, len, depth, diff, data);
+            if (err) return err;
+            x->prefix_len = (uint32_t)left;
+            memcpy(x->prefix, rest, min_size(left, ART_PREFIX_MAX));
+            return E_SUCCESS;
+        }
+        depth += x->prefix_len;
+    }
+
+    // every byte of the path was compared on the way down, a term leaf here is key
+    if (depth == len) {
+        if (x->term) {
+            void *old = x->term->data;
+            x->term->data = data;
+            if (t->free_data && old && old != data) t->free_data(old);
+            return E_NOOP;
+        }
+        if (!(x->term = leaf_new(key, len, data))) return E_BAD_ALLOC;
+        return E_SUCCESS;
+    }
+
+    void **child = find_child(x, key[depth]);
+    if (child) return insert(t, child, key, len, depth + 1, data);
+
+    art_leaf *l = leaf_new(key, len, data);
+    if (!l) return E_BAD_ALLOC;
+    UTIL_ERR err = add_child(ref, x, key[depth], tag_leaf(l));
+    if (err) free(l);
+    return err;
+}
+
+
+UTIL_ERR art_put(Art *t, const void *key, size_t len, void *data) {
+    if (!t) return E_EMPTY_OBJ;
+    if (!key && len) return E_EMPTY_ARG;
+    if (len > UINT32_MAX) return E_OUTOFBOUNDS;
+
+    UTIL_ERR err = insert(t, &t->root, key, len, 0, data);
+    if (err == E_SUCCESS) t->size++;
+    return err;
+}
+
+
+UTIL_ERR art_put_vec(Art *t, const Vec_char *key, void *data) {
+    if (!key) return E_EMPTY_ARG;
+    return art_put(t, key->data, key->size, data);
+}
+
+
+static void remove_child(art_node *n, unsigned char c, void **slot) {
+    switch (n->type) {
+    case NODE4: {
+        art_node4 *x = (art_node4*)n;
+        size_t i = (size_t)(slot - x->children);
+        memmove(x->keys + i, x->keys + i + 1, n->n - i - 1);
+        memmove(x->children + i, x->children + i + 1, (n->n - i - 1) * sizeof(void*));
+        break;
+    }
+    case NODE16: {
+        art_node16 *x = (art_node16*)n;
+        size_t i = (size_t)(slot - x->children);
+        memmove(x->keys + i, x->keys + i + 1, n->n - i - 1);
+        memmove(x->children + i, x->children + i + 1, (n->n - i - 1) * sizeof(void*));
+        break;
+    }
+    case NODE48: {
+        art_node48 *x = (art_node48*)n;
+        x->children[x->index[c] - 1] = NULL;
+        x->index[c] = 0;
+        break;
+    }
+    case NODE256:
+        ((art_node256*)n)->children[c] = NULL;
+        break;
+    default:
+        return;
+    }
+    n->n--;
+}
+
+
+/*
+    after a removal from the node at *ref: the next size down once it is
+    well under capacity (kept as is if that allocation fails), a Node4 with
+    nothing but its term becomes the term leaf, one with a single child and
+    no term is replaced by the child (a node child takes on the prefix)
+*/
+static void shrink(void **ref) {
+    art_node *n = *ref;
+    switch (n->type) {
+    case NODE4: {
+        art_node4 *x = (art_node4*)n;
+        if (!n->n && n->term) {
+            *ref = tag_leaf(n->term);
+            free(n);
+        } else if (n->n == 1 && !n->term) {
+            void *child = x->children[0];
+            if (!is_leaf(child)) {
+                art_node *c = child;
+                unsigned char buf[ART_PREFIX_MAX];
+                size_t have = min_size(n->prefix_len, ART_PREFIX_MAX);
+                memcpy(buf, n->prefix, have);
+                if (have < ART_PREFIX_MAX) buf[have++] = x->keys[0];
+                size_t take = min_size(min_size(c->prefix_len, ART_PREFIX_MAX), ART_PREFIX_MAX - have);
+                memcpy(buf + have, c->prefix, take);
+                have += take;
+                c->prefix_len += n->prefix_len + 1;
+                memcpy(c->prefix, buf, have);
+            }
+            *ref = child;
+            free(n);
+        }
+        return;
+    }
+    case NODE16: {
+        if (n->n > 3) return;
+        art_node16 *x = (art_node16*)n;
+        art_node4 *s = (art_node4*)node_new(NODE4);
+        if (!s) return;
+        copy_header(&s->h, n);
+        memcpy(s->keys, x->keys, n->n);
+        memcpy(s->children, x->children, n->n * sizeof(void*));
+        *ref = s;
+        free(n);
+        return;
+    }
+    case NODE48: {
+        if (n->n > 12) return;
+        art_node48 *x = (art_node48*)n;
+        art_node16 *s = (art_node16*)node_new(NODE16);
+        if (!s) return;
+        copy_header(&s->h, n);
+        size_t j = 0;
+        for (size_t b = 0; b < 256; b++) {
+            if (!x->index[b]) continue;
+            s->keys[j] = (unsigned char)b;
+            s->children[j++] = x->children[x->index[b] - 1];
+        }
+        *ref = s;
+        free(n);
+        return;
+    }
+    case NODE256: {
+        if (n->n > 37) return;
+        art_node256 *x = (art_node256*)n;
+        art_node48 *s = (art_node48*)node_new(NODE48);
+        if (!s) return;
+        copy_header(&s->h, n);
+        size_t j = 0;
+        for (size_t b = 0; b < 256; b++) {
+            if (!x->children[b]) continue;
+            s->index[b] = (unsigned char)(j + 1);
+            s->children[j++] = x->children[b];
+        }
+        *ref = s;
+        free(n);
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+
+static art_leaf *erase(void **ref, const unsigned char *key, size_t len, size_t depth) {
+    void *n = *ref;
+    if (!n) return NULL;
+    if (is_leaf(n)) {
+        if (!leaf_matches(as_leaf(n), key, len)) return NULL;
+        *ref = NULL;
+        return as_leaf(n);
+    }
+
+    art_node *x = n;
+    if (x->prefix_len) {
+        if (check_prefix(x, key, len, depth) != min_size(x->prefix_len, ART_PREFIX_MAX)) return NULL;
+        depth += x->prefix_len;
+        if (depth > len) return NULL;
+    }
+    if (depth == len) {
+        art_leaf *l = x->term;
+        if (!l || !leaf_matches(l, key, len)) return NULL;
+        x->term = NULL;
+        shrink(ref);
+        return l;
+    }
+
+    void **child = find_child(x, key[depth]);
+    if (!child) return NULL;
+    if (!is_leaf(*child)) return erase(child, key, len, depth + 1);
+
+    art_leaf *l = as_leaf(*child);
+    if (!leaf_matches(l, key, len)) return NULL;
+    remove_child(x, key[depth], child);
+    shrink(ref);
+    return l;
+}
+
+
+UTIL_ERR art_remove(Art *t, const void *key, size_t len, bool preserve) {
+    if (!t) return E_EMPTY_OBJ;
+    if (!key && len) return E_EMPTY_ARG;
+
+    art_leaf *l = erase(&t->root, key, len, 0);
+    if (!l) return E_DOESNT_EXIST;
+
+    t->size--;
+    if (!preserve && t->free_data && l->data) t->free_data(l->data);
+    free(l);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR art_remove_vec(Art *t, const Vec_char *key, bool preserve) {
+    if (!key) return E_EMPTY_ARG;
+    return art_remove(t, key->data, key->size, preserve);
+}
+
+// ###################### PUT / REMOVE ######################
+
+
+
+// ###################### ITERATION ######################
+
+typedef void (*art_visit)(const void *key, size_t len, void *data, void *arg);
+
+static size_t walk(const void *n, art_visit visit, void *arg) {
+    if (is_leaf(n)) {
+        const art_leaf *l = as_leaf(n);
+        visit(l->key, l->len, l->data, arg);
+        return 1;
+    }
+
+    const art_node *x = n;
+    size_t cnt = 0;
+    if (x->term) cnt += walk(tag_leaf(x->term), visit, arg);
+    switch (x->type) {
+    case NODE4:
+        for (size_t i = 0; i < x->n; i++) cnt += walk(((const art_node4*)x)->children[i], visit, arg);
+        break;
+    case NODE16:
+        for (size_t i = 0; i < x->n; i++) cnt += walk(((const art_node16*)x)->children[i], visit, arg);
+        break;
+    case NODE48: {
+        const art_node48 *y = (const art_node48*)x;
+        for (size_t b = 0; b < 256; b++) {
+            if (y->index[b]) cnt += walk(y->children[y->index[b] - 1], visit, arg);
+        }
+        break;
+    }
+    case NODE256: {
+        const art_node256 *y = (const art_node256*)x;
+        for (size_t b = 0; b < 256; b++) {
+            if (y->children[b]) cnt += walk(y->children[b], visit, arg);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return cnt;
+}
+
+
+size_t art_prefix_iter(const Art *t, const void *prefix, size_t len, art_visit visit, void *arg) {
+    if (!t || !visit || (!prefix && len)) return 0;
+
+    // down to the first node whose keys all start with prefix
+    const unsigned char *k = prefix;
+    void *n = t->root;
+    size_t depth = 0;
+    while (n) {
+        if (is_leaf(n)) {
+            const art_leaf *l = as_leaf(n);
+            if (l->len < len || (len && memcmp(l->key, k, len) != 0)) return 0;
+            return walk(n, visit, arg);
+        }
+
+        art_node *x = n;
+        size_t m = prefix_mismatch(x, k, len, depth);
+        if (depth + m == len) return walk(n, visit, arg);
+        if (m < x->prefix_len) return 0;
+        depth += x->prefix_len;
+
+        void **child = find_child(x, k[depth++]);
+        n = child ? *child : NULL;
+    }
+    return 0;
+}
+
+
+static void measure(const void *n, Art_mem *m) {
+    if (is_leaf(n)) {
+        const art_leaf *l = as_leaf(n);
+        m->leaves++;
+        m->leaf_bytes += sizeof(*l) + l->len;
+        m->key_bytes += l->len;
+        return;
+    }
+
+    const art_node *x = n;
+    m->nodes[x->type]++;
+    m->node_bytes += node_bytes[x->type];
+    if (x->term) measure(tag_leaf(x->term), m);
+    switch (x->type) {
+    case NODE4:
+        for (size_t i = 0; i < x->n; i++) measure(((const art_node4*)x)->children[i], m);
+        break;
+    case NODE16:
+        for (size_t i = 0; i < x->n; i++) measure(((const art_node16*)x)->children[i], m);
+        break;
+    case NODE48:
+        for (size_t i = 0; i < 48; i++) {
+            if (((const art_node48*)x)->children[i]) measure(((const art_node48*)x)->children[i], m);
+        }
+        break;
+    case NODE256:
+        for (size_t b = 0; b < 256; b++) {
+            if (((const art_node256*)x)->children[b]) measure(((const art_node256*)x)->children[b], m);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+
+Art_mem art_memory(const Art *t) {
+    Art_mem m = { .leaves = 0 };
+    if (t && t->root) measure(t->root, &m);
+    return m;
+}
+
+// ###################### ITERATION ######################
@@ -0,0 +1,628 @@
+/*
+ *  bit vector
+ *  flags packed 64 to a word, 8x smaller than a byte per flag
+ *      > storage is cache line aligned and padded to whole 256-bit chunks,
+ *        the bits past size are kept zero so whole words (and whole AVX2
+ *        registers) can be and-ed, counted and scanned with no tail handling
+ *      > AVX2 paths for the bulk ops, counting (nibble lookup + sad) and
+ *        packing byte flags (movemask), picked at runtime like sortnet.c
+ *
+ *  bits
+ *  bulk
+ *  rank / select
+ *      > rank9 (Vigna): per 512-bit block the ones before it and seven 9-bit
+ *        counts of the words before each word of the block
+ *  masks
+ */
+
+#include "../include/aputils_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITVEC_X86 1
+#else
+#define BITVEC_X86 0
+#endif
+
+
+#define BIT_CHUNK 4             // words per 256-bit register, storage is a multiple of it
+#define RANK_BLOCK_WORDS 8      // 512 bits
+
+static const Vec_alloc bit_alloc = { .align = APUTIL_CACHE_LINE };
+
+
+static inline size_t words_for(size_t bits) {
+    return (bits + 63) / 64;
+}
+
+static inline size_t chunk_words(size_t bits) {
+    return (words_for(bits) + BIT_CHUNK - 1) / BIT_CHUNK * BIT_CHUNK;
+}
+
+static inline int popcount64(uint64_t x) {
+    return __builtin_popcountll(x);
+}
+
+
+
+// ###################### BITS ######################
+
+Vec_bit *vec_bit_new(size_t cap) {
+    if (cap < 1) {
+        return (Vec_bit*)0;  // caller checks NULL
+    }
+
+    Vec_bit *new_vec = malloc(sizeof(*new_vec));
+    if (!new_vec) {
+        return (Vec_bit*)0;
+    }
+
+    size_t words = chunk_words(cap);
+    new_vec->data = vec_data_alloc(&bit_alloc, words * sizeof(uint64_t));
+    if (!new_vec->data) {
+        free(new_vec);
+        return (Vec_bit*)0;
+    }
+    memset(new_vec->data, 0, words * sizeof(uint64_t));
+
+    new_vec->cap = words * 64;
+    new_vec->size = 0;
+
+    return new_vec;
+}
+
+
+Vec_bit *vec_bit_filled(size_t n, bool value) {
+    Vec_bit *new_vec = vec_bit_new(n ? n : 1);
+    if (!new_vec) return (Vec_bit*)0;  // caller checks NULL
+
+    new_vec->size = n;
+    vec_bit_fill(new_vec, value);
+    return new_vec;
+}
+
+
+void vec_bit_free(Vec_bit *v) {
+    if (!v) return;
+    free(v->data);
+    free(v);
+}
+
+
+Vec_bit *vec_bit_copy(const Vec_bit *v) {
+    if (!v) return (Vec_bit*)0;
+
+    Vec_bit *new_vec = vec_bit_new(v->cap);
+    if (!new_vec) return (Vec_bit*)0;
+
+    memcpy(new_vec->data, v->data, v->cap / 64 * sizeof(uint64_t));
+    new_vec->size = v->size;
+    return new_vec;
+}
+
+
+// room for bits, grown words are zeroed
+static UTIL_ERR reserve_bits(Vec_bit *v, size_t bits) {
+    if (bits <= v->cap) return E_SUCCESS;
+
+    size_t want = v->cap * 2 > bits ? v->cap * 2 : bits;
+    size_t old_words = v->cap / 64, words = chunk_words(want);
+    uint64_t *data = vec_data_realloc(&bit_alloc, v->data, old_words * sizeof(uint64_t), words * sizeof(uint64_t));
+    if (!data) return E_BAD_ALLOC;
+
+    memset(data + old_words, 0, (words - old_words) * sizeof(uint64_t));
+    v->data = data;
+    v->cap = words * 64;
+    return E_SUCCESS;
+}
+
+
+// zero the bits past size in the last word
+static inline void trim_tail(Vec_bit *v) {
+    if (v->size % 64) v->data[v->size / 64] &= (1ull << (v->size % 64)) - 1;
+}
+
+
+UTIL_ERR vec_bit_add_back(Vec_bit *v, bool bit) {
+    if (!v) return E_EMPTY_OBJ;
+
+    UTIL_ERR err = reserve_bits(v, v->size + 1);
+    if (err) return err;
+
+    if (bit) v->data[v->size / 64] |= 1ull << (v->size % 64);
+    v->size++;
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vec_bit_resize(Vec_bit *v, size_t n) {
+    if (!v) return E_EMPTY_OBJ;
+
+    if (n < v->size) {
+        size_t old_words = words_for(v->size);
+        v->size = n;
+        trim_tail(v);
+        memset(v->data + words_for(n), 0, (old_words - words_for(n)) * sizeof(uint64_t));
+        return E_SUCCESS;
+    }
+
+    // the bits past size are already zero
+    UTIL_ERR err = reserve_bits(v, n);
+    if (err) return err;
+    v->size = n;
+    return E_SUCCESS;
+}
+
+
+void vec_bit_fill(Vec_bit *v, bool value) {
+    if (!v) return;
+    memset(v->data, value ? 0xff : 0, words_for(v->size) * sizeof(uint64_t));
+    trim_tail(v);
+}
+
+
+void vec_bit_clear(Vec_bit *v) {
+    if (!v) return;
+    memset(v->data, 0, words_for(v->size) * sizeof(uint64_t));
+    v->size = 0;
+}
+
+
+UTIL_ERR vec_bit_set(Vec_bit *v, size_t idx) {
+    if (!v) return E_EMPTY_OBJ;
+    if (idx >= v->size) return E_OUTOFBOUNDS;
+    v->data[idx / 64] |= 1ull << (idx % 64);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vec_bit_unset(Vec_bit *v, size_t idx) {
+    if (!v) return E_EMPTY_OBJ;
+    if (idx >= v->size) return E_OUTOFBOUNDS;
+    v->data[idx / 64] &= ~(1ull << (idx % 64));
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vec_bit_flip(Vec_bit *v, size_t idx) {
+    if (!v) return E_EMPTY_OBJ;
+    if (idx >= v->size) return E_OUTOFBOUNDS;
+    v->data[idx / 64] ^= 1ull << (idx % 64);
+    return E_SUCCESS;
+}
+
+
+bool vec_bit_get(const Vec_bit *v, size_t idx, UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return false;
+    }
+    if (idx >= v->size) {
+        *e = E_OUTOFBOUNDS;
+        return false;
+    }
+    return vec_bit_test(v, idx);
+}
+
+
+intmax_t vec_bit_next_set(const Vec_bit *v, size_t from) {
+    if (!v || from >= v->size) return -1;
+
+    size_t w = from / 64, words = words_for(v->size);
+    uint64_t bits = v->data[w] & (~0ull << (from % 64));
+    while (!bits) {
+        if (++w == words) return -1;
+        bits = v->data[w];
+    }
+    return (intmax_t)(w * 64 + (size_t)__builtin_ctzll(bits));
+}
+
+// ###################### BITS ######################
+
+
+
+// ###################### BULK ######################
+
+enum bit_op {
+    op_and,
+    op_or,
+    op_xor,
+    op_andnot,
+};
+
+#define BULK_LOOP(step, expr) \
+    for (size_t i = 0; i < words; i += (step)) { expr; }
+
+static void bulk_scalar(uint64_t *d, const uint64_t *s, size_t words, enum bit_op op) {
+    switch (op) {
+        case op_and: BULK_LOOP(1, d[i] &= s[i]) break;
+        case op_or: BULK_LOOP(1, d[i] |= s[i]) break;
+        case op_xor: BULK_LOOP(1, d[i] ^= s[i]) break;
+        case op_andnot: BULK_LOOP(1, d[i] &= ~s[i]) break;
+        default: break;
+    }
+}
+
+
+static size_t count_scalar(const uint64_t *d, size_t words) {
+    size_t n = 0;
+    for (size_t i = 0; i < words; i++) n += (size_t)popcount64(d[i]);
+    return n;
+}
+
+
+#if BITVEC_X86
+
+#define LD(p) _mm256_load_si256((const __m256i*)(p))
+#define ST(p, x) _mm256_store_si256((__m256i*)(p), (x))
+
+__attribute__((target("avx2")))
+static void bulk_avx2(uint64_t *d, const uint64_t *s, size_t words, enum bit_op op) {
+    switch (op) {
+        case op_and: BULK_LOOP(BIT_CHUNK, ST(d + i, _mm256_and_si256(LD(d + i), LD(s + i)))) break;
+        case op_or: BULK_LOOP(BIT_CHUNK, ST(d + i, _mm256_or_si256(LD(d + i), LD(s + i)))) break;
+        case op_xor: BULK_LOOP(BIT_CHUNK, ST(d + i, _mm256_xor_si256(LD(d + i), LD(s + i)))) break;
+        case op_andnot: BULK_LOOP(BIT_CHUNK, ST(d + i, _mm256_andnot_si256(LD(s + i), LD(d + i)))) break;
+        default: break;
+    }
+}
+
+
+// bytes counted through a nibble lookup, summed into 64-bit lanes with sad (Mula)
+__attribute__((target("avx2")))
+static size_t count_avx2(const uint64_t *d, size_t words) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f), zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    for (size_t i = 0; i < words; i += BIT_CHUNK) {
+        __m256i x = LD(d + i);
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), zero));
+    }
+    return (size_t)(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                    _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+}
+
+#endif
+
+
+static UTIL_ERR bulk(Vec_bit *dst, const Vec_bit *src, enum bit_op op) {
+    if (!dst) return E_EMPTY_OBJ;
+    if (!src) return E_EMPTY_ARG;
+    if (dst->size != src->size) return E_OUTOFBOUNDS;
+
+    // both hold at least this many (zero padded) words
+    size_t words = chunk_words(dst->size);
+#if BITVEC_X86
+    if (aputil_have_avx2()) {
+        bulk_avx2(dst->data, src->data, words, op);
+        return E_SUCCESS;
+    }
+#endif
+    bulk_scalar(dst->data, src->data, words, op);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vec_bit_and(Vec_bit *dst, const Vec_bit *src) {
+    return bulk(dst, src, op_and);
+}
+
+UTIL_ERR vec_bit_or(Vec_bit *dst, const Vec_bit *src) {
+    return bulk(dst, src, op_or);
+}
+
+UTIL_ERR vec_bit_xor(Vec_bit *dst, const Vec_bit *src) {
+    return bulk(dst, src, op_xor);
+}
+
+UTIL_ERR vec_bit_andnot(Vec_bit *dst, const Vec_bit *src) {
+    return bulk(dst, src, op_andnot);
+}
+
+
+size_t vec_bit_count(const Vec_bit *v) {
+    if (!v) return 0;
+#if BITVEC_X86
+    if (aputil_have_avx2()) return count_avx2(v->data, chunk_words(v->size));
+#endif
+    return count_scalar(v->data, words_for(v->size));
+}
+
+// ###################### BULK ######################
+
+
+
+// ###################### RANK / SELECT ######################
+
+// ones in the words of the block before word j (0..7)
+static inline size_t sub_count(uint64_t packed, size_t j) {
+    return j ? (size_t)(packed >> (9 * (j - 1))) & 0x1ff : 0;
+}
+
+
+Vec_bit_rank *vec_bit_rank_new(const Vec_bit *v) {
+    if (!v) return (Vec_bit_rank*)0;  // caller checks NULL
+
+    Vec_bit_rank *r = malloc(sizeof(*r));
+    if (!r) return (Vec_bit_rank*)0;
+
+    size_t words = words_for(v->size);
+    r->bits = v;
+    r->n_blocks = (words + RANK_BLOCK_WORDS - 1) / RANK_BLOCK_WORDS;
+    r->blocks = malloc(sizeof(uint64_t) * 2 * (r->n_blocks + 1));
+    if (!r->blocks) {
+        free(r);
+        return (Vec_bit_rank*)0;
+    }
+
+    // running counts, words past the end count as empty
+    size_t ones = 0;
+    for (size_t b = 0; b < r->n_blocks; b++) {
+        uint64_t packed = 0;
+        size_t in_block = 0;
+        for (size_t j = 0; j < RANK_BLOCK_WORDS; j++) {
+            if (j) packed |= (uint64_t)in_block << (9 * (j - 1));
+            size_t w = b * RANK_BLOCK_WORDS + j;
+            if (w < words) in_block += (size_t)popcount64(v->data[w]);
+        }
+        r->blocks[2 * b] = ones;
+        r->blocks[2 * b + 1] = packed;
+        ones += in_block;
+    }
+    r->blocks[2 * r->n_blocks] = ones;
+    r->blocks[2 * r->n_blocks + 1] = 0;
+    r->ones = ones;
+
+    // block of every VEC_BIT_SELECT_SAMPLE-th one, select searches between two samples
+    r->n_samples = (ones + VEC_BIT_SELECT_SAMPLE - 1) / VEC_BIT_SELECT_SAMPLE;
+    r->samples = malloc(sizeof(size_t) * (r->n_samples ? r->n_samples : 1));
+    if (!r->samples) {
+        free(r->blocks);
+        free(r);
+        return (Vec_bit_rank*)0;
+    }
+    size_t s = 0;
+    for (size_t b = 0; b < r->n_blocks && s < r->n_samples; b++) {
+        while (s < r->n_samples && s * VEC_BIT_SELECT_SAMPLE < r->blocks[2 * (b + 1)]) r->samples[s++] = b;
+    }
+
+    return r;
+}
+
+
+void vec_bit_rank_free(Vec_bit_rank *r) {
+    if (!r) return;
+    free(r->blocks);
+    free(r->samples);
+    free(r);
+}
+
+
+size_t vec_bit_rank(const Vec_bit_rank *r, size_t idx) {
+    if (!r) return 0;
+    if (idx >= r->bits->size) return r->ones;
+
+    size_t w = idx / 64, b = w / RANK_BLOCK_WORDS;
+    size_t below = r->blocks[2 * b] + sub_count(r->blocks[2 * b + 1], w % RANK_BLOCK_WORDS);
+    return below + (size_t)popcount64(r->bits->data[w] & ((1ull << (idx % 64)) - 1));
+}
+
+
+intmax_t vec_bit_select(const Vec_bit_rank *r, size_t k) {
+    if (!r || k >= r->ones) return -1;
+
+    // last block starting at or before one number k
+    size_t s = k / VEC_BIT_SELECT_SAMPLE;
+    size_t lo = r->samples[s], hi = s + 1 < r->n_samples ? r->samples[s + 1] + 1 : r->n_blocks;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (r->blocks[2 * mid] <= k) lo = mid;
+        else hi = mid;
+    }
+
+    size_t rem = k - r->blocks[2 * lo], j = 0;
+    uint64_t packed = r->blocks[2 * lo + 1];
+    while (j + 1 < RANK_BLOCK_WORDS && sub_count(packed, j + 1) <= rem) j++;
+    rem -= sub_count(packed, j);
+
+    size_t w = lo * RANK_BLOCK_WORDS + j;
+    uint64_t bits = r->bits->data[w];
+    for (; rem; rem--) bits &= bits - 1;
+    return (intmax_t)(w * 64 + (size_t)__builtin_ctzll(bits));
+}
+
+// ###################### RANK / SELECT ######################
+
+
+
+// ###################### MASKS ######################
+
+Vec_bit *vec_i32_mask(const Vec_i32 *v, bool(*pred)(int32_t), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_bit*)0;
+    }
+    if (!pred) {
+        *e = E_EMPTY_FUNC;
+        return (Vec_bit*)0;
+    }
+
+    Vec_bit *mask = vec_bit_filled(v->size, false);
+    if (!mask) {
+        *e = E_BAD_ALLOC;
+        return (Vec_bit*)0;
+    }
+
+    // a word at a time, no read-modify-write per bit
+    for (size_t w = 0; w < words_for(v->size); w++) {
+        size_t end = (w + 1) * 64 < v->size ? (w + 1) * 64 : v->size;
+        uint64_t bits = 0;
+        for (size_t i = w * 64; i < end; i++) bits |= (uint64_t)(pred(v->data[i]) ? 1 : 0) << (i % 64);
+        mask->data[w] = bits;
+    }
+    return mask;
+}
+
+
+Vec_bit *vector_mask(const Vector *v, bool(*pred)(void*), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_bit*)0;
+    }
+    if (!pred) {
+        *e = E_EMPTY_FUNC;
+        return (Vec_bit*)0;
+    }
+
+    Vec_bit *mask = vec_bit_filled(v->size, false);
+    if (!mask) {
+        *e = E_BAD_ALLOC;
+        return (Vec_bit*)0;
+    }
+
+    char *p = v->data;
+    for (size_t w = 0; w < words_for(v->size); w++) {
+        size_t end = (w + 1) * 64 < v->size ? (w + 1) * 64 : v->size;
+        uint64_t bits = 0;
+        for (size_t i = w * 64; i < end; i++, p += v->elem_size) bits |= (uint64_t)(pred(p) ? 1 : 0) << (i % 64);
+        mask->data[w] = bits;
+    }
+    return mask;
+}
+
+
+Vec_i32 *vec_i32_select_mask(const Vec_i32 *v, const Vec_bit *mask, UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_i32*)0;
+    }
+    if (!mask) {
+        *e = E_EMPTY_ARG;
+        return (Vec_i32*)0;
+    }
+    if (mask->size != v->size) {
+        *e = E_OUTOFBOUNDS;
+        return (Vec_i32*)0;
+    }
+
+    size_t n = vec_bit_count(mask);
+    Vec_i32 *new_vec = vec_i32_new(n ? n : 1);
+    if (!new_vec) {
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+
+    // sized once, set bits walked with ctz
+    int32_t *out = new_vec->data;
+    for (size_t w = 0; w < words_for(mask->size); w++) {
+        for (uint64_t bits = mask->data[w]; bits; bits &= bits - 1) {
+            *out++ = v->data[w * 64 + (size_t)__builtin_ctzll(bits)];
+        }
+    }
+    new_vec->size = n;
+    return new_vec;
+}
+
+
+Vector *vector_select_mask(const Vector *v, const Vec_bit *mask, UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vector*)0;
+    }
+    if (!mask) {
+        *e = E_EMPTY_ARG;
+        return (Vector*)0;
+    }
+    if (mask->size != v->size) {
+        *e = E_OUTOFBOUNDS;
+        return (Vector*)0;
+    }
+
+    size_t n = vec_bit_count(mask);
+    Vector *new_vec = vector_new(v->elem_size, n ? n : 1);
+    if (!new_vec) {
+        *e = E_BAD_ALLOC;
+        return (Vector*)0;
+    }
+
+    char *out = new_vec->data;
+    for (size_t w = 0; w < words_for(mask->size); w++) {
+        for (uint64_t bits = mask->data[w]; bits; bits &= bits - 1) {
+            memcpy(out, (const char*)v->data + (w * 64 + (size_t)__builtin_ctzll(bits)) * v->elem_size, v->elem_size);
+            out += v->elem_size;
+        }
+    }
+    new_vec->size = n;
+    return new_vec;
+}
+
+
+static void pack_scalar(uint64_t *bits, const char *flags, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (flags[i]) bits[i / 64] |= 1ull << (i % 64);
+    }
+}
+
+
+#if BITVEC_X86
+// 32 flags per compare, movemask gathers the byte signs into bits
+__attribute__((target("avx2")))
+static void pack_avx2(uint64_t *bits, const char *flags, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m256i lo = _mm256_loadu_si256((const __m256i*)(flags + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i*)(flags + i + 32));
+        uint32_t zlo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, zero));
+        uint32_t zhi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, zero));
+        bits[i / 64] = ~((uint64_t)zhi << 32 | zlo);
+    }
+    pack_scalar(bits + i / 64, flags + i, n - i);
+}
+#endif
+
+
+Vec_bit *vec_bit_from_chars(const Vec_char *flags, UTIL_ERR *e) {
+    if (!flags) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_bit*)0;
+    }
+
+    Vec_bit *new_vec = vec_bit_filled(flags->size, false);
+    if (!new_vec) {
+        *e = E_BAD_ALLOC;
+        return (Vec_bit*)0;
+    }
+
+#if BITVEC_X86
+    if (aputil_have_avx2()) {
+        pack_avx2(new_vec->data, flags->data, flags->size);
+        return new_vec;
+    }
+#endif
+    pack_scalar(new_vec->data, flags->data, flags->size);
+    return new_vec;
+}
+
+
+Vec_char *vec_bit_to_chars(const Vec_bit *v, UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_char*)0;
+    }
+
+    Vec_char *new_vec = vec_char_new(v->size ? v->size : 1);
+    if (!new_vec) {
+        *e = E_BAD_ALLOC;
+        return (Vec_char*)0;
+    }
+
+    for (size_t i = 0; i < v->size; i++) new_vec->data[i] = (char)vec_bit_test(v, i);
+    new_vec->size = v->size;
+    return new_vec;
+}
+
+// ###################### MASKS ######################
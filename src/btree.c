@@ -0,0 +1,729 @@
+/*
+ *  B+-tree
+ *  node layout, one aligned block of node_bytes (BTREE_NODE_BYTES unless
+ *  the keys are too wide for BTREE_MIN_KEYS of them):
+ *      [n, leaf, prev, next][keys, padded to 32 bytes][data or children]
+ *      > keys sit next to each other so a node search walks one or two
+ *        cache lines, int32_t keys are compared 8 at a time with AVX2 and
+ *        counted from the compare mask
+ *      > nodes have room for one key (and child) past node_keys: a put
+ *        inserts first and splits after, the key moving up is read from
+ *        where the split left it
+ *      > a put reserves the nodes it could need (height + 1) before
+ *        changing anything, so allocation failure leaves the tree intact
+ *
+ *  nodes
+ *  search
+ *  put / remove
+ *      > inner key i separates child i (keys below it) from child i + 1
+ *      > under node_keys / 2 keys a node borrows from a sibling or merges
+ *  bulk load
+ *  iteration
+ */
+
+#include <stddef.h>
+#include "../include/aputils_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BTREE_X86 1
+#else
+#define BTREE_X86 0
+#endif
+
+
+#define BTREE_MIN_KEYS 4
+#define BTREE_MAX_HEIGHT 64     // fanout of 3 at least, far more levels than 64-bit sizes need
+
+struct btree_node {
+    uint32_t n;
+    uint32_t leaf;
+    struct btree_node *prev;    // leaf chain
+    struct btree_node *next;    // leaf chain, spare list
+    unsigned char mem[];
+};
+typedef struct btree_node node;
+
+static const Vec_alloc node_alloc_opts = { .align = APUTIL_CACHE_LINE };
+
+
+// ###################### NODES ######################
+
+static inline unsigned char *key_at(const BTree *t, const node *x, size_t i) {
+    return (unsigned char*)x->mem + i * t->key_size;
+}
+
+static inline int32_t *keys_i32(const node *x) {
+    return (int32_t*)(void*)x->mem;
+}
+
+static inline void **ptrs(const BTree *t, const node *x) {
+    return (void**)(void*)((unsigned char*)x->mem + t->ptr_off);
+}
+
+static inline node *child(const BTree *t, const node *x, size_t i) {
+    return ptrs(t, x)[i];
+}
+
+static inline size_t round_up(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+
+static int key_cmp(const BTree *t, const void *a, const void *b) {
+    if (t->compare) return t->compare(a, b);
+    int32_t x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return (x > y) - (x < y);
+}
+
+
+static node *node_alloc(const BTree *t, bool leaf) {
+    node *x = vec_data_alloc(&node_alloc_opts, t->node_bytes);
+    if (!x) return NULL;
+    memset(x, 0, t->node_bytes);
+    x->leaf = leaf;
+    return x;
+}
+
+
+// room for the nodes a put may split into (one per level and a new root)
+static bool reserve(BTree *t) {
+    while (t->n_spare < t->height + 1) {
+        node *x = node_alloc(t, false);
+        if (!x) return false;
+        x->next = t->spare;
+        t->spare = x;
+        t->n_spare++;
+    }
+    return true;
+}
+
+static node *take_spare(BTree *t, bool leaf) {
+    node *x = t->spare;
+    t->spare = x->next;
+    t->n_spare--;
+    memset(x, 0, t->node_bytes);
+    x->leaf = leaf;
+    return x;
+}
+
+static void release(BTree *t, node *x) {
+    if (t->n_spare < t->height + 2) {
+        x->next = t->spare;
+        t->spare = x;
+        t->n_spare++;
+        return;
+    }
+    free(x);
+}
+
+
+static BTree *tree_init(size_t key_size, int (*compare)(const void*, const void*), void (*free_data)(void*)) {
+    if (key_size < 1 || (!compare && key_size != sizeof(int32_t))) return (BTree*)0;
+
+    BTree *t = malloc(sizeof(*t));
+    if (!t) return (BTree*)0;
+
+    // node_keys + 1 keys (padded for whole 32 byte loads) and node_keys + 2 pointers
+    size_t head = offsetof(node, mem), keys = BTREE_NODE_BYTES / (key_size + sizeof(void*));
+    while (keys > BTREE_MIN_KEYS && head + round_up((keys + 1) * key_size, 32) + (keys + 2) * sizeof(void*) > BTREE_NODE_BYTES) keys--;
+    if (!compare && keys > 63) keys = 63;   // one 64-bit compare mask per node
+    if (keys < BTREE_MIN_KEYS) keys = BTREE_MIN_KEYS;
+
+    t->key_size = key_size;
+    t->node_keys = keys;
+    t->ptr_off = round_up((keys + 1) * key_size, 32);
+    t->node_bytes = round_up(head + t->ptr_off + (keys + 2) * sizeof(void*), APUTIL_CACHE_LINE);
+    t->compare = compare;
+    t->free_data = free_data;
+    t->spare = NULL;
+    t->n_spare = 0;
+    t->size = 0;
+    t->height = 1;
+
+    t->root = t->first = node_alloc(t, true);
+    if (!t->root) {
+        free(t);
+        return (BTree*)0;
+    }
+    return t;
+}
+
+
+BTree *btree_new(size_t key_size, int (*compare)(const void*, const void*), void (*free_data)(void*)) {
+    return tree_init(key_size, compare, free_data);  // caller checks NULL
+}
+
+
+BTree *btree_i32_new(void (*free_data)(void*)) {
+    return tree_init(sizeof(int32_t), NULL, free_data);  // caller checks NULL
+}
+
+
+static void free_nodes(BTree *t, node *x, bool preserve) {
+    if (x->leaf) {
+        if (!preserve && t->free_data) {
+            for (size_t i = 0; i < x->n; i++) {
+                if (ptrs(t, x)[i]) t->free_data(ptrs(t, x)[i]);
+            }
+        }
+    } else {
+        for (size_t i = 0; i <= x->n; i++) free_nodes(t, child(t, x, i), preserve);
+    }
+    free(x);
+}
+
+
+void btree_free(BTree *t, bool preserve) {
+    if (!t) return;
+    free_nodes(t, t->root, preserve);
+    while (t->spare) {
+        node *x = t->spare;
+        t->spare = x->next;
+        free(x);
+    }
+    free(t);
+}
+
+// ###################### NODES ######################
+
+
+
+// ###################### SEARCH ######################
+
+#if BTREE_X86
+
+// one bit per key below (upper: not above) key, 8 keys per compare
+__attribute__((target("avx2,popcnt")))
+static size_t count_i32_avx2(const int32_t *keys, size_t n, int32_t key, bool upper) {
+    __m256i k = _mm256_set1_epi32(key);
+    uint64_t below = 0;
+    for (size_t c = 0; c < n; c += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(keys + c));
+        __m256i m = upper ? _mm256_cmpgt_epi32(x, k) : _mm256_cmpgt_epi32(k, x);
+        uint64_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(m));
+        below |= (upper ? ~bits & 0xff : bits) << c;
+    }
+    return (size_t)__builtin_popcountll(below & ((1ull << n) - 1));
+}
+
+#endif
+
+
+// branchless binary search, the same steps whatever the keys
+static size_t count_i32_scalar(const int32_t *keys, size_t n, int32_t key, bool upper) {
+    if (!n) return 0;
+    const int32_t *base = keys;
+    while (n > 1) {
+        size_t half = n / 2;
+        base += (size_t)(upper ? base[half] <= key : base[half] < key) * half;
+        n -= half;
+    }
+    return (size_t)(base - keys) + (upper ? *base <= key : *base < key);
+}
+
+
+static inline size_t count_i32(const node *x, int32_t key, bool upper) {
+#if BTREE_X86
+    if (aputil_have_avx2()) return count_i32_avx2(keys_i32(x), x->n, key, upper);
+#endif
+    return count_i32_scalar(keys_i32(x), x->n, key, upper);
+}
+
+
+// keys of x below key (upper: not above key), the slot key belongs in
+static size_t node_count(const BTree *t, const node *x, const void *key, bool upper) {
+    if (!t->compare) {
+        int32_t k;
+        memcpy(&k, key, sizeof(k));
+        return count_i32(x, k, upper);
+    }
+
+    size_t n = x->n, base = 0;
+    if (!n) return 0;
+    while (n > 1) {
+        size_t half = n / 2;
+        int c = t->compare(key_at(t, x, base + half), key);
+        base += (size_t)(upper ? c <= 0 : c < 0) * half;
+        n -= half;
+    }
+    int c = t->compare(key_at(t, x, base), key);
+    return base + (upper ? c <= 0 : c < 0);
+}
+
+
+static node *find_leaf(const BTree *t, const void *key) {
+    node *x = t->root;
+    while (!x->leaf) x = child(t, x, node_count(t, x, key, true));
+    return x;
+}
+
+
+// slot of key in its leaf or -1
+static intmax_t leaf_slot(const BTree *t, const node *x, const void *key) {
+    size_t i = node_count(t, x, key, false);
+    return i < x->n && key_cmp(t, key_at(t, x, i), key) == 0 ? (intmax_t)i : -1;
+}
+
+
+void *btree_get(const BTree *t, const void *key) {
+    if (!t || !key) return NULL;
+    node *x = find_leaf(t, key);
+    intmax_t i = leaf_slot(t, x, key);
+    return i < 0 ? NULL : ptrs(t, x)[i];
+}
+
+
+bool btree_contains(const BTree *t, const void *key) {
+    if (!t || !key) return false;
+    return leaf_slot(t, find_leaf(t, key), key) >= 0;
+}
+
+
+void *btree_i32_get(const BTree *t, int32_t key) {
+    if (!t || t->compare) return NULL;
+
+    const node *x = t->root;
+    while (!x->leaf) x = child(t, x, count_i32(x, key, true));
+    size_t i = count_i32(x, key, false);
+    return i < x->n && keys_i32(x)[i] == key ? ptrs(t, x)[i] : NULL;
+}
+
+// ###################### SEARCH ######################
+
+
+
+// ###################### PUT / REMOVE ######################
+
+static inline void move_keys(const BTree *t, node *dst, size_t di, const node *src, size_t si, size_t cnt) {
+    memmove(key_at(t, dst, di), key_at(t, src, si), cnt * t->key_size);
+}
+
+static inline void move_ptrs(const BTree *t, node *dst, size_t di, const node *src, size_t si, size_t cnt) {
+    memmove(ptrs(t, dst) + di, ptrs(t, src) + si, cnt * sizeof(void*));
+}
+
+
+// upper half of an overfull leaf into a new right sibling
+static node *split_leaf(BTree *t, node *x) {
+    node *r = take_spare(t, true);
+    size_t h = x->n / 2;
+    move_keys(t, r, 0, x, h, x->n - h);
+    move_ptrs(t, r, 0, x, h, x->n - h);
+    r->n = x->n - h;
+    x->n = (uint32_t)h;
+
+    r->next = x->next;
+    if (r->next) r->next->prev = r;
+    r->prev = x;
+    x->next = r;
+    return r;
+}
+
+
+// key h moves up (it stays readable in x at slot x->n), the keys after it go right
+static node *split_inner(BTree *t, node *x) {
+    node *r = take_spare(t, false);
+    size_t h = x->n / 2;
+    move_keys(t, r, 0, x, h + 1, x->n - h - 1);
+    move_ptrs(t, r, 0, x, h + 1, x->n - h);
+    r->n = x->n - (uint32_t)h - 1;
+    x->n = (uint32_t)h;
+    return r;
+}
+
+
+UTIL_ERR btree_put(BTree *t, const void *key, void *data) {
+    if (!t) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+
+    node *path[BTREE_MAX_HEIGHT];
+    size_t slot[BTREE_MAX_HEIGHT], depth = 0;
+    node *x = t->root;
+    while (!x->leaf) {
+        size_t c = node_count(t, x, key, true);
+        path[depth] = x;
+        slot[depth++] = c;
+        x = child(t, x, c);
+    }
+
+    size_t i = node_count(t, x, key, false);
+    if (i < x->n && key_cmp(t, key_at(t, x, i), key) == 0) {
+        void *old = ptrs(t, x)[i];
+        ptrs(t, x)[i] = data;
+        if (t->free_data && old && old != data) t->free_data(old);
+        return E_NOOP;
+    }
+    if (!reserve(t)) return E_BAD_ALLOC;
+
+    move_keys(t, x, i + 1, x, i, x->n - i);
+    move_ptrs(t, x, i + 1, x, i, x->n - i);
+    memcpy(key_at(t, x, i), key, t->key_size);
+    ptrs(t, x)[i] = data;
+    x->n++;
+    t->size++;
+    if (x->n <= t->node_keys) return E_SUCCESS;
+
+    // overfull: split and hand (separator, right node) to the parent, up to a new root
+    node *right = split_leaf(t, x);
+    const unsigned char *sep = key_at(t, right, 0);
+    while (right) {
+        if (!depth) {
+            node *root = take_spare(t, false);
+            memcpy(key_at(t, root, 0), sep, t->key_size);
+            ptrs(t, root)[0] = x;
+            ptrs(t, root)[1] = right;
+            root->n = 1;
+            t->root = root;
+            t->height++;
+            break;
+        }
+
+        node *p = path[--depth];
+        size_t c = slot[depth];
+        move_keys(t, p, c + 1, p, c, p->n - c);
+        move_ptrs(t, p, c + 2, p, c + 1, p->n - c);
+        memcpy(key_at(t, p, c), sep, t->key_size);
+        ptrs(t, p)[c + 1] = right;
+        p->n++;
+
+        x = p;
+        right = NULL;
+        if (p->n > t->node_keys) {
+            right = split_inner(t, p);
+            sep = key_at(t, p, p->n);
+        }
+    }
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR btree_i32_put(BTree *t, int32_t key, void *data) {
+    if (!t) return E_EMPTY_OBJ;
+    if (t->compare) return E_BAD_TYPE;
+    return btree_put(t, &key, data);
+}
+
+
+// child c of p fell under the minimum: take a key from a sibling with spare keys, or merge
+static void borrow_left(BTree *t, node *p, size_t c, node *l, node *x) {
+    move_keys(t, x, 1, x, 0, x->n);
+    if (x->leaf) {
+        move_ptrs(t, x, 1, x, 0, x->n);
+        move_keys(t, x, 0, l, l->n - 1, 1);
+        move_ptrs(t, x, 0, l, l->n - 1, 1);
+        move_keys(t, p, c - 1, x, 0, 1);
+    } else {
+        move_ptrs(t, x, 1, x, 0, x->n + 1);
+        move_keys(t, x, 0, p, c - 1, 1);
+        move_ptrs(t, x, 0, l, l->n, 1);
+        move_keys(t, p, c - 1, l, l->n - 1, 1);
+    }
+    l->n--;
+    x->n++;
+}
+
+static void borrow_right(BTree *t, node *p, size_t c, node *x, node *r) {
+    if (x->leaf) {
+        move_keys(t, x, x->n, r, 0, 1);
+        move_ptrs(t, x, x->n, r, 0, 1);
+        move_keys(t, r, 0, r, 1, r->n - 1);
+        move_ptrs(t, r, 0, r, 1, r->n - 1);
+        move_keys(t, p, c, r, 0, 1);
+    } else {
+        move_keys(t, x, x->n, p, c, 1);
+        move_ptrs(t, x, x->n + 1, r, 0, 1);
+        move_keys(t, p, c, r, 0, 1);
+        move_keys(t, r, 0, r, 1, r->n - 1);
+        move_ptrs(t, r, 0, r, 1, r->n);
+    }
+    r->n--;
+    x->n++;
+}
+
+// child i + 1 (b) into child i (a), separator i goes away
+static void merge(BTree *t, node *p, size_t i, node *a, node *b) {
+    if (a->leaf) {
+        move_keys(t, a, a->n, b, 0, b->n);
+        move_ptrs(t, a, a->n, b, 0, b->n);
+        a->n += b->n;
+        a->next = b->next;
+        if (a->next) a->next->prev = a;
+    } else {
+        move_keys(t, a, a->n, p, i, 1);
+        move_keys(t, a, a->n + 1, b, 0, b->n);
+        move_ptrs(t, a, a->n + 1, b, 0, b->n + 1);
+        a->n += 1 + b->n;
+    }
+    move_keys(t, p, i, p, i + 1, p->n - i - 1);
+    move_ptrs(t, p, i + 1, p, i + 2, p->n - i - 1);
+    p->n--;
+    release(t, b);
+}
+
+static void fix_child(BTree *t, node *p, size_t c) {
+    size_t min = t->node_keys / 2;
+    node *x = child(t, p, c);
+    node *l = c ? child(t, p, c - 1) : NULL, *r = c < p->n ? child(t, p, c + 1) : NULL;
+
+    if (l && l->n > min) borrow_left(t, p, c, l, x);
+    else if (r && r->n > min) borrow_right(t, p, c, x, r);
+    else if (l) merge(t, p, c - 1, l, x);
+    else merge(t, p, c, x, r);
+}
+
+
+UTIL_ERR btree_remove(BTree *t, const void *key, bool preserve) {
+    if (!t) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+
+    node *path[BTREE_MAX_HEIGHT];
+    size_t slot[BTREE_MAX_HEIGHT], depth = 0;
+    node *x = t->root;
+    while (!x->leaf) {
+        size_t c = node_count(t, x, key, true);
+        path[depth] = x;
+        slot[depth++] = c;
+        x = child(t, x, c);
+    }
+
+    intmax_t i = leaf_slot(t, x, key);
+    if (i < 0) return E_DOESNT_EXIST;
+
+    void *data = ptrs(t, x)[i];
+    move_keys(t, x, (size_t)i, x, (size_t)i + 1, x->n - (size_t)i - 1);
+    move_ptrs(t, x, (size_t)i, x, (size_t)i + 1, x->n - (size_t)i - 1);
+    x->n--;
+    t->size--;
+    if (!preserve && t->free_data && data) t->free_data(data);
+
+    // separators may name removed keys, they still split the key space correctly
+    while (depth && x->n < t->node_keys / 2) {
+        node *p = path[--depth];
+        fix_child(t, p, slot[depth]);
+        x = p;
+    }
+    if (!t->root->leaf && !t->root->n) {
+        node *old = t->root;
+        t->root = child(t, old, 0);
+        t->height--;
+        release(t, old);
+    }
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR btree_i32_remove(BTree *t, int32_t key, bool preserve) {
+    if (!t) return E_EMPTY_OBJ;
+    if (t->compare) return E_BAD_TYPE;
+    return btree_remove(t, &key, preserve);
+}
+
+// ###################### PUT / REMOVE ######################
+
+
+
+// ###################### BULK LOAD ######################
+
+// nodes for n keys: leaves, then each level of parents up to one root
+static size_t bulk_nodes(const BTree *t, size_t n) {
+    size_t m = (n + t->node_keys - 1) / t->node_keys, total = m;
+    while (m > 1) {
+        m = (m + t->node_keys) / (t->node_keys + 1);
+        total += m;
+    }
+    return total;
+}
+
+
+/*
+    leaves get n / L keys (the first n % L one more), each level above groups
+    its nodes the same way, so every node but the root is at least half full
+*/
+static UTIL_ERR bulk_build(BTree *t, const unsigned char *keys, size_t n, void *const *data) {
+    for (size_t i = 1; i < n; i++) {
+        if (key_cmp(t, keys + (i - 1) * t->key_size, keys + i * t->key_size) >= 0) return E_BAD_TYPE;
+    }
+    if (!n) return E_SUCCESS;
+
+    size_t total = bulk_nodes(t, n), used = 0;
+    node **nodes = malloc(sizeof(node*) * total);
+    const unsigned char **mins = malloc(sizeof(unsigned char*) * total);
+    if (!nodes || !mins) {
+        free(nodes);
+        free(mins);
+        return E_BAD_ALLOC;
+    }
+    for (size_t i = 0; i < total; i++) {
+        nodes[i] = node_alloc(t, false);
+        if (!nodes[i]) {
+            while (i--) free(nodes[i]);
+            free(nodes);
+            free(mins);
+            return E_BAD_ALLOC;
+        }
+    }
+
+    size_t m = (n + t->node_keys - 1) / t->node_keys, at = 0;
+    for (size_t j = 0; j < m; j++) {
+        node *x = nodes[j];
+        size_t cnt = n / m + (j < n % m);
+        x->leaf = true;
+        x->n = (uint32_t)cnt;
+        memcpy(x->mem, keys + at * t->key_size, cnt * t->key_size);
+        if (data) memcpy(ptrs(t, x), data + at, cnt * sizeof(void*));
+        x->prev = j ? nodes[j - 1] : NULL;
+        x->next = j + 1 < m ? nodes[j + 1] : NULL;
+        mins[j] = key_at(t, x, 0);
+        at += cnt;
+    }
+    used = m;
+
+    // level by level, the level below is nodes[below .. below + m)
+    size_t below = 0, height = 1;
+    while (m > 1) {
+        size_t groups = (m + t->node_keys) / (t->node_keys + 1), from = below;
+        for (size_t g = 0; g < groups; g++) {
+            node *x = nodes[used + g];
+            size_t cnt = m / groups + (g < m % groups);
+            x->n = (uint32_t)(cnt - 1);
+            for (size_t j = 0; j < cnt; j++) {
+                ptrs(t, x)[j] = nodes[from + j];
+                if (j) memcpy(key_at(t, x, j - 1), mins[from + j], t->key_size);
+            }
+            mins[used + g] = mins[from];
+            from += cnt;
+        }
+        below = used;
+        used += groups;
+        m = groups;
+        height++;
+    }
+
+    free(t->root);
+    t->root = nodes[used - 1];
+    t->first = nodes[0];
+    t->height = height;
+    t->size = n;
+    free(nodes);
+    free(mins);
+    return E_SUCCESS;
+}
+
+
+BTree *btree_from_sorted(const Vector *keys, void *const *data, int (*compare)(const void*, const void*),
+                         void (*free_data)(void*), UTIL_ERR *e) {
+    if (!keys) {
+        *e = E_EMPTY_OBJ;
+        return (BTree*)0;
+    }
+    if (!compare) {
+        *e = E_EMPTY_FUNC;
+        return (BTree*)0;
+    }
+
+    BTree *t = btree_new(keys->elem_size, compare, free_data);
+    if (!t) {
+        *e = E_BAD_ALLOC;
+        return (BTree*)0;
+    }
+    UTIL_ERR err = bulk_build(t, keys->data, keys->size, data);
+    if (err) {
+        btree_free(t, true);
+        *e = err;
+        return (BTree*)0;
+    }
+    return t;
+}
+
+
+BTree *btree_i32_from_sorted(const Vec_i32 *keys, void *const *data, void (*free_data)(void*), UTIL_ERR *e) {
+    if (!keys) {
+        *e = E_EMPTY_OBJ;
+        return (BTree*)0;
+    }
+
+    BTree *t = btree_i32_new(free_data);
+    if (!t) {
+        *e = E_BAD_ALLOC;
+        return (BTree*)0;
+    }
+    UTIL_ERR err = bulk_build(t, (const unsigned char*)keys->data, keys->size, data);
+    if (err) {
+        btree_free(t, true);
+        *e = err;
+        return (BTree*)0;
+    }
+    return t;
+}
+
+// ###################### BULK LOAD ######################
+
+
+
+// ###################### ITERATION ######################
+
+// past the end of a leaf continues at the next one (only the root leaf is ever empty)
+static BTree_iter iter_at(const BTree *t, node *leaf, size_t idx) {
+    if (leaf && idx >= leaf->n) {
+        leaf = leaf->next;
+        idx = 0;
+    }
+    return (BTree_iter){ .t = t, .leaf = leaf, .idx = idx };
+}
+
+
+BTree_iter btree_lower_bound(const BTree *t, const void *key) {
+    if (!t) return (BTree_iter){ .t = t, .leaf = NULL, .idx = 0 };
+    if (!key) return iter_at(t, t->first, 0);
+
+    node *x = find_leaf(t, key);
+    return iter_at(t, x, node_count(t, x, key, false));
+}
+
+
+BTree_iter btree_i32_lower_bound(const BTree *t, int32_t key) {
+    if (!t || t->compare) return (BTree_iter){ .t = t, .leaf = NULL, .idx = 0 };
+    return btree_lower_bound(t, &key);
+}
+
+
+bool btree_iter_valid(const BTree_iter *it) {
+    return it && it->leaf && it->idx < it->leaf->n;
+}
+
+
+const void *btree_iter_key(const BTree_iter *it) {
+    if (!btree_iter_valid(it)) return NULL;
+    return key_at(it->t, it->leaf, it->idx);
+}
+
+
+void *btree_iter_data(const BTree_iter *it) {
+    if (!btree_iter_valid(it)) return NULL;
+    return ptrs(it->t, it->leaf)[it->idx];
+}
+
+
+void btree_iter_next(BTree_iter *it) {
+    if (!btree_iter_valid(it)) return;
+    *it = iter_at(it->t, it->leaf, it->idx + 1);
+}
+
+
+size_t btree_range(const BTree *t, const void *lo, const void *hi, void (*visit)(const void *key, void *data, void *arg), void *arg) {
+    if (!t || !visit) return 0;
+
+    size_t cnt = 0;
+    for (BTree_iter it = btree_lower_bound(t, lo); btree_iter_valid(&it); btree_iter_next(&it)) {
+        const void *key = btree_iter_key(&it);
+        if (hi && key_cmp(t, key, hi) >= 0) break;
+        visit(key, btree_iter_data(&it), arg);
+        cnt++;
+    }
+    return cnt;
+}
+
+// ###################### ITERATION ######################
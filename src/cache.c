@@ -0,0 +1,518 @@
+/*
+ *  caches
+ *  hash index over intrusive use lists
+ *      > entries are one allocation: list node first, then index chain,
+ *        hash, charged bytes and the key inline, so a list releasing the
+ *        node with free() releases the whole entry
+ *      > the index chains entries per bucket, the bucket count doubles once
+ *        it is passed by the entry count
+ *      > every use count list (struct aputil_cache_freq) is an APUTIL_LList
+ *        with the cache's free hook, lfu keeps them ascending and drops the
+ *        empty ones, lru only ever has the one
+ *
+ *  index
+ *  use lists
+ *  cache
+ *  sharded cache
+ */
+
+#include <unistd.h>
+#include "../include/aputils.h"
+
+
+#define CACHE_FIB 0x9e3779b97f4a7c15ull
+
+
+struct aputil_cache_freq {
+    APUTIL_LList lst;                   // most recent first
+    size_t freq;
+    struct aputil_cache_freq *prev;
+    struct aputil_cache_freq *next;
+};
+
+
+static inline APUTIL_Cache_entry *entry_of(APUTIL_Node *n) {
+    return (APUTIL_Cache_entry*)n;
+}
+
+
+
+// ###################### INDEX ######################
+
+static inline uint64_t key_hash(const APUTIL_Cache *c, const void *key) {
+    return c->hash ? c->hash(key) : hash_bytes(key, c->key_size);
+}
+
+static inline bool key_equal(const APUTIL_Cache *c, const void *a, const void *b) {
+    return c->equal ? c->equal(a, b) : memcmp(a, b, c->key_size) == 0;
+}
+
+static inline size_t bucket_of(const APUTIL_Cache *c, uint64_t h) {
+    return (size_t)((h * CACHE_FIB) >> c->shift);
+}
+
+
+// link slot for key, *slot is the entry or NULL when absent
+static APUTIL_Cache_entry **index_slot(const APUTIL_Cache *c, const void *key, uint64_t h) {
+    APUTIL_Cache_entry **slot = &c->index[bucket_of(c, h)];
+    while (*slot && ((*slot)->hash != h || !key_equal(c, (*slot)->key, key))) slot = &(*slot)->chain;
+    return slot;
+}
+
+
+static void index_unlink(APUTIL_Cache *c, APUTIL_Cache_entry *en) {
+    APUTIL_Cache_entry **slot = &c->index[bucket_of(c, en->hash)];
+    while (*slot != en) slot = &(*slot)->chain;
+    *slot = en->chain;
+}
+
+
+// double the buckets, a failed grow only leaves chains longer
+static void index_grow(APUTIL_Cache *c) {
+    if (c->n_buckets > SIZE_MAX / 2 / sizeof(APUTIL_Cache_entry*)) return;
+    size_t n = c->n_buckets * 2;
+    APUTIL_Cache_entry **index = calloc(n, sizeof(APUTIL_Cache_entry*));
+    if (!index) return;
+
+    APUTIL_Cache_entry **old = c->index;
+    size_t old_n = c->n_buckets;
+    c->index = index;
+    c->n_buckets = n;
+    c->shift--;
+    for (size_t i = 0; i < old_n; i++) {
+        APUTIL_Cache_entry *en = old[i];
+        while (en) {
+            APUTIL_Cache_entry *next = en->chain;
+            size_t b = bucket_of(c, en->hash);
+            en->chain = index[b];
+            index[b] = en;
+            en = next;
+        }
+    }
+    free(old);
+}
+
+// ###################### INDEX ######################
+
+
+
+// ###################### USE LISTS ######################
+
+static struct aputil_cache_freq *freq_new(const APUTIL_Cache *c, size_t freq) {
+    struct aputil_cache_freq *f = calloc(1, sizeof(*f));
+    if (!f) return (struct aputil_cache_freq*)0;
+    f->lst.free = c->free;
+    f->lst.copydata = c->copydata;
+    f->freq = freq;
+    return f;
+}
+
+
+// link f into the ascending chain after prev (NULL for the front)
+static void freq_link(APUTIL_Cache *c, struct aputil_cache_freq *f, struct aputil_cache_freq *prev) {
+    f->prev = prev;
+    f->next = prev ? prev->next : c->freqs;
+    if (f->next) f->next->prev = f;
+    if (prev) prev->next = f;
+    else c->freqs = f;
+}
+
+
+static void freq_drop(APUTIL_Cache *c, struct aputil_cache_freq *f) {
+    if (f->prev) f->prev->next = f->next;
+    else c->freqs = f->next;
+    if (f->next) f->next->prev = f->prev;
+    free(f);
+}
+
+
+// a use: lru moves to the head, lfu to the head of the next count's list
+static void entry_touch(APUTIL_Cache *c, APUTIL_Cache_entry *en) {
+    struct aputil_cache_freq *f = en->freq;
+    if (c->policy == cache_lru) {
+        aputil_llist_move_front(&f->lst, &en->node);
+        return;
+    }
+
+    struct aputil_cache_freq *nf = f->next;
+    if (!nf || nf->freq != f->freq + 1) {
+        // this entry alone at its count, it can take the count up with it
+        if (f->lst.cnt == 1) {
+            f->freq++;
+            return;
+        }
+        nf = freq_new(c, f->freq + 1);
+        if (!nf) {
+            aputil_llist_move_front(&f->lst, &en->node);
+            return;
+        }
+        freq_link(c, nf, f);
+    }
+
+    aputil_llist_unlink(&f->lst, &en->node);
+    aputil_llist_link_front(&nf->lst, &en->node);
+    en->freq = nf;
+    if (!f->lst.cnt) freq_drop(c, f);
+}
+
+
+// least recent entry of the lowest count, skipping skip
+static APUTIL_Cache_entry *victim(const APUTIL_Cache *c, const APUTIL_Cache_entry *skip) {
+    for (struct aputil_cache_freq *f = c->freqs; f; f = f->next) {
+        APUTIL_Node *n = f->lst.tail;
+        if (n && entry_of(n) == skip) n = n->prev;
+        if (n) return entry_of(n);
+    }
+    return (APUTIL_Cache_entry*)0;
+}
+
+// ###################### USE LISTS ######################
+
+
+
+// ###################### CACHE ######################
+
+APUTIL_Cache *aputil_cache_new(
+    CACHEPOLICY policy,
+    size_t key_size,
+    size_t max_entries,                 // 0 for no limit
+    size_t max_bytes,                   // 0 for no limit
+    void (*free_data)(void*),           // data free, can be null
+    void *(*copydata)(const void*),     // data copy, can be null
+    uint64_t (*hash)(const void*),      // can be null, hashes key_size bytes
+    bool (*equal)(const void*, const void*),    // can be null, compares key_size bytes
+    UTIL_ERR *e
+) {
+    if (!key_size || (policy != cache_lru && policy != cache_lfu)) {
+        *e = E_EMPTY_ARG;
+        return (APUTIL_Cache*)0;
+    }
+
+    APUTIL_Cache *new_cache = malloc(sizeof(*new_cache));
+    if (!new_cache) {
+        *e = E_BAD_ALLOC;
+        return (APUTIL_Cache*)0;
+    }
+
+    new_cache->policy = policy;
+    new_cache->key_size = key_size;
+    new_cache->max_entries = max_entries;
+    new_cache->max_bytes = max_bytes;
+    new_cache->free = free_data;
+    new_cache->copydata = copydata;
+    new_cache->hash = hash;
+    new_cache->equal = equal;
+    new_cache->cnt = new_cache->bytes = 0;
+    new_cache->hits = new_cache->misses = new_cache->evictions = 0;
+    new_cache->freqs = NULL;
+    new_cache->n_buckets = CACHE_INDEX_INIT;
+    new_cache->shift = 64 - (unsigned)__builtin_ctzll(CACHE_INDEX_INIT);
+    new_cache->index = calloc(CACHE_INDEX_INIT, sizeof(APUTIL_Cache_entry*));
+
+    // lru's one list lives as long as the cache
+    struct aputil_cache_freq *f = policy == cache_lru ? freq_new(new_cache, 0) : NULL;
+    if (!new_cache->index || (policy == cache_lru && !f)) {
+        free(new_cache->index);
+        free(new_cache);
+        *e = E_BAD_ALLOC;
+        return (APUTIL_Cache*)0;
+    }
+    if (f) freq_link(new_cache, f, NULL);
+
+    return new_cache;
+}
+
+
+void aputil_cache_clear(APUTIL_Cache *c, bool preserve) {
+    if (!c) return;
+
+    struct aputil_cache_freq *f = c->freqs;
+    while (f) {
+        struct aputil_cache_freq *next = f->next;
+        // entries start with their node, the list's release frees the whole entry
+        aputil_llist_clear(&f->lst, preserve);
+        if (c->policy == cache_lfu) freq_drop(c, f);
+        f = next;
+    }
+    memset(c->index, 0, c->n_buckets * sizeof(APUTIL_Cache_entry*));
+    c->cnt = c->bytes = 0;
+}
+
+
+void aputil_cache_free(APUTIL_Cache *c, bool preserve) {
+    if (!c) return;
+    aputil_cache_clear(c, preserve);
+    if (c->freqs) free(c->freqs);
+    free(c->index);
+    free(c);
+}
+
+
+// unlink en everywhere and free it, its data unless preserve
+static void entry_drop(APUTIL_Cache *c, APUTIL_Cache_entry *en, bool preserve) {
+    index_unlink(c, en);
+    struct aputil_cache_freq *f = en->freq;
+    aputil_llist_unlink(&f->lst, &en->node);
+    if (c->policy == cache_lfu && !f->lst.cnt) freq_drop(c, f);
+
+    if (c->free && !preserve) c->free(en->node.data);
+    c->cnt--;
+    c->bytes -= en->bytes;
+    free(en);
+}
+
+
+// evict until entries more entries and add more bytes fit, never keep
+static void make_room(APUTIL_Cache *c, size_t add, size_t entries, const APUTIL_Cache_entry *keep) {
+    while ((c->max_entries && c->cnt + entries > c->max_entries) || (c->max_bytes && c->bytes + add > c->max_bytes)) {
+        APUTIL_Cache_entry *v = victim(c, keep);
+        if (!v) return;
+        entry_drop(c, v, false);
+        c->evictions++;
+    }
+}
+
+
+static void *cache_get_h(APUTIL_Cache *c, const void *key, uint64_t h) {
+    APUTIL_Cache_entry *en = *index_slot(c, key, h);
+    if (!en) {
+        c->misses++;
+        return NULL;
+    }
+    c->hits++;
+    entry_touch(c, en);
+    return en->node.data;
+}
+
+
+void *aputil_cache_get(APUTIL_Cache *c, const void *key) {
+    if (!c || !key) return NULL;
+    return cache_get_h(c, key, key_hash(c, key));
+}
+
+
+void *aputil_cache_peek(const APUTIL_Cache *c, const void *key) {
+    if (!c || !key) return NULL;
+    APUTIL_Cache_entry *en = *index_slot(c, key, key_hash(c, key));
+    return en ? en->node.data : NULL;
+}
+
+
+static UTIL_ERR cache_put_h(APUTIL_Cache *c, const void *key, uint64_t h, void *data, size_t bytes) {
+    if (c->max_bytes && bytes > c->max_bytes) return E_FULL;
+
+    APUTIL_Cache_entry *en = *index_slot(c, key, h);
+    if (en) {
+        // replace in place, the entry keeps its use count
+        if (c->free && en->node.data != data) c->free(en->node.data);
+        en->node.data = data;
+        c->bytes = c->bytes - en->bytes + bytes;
+        en->bytes = bytes;
+        entry_touch(c, en);
+        make_room(c, 0, 0, en);
+        return E_SUCCESS;
+    }
+
+    if (c->key_size > SIZE_MAX - sizeof(*en)) return E_BAD_ALLOC;
+    en = malloc(sizeof(*en) + c->key_size);
+    if (!en) return E_BAD_ALLOC;
+
+    // evict first, it may drop the count 1 list
+    make_room(c, bytes, 1, NULL);
+
+    // lfu new entries start at count 1, in front of everything used more
+    struct aputil_cache_freq *f = c->freqs;
+    if (c->policy == cache_lfu && (!f || f->freq != 1)) {
+        f = freq_new(c, 1);
+        if (!f) {
+            free(en);
+            return E_BAD_ALLOC;
+        }
+        freq_link(c, f, NULL);
+    }
+
+    memcpy(en->key, key, c->key_size);
+    en->hash = h;
+    en->bytes = bytes;
+    en->freq = f;
+    en->node.data = data;
+    en->node.slab = NULL;
+    aputil_llist_link_front(&f->lst, &en->node);
+
+    APUTIL_Cache_entry **slot = &c->index[bucket_of(c, h)];
+    en->chain = *slot;
+    *slot = en;
+
+    c->cnt++;
+    c->bytes += bytes;
+    if (c->cnt > c->n_buckets) index_grow(c);
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR aputil_cache_put(APUTIL_Cache *c, const void *key, void *data, size_t bytes) {
+    if (!c) return E_EMPTY_OBJ;
+    if (!key || !data) return E_EMPTY_ARG;
+    return cache_put_h(c, key, key_hash(c, key), data, bytes);
+}
+
+
+static UTIL_ERR cache_remove_h(APUTIL_Cache *c, const void *key, uint64_t h, bool preserve) {
+    APUTIL_Cache_entry *en = *index_slot(c, key, h);
+    if (!en) return E_DOESNT_EXIST;
+    entry_drop(c, en, preserve);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR aputil_cache_remove(APUTIL_Cache *c, const void *key, bool preserve) {
+    if (!c) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+    return cache_remove_h(c, key, key_hash(c, key), preserve);
+}
+
+
+UTIL_ERR aputil_cache_evict(APUTIL_Cache *c) {
+    if (!c) return E_EMPTY_OBJ;
+
+    APUTIL_Cache_entry *v = victim(c, NULL);
+    if (!v) return E_NODATA;
+    entry_drop(c, v, false);
+    c->evictions++;
+    return E_SUCCESS;
+}
+
+// ###################### CACHE ######################
+
+
+
+// ###################### SHARDED CACHE ######################
+
+static inline aputil_cache_shard *shard_of(const APUTIL_Cache_sharded *c, uint64_t h) {
+    return &c->shards[((h * CACHE_FIB) >> 32) & (c->n_shards - 1)];
+}
+
+static inline uint64_t sharded_hash(const APUTIL_Cache_sharded *c, const void *key) {
+    return c->hash ? c->hash(key) : hash_bytes(key, c->key_size);
+}
+
+
+APUTIL_Cache_sharded *aputil_cache_sharded_new(size_t n_shards, CACHEPOLICY policy, size_t key_size, size_t max_entries, size_t max_bytes,
+                                               void (*free_data)(void*), void *(*copydata)(const void*),
+                                               uint64_t (*hash)(const void*), bool (*equal)(const void*, const void*), UTIL_ERR *e) {
+    // gets hand out copies, the stored data can be evicted once the shard lock is released
+    if (!copydata) {
+        *e = E_EMPTY_FUNC;
+        return (APUTIL_Cache_sharded*)0;  // caller checks NULL
+    }
+    if (!n_shards) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        n_shards = online > 0 ? (size_t)online : 1;
+    }
+    size_t shards = 1;
+    while (shards < n_shards) {
+        if (shards > SIZE_MAX / 2 / sizeof(aputil_cache_shard)) {
+            *e = E_BAD_ALLOC;
+            return (APUTIL_Cache_sharded*)0;
+        }
+        shards *= 2;
+    }
+    // every shard needs at least one entry / byte, 0 would mean no limit
+    while (shards > 1 && ((max_entries && shards > max_entries) || (max_bytes && shards > max_bytes))) shards /= 2;
+
+    APUTIL_Cache_sharded *new_cache = malloc(sizeof(*new_cache));
+    void *mem = NULL;
+    if (!new_cache || posix_memalign(&mem, APUTIL_CACHE_LINE, shards * sizeof(aputil_cache_shard))) {
+        free(new_cache);
+        *e = E_BAD_ALLOC;
+        return (APUTIL_Cache_sharded*)0;
+    }
+    new_cache->shards = mem;
+    new_cache->n_shards = 0;
+    new_cache->hash = hash;
+    new_cache->key_size = key_size;
+
+    // limits split evenly, the first shards take the remainder so the shards sum to the limits
+    for (size_t i = 0; i < shards; i++, new_cache->n_shards++) {
+        size_t per_entries = max_entries / shards + (i < max_entries % shards);
+        size_t per_bytes = max_bytes / shards + (i < max_bytes % shards);
+        aputil_cache_shard *s = &new_cache->shards[i];
+        s->cache = aputil_cache_new(policy, key_size, per_entries, per_bytes, free_data, copydata, hash, equal, e);
+        if (!s->cache) {
+            aputil_cache_sharded_free(new_cache, true);
+            return (APUTIL_Cache_sharded*)0;
+        }
+        if (pthread_mutex_init(&s->lock, NULL)) {
+            aputil_cache_free(s->cache, true);
+            aputil_cache_sharded_free(new_cache, true);
+            *e = E_BAD_ALLOC;
+            return (APUTIL_Cache_sharded*)0;
+        }
+    }
+
+    return new_cache;
+}
+
+
+void aputil_cache_sharded_free(APUTIL_Cache_sharded *c, bool preserve) {
+    if (!c) return;
+    for (size_t i = 0; i < c->n_shards; i++) {
+        aputil_cache_free(c->shards[i].cache, preserve);
+        pthread_mutex_destroy(&c->shards[i].lock);
+    }
+    free(c->shards);
+    free(c);
+}
+
+
+void *aputil_cache_sharded_get(APUTIL_Cache_sharded *c, const void *key, UTIL_ERR *e) {
+    if (!c) {
+        *e = E_EMPTY_OBJ;
+        return NULL;
+    }
+    if (!key) {
+        *e = E_EMPTY_ARG;
+        return NULL;
+    }
+
+    uint64_t h = sharded_hash(c, key);
+    aputil_cache_shard *s = shard_of(c, h);
+    void *copy = NULL;
+
+    pthread_mutex_lock(&s->lock);
+    void *data = cache_get_h(s->cache, key, h);
+    if (!data) *e = E_DOESNT_EXIST;
+    else if (!(copy = s->cache->copydata(data))) *e = E_BAD_ALLOC;
+    pthread_mutex_unlock(&s->lock);
+
+    return copy;
+}
+
+
+UTIL_ERR aputil_cache_sharded_put(APUTIL_Cache_sharded *c, const void *key, void *data, size_t bytes) {
+    if (!c) return E_EMPTY_OBJ;
+    if (!key || !data) return E_EMPTY_ARG;
+
+    uint64_t h = sharded_hash(c, key);
+    aputil_cache_shard *s = shard_of(c, h);
+    pthread_mutex_lock(&s->lock);
+    UTIL_ERR err = cache_put_h(s->cache, key, h, data, bytes);
+    pthread_mutex_unlock(&s->lock);
+    return err;
+}
+
+
+UTIL_ERR aputil_cache_sharded_remove(APUTIL_Cache_sharded *c, const void *key, bool preserve) {
+    if (!c) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+
+    uint64_t h = sharded_hash(c, key);
+    aputil_cache_shard *s = shard_of(c, h);
+    pthread_mutex_lock(&s->lock);
+    UTIL_ERR err = cache_remove_h(s->cache, key, h, preserve);
+    pthread_mutex_unlock(&s->lock);
+    return err;
+}
+
+// ###################### SHARDED CACHE ######################
@@ -3,7 +3,11 @@
  *
  */
 
-#include "../include/aputils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../include/aputils_internal.h"
 
 
 const char *UTIL_ERR_PRINT(UTIL_ERR e) {
@@ -19,7 +23,81 @@ const char *UTIL_ERR_PRINT(UTIL_ERR e) {
         case -8: return "E_NODATA";
         case -9: return "E_DOESNT_EXIST";
         case -10: return "E_BAD_TYPE";
+        case -11: return "E_FULL";
+        case -12: return "E_IO";
+        case -13: return "E_CORRUPT";
         default:
     }
     return "UNDEF";
-}
\ No newline at end of file
+}
+
+
+// ###################### CPU FEATURES ######################
+
+#if defined(__x86_64__) || defined(__i386__)
+bool aputil_have_avx2(void) {
+    // -1 until probed, racing first calls store the same answer
+    static _Atomic int avx2 = -1;
+    int v = atomic_load_explicit(&avx2, memory_order_relaxed);
+    if (v < 0) {
+        __builtin_cpu_init();
+        v = __builtin_cpu_supports("avx2") ? 1 : 0;
+        atomic_store_explicit(&avx2, v, memory_order_relaxed);
+    }
+    return v;
+}
+#else
+bool aputil_have_avx2(void) { return false; }
+#endif
+
+// ###################### CPU FEATURES ######################
+
+
+
+// ###################### FILE REPLACE ######################
+
+static _Atomic unsigned replace_seq;
+
+
+int aputil_replace_open(const char *path, char **tmp) {
+    size_t cap = strlen(path) + 48;
+    char *name = malloc(cap);
+    if (!name) return -1;
+
+    struct stat st;
+    bool exists = stat(path, &st) == 0;
+
+    // O_EXCL instead of mkstemp so a new file's 0666 goes through the umask like open(path) would
+    int fd = -1;
+    for (int tries = 0; fd < 0 && tries < 64; tries++) {
+        unsigned seq = atomic_fetch_add_explicit(&replace_seq, 1, memory_order_relaxed);
+        snprintf(name, cap, "%s.tmp%ld.%u", path, (long)getpid(), seq);
+        fd = open(name, O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (fd < 0 && errno != EEXIST) break;
+    }
+    if (fd < 0) {
+        free(name);
+        return -1;
+    }
+
+    // replacing keeps the target's permissions
+    if (exists && fchmod(fd, st.st_mode & 07777) != 0) {
+        close(fd);
+        unlink(name);
+        free(name);
+        return -1;
+    }
+
+    *tmp = name;
+    return fd;
+}
+
+
+bool aputil_replace_finish(char *tmp, const char *path, bool ok) {
+    if (ok && rename(tmp, path) != 0) ok = false;
+    if (!ok) unlink(tmp);
+    free(tmp);
+    return ok;
+}
+
+// ###################### FILE REPLACE ######################
@@ -0,0 +1,446 @@
+/*
+ *  deques
+ *  circular buffer backed double ended queues
+ *      > elements live in [head, head + size) modulo cap
+ *      > O(1) amortized push/pop at both ends, O(1) random access
+ *      > storage is interchangeable with Vector/Vec_i32, conversions hand
+ *        the buffer over and only rotate it (bulk memmove) when wrapped
+ *
+ *  generic deque (elem_size bytes per element)
+ *  i32 deque
+ */
+
+#include "../include/aputils.h"
+
+
+static void deque_fatal(const char* err) {
+    fprintf(stderr, "%s\n", err);
+    exit(1);
+}
+
+
+// physical slot of logical index
+static inline size_t deque_slot(size_t head, size_t idx, size_t cap) {
+    size_t s = head + idx;
+    return s >= cap ? s - cap : s;
+}
+
+
+/*
+    rotate a wrapped buffer so the logical front is at slot 0
+    [ b b b . . . a a a a ]  ->  [ a a a a b b b . . . ]
+    a = cap - head elements at the end, b = size - a elements at the start
+    only the smaller part goes through a temporary buffer
+*/
+static void rotate_to_front(char *data, size_t head, size_t size, size_t cap, size_t es) {
+    if (head == 0 || size == 0) return;
+
+    if (head + size <= cap) {
+        memmove(data, data + head * es, size * es);
+        return;
+    }
+
+    size_t a = cap - head, b = size - a;
+    if (b <= a) {
+        void *tmp = malloc(b * es);
+        if (!tmp) deque_fatal("failed to alloc deque rotation buffer");
+        memcpy(tmp, data, b * es);
+        memmove(data, data + head * es, a * es);
+        memcpy(data + a * es, tmp, b * es);
+        free(tmp);
+    } else {
+        void *tmp = malloc(a * es);
+        if (!tmp) deque_fatal("failed to alloc deque rotation buffer");
+        memcpy(tmp, data + head * es, a * es);
+        memmove(data + a * es, data, b * es);
+        memcpy(data, tmp, a * es);
+        free(tmp);
+    }
+}
+
+
+// ###################### GENERIC DEQUE ######################
+
+Deque *deque_new(size_t elem_size, size_t cap) {
+    if (elem_size < 1 || cap < 1) {
+        return (Deque*)0;  // caller checks NULL
+    }
+
+    Deque *new_dq = malloc(sizeof(*new_dq));
+    if (!new_dq) {
+        return (Deque*)0;
+    }
+
+    new_dq->data = malloc(elem_size * cap);
+    if (!new_dq->data) {
+        free(new_dq);
+        return (Deque*)0;
+    }
+
+    new_dq->head = 0;
+    new_dq->size = 0;
+    new_dq->cap = cap;
+    new_dq->elem_size = elem_size;
+
+    return new_dq;
+}
+
+
+void deque_free(Deque *d) {
+    if (!d) return;
+    free(d->data);
+    free(d);
+}
+
+
+static void deque_resize(Deque *d) {
+    if (!d) return;
+    if (d->size < d->cap) return;
+
+    size_t old_cap = d->cap;
+    d->cap *= 2;
+    d->data = realloc(d->data, d->cap * d->elem_size);
+    if (!d->data) {
+        deque_fatal("failed to realloc deque");
+    }
+
+    // the wrapped part [0, head) moves after the old end
+    if (d->head > 0) {
+        size_t wrapped = d->head + d->size - old_cap;
+        memcpy((char*)d->data + old_cap * d->elem_size, d->data, wrapped * d->elem_size);
+    }
+}
+
+
+UTIL_ERR deque_push_back(Deque *d, const void *elem) {
+    if (!d) return E_EMPTY_OBJ;
+    if (!elem) return E_EMPTY_ARG;
+    if (d->size == d->cap) deque_resize(d);
+
+    size_t slot = deque_slot(d->head, d->size, d->cap);
+    memcpy((char*)d->data + slot * d->elem_size, elem, d->elem_size);
+    d->size++;
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR deque_push_front(Deque *d, const void *elem) {
+    if (!d) return E_EMPTY_OBJ;
+    if (!elem) return E_EMPTY_ARG;
+    if (d->size == d->cap) deque_resize(d);
+
+    d->head = d->head == 0 ? d->cap - 1 : d->head - 1;
+    memcpy((char*)d->data + d->head * d->elem_size, elem, d->elem_size);
+    d->size++;
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR deque_pop_back(Deque *d, void *out) {
+    if (!d) return E_EMPTY_OBJ;
+    if (d->size == 0) return E_NODATA;
+
+    d->size--;
+    if (out) {
+        size_t slot = deque_slot(d->head, d->size, d->cap);
+        memcpy(out, (char*)d->data + slot * d->elem_size, d->elem_size);
+    }
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR deque_pop_front(Deque *d, void *out) {
+    if (!d) return E_EMPTY_OBJ;
+    if (d->size == 0) return E_NODATA;
+
+    if (out) memcpy(out, (char*)d->data + d->head * d->elem_size, d->elem_size);
+    d->head = deque_slot(d->head, 1, d->cap);
+    d->size--;
+    if (d->size == 0) d->head = 0;
+
+    return E_SUCCESS;
+}
+
+
+void *deque_get(const Deque *d, size_t idx, UTIL_ERR *e) {
+    if (!d) {
+        *e = E_EMPTY_OBJ;
+        return NULL;
+    }
+    if (idx >= d->size) {
+        *e = E_OUTOFBOUNDS;
+        return NULL;
+    }
+
+    return (char*)d->data + deque_slot(d->head, idx, d->cap) * d->elem_size;
+}
+
+
+UTIL_ERR deque_clear(Deque *d) {
+    if (!d) return E_EMPTY_OBJ;
+    if (d->size == 0) return E_NOOP;
+
+    d->head = 0;
+    d->size = 0;
+
+    return E_SUCCESS;
+}
+
+
+size_t deque_spans(const Deque *d, void **first, size_t *first_len, void **second, size_t *second_len) {
+    if (!d || !first || !first_len || !second || !second_len) return 0;
+
+    size_t front = d->cap - d->head < d->size ? d->cap - d->head : d->size;
+    *first = (char*)d->data + d->head * d->elem_size;
+    *first_len = front;
+    *second = front < d->size ? d->data : NULL;
+    *second_len = d->size - front;
+
+    return *second_len ? 2 : (front ? 1 : 0);
+}
+
+
+UTIL_ERR deque_make_contiguous(Deque *d) {
+    if (!d) return E_EMPTY_OBJ;
+    if (d->head == 0) return E_NOOP;
+
+    rotate_to_front(d->data, d->head, d->size, d->cap, d->elem_size);
+    d->head = 0;
+
+    return E_SUCCESS;
+}
+
+
+Deque *deque_from_vector(Vector *v) {
+    if (!v) return (Deque*)0;
+
+    Deque *new_dq = malloc(sizeof(*new_dq));
+    if (!new_dq) {
+        return (Deque*)0;
+    }
+
+    new_dq->data = v->data;
+    new_dq->head = 0;
+    new_dq->size = v->size;
+    new_dq->cap = v->cap;
+    new_dq->elem_size = v->elem_size;
+
+    free(v);    // container only, data now owned by the deque
+    return new_dq;
+}
+
+
+Vector *deque_to_vector(Deque *d) {
+    if (!d) return (Vector*)0;
+
+    Vector *new_vec = malloc(sizeof(*new_vec));
+    if (!new_vec) {
+        return (Vector*)0;
+    }
+
+    deque_make_contiguous(d);
+    new_vec->data = d->data;
+    new_vec->size = d->size;
+    new_vec->cap = d->cap;
+    new_vec->elem_size = d->elem_size;
+    new_vec->alloc = (Vec_alloc){0};
+
+    free(d);    // container only, data now owned by the vector
+    return new_vec;
+}
+
+// ###################### GENERIC DEQUE ######################
+
+// ###################### i32 DEQUE ######################
+
+Deque_i32 *deque_i32_new(size_t cap) {
+    if (cap < 1) {
+        return (Deque_i32*)0;  // caller checks NULL
+    }
+
+    Deque_i32 *new_dq = malloc(sizeof(*new_dq));
+    if (!new_dq) {
+        return (Deque_i32*)0;
+    }
+
+    new_dq->data = malloc(sizeof(int32_t) * cap);
+    if (!new_dq->data) {
+        free(new_dq);
+        return (Deque_i32*)0;
+    }
+
+    new_dq->head = 0;
+    new_dq->size = 0;
+    new_dq->cap = cap;
+
+    return new_dq;
+}
+
+
+void deque_i32_free(Deque_i32 *d) {
+    if (!d) return;
+    free(d->data);
+    free(d);
+}
+
+
+static void deque_i32_resize(Deque_i32 *d) {
+    if (!d) return;
+    if (d->size < d->cap) return;
+
+    size_t old_cap = d->cap;
+    d->cap *= 2;
+    d->data = realloc(d->data, d->cap * sizeof(int32_t));
+    if (!d->data) {
+        deque_fatal("failed to realloc deque");
+    }
+
+    if (d->head > 0) {
+        size_t wrapped = d->head + d->size - old_cap;
+        memcpy(d->data + old_cap, d->data, wrapped * sizeof(int32_t));
+    }
+}
+
+
+UTIL_ERR deque_i32_push_back(Deque_i32 *d, int32_t elem) {
+    if (!d) return E_EMPTY_OBJ;
+    if (d->size == d->cap) deque_i32_resize(d);
+
+    d->data[deque_slot(d->head, d->size, d->cap)] = elem;
+    d->size++;
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR deque_i32_push_front(Deque_i32 *d, int32_t elem) {
+    if (!d) return E_EMPTY_OBJ;
+    if (d->size == d->cap) deque_i32_resize(d);
+
+    d->head = d->head == 0 ? d->cap - 1 : d->head - 1;
+    d->data[d->head] = elem;
+    d->size++;
+
+    return E_SUCCESS;
+}
+
+
+int32_t deque_i32_pop_back(Deque_i32 *d, UTIL_ERR *e) {
+    if (!d) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+    if (d->size == 0) {
+        *e = E_NODATA;
+        return 0;
+    }
+
+    d->size--;
+    return d->data[deque_slot(d->head, d->size, d->cap)];
+}
+
+
+int32_t deque_i32_pop_front(Deque_i32 *d, UTIL_ERR *e) {
+    if (!d) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+    if (d->size == 0) {
+        *e = E_NODATA;
+        return 0;
+    }
+
+    int32_t elem = d->data[d->head];
+    d->head = deque_slot(d->head, 1, d->cap);
+    d->size--;
+    if (d->size == 0) d->head = 0;
+
+    return elem;
+}
+
+
+int32_t deque_i32_get(const Deque_i32 *d, size_t idx, UTIL_ERR *e) {
+    if (!d) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+    if (idx >= d->size) {
+        *e = E_OUTOFBOUNDS;
+        return 0;
+    }
+
+    return d->data[deque_slot(d->head, idx, d->cap)];
+}
+
+
+void deque_i32_clear(Deque_i32 *d) {
+    if (!d) return;
+    d->head = 0;
+    d->size = 0;
+}
+
+
+size_t deque_i32_spans(const Deque_i32 *d, int32_t **first, size_t *first_len, int32_t **second, size_t *second_len) {
+    if (!d || !first || !first_len || !second || !second_len) return 0;
+
+    size_t front = d->cap - d->head < d->size ? d->cap - d->head : d->size;
+    *first = d->data + d->head;
+    *first_len = front;
+    *second = front < d->size ? d->data : NULL;
+    *second_len = d->size - front;
+
+    return *second_len ? 2 : (front ? 1 : 0);
+}
+
+
+UTIL_ERR deque_i32_make_contiguous(Deque_i32 *d) {
+    if (!d) return E_EMPTY_OBJ;
+    if (d->head == 0) return E_NOOP;
+
+    rotate_to_front((char*)d->data, d->head, d->size, d->cap, sizeof(int32_t));
+    d->head = 0;
+
+    return E_SUCCESS;
+}
+
+
+Deque_i32 *deque_i32_from_vec(Vec_i32 *v) {
+    if (!v) return (Deque_i32*)0;
+
+    Deque_i32 *new_dq = malloc(sizeof(*new_dq));
+    if (!new_dq) {
+        return (Deque_i32*)0;
+    }
+
+    new_dq->data = v->data;
+    new_dq->head = 0;
+    new_dq->size = v->size;
+    new_dq->cap = v->cap;
+
+    free(v);
+    return new_dq;
+}
+
+
+Vec_i32 *deque_i32_to_vec(Deque_i32 *d) {
+    if (!d) return (Vec_i32*)0;
+
+    Vec_i32 *new_vec = malloc(sizeof(*new_vec));
+    if (!new_vec) {
+        return (Vec_i32*)0;
+    }
+
+    deque_i32_make_contiguous(d);
+    new_vec->data = d->data;
+    new_vec->size = d->size;
+    new_vec->cap = d->cap;
+    new_vec->alloc = (Vec_alloc){0};
+
+    free(d);
+    return new_vec;
+}
+
+// ###################### i32 DEQUE ######################
@@ -0,0 +1,311 @@
+/*
+ *  external sort
+ *  merge sort for files of fixed-size records that do not fit in memory
+ *      > the input is read in chunks of at most mem_budget bytes, each chunk
+ *        is sorted with vector_sort (or vector_stable_sort) and spilled to
+ *        an unlinked temp file with one large write
+ *      > runs are merged through a loser tree, every run gets its own
+ *        read-ahead buffer and the output is written in buffer sized blocks
+ *      > when there are more runs than the budget can buffer at once, groups
+ *        are merged into longer runs first (multi-pass)
+ *      > extsort_file writes a temp file next to out_path and renames it
+ *        over out_path, a failed sort leaves out_path (and in_path) as is
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include "../include/aputils_internal.h"
+#include "../include/sorting.h"
+
+
+typedef struct {
+    FILE *f;
+    size_t n;           // records in the run
+} ext_run;
+
+typedef struct {
+    FILE *f;
+    char *buf;
+    size_t pos;         // next record in buf
+    size_t cnt;         // records in buf
+    size_t cap;         // buf capacity in records
+    bool err;
+} run_reader;
+
+typedef struct {
+    run_reader *rd;
+    size_t rec_size;
+    int (*compare)(const void*, const void*);
+} ext_merge_ctx;
+
+
+// unlinked temp file in dir, removed by the OS once closed
+static FILE *run_tmpfile(const char *dir) {
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/aputil_extsort_XXXXXX", dir);
+    if (len < 0 || (size_t)len >= sizeof(path)) return NULL;
+
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    unlink(path);
+
+    FILE *f = fdopen(fd, "w+b");
+    if (!f) {
+        close(fd);
+        return NULL;
+    }
+    // reads and writes already go through budget sized buffers
+    setvbuf(f, NULL, _IONBF, 0);
+    return f;
+}
+
+
+static void close_runs(Vector *runs, size_t from) {
+    for (size_t i = from; i < runs->size; i++) {
+        fclose(((ext_run*)runs->data)[i].f);
+    }
+    runs->size = from;
+}
+
+
+static void reader_fill(run_reader *r, size_t rec_size) {
+    r->pos = 0;
+    r->cnt = fread(r->buf, rec_size, r->cap, r->f);
+    if (r->cnt < r->cap && ferror(r->f)) r->err = true;
+}
+
+
+static bool ext_merge_less(void *ctx, size_t a, size_t b) {
+    ext_merge_ctx *m = ctx;
+    run_reader *ra = &m->rd[a], *rb = &m->rd[b];
+    if (ra->pos == ra->cnt) return false;
+    if (rb->pos == rb->cnt) return true;
+    int c = m->compare(ra->buf + ra->pos * m->rec_size, rb->buf + rb->pos * m->rec_size);
+    return c < 0 || (c == 0 && a < b);
+}
+
+
+/*
+    merge k runs into out using budget bytes of buffers
+    the budget is split evenly between the k readers and the output block
+*/
+static UTIL_ERR merge_runs(ext_run *runs, size_t k, FILE *out, size_t rec_size, int (*compare)(const void*, const void*), size_t budget) {
+    size_t per_buf = budget / (k + 1) / rec_size;
+    if (per_buf < 1) per_buf = 1;
+
+    run_reader *rd = calloc(k, sizeof(*rd));
+    char *bufs = malloc((k + 1) * per_buf * rec_size);
+    if (!rd || !bufs) {
+        free(rd);
+        free(bufs);
+        return E_BAD_ALLOC;
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        rewind(runs[i].f);
+        posix_fadvise(fileno(runs[i].f), 0, 0, POSIX_FADV_SEQUENTIAL);
+        rd[i].f = runs[i].f;
+        rd[i].buf = bufs + i * per_buf * rec_size;
+        rd[i].cap = per_buf;
+        reader_fill(&rd[i], rec_size);
+    }
+
+    ext_merge_ctx ctx = { .rd = rd, .rec_size = rec_size, .compare = compare };
+    loser_tree lt;
+    if (!loser_tree_init(&lt, k, ext_merge_less, &ctx)) {
+        free(rd);
+        free(bufs);
+        return E_BAD_ALLOC;
+    }
+
+    UTIL_ERR err = E_SUCCESS;
+    char *obuf = bufs + k * per_buf * rec_size;
+    size_t on = 0;
+    for (;;) {
+        run_reader *w = &rd[lt.winner];
+        if (w->pos == w->cnt) break;    // the winner is exhausted, so are all runs
+
+        memcpy(obuf + on * rec_size, w->buf + w->pos * rec_size, rec_size);
+        w->pos++;
+        if (++on == per_buf) {
+            if (fwrite(obuf, rec_size, on, out) != on) {
+                err = E_IO;
+                break;
+            }
+            on = 0;
+        }
+        if (w->pos == w->cnt) reader_fill(w, rec_size);
+        loser_tree_replay(&lt);
+    }
+
+    if (err == E_SUCCESS && on && fwrite(obuf, rec_size, on, out) != on) err = E_IO;
+    for (size_t i = 0; i < k; i++) {
+        if (rd[i].err) err = E_IO;
+    }
+
+    loser_tree_free(&lt);
+    free(rd);
+    free(bufs);
+    return err;
+}
+
+
+/*
+    chunk phase: fill the chunk buffer, sort it, spill it as a run
+    a single chunk holding the whole input is written straight to out
+    returns E_NOOP when that happened and no merge is needed
+*/
+static UTIL_ERR make_runs(FILE *in, FILE *out, Vector *runs, size_t rec_size, int (*compare)(const void*, const void*), const Extsort_opts *o) {
+    size_t scratch_bytes = o->stable ? o->mem_budget / 3 : 0;
+    size_t chunk_recs = (o->mem_budget - scratch_bytes) / rec_size;
+    if (chunk_recs < 1) chunk_recs = 1;
+
+    Vector *chunk = vector_new(rec_size, chunk_recs);
+    Vec_char *scratch = o->stable ? vec_char_new(scratch_bytes ? scratch_bytes : rec_size) : NULL;
+    if (!chunk || (o->stable && !scratch)) {
+        vector_free(chunk);
+        vec_char_free(scratch);
+        return E_BAD_ALLOC;
+    }
+
+    UTIL_ERR err = E_SUCCESS;
+    size_t chunk_bytes = chunk_recs * rec_size;
+    for (;;) {
+        size_t got = fread(chunk->data, 1, chunk_bytes, in);
+        if (got < chunk_bytes && ferror(in)) {
+            err = E_IO;
+            break;
+        }
+        if (got % rec_size) {
+            err = E_IO;         // trailing partial record
+            break;
+        }
+        if (got == 0) break;
+
+        chunk->size = got / rec_size;
+        err = o->stable ? vector_stable_sort_buf(chunk, vector, compare, scratch)
+                        : vector_sort(chunk, vector, compare);
+        if (err != E_SUCCESS) break;
+
+        // everything fit in one chunk, no runs needed
+        if (runs->size == 0 && got < chunk_bytes) {
+            if (fwrite(chunk->data, rec_size, chunk->size, out) != chunk->size) err = E_IO;
+            else err = E_NOOP;
+            break;
+        }
+
+        ext_run run = { .f = run_tmpfile(o->tmp_dir), .n = chunk->size };
+        if (!run.f) {
+            err = E_IO;
+            break;
+        }
+        if (vector_add_back(runs, &run) != E_SUCCESS) {
+            fclose(run.f);
+            err = E_BAD_ALLOC;
+            break;
+        }
+        if (fwrite(chunk->data, rec_size, chunk->size, run.f) != chunk->size) {
+            err = E_IO;
+            break;
+        }
+        if (got < chunk_bytes) break;
+    }
+
+    vector_free(chunk);
+    vec_char_free(scratch);
+    return err;
+}
+
+
+UTIL_ERR extsort_stream(FILE *in, FILE *out, size_t rec_size, int (*compare)(const void*, const void*), const Extsort_opts *opts) {
+    if (!in || !out) return E_EMPTY_OBJ;
+    if (rec_size < 1) return E_EMPTY_ARG;
+    if (!compare) return E_EMPTY_FUNC;
+
+    Extsort_opts o = { .mem_budget = EXTSORT_DEFAULT_BUDGET, .tmp_dir = NULL, .stable = false };
+    if (opts) o = *opts;
+    if (o.mem_budget == 0) o.mem_budget = EXTSORT_DEFAULT_BUDGET;
+    if (!o.tmp_dir) o.tmp_dir = getenv("TMPDIR");
+    if (!o.tmp_dir || !*o.tmp_dir) o.tmp_dir = "/tmp";
+
+    Vector *runs = vector_new(sizeof(ext_run), 16);
+    if (!runs) return E_BAD_ALLOC;
+
+    posix_fadvise(fileno(in), 0, 0, POSIX_FADV_SEQUENTIAL);
+    UTIL_ERR err = make_runs(in, out, runs, rec_size, compare, &o);
+    if (err == E_NOOP) err = E_SUCCESS;
+    else if (err == E_SUCCESS && runs->size) {
+        // every reader plus the output block gets at least EXTSORT_MIN_READAHEAD
+        size_t fan_in = o.mem_budget / EXTSORT_MIN_READAHEAD;
+        fan_in = fan_in > 3 ? fan_in - 1 : 2;
+
+        // intermediate passes: merge groups of fan_in runs into longer runs, in order
+        while (err == E_SUCCESS && runs->size > fan_in) {
+            size_t nruns = runs->size, merged = 0;
+            for (size_t i = 0; i < nruns && err == E_SUCCESS; i += fan_in, merged++) {
+                size_t k = nruns - i < fan_in ? nruns - i : fan_in;
+                ext_run *group = (ext_run*)runs->data + i;
+                ext_run run = { .f = run_tmpfile(o.tmp_dir), .n = 0 };
+                if (!run.f) {
+                    err = E_IO;
+                    break;
+                }
+                err = merge_runs(group, k, run.f, rec_size, compare, o.mem_budget);
+                for (size_t j = 0; j < k; j++) {
+                    run.n += group[j].n;
+                    fclose(group[j].f);
+                    group[j].f = NULL;
+                }
+                // merged runs never overtake the groups still to be read
+                ((ext_run*)runs->data)[merged] = run;
+            }
+            if (err != E_SUCCESS) {
+                // close whatever is still open, merged prefix and unread tail
+                for (size_t i = 0; i < nruns; i++) {
+                    FILE *f = ((ext_run*)runs->data)[i].f;
+                    if (f) fclose(f);
+                }
+                runs->size = 0;
+                break;
+            }
+            runs->size = merged;
+        }
+
+        if (err == E_SUCCESS) err = merge_runs(runs->data, runs->size, out, rec_size, compare, o.mem_budget);
+    }
+
+    close_runs(runs, 0);
+    vector_free(runs);
+    if (err == E_SUCCESS && fflush(out) != 0) err = E_IO;
+    return err;
+}
+
+
+UTIL_ERR extsort_file(const char *in_path, const char *out_path, size_t rec_size, int (*compare)(const void*, const void*), const Extsort_opts *opts) {
+    if (!in_path || !out_path) return E_EMPTY_ARG;
+
+    FILE *in = fopen(in_path, "rb");
+    if (!in) return E_IO;
+
+    // sorted output goes to a temp file renamed over out_path, in_path may be out_path
+    char *tmp;
+    int fd = aputil_replace_open(out_path, &tmp);
+    FILE *out = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (!out) {
+        if (fd >= 0) {
+            close(fd);
+            aputil_replace_finish(tmp, out_path, false);
+        }
+        fclose(in);
+        return E_IO;
+    }
+
+    UTIL_ERR err = extsort_stream(in, out, rec_size, compare, opts);
+    fclose(in);
+    if (err == E_SUCCESS && fsync(fileno(out)) != 0) err = E_IO;
+    if (fclose(out) != 0 && err == E_SUCCESS) err = E_IO;
+    if (!aputil_replace_finish(tmp, out_path, err == E_SUCCESS) && err == E_SUCCESS) err = E_IO;
+
+    return err;
+}
@@ -0,0 +1,396 @@
+/*
+ *  membership filters
+ *  split block bloom filter (the Parquet layout)
+ *      > 256-bit blocks of 8 x 32-bit lanes, the top of the key's hash
+ *        picks the block, the low 32 bits times a per lane odd salt pick
+ *        one bit (top 5 bits of the product) in every lane
+ *      > a check is a single block load and, with AVX2, a multiply, shift
+ *        and testc over all eight lanes at once
+ *      > sizing sums the rate over the Poisson spread of keys per block
+ *        (no libm: exp by halving, series and squaring)
+ *
+ *  cuckoo filter (Fan, Andersen, Kaminsky, Mitzenmacher)
+ *      > partial key cuckoo hashing: i2 = i1 ^ hash(fingerprint), either
+ *        bucket can be found again from the other and the fingerprint alone
+ *      > a full pair of buckets kicks a random fingerprint to its other
+ *        bucket, up to CUCKOO_MAX_KICKS times, the last one held is kept as
+ *        the victim so nothing already added is lost
+ */
+
+#include "../include/aputils_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_X86 1
+#else
+#define FILTER_X86 0
+#endif
+
+
+// ###################### BLOOM ######################
+
+static const uint32_t bloom_salt[BLOOM_LANES] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+
+static inline const uint32_t *block_of(const BloomFilter *f, uint64_t h) {
+    size_t b = (size_t)(((__uint128_t)h * f->n_blocks) >> 64);
+    return f->blocks + b * BLOOM_LANES;
+}
+
+
+static bool contains_scalar(const uint32_t *b, uint32_t key) {
+    for (int i = 0; i < BLOOM_LANES; i++) {
+        if (!(b[i] & (1u << ((key * bloom_salt[i]) >> 27)))) return false;
+    }
+    return true;
+}
+
+
+#if FILTER_X86
+
+__attribute__((target("avx2")))
+static bool contains_avx2(const uint32_t *b, uint32_t key) {
+    __m256i salt = _mm256_loadu_si256((const __m256i*)bloom_salt);
+    __m256i bit = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int)key), salt), 27);
+    __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), bit);
+    return _mm256_testc_si256(_mm256_load_si256((const __m256i*)b), mask);
+}
+
+#endif
+
+
+// e^-x for x >= 0 without libm
+static double exp_neg(double x) {
+    int halvings = 0;
+    while (x > 0.5) {
+        x /= 2;
+        halvings++;
+    }
+    double term = 1, sum = 1;
+    for (int i = 1; i < 20; i++) {
+        term *= -x / i;
+        sum += term;
+    }
+    while (halvings--) sum *= sum;
+    return sum;
+}
+
+
+double bloom_fpp(size_t n_blocks, size_t n) {
+    if (!n_blocks) return 1.0;
+    if (!n) return 0.0;
+
+    // keys per block ~ Poisson(lambda), a block with j keys has every lane hit with (1 - (31/32)^j)^8
+    double lambda = (double)n / n_blocks;
+    if (lambda > 500) return 1.0;
+
+    double p = exp_neg(lambda), miss = 1, fpp = 0;
+    for (size_t j = 0; j < (size_t)(2 * lambda) + 64; j++) {
+        double lane = 1 - miss;
+        lane *= lane;
+        lane *= lane;
+        fpp += p * lane * lane;
+        p *= lambda / (j + 1);
+        miss *= 31.0 / 32;
+    }
+    return fpp;
+}
+
+
+size_t bloom_blocks_for(size_t n, double fpp) {
+    if (!(fpp > 0 && fpp < 1)) return 0;
+    if (!n) return 1;
+
+    size_t lo = 1, hi = n / 16 + 1;
+    while (bloom_fpp(hi, n) > fpp) {
+        if (hi > SIZE_MAX / 2 / (BLOOM_LANES * sizeof(uint32_t))) return 0;
+        lo = hi;
+        hi *= 2;
+    }
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (bloom_fpp(mid, n) > fpp) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+
+BloomFilter *bloom_new(size_t n, double fpp, uint64_t seed) {
+    size_t n_blocks = bloom_blocks_for(n, fpp);
+    if (!n_blocks) return (BloomFilter*)0;  // caller checks NULL
+
+    BloomFilter *new_filter = malloc(sizeof(*new_filter));
+    if (!new_filter) return (BloomFilter*)0;
+
+    void *mem = NULL;
+    if (posix_memalign(&mem, APUTIL_CACHE_LINE, n_blocks * BLOOM_LANES * sizeof(uint32_t))) {
+        free(new_filter);
+        return (BloomFilter*)0;
+    }
+
+    new_filter->blocks = mem;
+    new_filter->n_blocks = n_blocks;
+    new_filter->seed = seed;
+    bloom_clear(new_filter);
+    return new_filter;
+}
+
+
+void bloom_free(BloomFilter *f) {
+    if (!f) return;
+    free(f->blocks);
+    free(f);
+}
+
+
+void bloom_clear(BloomFilter *f) {
+    if (!f) return;
+    memset(f->blocks, 0, f->n_blocks * BLOOM_LANES * sizeof(uint32_t));
+    f->count = 0;
+}
+
+
+void bloom_add_hash(BloomFilter *f, uint64_t h) {
+    if (!f) return;
+    uint32_t *b = (uint32_t*)block_of(f, h), key = (uint32_t)h;
+    for (int i = 0; i < BLOOM_LANES; i++) b[i] |= 1u << ((key * bloom_salt[i]) >> 27);
+    f->count++;
+}
+
+
+UTIL_ERR bloom_add(BloomFilter *f, const void *key, size_t len) {
+    if (!f) return E_EMPTY_OBJ;
+    if (!key && len) return E_EMPTY_ARG;
+    bloom_add_hash(f, hash_bytes_seed(key, len, f->seed));
+    return E_SUCCESS;
+}
+
+
+bool bloom_contains_hash(const BloomFilter *f, uint64_t h) {
+    if (!f) return false;
+    const uint32_t *b = block_of(f, h);
+#if FILTER_X86
+    if (aputil_have_avx2()) return contains_avx2(b, (uint32_t)h);
+#endif
+    return contains_scalar(b, (uint32_t)h);
+}
+
+
+bool bloom_contains(const BloomFilter *f, const void *key, size_t len) {
+    if (!f || (!key && len)) return false;
+    return bloom_contains_hash(f, hash_bytes_seed(key, len, f->seed));
+}
+
+
+UTIL_ERR bloom_merge(BloomFilter *dst, const BloomFilter *src) {
+    if (!dst) return E_EMPTY_OBJ;
+    if (!src) return E_EMPTY_ARG;
+    if (dst->n_blocks != src->n_blocks || dst->seed != src->seed) return E_BAD_TYPE;
+
+    for (size_t i = 0; i < dst->n_blocks * BLOOM_LANES; i++) dst->blocks[i] |= src->blocks[i];
+    dst->count += src->count;
+    return E_SUCCESS;
+}
+
+// ###################### BLOOM ######################
+
+
+
+// ###################### CUCKOO ######################
+
+static inline uint16_t fingerprint(const CuckooFilter *f, uint64_t h) {
+    uint16_t fp = (uint16_t)((h >> 32) & ((1u << f->fp_bits) - 1));
+    return fp ? fp : 1;
+}
+
+static inline size_t first_index(const CuckooFilter *f, uint64_t h) {
+    return (size_t)h & (f->n_buckets - 1);
+}
+
+// the other bucket, also the way back
+static inline size_t alt_index(const CuckooFilter *f, size_t i, uint16_t fp) {
+    return (i ^ (size_t)hash_u64(fp, 0)) & (f->n_buckets - 1);
+}
+
+
+static bool bucket_put(uint16_t *b, uint16_t fp) {
+    for (int s = 0; s < CUCKOO_SLOTS; s++) {
+        if (!b[s]) {
+            b[s] = fp;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool bucket_has(const uint16_t *b, uint16_t fp) {
+    for (int s = 0; s < CUCKOO_SLOTS; s++) {
+        if (b[s] == fp) return true;
+    }
+    return false;
+}
+
+static bool bucket_take(uint16_t *b, uint16_t fp) {
+    for (int s = 0; s < CUCKOO_SLOTS; s++) {
+        if (b[s] == fp) {
+            b[s] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static inline uint64_t next_rand(uint64_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+
+unsigned cuckoo_fp_bits_for(double fpp) {
+    unsigned bits = 4;
+    while (bits < 16 && 2.0 * CUCKOO_SLOTS / (double)(1u << bits) > fpp) bits++;
+    return bits;
+}
+
+
+size_t cuckoo_buckets_for(size_t n) {
+    size_t need = (size_t)((double)n / (CUCKOO_SLOTS * CUCKOO_MAX_LOAD)) + 1, buckets = 1;
+    while (buckets < need) {
+        if (buckets > SIZE_MAX / 2 / (CUCKOO_SLOTS * sizeof(uint16_t))) return 0;
+        buckets *= 2;
+    }
+    return buckets;
+}
+
+
+CuckooFilter *cuckoo_new(size_t n, double fpp, uint64_t seed) {
+    size_t n_buckets = cuckoo_buckets_for(n);
+    if (!n_buckets || !(fpp > 0 && fpp < 1)) return (CuckooFilter*)0;  // caller checks NULL
+
+    CuckooFilter *new_filter = malloc(sizeof(*new_filter));
+    if (!new_filter) return (CuckooFilter*)0;
+
+    new_filter->slots = calloc(n_buckets * CUCKOO_SLOTS, sizeof(uint16_t));
+    if (!new_filter->slots) {
+        free(new_filter);
+        return (CuckooFilter*)0;
+    }
+
+    new_filter->n_buckets = n_buckets;
+    new_filter->count = 0;
+    new_filter->fp_bits = cuckoo_fp_bits_for(fpp);
+    new_filter->seed = seed;
+    new_filter->rng = seed ^ 0x9e3779b97f4a7c15ull;
+    if (!new_filter->rng) new_filter->rng = 1;
+    new_filter->has_victim = false;
+    new_filter->victim_fp = 0;
+    new_filter->victim_idx = 0;
+    return new_filter;
+}
+
+
+void cuckoo_free(CuckooFilter *f) {
+    if (!f) return;
+    free(f->slots);
+    free(f);
+}
+
+
+UTIL_ERR cuckoo_add_hash(CuckooFilter *f, uint64_t h) {
+    if (!f) return E_EMPTY_OBJ;
+    if (f->has_victim) return E_FULL;
+
+    uint16_t fp = fingerprint(f, h);
+    size_t i1 = first_index(f, h), i2 = alt_index(f, i1, fp);
+    if (bucket_put(f->slots + i1 * CUCKOO_SLOTS, fp) || bucket_put(f->slots + i2 * CUCKOO_SLOTS, fp)) {
+        f->count++;
+        return E_SUCCESS;
+    }
+
+    size_t i = next_rand(&f->rng) & 1 ? i1 : i2;
+    for (int kick = 0; kick < CUCKOO_MAX_KICKS; kick++) {
+        uint16_t *b = f->slots + i * CUCKOO_SLOTS;
+        size_t s = next_rand(&f->rng) % CUCKOO_SLOTS;
+        uint16_t out = b[s];
+        b[s] = fp;
+        fp = out;
+        i = alt_index(f, i, fp);
+        if (bucket_put(f->slots + i * CUCKOO_SLOTS, fp)) {
+            f->count++;
+            return E_SUCCESS;
+        }
+    }
+
+    // the fingerprint in hand has no slot, keeping it aside keeps every added key findable
+    f->has_victim = true;
+    f->victim_fp = fp;
+    f->victim_idx = i;
+    f->count++;
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR cuckoo_add(CuckooFilter *f, const void *key, size_t len) {
+    if (!f) return E_EMPTY_OBJ;
+    if (!key && len) return E_EMPTY_ARG;
+    return cuckoo_add_hash(f, hash_bytes_seed(key, len, f->seed));
+}
+
+
+static bool victim_is(const CuckooFilter *f, uint16_t fp, size_t i1, size_t i2) {
+    return f->has_victim && f->victim_fp == fp && (f->victim_idx == i1 || f->victim_idx == i2);
+}
+
+
+bool cuckoo_contains_hash(const CuckooFilter *f, uint64_t h) {
+    if (!f) return false;
+    uint16_t fp = fingerprint(f, h);
+    size_t i1 = first_index(f, h), i2 = alt_index(f, i1, fp);
+    return bucket_has(f->slots + i1 * CUCKOO_SLOTS, fp) || bucket_has(f->slots + i2 * CUCKOO_SLOTS, fp) || victim_is(f, fp, i1, i2);
+}
+
+
+bool cuckoo_contains(const CuckooFilter *f, const void *key, size_t len) {
+    if (!f || (!key && len)) return false;
+    return cuckoo_contains_hash(f, hash_bytes_seed(key, len, f->seed));
+}
+
+
+UTIL_ERR cuckoo_remove_hash(CuckooFilter *f, uint64_t h) {
+    if (!f) return E_EMPTY_OBJ;
+
+    uint16_t fp = fingerprint(f, h);
+    size_t i1 = first_index(f, h), i2 = alt_index(f, i1, fp);
+    if (victim_is(f, fp, i1, i2)) {
+        f->has_victim = false;
+        f->count--;
+        return E_SUCCESS;
+    }
+    if (!bucket_take(f->slots + i1 * CUCKOO_SLOTS, fp) && !bucket_take(f->slots + i2 * CUCKOO_SLOTS, fp)) return E_DOESNT_EXIST;
+    f->count--;
+
+    // a slot opened up, the victim may fit again
+    if (f->has_victim) {
+        size_t v1 = f->victim_idx, v2 = alt_index(f, v1, f->victim_fp);
+        if (bucket_put(f->slots + v1 * CUCKOO_SLOTS, f->victim_fp) || bucket_put(f->slots + v2 * CUCKOO_SLOTS, f->victim_fp)) {
+            f->has_victim = false;
+        }
+    }
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR cuckoo_remove(CuckooFilter *f, const void *key, size_t len) {
+    if (!f) return E_EMPTY_OBJ;
+    if (!key && len) return E_EMPTY_ARG;
+    return cuckoo_remove_hash(f, hash_bytes_seed(key, len, f->seed));
+}
+
+// ###################### CUCKOO ######################
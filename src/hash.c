@@ -0,0 +1,241 @@
+/*
+ *  hashing
+ *  byte spans after wyhash final 4 (Wang Yi, public domain)
+ *      > mum: full 64x64 -> 128 multiply, the two halves xored back
+ *      > up to 16 bytes: two overlapping loads pick up every byte
+ *      > longer: 16 byte steps, over 48 bytes three lanes over whole
+ *        stripes first, the last 16 bytes are always read (overlapping
+ *        what was already consumed when the rest is shorter)
+ *
+ *  one-shot
+ *  integers and vectors
+ *  streaming
+ *      > the last stripe is held back until more bytes arrive, the one-shot
+ *        loop leaves the final 1..48 bytes to the tail in the same way
+ */
+
+#include <time.h>
+#include <sys/random.h>
+#include "../include/aputils.h"
+
+
+static const uint64_t hash_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+};
+
+
+static inline uint64_t mum(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+static inline uint64_t r8(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t r4(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// 1..3 bytes
+static inline uint64_t r3(const unsigned char *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+
+static inline uint64_t seed_mix(uint64_t seed) {
+    return seed ^ mum(seed ^ hash_secret[0], hash_secret[1]);
+}
+
+// one stripe through the three lanes
+static inline void stripe(uint64_t *lane, const unsigned char *p) {
+    lane[0] = mum(r8(p) ^ hash_secret[1], r8(p + 8) ^ lane[0]);
+    lane[1] = mum(r8(p + 16) ^ hash_secret[2], r8(p + 24) ^ lane[1]);
+    lane[2] = mum(r8(p + 32) ^ hash_secret[3], r8(p + 40) ^ lane[2]);
+}
+
+
+/*
+    the i (1..48) bytes left at p, p - 16 must be readable when i < 16, seed holds
+    the folded lanes. total is the length of the whole input
+*/
+static uint64_t tail(const unsigned char *p, size_t i, uint64_t seed, uint64_t total) {
+    while (i > 16) {
+        seed = mum(r8(p) ^ hash_secret[1], r8(p + 8) ^ seed);
+        p += 16;
+        i -= 16;
+    }
+    uint64_t a = r8(p + i - 16) ^ hash_secret[1], b = r8(p + i - 8) ^ seed;
+    __uint128_t r = (__uint128_t)a * b;
+    return mum((uint64_t)r ^ hash_secret[0] ^ total, (uint64_t)(r >> 64) ^ hash_secret[1]);
+}
+
+
+static uint64_t short_hash(const unsigned char *p, size_t n, uint64_t seed) {
+    uint64_t a = 0, b = 0;
+    if (n >= 4) {
+        size_t mid = (n >> 3) << 2;
+        a = (r4(p) << 32) | r4(p + mid);
+        b = (r4(p + n - 4) << 32) | r4(p + n - 4 - mid);
+    } else if (n) {
+        a = r3(p, n);
+    }
+    a ^= hash_secret[1];
+    b ^= seed;
+    __uint128_t r = (__uint128_t)a * b;
+    return mum((uint64_t)r ^ hash_secret[0] ^ n, (uint64_t)(r >> 64) ^ hash_secret[1]);
+}
+
+
+
+// ###################### ONE-SHOT ######################
+
+uint64_t hash_bytes_seed(const void *key, size_t n, uint64_t seed) {
+    const unsigned char *p = key;
+    seed = seed_mix(seed);
+    if (n <= 16) return short_hash(p, n, seed);
+
+    size_t i = n;
+    if (i > HASH_STRIPE) {
+        uint64_t lane[3] = { seed, seed, seed };
+        do {
+            stripe(lane, p);
+            p += HASH_STRIPE;
+            i -= HASH_STRIPE;
+        } while (i > HASH_STRIPE);
+        seed = lane[0] ^ lane[1] ^ lane[2];
+    }
+    return tail(p, i, seed, n);
+}
+
+
+uint64_t hash_bytes(const void *key, size_t n) {
+    return hash_bytes_seed(key, n, HASH_DEFAULT_SEED);
+}
+
+
+uint64_t hash_random_seed(void) {
+    uint64_t seed;
+    if (getrandom(&seed, sizeof(seed), GRND_NONBLOCK) == (ssize_t)sizeof(seed)) return seed;
+
+    // no entropy yet (early boot) or no syscall: not secret, but differs per process
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uintptr_t addr = (uintptr_t)&seed;
+    return hash_u64((uint64_t)ts.tv_nsec ^ ((uint64_t)ts.tv_sec << 30), (uint64_t)addr);
+}
+
+// ###################### ONE-SHOT ######################
+
+
+
+// ###################### INTEGERS AND VECTORS ######################
+
+uint64_t hash_u64(uint64_t x, uint64_t seed) {
+    // every step is invertible, seed only shifts which bijection is used
+    x ^= seed;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+
+uint64_t hash_i32(int32_t x, uint64_t seed) {
+    return hash_u64((uint32_t)x, seed);
+}
+
+
+uint64_t vec_char_hash(const Vec_char *v, uint64_t seed) {
+    if (!v) return 0;
+    return hash_bytes_seed(v->data, v->size, seed);
+}
+
+
+uint64_t vec_i32_hash(const Vec_i32 *v, uint64_t seed) {
+    if (!v) return 0;
+    return hash_bytes_seed(v->data, v->size * sizeof(int32_t), seed);
+}
+
+
+uint64_t vector_hash(const Vector *v, uint64_t seed) {
+    if (!v) return 0;
+    return hash_bytes_seed(v->data, v->size * v->elem_size, seed);
+}
+
+
+uint64_t vector_elem_hash(const Vector *v, size_t idx, uint64_t seed) {
+    if (!v || idx >= v->size) return 0;
+    return hash_bytes_seed((const char*)v->data + idx * v->elem_size, v->elem_size, seed);
+}
+
+// ###################### INTEGERS AND VECTORS ######################
+
+
+
+// ###################### STREAMING ######################
+
+void hash_init(Hash_state *st, uint64_t seed) {
+    if (!st) return;
+    st->seed = seed;
+    st->lane[0] = st->lane[1] = st->lane[2] = seed_mix(seed);
+    st->len = 0;
+    st->n_buf = 0;
+    st->striped = false;
+}
+
+
+static void consume(Hash_state *st, const unsigned char *p) {
+    stripe(st->lane, p);
+    memcpy(st->last, p + HASH_STRIPE - 16, 16);
+    st->striped = true;
+}
+
+
+void hash_update(Hash_state *st, const void *data, size_t n) {
+    if (!st || !n || !data) return;
+
+    const unsigned char *p = data;
+    st->len += n;
+    if (st->n_buf + n <= HASH_STRIPE) {
+        memcpy(st->buf + st->n_buf, p, n);
+        st->n_buf += n;
+        return;
+    }
+
+    // bytes follow, so a full buffer is not the last stripe
+    if (st->n_buf) {
+        size_t take = HASH_STRIPE - st->n_buf;
+        memcpy(st->buf + st->n_buf, p, take);
+        consume(st, st->buf);
+        p += take;
+        n -= take;
+    }
+    while (n > HASH_STRIPE) {
+        consume(st, p);
+        p += HASH_STRIPE;
+        n -= HASH_STRIPE;
+    }
+    memcpy(st->buf, p, n);
+    st->n_buf = n;
+}
+
+
+uint64_t hash_final(const Hash_state *st) {
+    if (!st) return 0;
+    if (!st->striped) return hash_bytes_seed(st->buf, st->n_buf, st->seed);
+
+    // the tail may look up to 15 bytes back into the last stripe
+    unsigned char tmp[16 + HASH_STRIPE];
+    memcpy(tmp, st->last, 16);
+    memcpy(tmp + 16, st->buf, st->n_buf);
+    return tail(tmp + 16, st->n_buf, st->lane[0] ^ st->lane[1] ^ st->lane[2], st->len);
+}
+
+// ###################### STREAMING ######################
@@ -0,0 +1,993 @@
+/*
+ *  hash sets
+ *  Robin Hood linear probing
+ *      > every slot keeps its key's probe distance (+1, 0 marks empty) in a
+ *        byte array, probing walks keys and distances in two flat arrays
+ *      > the byte saturates at HS_SAT, past it the exact distance is worked
+ *        out from the key's home slot (only with very long probe runs)
+ *      > insert: walk from the home slot, an occupant closer to its own home
+ *        than the carried key gives up its slot and is carried on instead
+ *      > lookup stops at the first slot whose distance is below the probe's,
+ *        the key would have displaced that occupant had it been inserted
+ *      > remove: the following keys with distance > 1 shift back one slot
+ *      > home slot: key (or its hash) times the 64-bit golden ratio, top bits
+ *
+ *  int32 set
+ *  generic set
+ *  concurrent map
+ *      > every shard holds a table of whole 8 byte words read and written
+ *        with relaxed atomics, a seqlock orders them: writers make the
+ *        counter odd, update, make it even, readers retry unless they saw
+ *        the same even value before and after their probe
+ */
+
+#include <sched.h>
+#include "../include/aputils.h"
+
+
+#define HS_FIB 0x9e3779b97f4a7c15ull
+#define HS_MIN_CAP 16
+#define HS_SAT 255                  // dist byte for distances of HS_SAT and more
+
+
+// smallest power of two capacity holding n keys under the max load, 0 on overflow
+static size_t slots_for(size_t n) {
+    size_t cap = HS_MIN_CAP;
+    while (cap / HASHSET_MAX_LOAD_DEN * HASHSET_MAX_LOAD_NUM < n) {
+        if (cap > SIZE_MAX / 2) return 0;
+        cap *= 2;
+    }
+    return cap;
+}
+
+static size_t max_load(size_t cap) {
+    return cap / HASHSET_MAX_LOAD_DEN * HASHSET_MAX_LOAD_NUM;
+}
+
+static unsigned cap_shift(size_t cap) {
+    return 64 - (unsigned)__builtin_ctzll(cap);
+}
+
+static inline uint8_t dist_byte(size_t d) {
+    return d < HS_SAT ? (uint8_t)d : HS_SAT;
+}
+
+
+// ###################### int32 SET ######################
+
+static inline size_t home_i32(unsigned shift, int32_t key) {
+    return (size_t)(((uint64_t)(uint32_t)key * HS_FIB) >> shift);
+}
+
+
+// probe distance + 1 of the key in slot i (occupied)
+static inline size_t i32_dist(const int32_t *keys, const uint8_t *dist, size_t mask, unsigned shift, size_t i) {
+    if (dist[i] < HS_SAT) return dist[i];
+    return ((i - home_i32(shift, keys[i])) & mask) + 1;
+}
+
+
+// place key (absent from the set) starting at slot i with distance d, displacing richer occupants
+static void i32_place(int32_t *keys, uint8_t *dist, size_t mask, unsigned shift, size_t i, size_t d, int32_t k) {
+    for (;;) {
+        if (!dist[i]) {
+            keys[i] = k;
+            dist[i] = dist_byte(d);
+            return;
+        }
+        size_t od = i32_dist(keys, dist, mask, shift, i);
+        if (od < d) {
+            int32_t tk = keys[i];
+            keys[i] = k;
+            dist[i] = dist_byte(d);
+            k = tk;
+            d = od;
+        }
+        i = (i + 1) & mask;
+        d++;
+    }
+}
+
+
+// move every key into new arrays of cap slots
+static bool i32_rehash(HashSet_i32 *s, size_t cap) {
+    int32_t *keys = malloc(sizeof(int32_t) * cap);
+    uint8_t *dist = calloc(cap, sizeof(uint8_t));
+    if (!keys || !dist) {
+        free(keys);
+        free(dist);
+        return false;
+    }
+
+    unsigned shift = cap_shift(cap);
+    for (size_t i = 0; i < s->cap; i++) {
+        if (s->dist[i]) i32_place(keys, dist, cap - 1, shift, home_i32(shift, s->keys[i]), 1, s->keys[i]);
+    }
+
+    free(s->keys);
+    free(s->dist);
+    s->keys = keys;
+    s->dist = dist;
+    s->cap = cap;
+    s->shift = shift;
+    return true;
+}
+
+
+HashSet_i32 *hashset_i32_new(size_t n) {
+    size_t cap = slots_for(n);
+    if (!cap) return (HashSet_i32*)0;  // caller checks NULL
+
+    HashSet_i32 *new_set = malloc(sizeof(*new_set));
+    if (!new_set) return (HashSet_i32*)0;
+
+    new_set->keys = malloc(sizeof(int32_t) * cap);
+    new_set->dist = calloc(cap, sizeof(uint8_t));
+    if (!new_set->keys || !new_set->dist) {
+        free(new_set->keys);
+        free(new_set->dist);
+        free(new_set);
+        return (HashSet_i32*)0;
+    }
+
+    new_set->cap = cap;
+    new_set->size = 0;
+    new_set->shift = cap_shift(cap);
+    return new_set;
+}
+
+
+void hashset_i32_free(HashSet_i32 *s) {
+    if (!s) return;
+    free(s->keys);
+    free(s->dist);
+    free(s);
+}
+
+
+UTIL_ERR hashset_i32_reserve(HashSet_i32 *s, size_t n) {
+    if (!s) return E_EMPTY_OBJ;
+    if (n <= max_load(s->cap)) return E_SUCCESS;
+
+    size_t cap = slots_for(n);
+    if (!cap || !i32_rehash(s, cap)) return E_BAD_ALLOC;
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR hashset_i32_insert(HashSet_i32 *s, int32_t key) {
+    if (!s) return E_EMPTY_OBJ;
+
+    // grow first so the walk below stays valid
+    if (s->size + 1 > max_load(s->cap) && !i32_rehash(s, s->cap * 2)) return E_BAD_ALLOC;
+
+    // one walk: look for key until a richer slot, then place from there
+    size_t mask = s->cap - 1, i = home_i32(s->shift, key), d = 1;
+    while (s->dist[i] && i32_dist(s->keys, s->dist, mask, s->shift, i) >= d) {
+        if (s->keys[i] == key) return E_NOOP;
+        i = (i + 1) & mask;
+        d++;
+    }
+
+    i32_place(s->keys, s->dist, mask, s->shift, i, d, key);
+    s->size++;
+    return E_SUCCESS;
+}
+
+
+// slot holding key, or cap when absent
+static size_t i32_find(const HashSet_i32 *s, int32_t key) {
+    size_t mask = s->cap - 1, i = home_i32(s->shift, key), d = 1;
+    while (s->dist[i] && i32_dist(s->keys, s->dist, mask, s->shift, i) >= d) {
+        if (s->keys[i] == key) return i;
+        i = (i + 1) & mask;
+        d++;
+    }
+    return s->cap;
+}
+
+
+bool hashset_i32_contains(const HashSet_i32 *s, int32_t key) {
+    if (!s) return false;
+    return i32_find(s, key) != s->cap;
+}
+
+
+UTIL_ERR hashset_i32_remove(HashSet_i32 *s, int32_t key) {
+    if (!s) return E_EMPTY_OBJ;
+
+    size_t i = i32_find(s, key);
+    if (i == s->cap) return E_DOESNT_EXIST;
+
+    // backward shift: pull the run that follows one slot closer to home
+    size_t mask = s->cap - 1, next = (i + 1) & mask;
+    while (s->dist[next] > 1) {
+        s->keys[i] = s->keys[next];
+        s->dist[i] = dist_byte(i32_dist(s->keys, s->dist, mask, s->shift, next) - 1);
+        i = next;
+        next = (next + 1) & mask;
+    }
+    s->dist[i] = 0;
+    s->size--;
+
+    return E_SUCCESS;
+}
+
+
+void hashset_i32_clear(HashSet_i32 *s) {
+    if (!s) return;
+    memset(s->dist, 0, s->cap);
+    s->size = 0;
+}
+
+
+UTIL_ERR hashset_i32_insert_from_vec(HashSet_i32 *s, const Vec_i32 *v) {
+    if (!s) return E_EMPTY_OBJ;
+    if (!v) return E_EMPTY_ARG;
+
+    UTIL_ERR err = hashset_i32_reserve(s, s->size + v->size);
+    if (err) return err;
+    for (size_t i = 0; i < v->size; i++) {
+        err = hashset_i32_insert(s, v->data[i]);
+        if (err == E_BAD_ALLOC) return err;
+    }
+    return E_SUCCESS;
+}
+
+
+Vec_i32 *hashset_i32_to_vec(const HashSet_i32 *s, UTIL_ERR *e) {
+    if (!s) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_i32*)0;
+    }
+
+    Vec_i32 *new_vec = vec_i32_new(s->size ? s->size : 1);
+    if (!new_vec) {
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+    for (size_t i = 0; i < s->cap; i++) {
+        if (s->dist[i]) new_vec->data[new_vec->size++] = s->keys[i];
+    }
+    return new_vec;
+}
+
+
+Vec_i32 *vec_i32_unique(const Vec_i32 *v, UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_i32*)0;
+    }
+
+    HashSet_i32 *seen = hashset_i32_new(v->size);
+    Vec_i32 *new_vec = vec_i32_new(v->size ? v->size : 1);
+    if (!seen || !new_vec) {
+        hashset_i32_free(seen);
+        vec_i32_free(new_vec);
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+
+    // reserved for every element, inserts never grow
+    for (size_t i = 0; i < v->size; i++) {
+        if (hashset_i32_insert(seen, v->data[i]) == E_SUCCESS) new_vec->data[new_vec->size++] = v->data[i];
+    }
+
+    hashset_i32_free(seen);
+    return new_vec;
+}
+
+// ###################### int32 SET ######################
+
+
+// ###################### GENERIC SET ######################
+
+static inline uint64_t key_hash(const HashSet *s, const void *key) {
+    return s->hash ? s->hash(key) : hash_bytes(key, s->elem_size);
+}
+
+static inline bool key_equal(const HashSet *s, const void *a, const void *b) {
+    return s->equal ? s->equal(a, b) : memcmp(a, b, s->elem_size) == 0;
+}
+
+static inline size_t home_hash(unsigned shift, uint64_t h) {
+    return (size_t)((h * HS_FIB) >> shift);
+}
+
+
+typedef struct {
+    char *keys;
+    uint64_t *hashes;
+    uint8_t *dist;
+    size_t mask;
+    size_t es;
+} hs_slots;
+
+
+static inline size_t hs_dist(const hs_slots *t, unsigned shift, size_t i) {
+    if (t->dist[i] < HS_SAT) return t->dist[i];
+    return ((i - home_hash(shift, t->hashes[i])) & t->mask) + 1;
+}
+
+
+// same as i32_place, the carried key lives in carry (elem_size bytes) and is swapped through tmp
+static void hs_place(hs_slots *t, unsigned shift, char *tmp, size_t i, size_t d, char *carry, uint64_t h) {
+    for (;;) {
+        char *slot = t->keys + i * t->es;
+        if (!t->dist[i]) {
+            memcpy(slot, carry, t->es);
+            t->hashes[i] = h;
+            t->dist[i] = dist_byte(d);
+            return;
+        }
+        size_t od = hs_dist(t, shift, i);
+        if (od < d) {
+            memcpy(tmp, slot, t->es);
+            memcpy(slot, carry, t->es);
+            memcpy(carry, tmp, t->es);
+            uint64_t th = t->hashes[i];
+            t->hashes[i] = h;
+            t->dist[i] = dist_byte(d);
+            h = th;
+            d = od;
+        }
+        i = (i + 1) & t->mask;
+        d++;
+    }
+}
+
+
+static bool hs_alloc(hs_slots *t, size_t cap, size_t es) {
+    t->keys = malloc(cap * es);
+    t->hashes = malloc(sizeof(uint64_t) * cap);
+    t->dist = calloc(cap, sizeof(uint8_t));
+    t->mask = cap - 1;
+    t->es = es;
+    if (!t->keys || !t->hashes || !t->dist) {
+        free(t->keys);
+        free(t->hashes);
+        free(t->dist);
+        return false;
+    }
+    return true;
+}
+
+
+static hs_slots hs_view(const HashSet *s) {
+    return (hs_slots){ .keys = s->keys, .hashes = s->hashes, .dist = s->dist, .mask = s->cap - 1, .es = s->elem_size };
+}
+
+
+// cached hashes, so growing never calls back into the user's hash
+static bool hs_rehash(HashSet *s, size_t cap) {
+    if (cap > SIZE_MAX / s->elem_size) return false;
+
+    hs_slots t;
+    if (!hs_alloc(&t, cap, s->elem_size)) return false;
+
+    unsigned shift = cap_shift(cap);
+    char *carry = s->tmp + s->elem_size;
+    for (size_t i = 0; i < s->cap; i++) {
+        if (!s->dist[i]) continue;
+        memcpy(carry, s->keys + i * s->elem_size, s->elem_size);
+        hs_place(&t, shift, s->tmp, home_hash(shift, s->hashes[i]), 1, carry, s->hashes[i]);
+    }
+
+    free(s->keys);
+    free(s->hashes);
+    free(s->dist);
+    s->keys = t.keys;
+    s->hashes = t.hashes;
+    s->dist = t.dist;
+    s->cap = cap;
+    s->shift = shift;
+    return true;
+}
+
+
+HashSet *hashset_new(size_t elem_size, size_t n, uint64_t (*hash)(const void*), bool (*equal)(const void*, const void*)) {
+    size_t cap = slots_for(n);
+    if (elem_size < 1 || !cap || cap > SIZE_MAX / elem_size) return (HashSet*)0;  // caller checks NULL
+
+    HashSet *new_set = malloc(sizeof(*new_set));
+    if (!new_set) return (HashSet*)0;
+
+    hs_slots t;
+    new_set->tmp = malloc(2 * elem_size);
+    if (!new_set->tmp || !hs_alloc(&t, cap, elem_size)) {
+        free(new_set->tmp);
+        free(new_set);
+        return (HashSet*)0;
+    }
+
+    new_set->keys = t.keys;
+    new_set->hashes = t.hashes;
+    new_set->dist = t.dist;
+    new_set->cap = cap;
+    new_set->size = 0;
+    new_set->elem_size = elem_size;
+    new_set->shift = cap_shift(cap);
+    new_set->hash = hash;
+    new_set->equal = equal;
+    return new_set;
+}
+
+
+void hashset_free(HashSet *s) {
+    if (!s) return;
+    free(s->keys);
+    free(s->hashes);
+    free(s->dist);
+    free(s->tmp);
+    free(s);
+}
+
+
+UTIL_ERR hashset_reserve(HashSet *s, size_t n) {
+    if (!s) return E_EMPTY_OBJ;
+    if (n <= max_load(s->cap)) return E_SUCCESS;
+
+    size_t cap = slots_for(n);
+    if (!cap || !hs_rehash(s, cap)) return E_BAD_ALLOC;
+    return E_SUCCESS;
+}
+
+
+// slot holding key (with hash h), or cap when absent
+static size_t hs_find(const HashSet *s, const void *key, uint64_t h) {
+    hs_slots t = hs_view(s);
+    size_t i = home_hash(s->shift, h), d = 1;
+    while (t.dist[i] && hs_dist(&t, s->shift, i) >= d) {
+        if (t.hashes[i] == h && key_equal(s, t.keys + i * t.es, key)) return i;
+        i = (i + 1) & t.mask;
+        d++;
+    }
+    return s->cap;
+}
+
+
+UTIL_ERR hashset_insert(HashSet *s, const void *key) {
+    if (!s) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+
+    if (s->size + 1 > max_load(s->cap) && !hs_rehash(s, s->cap * 2)) return E_BAD_ALLOC;
+
+    uint64_t h = key_hash(s, key);
+    hs_slots t = hs_view(s);
+    size_t i = home_hash(s->shift, h), d = 1;
+    while (t.dist[i] && hs_dist(&t, s->shift, i) >= d) {
+        if (t.hashes[i] == h && key_equal(s, t.keys + i * t.es, key)) return E_NOOP;
+        i = (i + 1) & t.mask;
+        d++;
+    }
+
+    char *carry = s->tmp + s->elem_size;
+    memcpy(carry, key, s->elem_size);
+    hs_place(&t, s->shift, s->tmp, i, d, carry, h);
+    s->size++;
+    return E_SUCCESS;
+}
+
+
+bool hashset_contains(const HashSet *s, const void *key) {
+    if (!s || !key) return false;
+    return hs_find(s, key, key_hash(s, key)) != s->cap;
+}
+
+
+UTIL_ERR hashset_remove(HashSet *s, const void *key) {
+    if (!s) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+
+    size_t i = hs_find(s, key, key_hash(s, key));
+    if (i == s->cap) return E_DOESNT_EXIST;
+
+    hs_slots t = hs_view(s);
+    size_t mask = t.mask, next = (i + 1) & mask, es = s->elem_size;
+    while (s->dist[next] > 1) {
+        memcpy(s->keys + i * es, s->keys + next * es, es);
+        s->hashes[i] = s->hashes[next];
+        s->dist[i] = dist_byte(hs_dist(&t, s->shift, next) - 1);
+        i = next;
+        next = (next + 1) & mask;
+    }
+    s->dist[i] = 0;
+    s->size--;
+
+    return E_SUCCESS;
+}
+
+
+void hashset_clear(HashSet *s) {
+    if (!s) return;
+    memset(s->dist, 0, s->cap);
+    s->size = 0;
+}
+
+
+UTIL_ERR hashset_insert_from_vec(HashSet *s, const Vector *v) {
+    if (!s) return E_EMPTY_OBJ;
+    if (!v) return E_EMPTY_ARG;
+    if (v->elem_size != s->elem_size) return E_BAD_TYPE;
+
+    UTIL_ERR err = hashset_reserve(s, s->size + v->size);
+    if (err) return err;
+    for (size_t i = 0; i < v->size; i++) {
+        err = hashset_insert(s, (char*)v->data + i * v->elem_size);
+        if (err == E_BAD_ALLOC) return err;
+    }
+    return E_SUCCESS;
+}
+
+
+Vector *hashset_to_vec(const HashSet *s, UTIL_ERR *e) {
+    if (!s) {
+        *e = E_EMPTY_OBJ;
+        return (Vector*)0;
+    }
+
+    Vector *new_vec = vector_new(s->elem_size, s->size ? s->size : 1);
+    if (!new_vec) {
+        *e = E_BAD_ALLOC;
+        return (Vector*)0;
+    }
+    for (size_t i = 0; i < s->cap; i++) {
+        if (!s->dist[i]) continue;
+        memcpy((char*)new_vec->data + new_vec->size++ * s->elem_size, s->keys + i * s->elem_size, s->elem_size);
+    }
+    return new_vec;
+}
+
+
+Vector *vector_unique(const Vector *v, uint64_t (*hash)(const void*), bool (*equal)(const void*, const void*), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vector*)0;
+    }
+
+    HashSet *seen = hashset_new(v->elem_size, v->size, hash, equal);
+    Vector *new_vec = vector_new(v->elem_size, v->size ? v->size : 1);
+    if (!seen || !new_vec) {
+        hashset_free(seen);
+        vector_free(new_vec);
+        *e = E_BAD_ALLOC;
+        return (Vector*)0;
+    }
+
+    for (size_t i = 0; i < v->size; i++) {
+        const char *elem = (const char*)v->data + i * v->elem_size;
+        if (hashset_insert(seen, elem) == E_SUCCESS) {
+            memcpy((char*)new_vec->data + new_vec->size++ * v->elem_size, elem, v->elem_size);
+        }
+    }
+
+    hashset_free(seen);
+    return new_vec;
+}
+
+// ###################### GENERIC SET ######################
+
+
+// ###################### CONCURRENT MAP ######################
+
+#define CM_WORD sizeof(uint64_t)
+#define CM_SLOT(m) ((m)->key_words + (m)->val_words)
+
+struct cmap_table {
+    size_t cap;
+    unsigned shift;
+    struct cmap_table *retired;     // older tables, lock free readers may still be probing them
+    _Atomic uint64_t *hashes;
+    _Atomic uint64_t *words;        // per slot: key_words then val_words
+    _Atomic uint8_t *dist;
+};
+
+
+static cmap_table *ct_new(size_t cap, size_t slot_words) {
+    if (cap > SIZE_MAX / ((slot_words + 1) * CM_WORD + 1)) return (cmap_table*)0;
+
+    // one block: header, hashes, words, dist
+    cmap_table *t = calloc(1, sizeof(*t) + cap * (slot_words + 1) * CM_WORD + cap);
+    if (!t) return (cmap_table*)0;
+
+    t->cap = cap;
+    t->shift = cap_shift(cap);
+    t->hashes = (_Atomic uint64_t*)(t + 1);
+    t->words = t->hashes + cap;
+    t->dist = (_Atomic uint8_t*)(t->words + cap * slot_words);
+    return t;
+}
+
+
+static inline size_t ct_dist(const cmap_table *t, size_t i, uint8_t b) {
+    if (b < HS_SAT) return b;
+    uint64_t h = atomic_load_explicit(&t->hashes[i], memory_order_relaxed);
+    return ((i - home_hash(t->shift, h)) & (t->cap - 1)) + 1;
+}
+
+
+static void ct_fetch(const cmap_table *t, size_t sw, size_t i, uint64_t *dst) {
+    const _Atomic uint64_t *w = t->words + i * sw;
+    for (size_t j = 0; j < sw; j++) dst[j] = atomic_load_explicit(&w[j], memory_order_relaxed);
+}
+
+
+static void ct_store(cmap_table *t, size_t sw, size_t i, const uint64_t *src, uint64_t h, size_t d) {
+    _Atomic uint64_t *w = t->words + i * sw;
+    for (size_t j = 0; j < sw; j++) atomic_store_explicit(&w[j], src[j], memory_order_relaxed);
+    atomic_store_explicit(&t->hashes[i], h, memory_order_relaxed);
+    atomic_store_explicit(&t->dist[i], dist_byte(d), memory_order_relaxed);
+}
+
+
+// key bytes zero padded to whole words
+static void cm_pack(uint64_t *dst, const void *src, size_t bytes, size_t words) {
+    memset(dst, 0, words * CM_WORD);
+    memcpy(dst, src, bytes);
+}
+
+
+static bool ct_key_equal(const ConcMap *m, const cmap_table *t, size_t i, const void *key) {
+    const _Atomic uint64_t *w = t->words + i * CM_SLOT(m);
+    const char *k = key;
+    for (size_t j = 0; j < m->key_words; j++) {
+        uint64_t x = 0;
+        size_t left = m->key_size - j * CM_WORD;
+        memcpy(&x, k + j * CM_WORD, left < CM_WORD ? left : CM_WORD);
+        if (atomic_load_explicit(&w[j], memory_order_relaxed) != x) return false;
+    }
+    return true;
+}
+
+
+static void ct_copy_val(const ConcMap *m, const cmap_table *t, size_t i, void *out) {
+    const _Atomic uint64_t *w = t->words + i * CM_SLOT(m) + m->key_words;
+    char *o = out;
+    for (size_t j = 0; j < m->val_words; j++) {
+        uint64_t x = atomic_load_explicit(&w[j], memory_order_relaxed);
+        size_t left = m->val_size - j * CM_WORD;
+        memcpy(o + j * CM_WORD, &x, left < CM_WORD ? left : CM_WORD);
+    }
+}
+
+
+/*
+    walk from key's home slot, true with its slot in *at when present, otherwise *at and *d
+    are where it would be placed. the walk is bounded since a reader may see a table mid update
+*/
+static bool ct_probe(const ConcMap *m, const cmap_table *t, const void *key, uint64_t h, size_t *at, size_t *d) {
+    size_t mask = t->cap - 1, i = home_hash(t->shift, h), pd = 1;
+    for (size_t n = 0; n < t->cap; n++) {
+        uint8_t b = atomic_load_explicit(&t->dist[i], memory_order_relaxed);
+        if (!b || ct_dist(t, i, b) < pd) break;
+        if (atomic_load_explicit(&t->hashes[i], memory_order_relaxed) == h && ct_key_equal(m, t, i, key)) {
+            *at = i;
+            *d = pd;
+            return true;
+        }
+        i = (i + 1) & mask;
+        pd++;
+    }
+    *at = i;
+    *d = pd;
+    return false;
+}
+
+
+// writer only, same as hs_place on word slots
+static void ct_place(cmap_table *t, size_t sw, uint64_t *tmp, size_t i, size_t d, uint64_t *carry, uint64_t h) {
+    size_t mask = t->cap - 1;
+    for (;;) {
+        uint8_t b = atomic_load_explicit(&t->dist[i], memory_order_relaxed);
+        if (!b) {
+            ct_store(t, sw, i, carry, h, d);
+            return;
+        }
+        size_t od = ct_dist(t, i, b);
+        if (od < d) {
+            uint64_t th = atomic_load_explicit(&t->hashes[i], memory_order_relaxed);
+            ct_fetch(t, sw, i, tmp);
+            ct_store(t, sw, i, carry, h, d);
+            memcpy(carry, tmp, sw * CM_WORD);
+            h = th;
+            d = od;
+        }
+        i = (i + 1) & mask;
+        d++;
+    }
+}
+
+
+// writer only: a doubled copy of t, not yet visible to readers
+static cmap_table *ct_grow(const ConcMap *m, cmap_shard *s, cmap_table *t) {
+    size_t sw = CM_SLOT(m);
+    if (t->cap > SIZE_MAX / 2) return (cmap_table*)0;
+    cmap_table *n = ct_new(t->cap * 2, sw);
+    if (!n) return (cmap_table*)0;
+
+    uint64_t *tmp = s->scratch + sw, *move = s->scratch + 2 * sw;
+    for (size_t i = 0; i < t->cap; i++) {
+        if (!atomic_load_explicit(&t->dist[i], memory_order_relaxed)) continue;
+        uint64_t h = atomic_load_explicit(&t->hashes[i], memory_order_relaxed);
+        ct_fetch(t, sw, i, move);
+        ct_place(n, sw, tmp, home_hash(n->shift, h), 1, move, h);
+    }
+    n->retired = t;
+    return n;
+}
+
+
+static inline uint64_t cm_hash(const ConcMap *m, const void *key) {
+    return m->hash ? m->hash(key) : hash_bytes(key, m->key_size);
+}
+
+// middle bits of the mixed hash, the home slot takes the top ones
+static inline cmap_shard *cm_shard(const ConcMap *m, uint64_t h) {
+    return &m->shards[((h * HS_FIB) >> 32) & (m->n_shards - 1)];
+}
+
+
+static void seq_begin(cmap_shard *s) {
+    size_t q = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, q + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void seq_end(cmap_shard *s) {
+    size_t q = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, q + 1, memory_order_release);
+}
+
+
+/*
+    shard lock held, key absent and s->scratch holds its packed entry: place it, growing
+    the table first when full. the grown table is published inside the write section
+*/
+static UTIL_ERR cm_add(ConcMap *m, cmap_shard *s, const void *key, uint64_t h, size_t i, size_t d) {
+    cmap_table *t = atomic_load_explicit(&s->table, memory_order_relaxed), *n = (cmap_table*)0;
+    size_t sw = CM_SLOT(m);
+
+    if (atomic_load_explicit(&s->size, memory_order_relaxed) + 1 > max_load(t->cap)) {
+        n = ct_grow(m, s, t);
+        if (!n) return E_BAD_ALLOC;
+        ct_probe(m, n, key, h, &i, &d);
+        t = n;
+    }
+
+    seq_begin(s);
+    if (n) atomic_store_explicit(&s->table, n, memory_order_release);
+    ct_place(t, sw, s->scratch + sw, i, d, s->scratch, h);
+    seq_end(s);
+
+    atomic_fetch_add_explicit(&s->size, 1, memory_order_relaxed);
+    return E_SUCCESS;
+}
+
+
+ConcMap *cmap_new(size_t key_size, size_t val_size, size_t n_shards, uint64_t (*hash)(const void*)) {
+    if (!key_size) return (ConcMap*)0;  // caller checks NULL
+
+    if (!n_shards) n_shards = CMAP_DEFAULT_SHARDS;
+    size_t shards = 1;
+    while (shards < n_shards) {
+        if (shards > SIZE_MAX / 2 / sizeof(cmap_shard)) return (ConcMap*)0;
+        shards *= 2;
+    }
+
+    ConcMap *new_map = malloc(sizeof(*new_map));
+    if (!new_map) return (ConcMap*)0;
+
+    new_map->key_size = key_size;
+    new_map->val_size = val_size;
+    new_map->key_words = (key_size + CM_WORD - 1) / CM_WORD;
+    new_map->val_words = (val_size + CM_WORD - 1) / CM_WORD;
+    new_map->hash = hash;
+    new_map->n_shards = 0;
+
+    void *mem = NULL;
+    if (posix_memalign(&mem, APUTIL_CACHE_LINE, shards * sizeof(cmap_shard))) {
+        free(new_map);
+        return (ConcMap*)0;
+    }
+    new_map->shards = mem;
+
+    size_t sw = CM_SLOT(new_map);
+    for (size_t i = 0; i < shards; i++, new_map->n_shards++) {
+        cmap_shard *s = &new_map->shards[i];
+        s->scratch = malloc(3 * sw * CM_WORD);
+        cmap_table *t = ct_new(HS_MIN_CAP, sw);
+        if (!s->scratch || !t || pthread_mutex_init(&s->lock, NULL)) {
+            free(s->scratch);
+            free(t);
+            cmap_free(new_map);
+            return (ConcMap*)0;
+        }
+        atomic_init(&s->seq, 0);
+        atomic_init(&s->table, t);
+        atomic_init(&s->size, 0);
+    }
+
+    return new_map;
+}
+
+
+void cmap_free(ConcMap *m) {
+    if (!m) return;
+    for (size_t i = 0; i < m->n_shards; i++) {
+        cmap_shard *s = &m->shards[i];
+        cmap_table *t = atomic_load_explicit(&s->table, memory_order_relaxed);
+        while (t) {
+            cmap_table *older = t->retired;
+            free(t);
+            t = older;
+        }
+        free(s->scratch);
+        pthread_mutex_destroy(&s->lock);
+    }
+    free(m->shards);
+    free(m);
+}
+
+
+bool cmap_get(const ConcMap *m, const void *key, void *val_out) {
+    if (!m || !key) return false;
+
+    uint64_t h = cm_hash(m, key);
+    cmap_shard *s = cm_shard(m, h);
+    for (;;) {
+        size_t q = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (q & 1) {
+            sched_yield();
+            continue;
+        }
+
+        cmap_table *t = atomic_load_explicit(&s->table, memory_order_acquire);
+        size_t i, d;
+        bool found = ct_probe(m, t, key, h, &i, &d);
+        if (found && val_out) ct_copy_val(m, t, i, val_out);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s->seq, memory_order_relaxed) == q) return found;
+    }
+}
+
+
+UTIL_ERR cmap_put(ConcMap *m, const void *key, const void *val) {
+    if (!m) return E_EMPTY_OBJ;
+    if (!key || (!val && m->val_size)) return E_EMPTY_ARG;
+
+    uint64_t h = cm_hash(m, key);
+    cmap_shard *s = cm_shard(m, h);
+    size_t sw = CM_SLOT(m), i, d;
+    UTIL_ERR err = E_NOOP;
+
+    pthread_mutex_lock(&s->lock);
+    cmap_table *t = atomic_load_explicit(&s->table, memory_order_relaxed);
+    cm_pack(s->scratch, key, m->key_size, m->key_words);
+    if (m->val_size) cm_pack(s->scratch + m->key_words, val, m->val_size, m->val_words);
+
+    if (ct_probe(m, t, key, h, &i, &d)) {
+        seq_begin(s);
+        ct_store(t, sw, i, s->scratch, h, d);
+        seq_end(s);
+    } else {
+        err = cm_add(m, s, key, h, i, d);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return err;
+}
+
+
+UTIL_ERR cmap_remove(ConcMap *m, const void *key) {
+    if (!m) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+
+    uint64_t h = cm_hash(m, key);
+    cmap_shard *s = cm_shard(m, h);
+    size_t sw = CM_SLOT(m), i, d;
+
+    pthread_mutex_lock(&s->lock);
+    cmap_table *t = atomic_load_explicit(&s->table, memory_order_relaxed);
+    if (!ct_probe(m, t, key, h, &i, &d)) {
+        pthread_mutex_unlock(&s->lock);
+        return E_DOESNT_EXIST;
+    }
+
+    // backward shift as in the sets
+    uint64_t *tmp = s->scratch;
+    size_t mask = t->cap - 1, next = (i + 1) & mask;
+    seq_begin(s);
+    for (;;) {
+        uint8_t b = atomic_load_explicit(&t->dist[next], memory_order_relaxed);
+        if (b <= 1) break;
+        uint64_t nh = atomic_load_explicit(&t->hashes[next], memory_order_relaxed);
+        ct_fetch(t, sw, next, tmp);
+        ct_store(t, sw, i, tmp, nh, ct_dist(t, next, b) - 1);
+        i = next;
+        next = (next + 1) & mask;
+    }
+    atomic_store_explicit(&t->dist[i], 0, memory_order_relaxed);
+    seq_end(s);
+
+    atomic_fetch_sub_explicit(&s->size, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&s->lock);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR cmap_compute_if_absent(ConcMap *m, const void *key, UTIL_ERR (*make)(const void *key, void *val, void *arg), void *arg, void *val_out) {
+    if (!m) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+    if (!make) return E_EMPTY_FUNC;
+
+    // present keys never touch the lock
+    if (cmap_get(m, key, val_out)) return E_NOOP;
+
+    uint64_t h = cm_hash(m, key);
+    cmap_shard *s = cm_shard(m, h);
+    size_t i, d;
+
+    pthread_mutex_lock(&s->lock);
+    cmap_table *t = atomic_load_explicit(&s->table, memory_order_relaxed);
+    if (ct_probe(m, t, key, h, &i, &d)) {
+        // another thread made it since the lock free look
+        if (val_out) ct_copy_val(m, t, i, val_out);
+        pthread_mutex_unlock(&s->lock);
+        return E_NOOP;
+    }
+
+    cm_pack(s->scratch, key, m->key_size, m->key_words);
+    char *val = (char*)(s->scratch + m->key_words);
+    memset(val, 0, m->val_words * CM_WORD);
+    UTIL_ERR err = make(key, val, arg);
+    if (!err) {
+        // placing swaps entries through scratch, copy out first
+        if (val_out) memcpy(val_out, val, m->val_size);
+        err = cm_add(m, s, key, h, i, d);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return err;
+}
+
+
+UTIL_ERR cmap_upsert(ConcMap *m, const void *key, void (*update)(void *val, bool present, void *arg), void *arg) {
+    if (!m) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+    if (!update) return E_EMPTY_FUNC;
+
+    uint64_t h = cm_hash(m, key);
+    cmap_shard *s = cm_shard(m, h);
+    size_t sw = CM_SLOT(m), i, d;
+    char *val = (char*)(s->scratch + m->key_words);
+    UTIL_ERR err = E_SUCCESS;
+
+    pthread_mutex_lock(&s->lock);
+    cmap_table *t = atomic_load_explicit(&s->table, memory_order_relaxed);
+    if (ct_probe(m, t, key, h, &i, &d)) {
+        ct_fetch(t, sw, i, s->scratch);
+        update(val, true, arg);
+        seq_begin(s);
+        ct_store(t, sw, i, s->scratch, h, d);
+        seq_end(s);
+    } else {
+        cm_pack(s->scratch, key, m->key_size, m->key_words);
+        memset(val, 0, m->val_words * CM_WORD);
+        update(val, false, arg);
+        err = cm_add(m, s, key, h, i, d);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return err;
+}
+
+
+size_t cmap_size(const ConcMap *m) {
+    if (!m) return 0;
+    size_t n = 0;
+    for (size_t i = 0; i < m->n_shards; i++) n += atomic_load_explicit(&m->shards[i].size, memory_order_relaxed);
+    return n;
+}
+
+// ###################### CONCURRENT MAP ######################
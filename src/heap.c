@@ -0,0 +1,599 @@
+/*
+ *  heaps / priority queues
+ *  implicit d-ary heaps stored in vectors
+ *      > arity 2 is a binary heap, arity 4 halves the depth and keeps all
+ *        children of a node in one or two cache lines
+ *      > sifts move a "hole" instead of swapping, so each level costs one copy
+ *      > min-heap by default, max flag reverses the compare
+ *
+ *  generic heap (Vector storage, compare function)
+ *  i32 heap (Vec_i32 storage, optional compare function)
+ *  indexed heap (int32 priorities keyed by id, supports decrease-key)
+ */
+
+#include "../include/aputils.h"
+
+
+#define HEAP_PARENT(i, d) (((i) - 1) / (d))
+#define HEAP_CHILD(i, d) ((i) * (d) + 1)
+
+
+// ###################### GENERIC HEAP ######################
+
+// does a belong above b
+static inline bool heap_before(const Heap *h, const void *a, const void *b) {
+    int c = h->compare(a, b);
+    return h->max ? c > 0 : c < 0;
+}
+
+static inline void *heap_at(const Heap *h, size_t idx) {
+    return (char*)h->vec->data + idx * h->vec->elem_size;
+}
+
+
+// move the element held in h->tmp up from the hole at idx
+static void heap_sift_up(Heap *h, size_t idx) {
+    size_t es = h->vec->elem_size;
+    while (idx > 0) {
+        size_t parent = HEAP_PARENT(idx, h->arity);
+        if (!heap_before(h, h->tmp, heap_at(h, parent))) break;
+        memcpy(heap_at(h, idx), heap_at(h, parent), es);
+        idx = parent;
+    }
+    memcpy(heap_at(h, idx), h->tmp, es);
+}
+
+
+// move the element held in h->tmp down from the hole at idx
+static void heap_sift_down(Heap *h, size_t idx) {
+    size_t es = h->vec->elem_size, n = h->vec->size;
+    for (;;) {
+        size_t first = HEAP_CHILD(idx, h->arity);
+        if (first >= n) break;
+
+        size_t last = first + h->arity < n ? first + h->arity : n;
+        size_t best = first;
+        for (size_t c = first + 1; c < last; c++) {
+            if (heap_before(h, heap_at(h, c), heap_at(h, best))) best = c;
+        }
+
+        if (!heap_before(h, heap_at(h, best), h->tmp)) break;
+        memcpy(heap_at(h, idx), heap_at(h, best), es);
+        idx = best;
+    }
+    memcpy(heap_at(h, idx), h->tmp, es);
+}
+
+
+static Heap *heap_container(int (*compare)(const void*, const void*), bool max, size_t arity) {
+    Heap *new_heap = malloc(sizeof(*new_heap));
+    if (!new_heap) return (Heap*)0;
+
+    new_heap->vec = NULL;
+    new_heap->tmp = NULL;
+    new_heap->compare = compare;
+    new_heap->arity = arity;
+    new_heap->max = max;
+
+    return new_heap;
+}
+
+
+Heap *heap_new(size_t elem_size, size_t cap, int (*compare)(const void*, const void*), bool max, size_t arity) {
+    if (elem_size < 1 || !compare || arity < 2) {
+        return (Heap*)0;  // caller checks NULL
+    }
+
+    Heap *new_heap = heap_container(compare, max, arity);
+    if (!new_heap) return (Heap*)0;
+
+    new_heap->vec = vector_new(elem_size, cap);
+    new_heap->tmp = malloc(elem_size);
+    if (!new_heap->vec || !new_heap->tmp) {
+        heap_free(new_heap);
+        return (Heap*)0;
+    }
+
+    return new_heap;
+}
+
+
+Heap *heap_from_vector(Vector *v, int (*compare)(const void*, const void*), bool max, size_t arity) {
+    if (!v || !compare || arity < 2) {
+        return (Heap*)0;
+    }
+
+    Heap *new_heap = heap_container(compare, max, arity);
+    if (!new_heap) return (Heap*)0;
+
+    new_heap->tmp = malloc(v->elem_size);
+    if (!new_heap->tmp) {
+        free(new_heap);
+        return (Heap*)0;
+    }
+    new_heap->vec = v;
+    heap_heapify(new_heap);
+
+    return new_heap;
+}
+
+
+void heap_free(Heap *h) {
+    if (!h) return;
+    vector_free(h->vec);
+    free(h->tmp);
+    free(h);
+}
+
+
+UTIL_ERR heap_heapify(Heap *h) {
+    if (!h) return E_EMPTY_OBJ;
+    if (h->vec->size < 2) return E_NOOP;
+
+    // bottom-up (Floyd), O(n)
+    size_t i = HEAP_PARENT(h->vec->size - 1, h->arity) + 1;
+    while (i-- > 0) {
+        memcpy(h->tmp, heap_at(h, i), h->vec->elem_size);
+        heap_sift_down(h, i);
+    }
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR heap_push(Heap *h, const void *elem) {
+    if (!h) return E_EMPTY_OBJ;
+    if (!elem) return E_EMPTY_ARG;
+
+    memcpy(h->tmp, elem, h->vec->elem_size);
+    UTIL_ERR e = vector_add_back(h->vec, h->tmp);
+    if (e) return e;
+
+    heap_sift_up(h, h->vec->size - 1);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR heap_pop(Heap *h, void *out) {
+    if (!h) return E_EMPTY_OBJ;
+    if (h->vec->size == 0) return E_NODATA;
+
+    if (out) memcpy(out, heap_at(h, 0), h->vec->elem_size);
+
+    h->vec->size--;
+    if (h->vec->size > 0) {
+        memcpy(h->tmp, heap_at(h, h->vec->size), h->vec->elem_size);
+        heap_sift_down(h, 0);
+    }
+
+    return E_SUCCESS;
+}
+
+
+void *heap_peek(const Heap *h, UTIL_ERR *e) {
+    if (!h) {
+        *e = E_EMPTY_OBJ;
+        return NULL;
+    }
+    if (h->vec->size == 0) {
+        *e = E_NODATA;
+        return NULL;
+    }
+
+    return h->vec->data;
+}
+
+
+UTIL_ERR heap_replace_top(Heap *h, const void *elem, void *out) {
+    if (!h) return E_EMPTY_OBJ;
+    if (!elem) return E_EMPTY_ARG;
+    if (h->vec->size == 0) return E_NODATA;
+
+    if (out) memcpy(out, heap_at(h, 0), h->vec->elem_size);
+    memcpy(h->tmp, elem, h->vec->elem_size);
+    heap_sift_down(h, 0);
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR heap_push_bounded(Heap *h, const void *elem, size_t k) {
+    if (!h) return E_EMPTY_OBJ;
+    if (!elem) return E_EMPTY_ARG;
+    if (k == 0) return E_NOOP;
+
+    if (h->vec->size < k) return heap_push(h, elem);
+
+    // full: elem only gets in if the current top ranks above it
+    if (!heap_before(h, heap_at(h, 0), elem)) return E_NOOP;
+    memcpy(h->tmp, elem, h->vec->elem_size);
+    heap_sift_down(h, 0);
+
+    return E_SUCCESS;
+}
+
+
+size_t heap_size(const Heap *h) {
+    return h ? h->vec->size : 0;
+}
+
+// ###################### GENERIC HEAP ######################
+
+// ###################### i32 HEAP ######################
+
+static inline bool heap_i32_before(const Heap_i32 *h, int32_t a, int32_t b) {
+    int c = h->compare ? h->compare(&a, &b) : (a > b) - (a < b);
+    return h->max ? c > 0 : c < 0;
+}
+
+
+static void heap_i32_sift_up(Heap_i32 *h, size_t idx, int32_t elem) {
+    int32_t *data = h->vec->data;
+    while (idx > 0) {
+        size_t parent = HEAP_PARENT(idx, h->arity);
+        if (!heap_i32_before(h, elem, data[parent])) break;
+        data[idx] = data[parent];
+        idx = parent;
+    }
+    data[idx] = elem;
+}
+
+
+static void heap_i32_sift_down(Heap_i32 *h, size_t idx, int32_t elem) {
+    int32_t *data = h->vec->data;
+    size_t n = h->vec->size;
+    for (;;) {
+        size_t first = HEAP_CHILD(idx, h->arity);
+        if (first >= n) break;
+
+        size_t last = first + h->arity < n ? first + h->arity : n;
+        size_t best = first;
+        for (size_t c = first + 1; c < last; c++) {
+            if (heap_i32_before(h, data[c], data[best])) best = c;
+        }
+
+        if (!heap_i32_before(h, data[best], elem)) break;
+        data[idx] = data[best];
+        idx = best;
+    }
+    data[idx] = elem;
+}
+
+
+Heap_i32 *heap_i32_new(size_t cap, int (*compare)(const void*, const void*), bool max, size_t arity) {
+    if (arity < 2) {
+        return (Heap_i32*)0;  // caller checks NULL
+    }
+
+    Heap_i32 *new_heap = malloc(sizeof(*new_heap));
+    if (!new_heap) return (Heap_i32*)0;
+
+    new_heap->vec = vec_i32_new(cap);
+    if (!new_heap->vec) {
+        free(new_heap);
+        return (Heap_i32*)0;
+    }
+    new_heap->compare = compare;
+    new_heap->arity = arity;
+    new_heap->max = max;
+
+    return new_heap;
+}
+
+
+Heap_i32 *heap_i32_from_vec(Vec_i32 *v, int (*compare)(const void*, const void*), bool max, size_t arity) {
+    if (!v || arity < 2) {
+        return (Heap_i32*)0;
+    }
+
+    Heap_i32 *new_heap = malloc(sizeof(*new_heap));
+    if (!new_heap) return (Heap_i32*)0;
+
+    new_heap->vec = v;
+    new_heap->compare = compare;
+    new_heap->arity = arity;
+    new_heap->max = max;
+    heap_i32_heapify(new_heap);
+
+    return new_heap;
+}
+
+
+void heap_i32_free(Heap_i32 *h) {
+    if (!h) return;
+    vec_i32_free(h->vec);
+    free(h);
+}
+
+
+UTIL_ERR heap_i32_heapify(Heap_i32 *h) {
+    if (!h) return E_EMPTY_OBJ;
+    if (h->vec->size < 2) return E_NOOP;
+
+    size_t i = HEAP_PARENT(h->vec->size - 1, h->arity) + 1;
+    while (i-- > 0) {
+        heap_i32_sift_down(h, i, h->vec->data[i]);
+    }
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR heap_i32_push(Heap_i32 *h, int32_t elem) {
+    if (!h) return E_EMPTY_OBJ;
+
+    UTIL_ERR e = vec_i32_add_back(h->vec, elem);
+    if (e) return e;
+
+    heap_i32_sift_up(h, h->vec->size - 1, elem);
+    return E_SUCCESS;
+}
+
+
+int32_t heap_i32_pop(Heap_i32 *h, UTIL_ERR *e) {
+    if (!h) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+    if (h->vec->size == 0) {
+        *e = E_NODATA;
+        return 0;
+    }
+
+    int32_t top = h->vec->data[0];
+    h->vec->size--;
+    if (h->vec->size > 0) {
+        heap_i32_sift_down(h, 0, h->vec->data[h->vec->size]);
+    }
+
+    return top;
+}
+
+
+int32_t heap_i32_peek(const Heap_i32 *h, UTIL_ERR *e) {
+    if (!h) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+    if (h->vec->size == 0) {
+        *e = E_NODATA;
+        return 0;
+    }
+
+    return h->vec->data[0];
+}
+
+
+int32_t heap_i32_replace_top(Heap_i32 *h, int32_t elem, UTIL_ERR *e) {
+    if (!h) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+    if (h->vec->size == 0) {
+        *e = E_NODATA;
+        return 0;
+    }
+
+    int32_t top = h->vec->data[0];
+    heap_i32_sift_down(h, 0, elem);
+
+    return top;
+}
+
+
+UTIL_ERR heap_i32_push_bounded(Heap_i32 *h, int32_t elem, size_t k) {
+    if (!h) return E_EMPTY_OBJ;
+    if (k == 0) return E_NOOP;
+
+    if (h->vec->size < k) return heap_i32_push(h, elem);
+
+    if (!heap_i32_before(h, h->vec->data[0], elem)) return E_NOOP;
+    heap_i32_sift_down(h, 0, elem);
+
+    return E_SUCCESS;
+}
+
+
+size_t heap_i32_size(const Heap_i32 *h) {
+    return h ? h->vec->size : 0;
+}
+
+// ###################### i32 HEAP ######################
+
+// ###################### INDEXED HEAP ######################
+
+#define HEAP_IDX_ABSENT SIZE_MAX
+
+static inline bool heap_idx_before(const Heap_idx *h, int32_t a, int32_t b) {
+    return h->max ? a > b : a < b;
+}
+
+
+static void heap_idx_sift_up(Heap_idx *h, size_t idx, int32_t id) {
+    int32_t *ids = h->heap->data;
+    int32_t prio = h->prio[id];
+    while (idx > 0) {
+        size_t parent = HEAP_PARENT(idx, h->arity);
+        if (!heap_idx_before(h, prio, h->prio[ids[parent]])) break;
+        ids[idx] = ids[parent];
+        h->pos[ids[idx]] = idx;
+        idx = parent;
+    }
+    ids[idx] = id;
+    h->pos[id] = idx;
+}
+
+
+static void heap_idx_sift_down(Heap_idx *h, size_t idx, int32_t id) {
+    int32_t *ids = h->heap->data;
+    int32_t prio = h->prio[id];
+    size_t n = h->heap->size;
+    for (;;) {
+        size_t first = HEAP_CHILD(idx, h->arity);
+        if (first >= n) break;
+
+        size_t last = first + h->arity < n ? first + h->arity : n;
+        size_t best = first;
+        for (size_t c = first + 1; c < last; c++) {
+            if (heap_idx_before(h, h->prio[ids[c]], h->prio[ids[best]])) best = c;
+        }
+
+        if (!heap_idx_before(h, h->prio[ids[best]], prio)) break;
+        ids[idx] = ids[best];
+        h->pos[ids[idx]] = idx;
+        idx = best;
+    }
+    ids[idx] = id;
+    h->pos[id] = idx;
+}
+
+
+Heap_idx *heap_idx_new(size_t n_ids, bool max, size_t arity) {
+    if (n_ids < 1 || n_ids > INT32_MAX || arity < 2) {
+        return (Heap_idx*)0;  // caller checks NULL
+    }
+
+    Heap_idx *new_heap = malloc(sizeof(*new_heap));
+    if (!new_heap) return (Heap_idx*)0;
+
+    new_heap->heap = vec_i32_new(n_ids);
+    new_heap->prio = malloc(sizeof(int32_t) * n_ids);
+    new_heap->pos = malloc(sizeof(size_t) * n_ids);
+    if (!new_heap->heap || !new_heap->prio || !new_heap->pos) {
+        vec_i32_free(new_heap->heap);
+        free(new_heap->prio);
+        free(new_heap->pos);
+        free(new_heap);
+        return (Heap_idx*)0;
+    }
+
+    for (size_t i = 0; i < n_ids; i++) new_heap->pos[i] = HEAP_IDX_ABSENT;
+    new_heap->n_ids = n_ids;
+    new_heap->arity = arity;
+    new_heap->max = max;
+
+    return new_heap;
+}
+
+
+void heap_idx_free(Heap_idx *h) {
+    if (!h) return;
+    vec_i32_free(h->heap);
+    free(h->prio);
+    free(h->pos);
+    free(h);
+}
+
+
+bool heap_idx_contains(const Heap_idx *h, size_t id) {
+    if (!h || id >= h->n_ids) return false;
+    return h->pos[id] != HEAP_IDX_ABSENT;
+}
+
+
+UTIL_ERR heap_idx_push(Heap_idx *h, size_t id, int32_t prio) {
+    if (!h) return E_EMPTY_OBJ;
+    if (id >= h->n_ids) return E_OUTOFBOUNDS;
+    if (h->pos[id] != HEAP_IDX_ABSENT) return E_NOOP;     // use heap_idx_update
+
+    h->prio[id] = prio;
+    UTIL_ERR e = vec_i32_add_back(h->heap, (int32_t)id);
+    if (e) return e;
+
+    heap_idx_sift_up(h, h->heap->size - 1, (int32_t)id);
+    return E_SUCCESS;
+}
+
+
+size_t heap_idx_pop(Heap_idx *h, int32_t *prio, UTIL_ERR *e) {
+    if (!h) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+    if (h->heap->size == 0) {
+        *e = E_NODATA;
+        return 0;
+    }
+
+    int32_t top = h->heap->data[0];
+    if (prio) *prio = h->prio[top];
+    h->pos[top] = HEAP_IDX_ABSENT;
+
+    h->heap->size--;
+    if (h->heap->size > 0) {
+        heap_idx_sift_down(h, 0, h->heap->data[h->heap->size]);
+    }
+
+    return (size_t)top;
+}
+
+
+size_t heap_idx_peek(const Heap_idx *h, int32_t *prio, UTIL_ERR *e) {
+    if (!h) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+    if (h->heap->size == 0) {
+        *e = E_NODATA;
+        return 0;
+    }
+
+    int32_t top = h->heap->data[0];
+    if (prio) *prio = h->prio[top];
+    return (size_t)top;
+}
+
+
+UTIL_ERR heap_idx_decrease_key(Heap_idx *h, size_t id, int32_t prio) {
+    if (!h) return E_EMPTY_OBJ;
+    if (id >= h->n_ids) return E_OUTOFBOUNDS;
+    if (h->pos[id] == HEAP_IDX_ABSENT) return E_DOESNT_EXIST;
+    if (heap_idx_before(h, h->prio[id], prio)) return E_NOOP;   // would move away from the top
+
+    h->prio[id] = prio;
+    heap_idx_sift_up(h, h->pos[id], (int32_t)id);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR heap_idx_update(Heap_idx *h, size_t id, int32_t prio) {
+    if (!h) return E_EMPTY_OBJ;
+    if (id >= h->n_ids) return E_OUTOFBOUNDS;
+    if (h->pos[id] == HEAP_IDX_ABSENT) return E_DOESNT_EXIST;
+
+    bool up = heap_idx_before(h, prio, h->prio[id]);
+    h->prio[id] = prio;
+    if (up) heap_idx_sift_up(h, h->pos[id], (int32_t)id);
+    else heap_idx_sift_down(h, h->pos[id], (int32_t)id);
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR heap_idx_remove(Heap_idx *h, size_t id) {
+    if (!h) return E_EMPTY_OBJ;
+    if (id >= h->n_ids) return E_OUTOFBOUNDS;
+    if (h->pos[id] == HEAP_IDX_ABSENT) return E_DOESNT_EXIST;
+
+    size_t idx = h->pos[id];
+    h->pos[id] = HEAP_IDX_ABSENT;
+    h->heap->size--;
+    if (idx == h->heap->size) return E_SUCCESS;
+
+    // fill the hole with the last element and restore order in either direction
+    int32_t last = h->heap->data[h->heap->size];
+    if (idx > 0 && heap_idx_before(h, h->prio[last], h->prio[h->heap->data[HEAP_PARENT(idx, h->arity)]])) {
+        heap_idx_sift_up(h, idx, last);
+    } else {
+        heap_idx_sift_down(h, idx, last);
+    }
+
+    return E_SUCCESS;
+}
+
+
+size_t heap_idx_size(const Heap_idx *h) {
+    return h ? h->heap->size : 0;
+}
+
+// ###################### INDEXED HEAP ######################
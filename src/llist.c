@@ -9,6 +9,23 @@
 #include "../include/aputils.h"
 
 
+// nodes from push_back_n, the block is freed once every node is released
+struct aputil_node_slab {
+    size_t live;
+    APUTIL_Node nodes[];
+};
+
+
+static void release_node(APUTIL_Node *n) {
+    struct aputil_node_slab *slab = n->slab;
+    if (!slab) {
+        free(n);
+        return;
+    }
+    if (--slab->live == 0) free(slab);
+}
+
+
 APUTIL_LList *aputil_llist_new(
     void (*free)(void*),                // free data, can be null, used when preserve = false in free function
     void *(*copydata)(const void*),     // copy data, can be null, and copies will be shallow
@@ -48,7 +65,7 @@ void aputil_llist_free(APUTIL_LList *lst, bool preserve) {
         prev = cur;
         cur = cur->next;
         if (lst->free && !preserve) lst->free(prev->data);
-        free(prev);
+        release_node(prev);
     }
     free(lst);
 
@@ -79,6 +96,7 @@ static APUTIL_Node *make_node(void) {
     APUTIL_Node * new_node = malloc(sizeof(*new_node));
     if (!new_node) return (APUTIL_Node*)0;
     new_node->data = new_node->next = new_node->prev = NULL;
+    new_node->slab = NULL;
     return new_node;
 }
 
@@ -122,7 +140,7 @@ void *aputil_llist_pop(APUTIL_LList *lst, UTIL_ERR *e) {
     if (lst->cnt == 0) lst->tail = NULL;
     
     void *data = popped->data;
-    free(popped);   // node not data
+    release_node(popped);   // node not data
     return data;
 
 }
@@ -149,6 +167,38 @@ UTIL_ERR aputil_llist_push_back(APUTIL_LList *lst, void *elem) {
 }
 
 
+UTIL_ERR aputil_llist_push_back_n(APUTIL_LList *lst, void *const *elems, size_t n) {
+    if (!lst) return E_EMPTY_OBJ;
+    if (n == 0) return E_SUCCESS;
+    if (!elems) return E_EMPTY_ARG;
+    for (size_t i = 0; i < n; i++) {
+        if (!elems[i]) return E_EMPTY_ARG;
+    }
+    if (n > (SIZE_MAX - sizeof(struct aputil_node_slab)) / sizeof(APUTIL_Node)) return E_BAD_ALLOC;
+
+    struct aputil_node_slab *slab = malloc(sizeof(*slab) + n * sizeof(APUTIL_Node));
+    if (!slab) return E_BAD_ALLOC;
+    slab->live = n;
+
+    // link the batch among itself, then splice it on in one step
+    APUTIL_Node *nodes = slab->nodes;
+    for (size_t i = 0; i < n; i++) {
+        nodes[i].data = elems[i];
+        nodes[i].prev = i ? &nodes[i-1] : lst->tail;
+        nodes[i].next = i + 1 < n ? &nodes[i+1] : NULL;
+        nodes[i].slab = slab;
+    }
+
+    if (lst->tail) lst->tail->next = &nodes[0];
+    else lst->head = &nodes[0];
+    lst->tail = &nodes[n-1];
+    lst->cnt += n;
+
+    return E_SUCCESS;
+
+}
+
+
 void *aputil_llist_pop_back(APUTIL_LList *lst, UTIL_ERR *e) {
     // doesn't free data when popped, caller must free if alloced
     if (!lst) {
@@ -168,7 +218,7 @@ void *aputil_llist_pop_back(APUTIL_LList *lst, UTIL_ERR *e) {
     if (lst->cnt == 0) lst->head = NULL;
     
     void *data = popped->data;
-    free(popped);   // node not data
+    release_node(popped);   // node not data
     return data;
 
 }
@@ -197,13 +247,55 @@ UTIL_ERR aputil_llist_delete(APUTIL_LList *lst, APUTIL_Node *n, bool preserve) {
     }
 
     if (lst->free && !preserve) lst->free(n->data);
-    free(n);
+    release_node(n);
+    lst->cnt--;
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR aputil_llist_unlink(APUTIL_LList *lst, APUTIL_Node *n) {
+    // no membership walk, unlike delete
+    if (!lst) return E_EMPTY_OBJ;
+    if (!n) return E_EMPTY_ARG;
+
+    if (n->prev) n->prev->next = n->next;
+    else lst->head = n->next;
+    if (n->next) n->next->prev = n->prev;
+    else lst->tail = n->prev;
+
+    n->next = n->prev = NULL;
     lst->cnt--;
 
     return E_SUCCESS;
 }
 
 
+UTIL_ERR aputil_llist_link_front(APUTIL_LList *lst, APUTIL_Node *n) {
+    if (!lst) return E_EMPTY_OBJ;
+    if (!n) return E_EMPTY_ARG;
+
+    n->prev = NULL;
+    n->next = lst->head;
+    if (lst->head) lst->head->prev = n;
+    else lst->tail = n;
+    lst->head = n;
+    lst->cnt++;
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR aputil_llist_move_front(APUTIL_LList *lst, APUTIL_Node *n) {
+    if (!lst) return E_EMPTY_OBJ;
+    if (!n) return E_EMPTY_ARG;
+    if (n == lst->head) return E_SUCCESS;
+
+    aputil_llist_unlink(lst, n);
+    return aputil_llist_link_front(lst, n);
+}
+
+
 static void copy_node_values(APUTIL_Node *n_dest, const APUTIL_Node *n_src) {
     if (!n_dest || !n_src) return;
     n_dest->data = n_src->data;
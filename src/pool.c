@@ -0,0 +1,499 @@
+/*
+ *  thread pool
+ *  fixed set of pthreads that run fork-join batches of indexed tasks
+ *      > pool_run hands out task indices through an atomic counter, the
+ *        calling thread works too and returns once every task ran
+ *      > parallel vector operations split the data into cache line aligned
+ *        chunks (several per thread for balance), per chunk results are
+ *        padded to their own cache line and combined in chunk order so the
+ *        output matches the serial version
+ *      > a task calling pool_run on its own pool runs the nested batch
+ *        inline on its thread instead of waiting on itself
+ *
+ *  pool
+ *  parallel vector map / filter / reduce
+ */
+
+#include <unistd.h>
+#include "../include/aputils.h"
+
+
+// ###################### POOL ######################
+
+// worker of the pool the current thread is running tasks for, NULL outside
+static _Thread_local APUTIL_Pool_worker *tls_worker;
+
+
+// take task indices until the batch is exhausted
+static void pool_drain(APUTIL_Pool *p, size_t worker) {
+    for (;;) {
+        size_t idx = atomic_fetch_add_explicit(&p->next, 1, memory_order_relaxed);
+        if (idx >= p->n_tasks) return;
+        p->task(p->ctx, idx, worker);
+    }
+}
+
+
+static void *pool_worker(void *arg) {
+    APUTIL_Pool_worker *w = arg;
+    APUTIL_Pool *p = w->pool;
+    size_t seen = 0;
+    tls_worker = w;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (p->generation == seen && !p->stop) pthread_cond_wait(&p->work_cv, &p->lock);
+        if (p->stop) break;
+        seen = p->generation;
+        pthread_mutex_unlock(&p->lock);
+
+        pool_drain(p, w->id);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->active == 0) pthread_cond_signal(&p->done_cv);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+
+APUTIL_Pool *pool_new(size_t n_threads) {
+    if (n_threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = online > 0 ? (size_t)online : 1;
+    }
+
+    APUTIL_Pool *new_pool = calloc(1, sizeof(*new_pool));
+    if (!new_pool) {
+        return (APUTIL_Pool*)0;  // caller checks NULL
+    }
+
+    new_pool->n_threads = n_threads;
+    new_pool->workers = calloc(n_threads, sizeof(APUTIL_Pool_worker));
+    if (!new_pool->workers) {
+        free(new_pool);
+        return (APUTIL_Pool*)0;
+    }
+
+    pthread_mutex_init(&new_pool->lock, NULL);
+    pthread_mutex_init(&new_pool->run_lock, NULL);
+    pthread_cond_init(&new_pool->work_cv, NULL);
+    pthread_cond_init(&new_pool->done_cv, NULL);
+    atomic_init(&new_pool->next, 0);
+
+    // worker 0 is whichever thread calls pool_run
+    new_pool->workers[0].pool = new_pool;
+    for (size_t i = 1; i < n_threads; i++) {
+        new_pool->workers[i].pool = new_pool;
+        new_pool->workers[i].id = i;
+        if (pthread_create(&new_pool->workers[i].tid, NULL, pool_worker, &new_pool->workers[i]) != 0) {
+            new_pool->n_threads = i;
+            pool_free(new_pool);
+            return (APUTIL_Pool*)0;
+        }
+    }
+
+    return new_pool;
+}
+
+
+void pool_free(APUTIL_Pool *p) {
+    if (!p) return;
+
+    pthread_mutex_lock(&p->lock);
+    p->stop = true;
+    pthread_cond_broadcast(&p->work_cv);
+    pthread_mutex_unlock(&p->lock);
+
+    for (size_t i = 1; i < p->n_threads; i++) pthread_join(p->workers[i].tid, NULL);
+
+    pthread_mutex_destroy(&p->lock);
+    pthread_mutex_destroy(&p->run_lock);
+    pthread_cond_destroy(&p->work_cv);
+    pthread_cond_destroy(&p->done_cv);
+    free(p->workers);
+    free(p);
+}
+
+
+size_t pool_threads(const APUTIL_Pool *p) {
+    return p ? p->n_threads : 0;
+}
+
+
+UTIL_ERR pool_run(APUTIL_Pool *p, size_t n_tasks, void (*task)(void *ctx, size_t idx, size_t worker), void *ctx) {
+    if (!p) return E_EMPTY_OBJ;
+    if (!task) return E_EMPTY_FUNC;
+    if (n_tasks == 0) return E_NOOP;
+
+    // nested batch from one of this pool's tasks, the workers are busy with the outer one
+    if (tls_worker && tls_worker->pool == p) {
+        for (size_t i = 0; i < n_tasks; i++) task(ctx, i, tls_worker->id);
+        return E_SUCCESS;
+    }
+
+    pthread_mutex_lock(&p->run_lock);
+    APUTIL_Pool_worker *prev = tls_worker;
+    tls_worker = &p->workers[0];
+
+    // a single task doesn't need to wake anyone
+    if (n_tasks == 1 || p->n_threads == 1) {
+        for (size_t i = 0; i < n_tasks; i++) task(ctx, i, 0);
+        tls_worker = prev;
+        pthread_mutex_unlock(&p->run_lock);
+        return E_SUCCESS;
+    }
+
+    p->task = task;
+    p->ctx = ctx;
+    p->n_tasks = n_tasks;
+    atomic_store_explicit(&p->next, 0, memory_order_relaxed);
+
+    pthread_mutex_lock(&p->lock);
+    p->generation++;
+    p->active = p->n_threads - 1;
+    pthread_cond_broadcast(&p->work_cv);
+    pthread_mutex_unlock(&p->lock);
+
+    pool_drain(p, 0);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->active) pthread_cond_wait(&p->done_cv, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    tls_worker = prev;
+    pthread_mutex_unlock(&p->run_lock);
+    return E_SUCCESS;
+}
+
+// ###################### POOL ######################
+
+
+// ###################### PARALLEL VECTOR OPS ######################
+
+static size_t gcd(size_t a, size_t b) {
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+
+/*
+    elements per chunk
+    a multiple of the smallest element count spanning whole cache lines, so
+    neighbouring chunks never write to the same line (when data is line
+    aligned), at least POOL_MIN_CHUNK bytes, about POOL_CHUNKS_PER_THREAD
+    chunks per thread for balance
+*/
+static size_t par_chunk(size_t n, size_t es, size_t threads, size_t *n_chunks) {
+    size_t line_elems = APUTIL_CACHE_LINE / gcd(es, APUTIL_CACHE_LINE);
+    size_t chunk = (n + threads * POOL_CHUNKS_PER_THREAD - 1) / (threads * POOL_CHUNKS_PER_THREAD);
+    size_t min_chunk = POOL_MIN_CHUNK / es;
+    if (chunk < min_chunk) chunk = min_chunk;
+    chunk = (chunk + line_elems - 1) / line_elems * line_elems;
+
+    *n_chunks = (n + chunk - 1) / chunk;
+    return chunk;
+}
+
+
+// per chunk slot of sz bytes rounded up to whole cache lines
+static size_t line_round(size_t sz) {
+    return (sz + APUTIL_CACHE_LINE - 1) / APUTIL_CACHE_LINE * APUTIL_CACHE_LINE;
+}
+
+
+typedef struct {
+    char *data;
+    size_t n;
+    size_t es;
+    size_t chunk;
+    void (*mapfunc)(void*);
+    void (*map_i32)(int32_t*);
+} map_ctx;
+
+static void map_task(void *ctx, size_t idx, size_t worker) {
+    (void)worker;
+    map_ctx *m = ctx;
+    size_t lo = idx * m->chunk, hi = lo + m->chunk < m->n ? lo + m->chunk : m->n;
+    if (m->map_i32) {
+        for (size_t i = lo; i < hi; i++) m->map_i32((int32_t*)m->data + i);
+    } else {
+        for (size_t i = lo; i < hi; i++) m->mapfunc(m->data + i * m->es);
+    }
+}
+
+
+UTIL_ERR vector_map_par(APUTIL_Pool *p, Vector *v, void(*mapfunc)(void*)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!mapfunc) return E_EMPTY_FUNC;
+    if (!p) return E_EMPTY_ARG;
+    if (v->size == 0) return E_SUCCESS;
+
+    map_ctx m = { .data = v->data, .n = v->size, .es = v->elem_size, .mapfunc = mapfunc };
+    size_t n_chunks;
+    m.chunk = par_chunk(v->size, v->elem_size, p->n_threads, &n_chunks);
+
+    return pool_run(p, n_chunks, map_task, &m);
+}
+
+
+UTIL_ERR vec_i32_map_par(APUTIL_Pool *p, Vec_i32 *v, void(*mapfunc)(int32_t*)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!mapfunc) return E_EMPTY_FUNC;
+    if (!p) return E_EMPTY_ARG;
+    if (v->size == 0) return E_SUCCESS;
+
+    map_ctx m = { .data = (char*)v->data, .n = v->size, .es = sizeof(int32_t), .map_i32 = mapfunc };
+    size_t n_chunks;
+    m.chunk = par_chunk(v->size, sizeof(int32_t), p->n_threads, &n_chunks);
+
+    return pool_run(p, n_chunks, map_task, &m);
+}
+
+
+typedef struct {
+    const char *data;
+    size_t n;
+    size_t es;
+    size_t chunk;
+    bool (*filter)(void*);
+    bool (*filter_i32)(int32_t);
+    char *out;          // n * es scratch, chunk c writes from c * chunk
+    size_t *kept;       // per chunk count, one cache line each
+    size_t kept_stride;
+} filter_ctx;
+
+static void filter_task(void *ctx, size_t idx, size_t worker) {
+    (void)worker;
+    filter_ctx *f = ctx;
+    size_t lo = idx * f->chunk, hi = lo + f->chunk < f->n ? lo + f->chunk : f->n;
+    char *dst = f->out + lo * f->es;
+    size_t kept = 0;
+    for (size_t i = lo; i < hi; i++) {
+        const char *elem = f->data + i * f->es;
+        bool keep = f->filter_i32 ? f->filter_i32(*(const int32_t*)elem) : f->filter((void*)elem);
+        if (keep) memcpy(dst + kept++ * f->es, elem, f->es);
+    }
+    *(size_t*)((char*)f->kept + idx * f->kept_stride) = kept;
+}
+
+
+/*
+    every chunk filters into its own slice of one scratch buffer, the slices
+    are then packed in chunk order, so the result has the serial order
+    returns the packed buffer (owned by the caller) and its element count
+*/
+static char *filter_par(APUTIL_Pool *p, filter_ctx *f, size_t *out_n, UTIL_ERR *e) {
+    size_t n_chunks;
+    f->chunk = par_chunk(f->n, f->es, p->n_threads, &n_chunks);
+    f->kept_stride = line_round(sizeof(size_t));
+    f->out = malloc(f->n * f->es);
+    f->kept = aligned_alloc(APUTIL_CACHE_LINE, n_chunks * f->kept_stride);
+    if (!f->out || !f->kept) {
+        free(f->out);
+        free(f->kept);
+        *e = E_BAD_ALLOC;
+        return NULL;
+    }
+
+    pool_run(p, n_chunks, filter_task, f);
+
+    size_t total = 0;
+    for (size_t c = 0; c < n_chunks; c++) {
+        size_t kept = *(size_t*)((char*)f->kept + c * f->kept_stride);
+        if (c * f->chunk != total) {
+            memmove(f->out + total * f->es, f->out + c * f->chunk * f->es, kept * f->es);
+        }
+        total += kept;
+    }
+
+    free(f->kept);
+    *out_n = total;
+    return f->out;
+}
+
+
+Vector *vector_filter_par(APUTIL_Pool *p, const Vector *v, bool(*filter)(void*), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vector*)0;
+    }
+    if (!filter) {
+        *e = E_EMPTY_FUNC;
+        return (Vector*)0;
+    }
+    if (!p) {
+        *e = E_EMPTY_ARG;
+        return (Vector*)0;
+    }
+    if (v->size == 0) return vector_new(v->elem_size, 1);
+
+    filter_ctx f = { .data = v->data, .n = v->size, .es = v->elem_size, .filter = filter };
+    size_t kept;
+    char *packed = filter_par(p, &f, &kept, e);
+    if (!packed) return (Vector*)0;
+
+    Vector *new_vec = vector_new(v->elem_size, kept ? kept : 1);
+    if (!new_vec) {
+        free(packed);
+        *e = E_BAD_ALLOC;
+        return (Vector*)0;
+    }
+    memcpy(new_vec->data, packed, kept * v->elem_size);
+    new_vec->size = kept;
+
+    free(packed);
+    return new_vec;
+}
+
+
+Vec_i32 *vec_i32_filter_par(APUTIL_Pool *p, const Vec_i32 *v, bool(*filter)(int32_t), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_i32*)0;
+    }
+    if (!filter) {
+        *e = E_EMPTY_FUNC;
+        return (Vec_i32*)0;
+    }
+    if (!p) {
+        *e = E_EMPTY_ARG;
+        return (Vec_i32*)0;
+    }
+    if (v->size == 0) return vec_i32_new(1);
+
+    filter_ctx f = { .data = (const char*)v->data, .n = v->size, .es = sizeof(int32_t), .filter_i32 = filter };
+    size_t kept;
+    char *packed = filter_par(p, &f, &kept, e);
+    if (!packed) return (Vec_i32*)0;
+
+    Vec_i32 *new_vec = vec_i32_new(kept ? kept : 1);
+    if (!new_vec) {
+        free(packed);
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+    memcpy(new_vec->data, packed, kept * sizeof(int32_t));
+    new_vec->size = kept;
+
+    free(packed);
+    return new_vec;
+}
+
+
+typedef struct {
+    const char *data;
+    size_t n;
+    size_t es;
+    size_t chunk;
+    char *parts;        // one accumulator per chunk, acc_stride apart
+    size_t acc_size;
+    size_t acc_stride;
+    void (*reduce)(void *acc, const void *elem);
+} reduce_ctx;
+
+static void reduce_task(void *ctx, size_t idx, size_t worker) {
+    (void)worker;
+    reduce_ctx *r = ctx;
+    size_t lo = idx * r->chunk, hi = lo + r->chunk < r->n ? lo + r->chunk : r->n;
+    void *acc = r->parts + idx * r->acc_stride;
+    for (size_t i = lo; i < hi; i++) r->reduce(acc, r->data + i * r->es);
+}
+
+
+UTIL_ERR vector_reduce_par(APUTIL_Pool *p, const Vector *v, void *acc, size_t acc_size,
+                           void (*reduce)(void *acc, const void *elem),
+                           void (*combine)(void *acc, const void *part)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!reduce || !combine) return E_EMPTY_FUNC;
+    if (!p || !acc || acc_size == 0) return E_EMPTY_ARG;
+    if (v->size == 0) return E_SUCCESS;
+
+    reduce_ctx r = { .data = v->data, .n = v->size, .es = v->elem_size, .acc_size = acc_size, .reduce = reduce };
+    size_t n_chunks;
+    r.chunk = par_chunk(v->size, v->elem_size, p->n_threads, &n_chunks);
+    r.acc_stride = line_round(acc_size);
+    r.parts = aligned_alloc(APUTIL_CACHE_LINE, n_chunks * r.acc_stride);
+    if (!r.parts) return E_BAD_ALLOC;
+
+    // every partial starts from the identity the caller left in acc
+    for (size_t c = 0; c < n_chunks; c++) memcpy(r.parts + c * r.acc_stride, acc, acc_size);
+
+    pool_run(p, n_chunks, reduce_task, &r);
+
+    // chunk order, combine only has to be associative
+    memcpy(acc, r.parts, acc_size);
+    for (size_t c = 1; c < n_chunks; c++) combine(acc, r.parts + c * r.acc_stride);
+
+    free(r.parts);
+    return E_SUCCESS;
+}
+
+
+typedef struct {
+    char *data;         // first element to zero
+    size_t n;
+    size_t es;
+    size_t chunk;
+} touch_ctx;
+
+static void touch_task(void *ctx, size_t idx, size_t worker) {
+    (void)worker;
+    touch_ctx *t = ctx;
+    size_t lo = idx * t->chunk, hi = lo + t->chunk < t->n ? lo + t->chunk : t->n;
+    memset(t->data + lo * t->es, 0, (hi - lo) * t->es);
+}
+
+
+/*
+    grow *data to n elements without touching the new part (only the held
+    elements are copied), then zero [size, n) in the same chunks the other
+    *_par ops use, a page belongs to the node of the first thread writing it
+*/
+static UTIL_ERR touch_par(APUTIL_Pool *p, void **data, size_t *cap, size_t size, size_t n, size_t es, const Vec_alloc *a) {
+    if (n > *cap) {
+        if (n > SIZE_MAX / es) return E_BAD_ALLOC;
+        void *grown = vec_data_realloc(a, *data, size * es, n * es);
+        if (!grown) return E_BAD_ALLOC;
+        *data = grown;
+        *cap = n;
+    }
+
+    touch_ctx t = { .data = (char*)*data + size * es, .n = n - size, .es = es };
+    size_t n_chunks;
+    t.chunk = par_chunk(t.n, es, p->n_threads, &n_chunks);
+    return pool_run(p, n_chunks, touch_task, &t);
+}
+
+
+UTIL_ERR vector_touch_par(APUTIL_Pool *p, Vector *v, size_t n) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!p) return E_EMPTY_ARG;
+    if (n <= v->size) return E_NOOP;
+
+    UTIL_ERR err = touch_par(p, &v->data, &v->cap, v->size, n, v->elem_size, &v->alloc);
+    if (err) return err;
+    v->size = n;
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vec_i32_touch_par(APUTIL_Pool *p, Vec_i32 *v, size_t n) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!p) return E_EMPTY_ARG;
+    if (n <= v->size) return E_NOOP;
+
+    void *data = v->data;
+    UTIL_ERR err = touch_par(p, &data, &v->cap, v->size, n, sizeof(int32_t), &v->alloc);
+    v->data = data;
+    if (err) return err;
+    v->size = n;
+    return E_SUCCESS;
+}
+
+// ###################### PARALLEL VECTOR OPS ######################
@@ -0,0 +1,291 @@
+/*
+ *  ring buffers
+ *  single-producer/single-consumer, wait-free
+ *      > head and tail are free running counters, slot = counter & mask
+ *      > producer owns tail, consumer owns head
+ *      > each side re-reads the other side's index only when its cached
+ *        copy says the ring is full/empty
+ *
+ *  generic ring (elem_size bytes per element)
+ *  i32 ring
+ */
+
+#include "../include/aputils.h"
+
+
+// round up to the next power of two (0 if it would overflow)
+static size_t ring_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        if (p > SIZE_MAX / 2) return 0;
+        p <<= 1;
+    }
+    return p;
+}
+
+
+// ###################### GENERIC RING ######################
+
+Ring *ring_new(size_t elem_size, size_t cap) {
+    if (elem_size < 1 || cap < 1) {
+        return (Ring*)0;  // caller checks NULL
+    }
+
+    size_t pcap = ring_pow2(cap);
+    if (!pcap || pcap > SIZE_MAX / elem_size) return (Ring*)0;
+
+    Ring *new_ring = aligned_alloc(APUTIL_CACHE_LINE, sizeof(*new_ring));
+    if (!new_ring) {
+        return (Ring*)0;
+    }
+
+    new_ring->data = malloc(elem_size * pcap);
+    if (!new_ring->data) {
+        free(new_ring);
+        return (Ring*)0;
+    }
+
+    atomic_init(&new_ring->head, 0);
+    atomic_init(&new_ring->tail, 0);
+    new_ring->head_cache = 0;
+    new_ring->tail_cache = 0;
+    new_ring->cap = pcap;
+    new_ring->mask = pcap - 1;
+    new_ring->elem_size = elem_size;
+
+    return new_ring;
+}
+
+
+void ring_free(Ring *r) {
+    if (!r) return;
+    free(r->data);
+    free(r);
+}
+
+
+size_t ring_size(const Ring *r) {
+    if (!r) return 0;
+    size_t head = atomic_load_explicit(&((Ring*)r)->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&((Ring*)r)->tail, memory_order_acquire);
+    return tail - head;
+}
+
+
+UTIL_ERR ring_push(Ring *r, const void *elem) {
+    if (!r) return E_EMPTY_OBJ;
+    if (!elem) return E_EMPTY_ARG;
+
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (tail - r->head_cache == r->cap) {
+        r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (tail - r->head_cache == r->cap) return E_FULL;
+    }
+
+    memcpy((char*)r->data + (tail & r->mask) * r->elem_size, elem, r->elem_size);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR ring_pop(Ring *r, void *out) {
+    if (!r) return E_EMPTY_OBJ;
+    if (!out) return E_EMPTY_ARG;
+
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head == r->tail_cache) {
+        r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        if (head == r->tail_cache) return E_NODATA;
+    }
+
+    memcpy(out, (char*)r->data + (head & r->mask) * r->elem_size, r->elem_size);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+
+    return E_SUCCESS;
+}
+
+
+size_t ring_push_n(Ring *r, const void *elems, size_t n) {
+    if (!r || !elems || n == 0) return 0;
+
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t room = r->cap - (tail - r->head_cache);
+    if (room < n) {
+        r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+        room = r->cap - (tail - r->head_cache);
+    }
+    if (n > room) n = room;
+    if (n == 0) return 0;
+
+    // at most two spans: [slot, cap) then [0, rest)
+    size_t slot = tail & r->mask;
+    size_t first = r->cap - slot < n ? r->cap - slot : n;
+    memcpy((char*)r->data + slot * r->elem_size, elems, first * r->elem_size);
+    if (first < n) {
+        memcpy(r->data, (const char*)elems + first * r->elem_size, (n - first) * r->elem_size);
+    }
+
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+    return n;
+}
+
+
+size_t ring_pop_n(Ring *r, void *out, size_t n) {
+    if (!r || !out || n == 0) return 0;
+
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t avail = r->tail_cache - head;
+    if (avail < n) {
+        r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        avail = r->tail_cache - head;
+    }
+    if (n > avail) n = avail;
+    if (n == 0) return 0;
+
+    size_t slot = head & r->mask;
+    size_t first = r->cap - slot < n ? r->cap - slot : n;
+    memcpy(out, (char*)r->data + slot * r->elem_size, first * r->elem_size);
+    if (first < n) {
+        memcpy((char*)out + first * r->elem_size, r->data, (n - first) * r->elem_size);
+    }
+
+    atomic_store_explicit(&r->head, head + n, memory_order_release);
+    return n;
+}
+
+// ###################### GENERIC RING ######################
+
+// ###################### i32 RING ######################
+
+Ring_i32 *ring_i32_new(size_t cap) {
+    if (cap < 1) {
+        return (Ring_i32*)0;  // caller checks NULL
+    }
+
+    size_t pcap = ring_pow2(cap);
+    if (!pcap || pcap > SIZE_MAX / sizeof(int32_t)) return (Ring_i32*)0;
+
+    Ring_i32 *new_ring = aligned_alloc(APUTIL_CACHE_LINE, sizeof(*new_ring));
+    if (!new_ring) {
+        return (Ring_i32*)0;
+    }
+
+    new_ring->data = malloc(sizeof(int32_t) * pcap);
+    if (!new_ring->data) {
+        free(new_ring);
+        return (Ring_i32*)0;
+    }
+
+    atomic_init(&new_ring->head, 0);
+    atomic_init(&new_ring->tail, 0);
+    new_ring->head_cache = 0;
+    new_ring->tail_cache = 0;
+    new_ring->cap = pcap;
+    new_ring->mask = pcap - 1;
+
+    return new_ring;
+}
+
+
+void ring_i32_free(Ring_i32 *r) {
+    if (!r) return;
+    free(r->data);
+    free(r);
+}
+
+
+size_t ring_i32_size(const Ring_i32 *r) {
+    if (!r) return 0;
+    size_t head = atomic_load_explicit(&((Ring_i32*)r)->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&((Ring_i32*)r)->tail, memory_order_acquire);
+    return tail - head;
+}
+
+
+UTIL_ERR ring_i32_push(Ring_i32 *r, int32_t elem) {
+    if (!r) return E_EMPTY_OBJ;
+
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (tail - r->head_cache == r->cap) {
+        r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (tail - r->head_cache == r->cap) return E_FULL;
+    }
+
+    r->data[tail & r->mask] = elem;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+
+    return E_SUCCESS;
+}
+
+
+int32_t ring_i32_pop(Ring_i32 *r, UTIL_ERR *e) {
+    if (!r) {
+        *e = E_EMPTY_OBJ;
+        return 0;
+    }
+
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head == r->tail_cache) {
+        r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        if (head == r->tail_cache) {
+            *e = E_NODATA;
+            return 0;
+        }
+    }
+
+    int32_t elem = r->data[head & r->mask];
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+
+    return elem;
+}
+
+
+size_t ring_i32_push_n(Ring_i32 *r, const int32_t *elems, size_t n) {
+    if (!r || !elems || n == 0) return 0;
+
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t room = r->cap - (tail - r->head_cache);
+    if (room < n) {
+        r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+        room = r->cap - (tail - r->head_cache);
+    }
+    if (n > room) n = room;
+    if (n == 0) return 0;
+
+    size_t slot = tail & r->mask;
+    size_t first = r->cap - slot < n ? r->cap - slot : n;
+    memcpy(r->data + slot, elems, first * sizeof(int32_t));
+    if (first < n) {
+        memcpy(r->data, elems + first, (n - first) * sizeof(int32_t));
+    }
+
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+    return n;
+}
+
+
+size_t ring_i32_pop_n(Ring_i32 *r, int32_t *out, size_t n) {
+    if (!r || !out || n == 0) return 0;
+
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t avail = r->tail_cache - head;
+    if (avail < n) {
+        r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        avail = r->tail_cache - head;
+    }
+    if (n > avail) n = avail;
+    if (n == 0) return 0;
+
+    size_t slot = head & r->mask;
+    size_t first = r->cap - slot < n ? r->cap - slot : n;
+    memcpy(out, r->data + slot, first * sizeof(int32_t));
+    if (first < n) {
+        memcpy(out + first, r->data, (n - first) * sizeof(int32_t));
+    }
+
+    atomic_store_explicit(&r->head, head + n, memory_order_release);
+    return n;
+}
+
+// ###################### i32 RING ######################
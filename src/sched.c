@@ -0,0 +1,365 @@
+/*
+ *  work-stealing scheduler
+ *  fork-join tasks for recursive divide and conquer
+ *      > every worker owns a Chase-Lev deque: it pushes and pops spawned
+ *        tasks at the bottom (LIFO, cache warm), idle workers steal from
+ *        the top (FIFO, the largest pieces of work)
+ *      > sched_sync keeps executing tasks (own first, then stolen) until
+ *        the group's counter drops to zero, so blocked workers stay busy
+ *      > task records come from per-worker blocks and are recycled through
+ *        per-worker free lists, spawning never calls malloc in the steady state
+ *      > the thread calling sched_run is worker 0
+ *
+ *  deque (Le, Pop, Cohen, Zappa Nardelli: C11 Chase-Lev)
+ *  scheduler
+ */
+
+#include <unistd.h>
+#include <sched.h>
+#include "../include/aputils.h"
+
+
+#define SCHED_DEQUE_INIT 64         // slots, power of two
+#define SCHED_TASK_BLOCK 64         // task records per allocation
+
+
+static void sched_fatal(const char* err) {
+    fprintf(stderr, "%s\n", err);
+    exit(1);
+}
+
+
+typedef struct sched_task {
+    void (*fn)(void*);
+    void *arg;
+    APUTIL_Sync *grp;
+    struct sched_task *next_free;
+} sched_task;
+
+typedef struct cl_array {
+    size_t size;                    // power of two
+    struct cl_array *retired;       // older arrays, stealers may still read them
+    _Atomic(sched_task*) buf[];
+} cl_array;
+
+typedef struct sched_worker {
+    _Alignas(APUTIL_CACHE_LINE) _Atomic int64_t top;         // stealers
+    _Alignas(APUTIL_CACHE_LINE) _Atomic int64_t bottom;      // owner
+    _Atomic(cl_array*) array;
+    sched_task *free_tasks;
+    void **blocks;                  // task blocks allocated by this worker
+    size_t n_blocks;
+    uint64_t rng;                   // victim selection
+    size_t id;
+    APUTIL_Sched *sched;
+    pthread_t tid;
+} sched_worker;
+
+
+static _Thread_local sched_worker *tls_worker;
+
+
+// ###################### DEQUE ######################
+
+static cl_array *cl_array_new(size_t size) {
+    cl_array *a = malloc(sizeof(*a) + size * sizeof(_Atomic(sched_task*)));
+    if (!a) sched_fatal("failed to alloc scheduler deque");
+    a->size = size;
+    a->retired = NULL;
+    return a;
+}
+
+
+// owner only: double the array, the old one stays alive for concurrent stealers
+static cl_array *cl_grow(sched_worker *w, cl_array *a, int64_t t, int64_t b) {
+    cl_array *n = cl_array_new(a->size * 2);
+    for (int64_t i = t; i < b; i++) {
+        sched_task *x = atomic_load_explicit(&a->buf[(size_t)i & (a->size - 1)], memory_order_relaxed);
+        atomic_store_explicit(&n->buf[(size_t)i & (n->size - 1)], x, memory_order_relaxed);
+    }
+    n->retired = a;
+    atomic_store_explicit(&w->array, n, memory_order_release);
+    return n;
+}
+
+
+static void cl_push(sched_worker *w, sched_task *x) {
+    int64_t b = atomic_load_explicit(&w->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&w->top, memory_order_acquire);
+    cl_array *a = atomic_load_explicit(&w->array, memory_order_relaxed);
+    if (b - t > (int64_t)a->size - 1) a = cl_grow(w, a, t, b);
+    atomic_store_explicit(&a->buf[(size_t)b & (a->size - 1)], x, memory_order_relaxed);
+    // publishes the slot and the task record to stealers acquiring bottom
+    atomic_store_explicit(&w->bottom, b + 1, memory_order_release);
+}
+
+
+// owner only: newest task or NULL
+static sched_task *cl_take(sched_worker *w) {
+    int64_t b = atomic_load_explicit(&w->bottom, memory_order_relaxed) - 1;
+    cl_array *a = atomic_load_explicit(&w->array, memory_order_relaxed);
+    atomic_store_explicit(&w->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&w->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&w->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    sched_task *x = atomic_load_explicit(&a->buf[(size_t)b & (a->size - 1)], memory_order_relaxed);
+    if (t == b) {
+        // last task, race the stealers for it
+        if (!atomic_compare_exchange_strong_explicit(&w->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            x = NULL;
+        }
+        atomic_store_explicit(&w->bottom, b + 1, memory_order_relaxed);
+    }
+    return x;
+}
+
+
+// any thread: oldest task or NULL (empty or lost a race)
+static sched_task *cl_steal(sched_worker *w) {
+    int64_t t = atomic_load_explicit(&w->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&w->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+
+    cl_array *a = atomic_load_explicit(&w->array, memory_order_acquire);
+    sched_task *x = atomic_load_explicit(&a->buf[(size_t)t & (a->size - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&w->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return x;
+}
+
+// ###################### DEQUE ######################
+
+
+// ###################### SCHEDULER ######################
+
+static sched_task *task_alloc(sched_worker *w) {
+    if (!w->free_tasks) {
+        sched_task *block = malloc(sizeof(sched_task) * SCHED_TASK_BLOCK);
+        void **blocks = realloc(w->blocks, sizeof(void*) * (w->n_blocks + 1));
+        if (!block || !blocks) sched_fatal("failed to alloc scheduler tasks");
+        w->blocks = blocks;
+        w->blocks[w->n_blocks++] = block;
+        for (size_t i = 0; i < SCHED_TASK_BLOCK; i++) {
+            block[i].next_free = w->free_tasks;
+            w->free_tasks = &block[i];
+        }
+    }
+    sched_task *t = w->free_tasks;
+    w->free_tasks = t->next_free;
+    return t;
+}
+
+
+// run a task on worker w, the record goes to w's free list
+static void task_exec(sched_worker *w, sched_task *t) {
+    APUTIL_Sync *grp = t->grp;
+    t->fn(t->arg);
+    t->next_free = w->free_tasks;
+    w->free_tasks = t;
+    atomic_fetch_sub_explicit(&grp->pending, 1, memory_order_release);
+}
+
+
+static sched_task *steal_any(sched_worker *w) {
+    APUTIL_Sched *s = w->sched;
+    if (s->n_workers < 2) return NULL;
+
+    // xorshift, start at a random victim and sweep the rest once
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 7;
+    w->rng ^= w->rng << 17;
+    size_t start = (size_t)(w->rng % s->n_workers);
+    for (size_t i = 0; i < s->n_workers; i++) {
+        size_t v = (start + i) % s->n_workers;
+        if (v == w->id) continue;
+        sched_task *t = cl_steal(&s->workers[v]);
+        if (t) return t;
+    }
+    return NULL;
+}
+
+
+static void *sched_worker_loop(void *arg) {
+    sched_worker *w = arg;
+    APUTIL_Sched *s = w->sched;
+    tls_worker = w;
+
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        while (!s->active && !s->stop) pthread_cond_wait(&s->work_cv, &s->lock);
+        bool stop = s->stop;
+        pthread_mutex_unlock(&s->lock);
+        if (stop) break;
+
+        // steal while a run is in progress
+        while (atomic_load_explicit(&s->running, memory_order_acquire)) {
+            sched_task *t = cl_take(w);
+            if (!t) t = steal_any(w);
+            if (t) task_exec(w, t);
+            else sched_yield();
+        }
+    }
+
+    tls_worker = NULL;
+    return NULL;
+}
+
+
+APUTIL_Sched *sched_new(size_t n_workers) {
+    if (n_workers == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        n_workers = online > 0 ? (size_t)online : 1;
+    }
+
+    APUTIL_Sched *new_sched = calloc(1, sizeof(*new_sched));
+    if (!new_sched) {
+        return (APUTIL_Sched*)0;  // caller checks NULL
+    }
+
+    new_sched->workers = aligned_alloc(APUTIL_CACHE_LINE, sizeof(sched_worker) * n_workers);
+    if (!new_sched->workers) {
+        free(new_sched);
+        return (APUTIL_Sched*)0;
+    }
+    memset(new_sched->workers, 0, sizeof(sched_worker) * n_workers);
+    new_sched->n_workers = n_workers;
+
+    pthread_mutex_init(&new_sched->lock, NULL);
+    pthread_mutex_init(&new_sched->run_lock, NULL);
+    pthread_cond_init(&new_sched->work_cv, NULL);
+    atomic_init(&new_sched->running, false);
+
+    for (size_t i = 0; i < n_workers; i++) {
+        sched_worker *w = &new_sched->workers[i];
+        atomic_init(&w->top, 0);
+        atomic_init(&w->bottom, 0);
+        atomic_init(&w->array, cl_array_new(SCHED_DEQUE_INIT));
+        w->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+        w->id = i;
+        w->sched = new_sched;
+    }
+
+    // worker 0 is whichever thread calls sched_run
+    for (size_t i = 1; i < n_workers; i++) {
+        if (pthread_create(&new_sched->workers[i].tid, NULL, sched_worker_loop, &new_sched->workers[i]) != 0) {
+            new_sched->n_started = i;
+            sched_free(new_sched);
+            return (APUTIL_Sched*)0;
+        }
+    }
+    new_sched->n_started = n_workers;
+
+    return new_sched;
+}
+
+
+void sched_free(APUTIL_Sched *s) {
+    if (!s) return;
+
+    pthread_mutex_lock(&s->lock);
+    s->stop = true;
+    pthread_cond_broadcast(&s->work_cv);
+    pthread_mutex_unlock(&s->lock);
+
+    for (size_t i = 1; i < s->n_started; i++) pthread_join(s->workers[i].tid, NULL);
+
+    for (size_t i = 0; i < s->n_workers; i++) {
+        sched_worker *w = &s->workers[i];
+        cl_array *a = atomic_load(&w->array);
+        while (a) {
+            cl_array *older = a->retired;
+            free(a);
+            a = older;
+        }
+        for (size_t b = 0; b < w->n_blocks; b++) free(w->blocks[b]);
+        free(w->blocks);
+    }
+
+    pthread_mutex_destroy(&s->lock);
+    pthread_mutex_destroy(&s->run_lock);
+    pthread_cond_destroy(&s->work_cv);
+    free(s->workers);
+    free(s);
+}
+
+
+size_t sched_workers(const APUTIL_Sched *s) {
+    return s ? s->n_workers : 0;
+}
+
+
+UTIL_ERR sched_run(APUTIL_Sched *s, void (*fn)(void*), void *arg) {
+    if (!s) return E_EMPTY_OBJ;
+    if (!fn) return E_EMPTY_FUNC;
+
+    // nested run from inside a task, just call it
+    if (tls_worker && tls_worker->sched == s) {
+        fn(arg);
+        return E_SUCCESS;
+    }
+
+    pthread_mutex_lock(&s->run_lock);
+
+    atomic_store_explicit(&s->running, true, memory_order_release);
+    pthread_mutex_lock(&s->lock);
+    s->active = true;
+    pthread_cond_broadcast(&s->work_cv);
+    pthread_mutex_unlock(&s->lock);
+
+    sched_worker *prev = tls_worker;
+    tls_worker = &s->workers[0];
+    fn(arg);
+    tls_worker = prev;
+
+    // fn synced everything it spawned, the deques are empty
+    pthread_mutex_lock(&s->lock);
+    s->active = false;
+    pthread_mutex_unlock(&s->lock);
+    atomic_store_explicit(&s->running, false, memory_order_release);
+
+    pthread_mutex_unlock(&s->run_lock);
+    return E_SUCCESS;
+}
+
+
+void sched_spawn(APUTIL_Sync *grp, void (*fn)(void*), void *arg) {
+    sched_worker *w = tls_worker;
+    if (!w) {
+        // not on a worker, nothing could steal it
+        fn(arg);
+        return;
+    }
+
+    atomic_fetch_add_explicit(&grp->pending, 1, memory_order_relaxed);
+    sched_task *t = task_alloc(w);
+    t->fn = fn;
+    t->arg = arg;
+    t->grp = grp;
+    cl_push(w, t);
+}
+
+
+void sched_sync(APUTIL_Sync *grp) {
+    sched_worker *w = tls_worker;
+    while (atomic_load_explicit(&grp->pending, memory_order_acquire) > 0) {
+        // only reachable on a worker, spawn runs inline elsewhere
+        sched_task *t = cl_take(w);
+        if (!t) t = steal_any(w);
+        if (t) task_exec(w, t);
+        else sched_yield();
+    }
+}
+
+
+size_t sched_worker_id(void) {
+    return tls_worker ? tls_worker->id : 0;
+}
+
+// ###################### SCHEDULER ######################
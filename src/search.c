@@ -0,0 +1,288 @@
+/*
+ *  searching sorted vectors
+ *  binary search
+ *      > branchless: base moves by (probe < key) * half, the loop count only
+ *        depends on n so there is nothing for the branch predictor to miss,
+ *        the probes of both possible next steps are prefetched
+ *
+ *  eytzinger index
+ *      > BFS order from 1 (Khuong & Morin), the descent is k = 2k + (tree[k] < key)
+ *        and the answer is k with its trailing ones (right turns after the
+ *        last left turn) shifted off
+ *      > the sorted index of node k comes from its position in the perfect
+ *        tree of the same height, less the missing last level leaves that
+ *        would come before it in order
+ */
+
+#include "../include/aputils.h"
+
+
+// ###################### BINARY SEARCH ######################
+
+// first index with a[i] >= key (upper: a[i] > key)
+static inline size_t bound_i32(const int32_t *a, size_t n, int32_t key, bool upper) {
+    if (!n) return 0;
+
+    const int32_t *base = a;
+    while (n > 1) {
+        size_t half = n / 2;
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+        base += (size_t)(upper ? base[half] <= key : base[half] < key) * half;
+        n -= half;
+    }
+    return (size_t)(base - a) + (upper ? *base <= key : *base < key);
+}
+
+
+static inline size_t bound_any(const char *a, size_t n, size_t es, const void *key, int (*compare)(const void*, const void*), bool upper) {
+    if (!n) return 0;
+
+    const char *base = a;
+    while (n > 1) {
+        size_t half = n / 2;
+        __builtin_prefetch(base + half / 2 * es);
+        __builtin_prefetch(base + (half + half / 2) * es);
+        int c = compare(base + half * es, key);
+        base += (size_t)(upper ? c <= 0 : c < 0) * half * es;
+        n -= half;
+    }
+    int c = compare(base, key);
+    return (size_t)(base - a) / es + (upper ? c <= 0 : c < 0);
+}
+
+
+size_t vec_i32_lower_bound(const Vec_i32 *v, int32_t key) {
+    if (!v) return 0;
+    return bound_i32(v->data, v->size, key, false);
+}
+
+
+size_t vec_i32_upper_bound(const Vec_i32 *v, int32_t key) {
+    if (!v) return 0;
+    return bound_i32(v->data, v->size, key, true);
+}
+
+
+intmax_t vec_i32_bsearch(const Vec_i32 *v, int32_t key, UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return -1;
+    }
+
+    size_t i = bound_i32(v->data, v->size, key, false);
+    return i < v->size && v->data[i] == key ? (intmax_t)i : -1;
+}
+
+
+size_t vector_lower_bound(const Vector *v, const void *key, int (*compare)(const void*, const void*)) {
+    if (!v || !key || !compare) return 0;
+    return bound_any(v->data, v->size, v->elem_size, key, compare, false);
+}
+
+
+size_t vector_upper_bound(const Vector *v, const void *key, int (*compare)(const void*, const void*)) {
+    if (!v || !key || !compare) return 0;
+    return bound_any(v->data, v->size, v->elem_size, key, compare, true);
+}
+
+
+intmax_t vector_bsearch(const Vector *v, const void *key, int (*compare)(const void*, const void*), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return -1;
+    }
+    if (!key) {
+        *e = E_EMPTY_ARG;
+        return -1;
+    }
+    if (!compare) {
+        *e = E_EMPTY_FUNC;
+        return -1;
+    }
+
+    size_t i = bound_any(v->data, v->size, v->elem_size, key, compare, false);
+    return i < v->size && compare(vector_at(v, i), key) == 0 ? (intmax_t)i : -1;
+}
+
+// ###################### BINARY SEARCH ######################
+
+
+
+// ###################### EYTZINGER INDEX ######################
+
+static const Vec_alloc eytz_alloc = { .align = APUTIL_CACHE_LINE };
+
+
+static inline unsigned height_for(size_t n) {
+    return n ? 64 - (unsigned)__builtin_clzll(n) : 0;
+}
+
+
+// sorted index of BFS node k (1..n)
+static inline size_t node_rank(size_t k, size_t n, unsigned height) {
+    unsigned depth = 63 - (unsigned)__builtin_clzll(k);
+    size_t r = ((2 * (k - ((size_t)1 << depth)) + 1) << (height - 1 - depth)) - 1;
+
+    // the perfect tree's missing leaves hold every other rank from first_missing up
+    size_t first_missing = 2 * (n + 1 - ((size_t)1 << (height - 1)));
+    if (r > first_missing) r -= (r - first_missing + 1) / 2;
+    return r;
+}
+
+
+// node k at the end of a descent to the sorted index, 0 (ran off the right edge) is n
+static inline size_t descent_result(size_t k, size_t n, unsigned height) {
+    k >>= __builtin_ffsll((long long)~k);
+    return k ? node_rank(k, n, height) : n;
+}
+
+
+// in-order walk writes the sorted elements into BFS slots, reads are sequential
+static size_t fill_i32(int32_t *tree, const int32_t *src, size_t i, size_t k, size_t n) {
+    if (k > n) return i;
+    i = fill_i32(tree, src, i, 2 * k, n);
+    tree[k] = src[i++];
+    return fill_i32(tree, src, i, 2 * k + 1, n);
+}
+
+static size_t fill_any(char *tree, const char *src, size_t es, size_t i, size_t k, size_t n) {
+    if (k > n) return i;
+    i = fill_any(tree, src, es, i, 2 * k, n);
+    memcpy(tree + k * es, src + i * es, es);
+    return fill_any(tree, src, es, i + 1, 2 * k + 1, n);
+}
+
+
+Eytz_i32 *eytz_i32_new(const Vec_i32 *sorted) {
+    if (!sorted) return (Eytz_i32*)0;  // caller checks NULL
+
+    Eytz_i32 *t = malloc(sizeof(*t));
+    if (!t) return (Eytz_i32*)0;
+
+    t->tree = vec_data_alloc(&eytz_alloc, sizeof(int32_t) * (sorted->size + 1));
+    if (!t->tree) {
+        free(t);
+        return (Eytz_i32*)0;
+    }
+
+    t->n = sorted->size;
+    t->height = height_for(t->n);
+    t->tree[0] = 0;
+    fill_i32(t->tree, sorted->data, 0, 1, t->n);
+    return t;
+}
+
+
+void eytz_i32_free(Eytz_i32 *t) {
+    if (!t) return;
+    free(t->tree);
+    free(t);
+}
+
+
+static inline size_t eytz_i32_bound(const Eytz_i32 *t, int32_t key, bool upper) {
+    const int32_t *tree = t->tree;
+    size_t k = 1, n = t->n;
+    while (k <= n) {
+        // 16k .. 16k + 15 are the descendants four levels down, one cache line
+        __builtin_prefetch((const char*)tree + 16 * k * sizeof(int32_t));
+        k = 2 * k + (upper ? tree[k] <= key : tree[k] < key);
+    }
+    return descent_result(k, n, t->height);
+}
+
+
+size_t eytz_i32_lower_bound(const Eytz_i32 *t, int32_t key) {
+    if (!t) return 0;
+    return eytz_i32_bound(t, key, false);
+}
+
+
+size_t eytz_i32_upper_bound(const Eytz_i32 *t, int32_t key) {
+    if (!t) return 0;
+    return eytz_i32_bound(t, key, true);
+}
+
+
+intmax_t eytz_i32_bsearch(const Eytz_i32 *t, int32_t key) {
+    if (!t) return -1;
+
+    const int32_t *tree = t->tree;
+    size_t k = 1, n = t->n;
+    while (k <= n) {
+        __builtin_prefetch((const char*)tree + 16 * k * sizeof(int32_t));
+        k = 2 * k + (tree[k] < key);
+    }
+    k >>= __builtin_ffsll((long long)~k);
+    return k && tree[k] == key ? (intmax_t)node_rank(k, n, t->height) : -1;
+}
+
+
+Eytz *eytz_new(const Vector *sorted, int (*compare)(const void*, const void*)) {
+    if (!sorted || !compare) return (Eytz*)0;  // caller checks NULL
+
+    Eytz *t = malloc(sizeof(*t));
+    if (!t) return (Eytz*)0;
+
+    t->tree = vec_data_alloc(&eytz_alloc, sorted->elem_size * (sorted->size + 1));
+    if (!t->tree) {
+        free(t);
+        return (Eytz*)0;
+    }
+
+    t->n = sorted->size;
+    t->height = height_for(t->n);
+    t->elem_size = sorted->elem_size;
+    t->compare = compare;
+
+    // levels down until the descendants outgrow a line, at least the children
+    t->prefetch = 1;
+    while (((size_t)2 << t->prefetch) * t->elem_size <= APUTIL_CACHE_LINE) t->prefetch++;
+
+    memset(t->tree, 0, t->elem_size);
+    fill_any(t->tree, sorted->data, t->elem_size, 0, 1, t->n);
+    return t;
+}
+
+
+void eytz_free(Eytz *t) {
+    if (!t) return;
+    free(t->tree);
+    free(t);
+}
+
+
+// the final node, with its trailing ones still on
+static inline size_t eytz_descend(const Eytz *t, const void *key, bool upper) {
+    size_t k = 1, n = t->n, es = t->elem_size;
+    while (k <= n) {
+        __builtin_prefetch(t->tree + (k << t->prefetch) * es);
+        int c = t->compare(t->tree + k * es, key);
+        k = 2 * k + (upper ? c <= 0 : c < 0);
+    }
+    return k;
+}
+
+
+size_t eytz_lower_bound(const Eytz *t, const void *key) {
+    if (!t || !key) return 0;
+    return descent_result(eytz_descend(t, key, false), t->n, t->height);
+}
+
+
+size_t eytz_upper_bound(const Eytz *t, const void *key) {
+    if (!t || !key) return 0;
+    return descent_result(eytz_descend(t, key, true), t->n, t->height);
+}
+
+
+intmax_t eytz_bsearch(const Eytz *t, const void *key) {
+    if (!t || !key) return -1;
+
+    size_t k = eytz_descend(t, key, false);
+    k >>= __builtin_ffsll((long long)~k);
+    return k && t->compare(t->tree + k * t->elem_size, key) == 0 ? (intmax_t)node_rank(k, t->n, t->height) : -1;
+}
+
+// ###################### EYTZINGER INDEX ######################
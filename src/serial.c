@@ -0,0 +1,685 @@
+/*
+ *  binary serialization
+ *  save / reload vectors and lists as a 64 byte header plus raw payload
+ *      > the header holds type, elem_size, count, payload size and a checksum
+ *        of the payload, numbers are in host byte order (not portable across
+ *        endianness)
+ *      > vectors are written with a single writev (header + data) and read
+ *        straight into the new vector's storage
+ *      > saves go to a temp file next to the target, fsync'd and renamed
+ *        over it, so the old file survives a failed or interrupted save.
+ *        the new file keeps the target's mode (a new target gets the umask)
+ *      > vector_mmap / vec_i32_mmap map the file copy-on-write and point the
+ *        vector at the payload, nothing is copied
+ *      > list data goes through user hooks, records are [u64 len][bytes]
+ *        padded to 8 bytes, a loaded list gets all its nodes in one slab
+ *      > filters lead with a parameter record (seed, count, ...) ahead of
+ *        the table, elem_size / count describe the table alone and the
+ *        checksum covers both parts
+ *
+ *  checksum
+ *  files
+ *  vectors
+ *  lists
+ *  filters
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "../include/aputils_internal.h"
+
+
+#define SERIAL_MAGIC 0x3153494c49545041ull     // "APUTILS1"
+#define SERIAL_VERSION 1
+#define SERIAL_REC_ALIGN 8
+
+_Static_assert(sizeof(Serial_header) == 64, "payload must start on a cache line");
+
+
+// ###################### CHECKSUM ######################
+
+#define CK_P1 0x9e3779b185ebca87ull
+#define CK_P2 0xc2b2ae3d27d4eb4full
+#define CK_P3 0x165667b19e3779f9ull
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// xxhash64 style round, four of these run as independent lanes
+static inline uint64_t ck_round(uint64_t acc, uint64_t w) {
+    acc += w * CK_P2;
+    acc = rotl64(acc, 31);
+    return acc * CK_P1;
+}
+
+static inline uint64_t ck_load(const unsigned char *p) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+
+uint64_t serial_checksum(const void *data, size_t n) {
+    const unsigned char *p = data;
+    uint64_t h;
+
+    if (n >= 32) {
+        uint64_t l0 = CK_P1 + CK_P2, l1 = CK_P2, l2 = 0, l3 = -CK_P1;
+        size_t blocks = n / 32;
+        for (size_t i = 0; i < blocks; i++, p += 32) {
+            l0 = ck_round(l0, ck_load(p));
+            l1 = ck_round(l1, ck_load(p + 8));
+            l2 = ck_round(l2, ck_load(p + 16));
+            l3 = ck_round(l3, ck_load(p + 24));
+        }
+        h = rotl64(l0, 1) + rotl64(l1, 7) + rotl64(l2, 12) + rotl64(l3, 18);
+        h = (h ^ ck_round(0, l0)) * CK_P1 + CK_P3;
+        h = (h ^ ck_round(0, l1)) * CK_P1 + CK_P3;
+        h = (h ^ ck_round(0, l2)) * CK_P1 + CK_P3;
+        h = (h ^ ck_round(0, l3)) * CK_P1 + CK_P3;
+    } else {
+        h = CK_P3;
+    }
+    h += (uint64_t)n;
+
+    size_t rest = n % 32;
+    for (; rest >= 8; rest -= 8, p += 8) h = rotl64(h ^ ck_round(0, ck_load(p)), 27) * CK_P1 + CK_P3;
+    for (; rest; rest--, p++) h = rotl64(h ^ (*p * CK_P3), 11) * CK_P1;
+
+    h ^= h >> 33;
+    h *= CK_P2;
+    h ^= h >> 29;
+    h *= CK_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ###################### CHECKSUM ######################
+
+
+// ###################### FILES ######################
+
+// write every iovec, resuming after partial writes
+static bool write_all_iov(int fd, struct iovec *iov, int cnt) {
+    while (cnt > 0) {
+        ssize_t w = writev(fd, iov, cnt);
+        if (w < 0) return false;
+        size_t done = (size_t)w;
+        while (cnt > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+
+static bool read_all(int fd, void *buf, size_t n) {
+    char *p = buf;
+    while (n) {
+        ssize_t r = read(fd, p, n);
+        if (r <= 0) return false;
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+
+// header, then params_bytes of params (filters, else 0) and the rest of data_bytes from payload
+// written to a temp file next to path and renamed over it once on disk
+static UTIL_ERR save_payload(const char *path, Serial_header *h, const void *params, size_t params_bytes, const void *payload) {
+    char *tmp;
+    int fd = aputil_replace_open(path, &tmp);
+    if (fd < 0) return E_IO;
+
+    struct iovec iov[3] = {
+        { .iov_base = h, .iov_len = sizeof(*h) },
+        { .iov_base = (void*)params, .iov_len = params_bytes },
+        { .iov_base = (void*)payload, .iov_len = h->data_bytes - params_bytes },
+    };
+    bool ok = write_all_iov(fd, iov, 3) && fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+    return aputil_replace_finish(tmp, path, ok) ? E_SUCCESS : E_IO;
+}
+
+
+static void header_init(Serial_header *h, enum serial_type type, size_t elem_size, size_t count, const void *payload, size_t bytes) {
+    *h = (Serial_header){
+        .magic = SERIAL_MAGIC,
+        .version = SERIAL_VERSION,
+        .type = type,
+        .elem_size = elem_size,
+        .count = count,
+        .data_bytes = bytes,
+        .checksum = serial_checksum(payload, bytes),
+    };
+}
+
+
+// bytes of parameters ahead of the elements
+static size_t params_bytes(enum serial_type type);
+
+
+// header sanity against the file size and the expected type
+static UTIL_ERR header_check(const Serial_header *h, enum serial_type type, size_t file_size) {
+    if (h->magic != SERIAL_MAGIC || h->version != SERIAL_VERSION) return E_CORRUPT;
+    if (h->type != (uint32_t)type) return E_BAD_TYPE;
+    if (h->data_bytes > file_size - sizeof(*h)) return E_CORRUPT;
+    if (type != ser_llist) {
+        size_t params = params_bytes(type);
+        if (h->elem_size == 0 || h->count > SIZE_MAX / h->elem_size) return E_CORRUPT;
+        if (h->data_bytes < params || h->count * h->elem_size != h->data_bytes - params) return E_CORRUPT;
+    }
+    return E_SUCCESS;
+}
+
+
+// open path and read its header, returns the fd or -1 with *e set
+static int open_checked(const char *path, enum serial_type type, Serial_header *h, size_t *file_size, UTIL_ERR *e) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        *e = E_IO;
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        *e = E_IO;
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(*h) || !read_all(fd, h, sizeof(*h))) {
+        close(fd);
+        *e = E_CORRUPT;     // shorter than a header
+        return -1;
+    }
+
+    UTIL_ERR err = header_check(h, type, (size_t)st.st_size);
+    if (err) {
+        close(fd);
+        *e = err;
+        return -1;
+    }
+
+    *file_size = (size_t)st.st_size;
+    return fd;
+}
+
+
+// map the whole file copy-on-write, payload at map + sizeof(Serial_header)
+static void *map_checked(const char *path, enum serial_type type, bool verify, size_t *map_len, UTIL_ERR *e) {
+    Serial_header h;
+    size_t file_size;
+    int fd = open_checked(path, type, &h, &file_size, e);
+    if (fd < 0) return NULL;
+
+    void *map = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        *e = E_IO;
+        return NULL;
+    }
+
+    const char *payload = (const char*)map + sizeof(Serial_header);
+    if (verify && serial_checksum(payload, h.data_bytes) != h.checksum) {
+        munmap(map, file_size);
+        *e = E_CORRUPT;
+        return NULL;
+    }
+
+    *map_len = file_size;
+    return map;
+}
+
+// ###################### FILES ######################
+
+
+// ###################### VECTORS ######################
+
+UTIL_ERR vector_save(const Vector *v, const char *path) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!path) return E_EMPTY_ARG;
+
+    Serial_header h;
+    header_init(&h, ser_vector, v->elem_size, v->size, v->data, v->size * v->elem_size);
+    return save_payload(path, &h, NULL, 0, v->data);
+}
+
+
+UTIL_ERR vec_i32_save(const Vec_i32 *v, const char *path) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!path) return E_EMPTY_ARG;
+
+    Serial_header h;
+    header_init(&h, ser_vec_i32, sizeof(int32_t), v->size, v->data, v->size * sizeof(int32_t));
+    return save_payload(path, &h, NULL, 0, v->data);
+}
+
+
+// read the payload of a checked file into data, then verify it
+static UTIL_ERR load_payload(int fd, const Serial_header *h, void *data) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (!read_all(fd, data, h->data_bytes)) return E_IO;
+    if (serial_checksum(data, h->data_bytes) != h->checksum) return E_CORRUPT;
+    return E_SUCCESS;
+}
+
+
+Vector *vector_load(const char *path, UTIL_ERR *e) {
+    if (!path) {
+        *e = E_EMPTY_ARG;
+        return (Vector*)0;
+    }
+
+    Serial_header h;
+    size_t file_size;
+    int fd = open_checked(path, ser_vector, &h, &file_size, e);
+    if (fd < 0) return (Vector*)0;
+
+    Vector *new_vec = vector_new(h.elem_size, h.count ? h.count : 1);
+    if (!new_vec) {
+        close(fd);
+        *e = E_BAD_ALLOC;
+        return (Vector*)0;
+    }
+
+    UTIL_ERR err = load_payload(fd, &h, new_vec->data);
+    close(fd);
+    if (err) {
+        vector_free(new_vec);
+        *e = err;
+        return (Vector*)0;
+    }
+
+    new_vec->size = h.count;
+    return new_vec;
+}
+
+
+Vec_i32 *vec_i32_load(const char *path, UTIL_ERR *e) {
+    if (!path) {
+        *e = E_EMPTY_ARG;
+        return (Vec_i32*)0;
+    }
+
+    Serial_header h;
+    size_t file_size;
+    int fd = open_checked(path, ser_vec_i32, &h, &file_size, e);
+    if (fd < 0) return (Vec_i32*)0;
+
+    Vec_i32 *new_vec = vec_i32_new(h.count ? h.count : 1);
+    if (!new_vec) {
+        close(fd);
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+
+    UTIL_ERR err = load_payload(fd, &h, new_vec->data);
+    close(fd);
+    if (err) {
+        vec_i32_free(new_vec);
+        *e = err;
+        return (Vec_i32*)0;
+    }
+
+    new_vec->size = h.count;
+    return new_vec;
+}
+
+
+Vector_mapped *vector_mmap(const char *path, bool verify, UTIL_ERR *e) {
+    if (!path) {
+        *e = E_EMPTY_ARG;
+        return (Vector_mapped*)0;
+    }
+
+    Vector_mapped *m = malloc(sizeof(*m));
+    if (!m) {
+        *e = E_BAD_ALLOC;
+        return (Vector_mapped*)0;
+    }
+
+    m->map = map_checked(path, ser_vector, verify, &m->map_len, e);
+    if (!m->map) {
+        free(m);
+        return (Vector_mapped*)0;
+    }
+
+    const Serial_header *h = m->map;
+    m->vec = (Vector){
+        .data = (char*)m->map + sizeof(*h),
+        .size = h->count,
+        .cap = h->count,
+        .elem_size = h->elem_size,
+    };
+    return m;
+}
+
+
+void vector_munmap(Vector_mapped *m) {
+    if (!m) return;
+    munmap(m->map, m->map_len);
+    free(m);
+}
+
+
+Vec_i32_mapped *vec_i32_mmap(const char *path, bool verify, UTIL_ERR *e) {
+    if (!path) {
+        *e = E_EMPTY_ARG;
+        return (Vec_i32_mapped*)0;
+    }
+
+    Vec_i32_mapped *m = malloc(sizeof(*m));
+    if (!m) {
+        *e = E_BAD_ALLOC;
+        return (Vec_i32_mapped*)0;
+    }
+
+    m->map = map_checked(path, ser_vec_i32, verify, &m->map_len, e);
+    if (!m->map) {
+        free(m);
+        return (Vec_i32_mapped*)0;
+    }
+
+    const Serial_header *h = m->map;
+    m->vec = (Vec_i32){
+        .data = (int32_t*)((char*)m->map + sizeof(*h)),
+        .size = h->count,
+        .cap = h->count,
+    };
+    return m;
+}
+
+
+void vec_i32_munmap(Vec_i32_mapped *m) {
+    if (!m) return;
+    munmap(m->map, m->map_len);
+    free(m);
+}
+
+// ###################### VECTORS ######################
+
+
+// ###################### LISTS ######################
+
+UTIL_ERR aputil_llist_save(const APUTIL_LList *lst, const char *path, UTIL_ERR (*serialize)(const void *data, Vec_char *out)) {
+    if (!lst) return E_EMPTY_OBJ;
+    if (!serialize) return E_EMPTY_FUNC;
+    if (!path) return E_EMPTY_ARG;
+
+    Vec_char *buf = vec_char_new(4096);
+    if (!buf) return E_BAD_ALLOC;
+
+    // records go into one buffer: length slot, hook output, padding
+    UTIL_ERR err = E_SUCCESS;
+    const char zeros[SERIAL_REC_ALIGN] = {0};
+    for (APUTIL_Node *cur = lst->head; cur && !err; cur = cur->next) {
+        size_t at = buf->size;
+        uint64_t len = 0;
+        err = vec_char_append_n(buf, (const char*)&len, sizeof(len));
+        if (!err) err = serialize(cur->data, buf);
+        if (err) break;
+
+        len = buf->size - at - sizeof(len);
+        memcpy(buf->data + at, &len, sizeof(len));
+        size_t pad = (SERIAL_REC_ALIGN - buf->size % SERIAL_REC_ALIGN) % SERIAL_REC_ALIGN;
+        err = vec_char_append_n(buf, zeros, pad);
+    }
+
+    if (!err) {
+        Serial_header h;
+        header_init(&h, ser_llist, 0, lst->cnt, buf->data, buf->size);
+        err = save_payload(path, &h, NULL, 0, buf->data);
+    }
+
+    vec_char_free(buf);
+    return err;
+}
+
+
+UTIL_ERR aputil_llist_load(APUTIL_LList *lst, const char *path, void *(*deserialize)(const void *bytes, size_t len)) {
+    if (!lst) return E_EMPTY_OBJ;
+    if (!deserialize) return E_EMPTY_FUNC;
+    if (!path) return E_EMPTY_ARG;
+
+    UTIL_ERR err = E_SUCCESS;
+    size_t map_len;
+    void *map = map_checked(path, ser_llist, true, &map_len, &err);
+    if (!map) return err;
+
+    const Serial_header *h = map;
+    const char *p = (const char*)map + sizeof(*h), *end = p + h->data_bytes;
+    if (h->count > h->data_bytes / sizeof(uint64_t)) {
+        munmap(map, map_len);
+        return E_CORRUPT;
+    }
+
+    void **elems = malloc(sizeof(void*) * (h->count ? h->count : 1));
+    if (!elems) {
+        munmap(map, map_len);
+        return E_BAD_ALLOC;
+    }
+
+    size_t n = 0;
+    for (; n < h->count; n++) {
+        uint64_t len;
+        if ((size_t)(end - p) < sizeof(len)) {
+            err = E_CORRUPT;
+            break;
+        }
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        if (len > (size_t)(end - p)) {
+            err = E_CORRUPT;
+            break;
+        }
+
+        elems[n] = deserialize(p, len);
+        if (!elems[n]) {
+            err = E_BAD_ALLOC;
+            break;
+        }
+        size_t step = (sizeof(len) + len + SERIAL_REC_ALIGN - 1) / SERIAL_REC_ALIGN * SERIAL_REC_ALIGN - sizeof(len);
+        p += step < (size_t)(end - p) ? step : (size_t)(end - p);
+    }
+
+    // one node slab for the whole list
+    if (!err) err = aputil_llist_push_back_n(lst, elems, n);
+    if (err && lst->free) {
+        for (size_t i = 0; i < n; i++) lst->free(elems[i]);
+    }
+
+    free(elems);
+    munmap(map, map_len);
+    return err;
+}
+
+// ###################### LISTS ######################
+
+
+
+// ###################### FILTERS ######################
+
+typedef struct {
+    uint64_t seed;
+    uint64_t count;
+} Bloom_params;
+
+typedef struct {
+    uint64_t seed;
+    uint64_t count;
+    uint64_t rng;
+    uint64_t victim_idx;
+    uint32_t fp_bits;
+    uint32_t has_victim;
+    uint32_t victim_fp;
+    uint32_t pad;
+} Cuckoo_params;
+
+
+static size_t params_bytes(enum serial_type type) {
+    switch (type) {
+        case ser_bloom: return sizeof(Bloom_params);
+        case ser_cuckoo: return sizeof(Cuckoo_params);
+        default: return 0;
+    }
+}
+
+
+// params and table are checksummed apart, so neither has to be copied next to the other
+static uint64_t parts_checksum(const void *params, size_t n_params, const void *table, size_t n_table) {
+    return serial_checksum(params, n_params) ^ rotl64(serial_checksum(table, n_table), 1);
+}
+
+
+static UTIL_ERR save_filter(const char *path, enum serial_type type, const void *params, const void *table, size_t elem_size, size_t count) {
+    size_t n_params = params_bytes(type);
+    Serial_header h = {
+        .magic = SERIAL_MAGIC,
+        .version = SERIAL_VERSION,
+        .type = type,
+        .elem_size = elem_size,
+        .count = count,
+        .data_bytes = n_params + elem_size * count,
+        .checksum = parts_checksum(params, n_params, table, elem_size * count),
+    };
+    return save_payload(path, &h, params, n_params, table);
+}
+
+
+// open a filter file, read its params and a table of elem_size elements (allocated with align)
+static void *load_filter(const char *path, enum serial_type type, size_t elem_size, size_t align, void *params, Serial_header *h, UTIL_ERR *e) {
+    if (!path) {
+        *e = E_EMPTY_ARG;
+        return NULL;
+    }
+
+    size_t file_size;
+    int fd = open_checked(path, type, h, &file_size, e);
+    if (fd < 0) return NULL;
+
+    size_t n_params = params_bytes(type), n_table = h->data_bytes - n_params;
+    if (h->elem_size != elem_size || !h->count) {
+        close(fd);
+        *e = E_CORRUPT;
+        return NULL;
+    }
+
+    void *table = NULL;
+    if (posix_memalign(&table, align, n_table)) {
+        close(fd);
+        *e = E_BAD_ALLOC;
+        return NULL;
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    UTIL_ERR err = E_SUCCESS;
+    if (!read_all(fd, params, n_params) || !read_all(fd, table, n_table)) err = E_IO;
+    else if (parts_checksum(params, n_params, table, n_table) != h->checksum) err = E_CORRUPT;
+    close(fd);
+    if (err) {
+        free(table);
+        *e = err;
+        return NULL;
+    }
+    return table;
+}
+
+
+UTIL_ERR bloom_save(const BloomFilter *f, const char *path) {
+    if (!f) return E_EMPTY_OBJ;
+    if (!path) return E_EMPTY_ARG;
+
+    Bloom_params p = { .seed = f->seed, .count = f->count };
+    return save_filter(path, ser_bloom, &p, f->blocks, sizeof(uint32_t), f->n_blocks * BLOOM_LANES);
+}
+
+
+BloomFilter *bloom_load(const char *path, UTIL_ERR *e) {
+    Bloom_params p;
+    Serial_header h;
+    uint32_t *blocks = load_filter(path, ser_bloom, sizeof(uint32_t), APUTIL_CACHE_LINE, &p, &h, e);
+    if (!blocks) return (BloomFilter*)0;
+    if (h.count % BLOOM_LANES) {
+        free(blocks);
+        *e = E_CORRUPT;
+        return (BloomFilter*)0;
+    }
+
+    BloomFilter *new_filter = malloc(sizeof(*new_filter));
+    if (!new_filter) {
+        free(blocks);
+        *e = E_BAD_ALLOC;
+        return (BloomFilter*)0;
+    }
+
+    new_filter->blocks = blocks;
+    new_filter->n_blocks = h.count / BLOOM_LANES;
+    new_filter->count = p.count;
+    new_filter->seed = p.seed;
+    return new_filter;
+}
+
+
+UTIL_ERR cuckoo_save(const CuckooFilter *f, const char *path) {
+    if (!f) return E_EMPTY_OBJ;
+    if (!path) return E_EMPTY_ARG;
+
+    Cuckoo_params p = {
+        .seed = f->seed,
+        .count = f->count,
+        .rng = f->rng,
+        .victim_idx = f->victim_idx,
+        .fp_bits = f->fp_bits,
+        .has_victim = f->has_victim,
+        .victim_fp = f->victim_fp,
+    };
+    return save_filter(path, ser_cuckoo, &p, f->slots, sizeof(uint16_t), f->n_buckets * CUCKOO_SLOTS);
+}
+
+
+CuckooFilter *cuckoo_load(const char *path, UTIL_ERR *e) {
+    Cuckoo_params p;
+    Serial_header h;
+    uint16_t *slots = load_filter(path, ser_cuckoo, sizeof(uint16_t), sizeof(void*), &p, &h, e);
+    if (!slots) return (CuckooFilter*)0;
+
+    // buckets must stay a power of two, the parameters in range
+    size_t n_buckets = h.count / CUCKOO_SLOTS;
+    if (h.count % CUCKOO_SLOTS || (n_buckets & (n_buckets - 1)) || p.fp_bits < 4 || p.fp_bits > 16 ||
+        p.has_victim > 1 || (p.has_victim && p.victim_idx >= n_buckets) || !p.rng) {
+        free(slots);
+        *e = E_CORRUPT;
+        return (CuckooFilter*)0;
+    }
+
+    CuckooFilter *new_filter = malloc(sizeof(*new_filter));
+    if (!new_filter) {
+        free(slots);
+        *e = E_BAD_ALLOC;
+        return (CuckooFilter*)0;
+    }
+
+    new_filter->slots = slots;
+    new_filter->n_buckets = n_buckets;
+    new_filter->count = p.count;
+    new_filter->fp_bits = p.fp_bits;
+    new_filter->seed = p.seed;
+    new_filter->rng = p.rng;
+    new_filter->has_victim = p.has_victim;
+    new_filter->victim_fp = (uint16_t)p.victim_fp;
+    new_filter->victim_idx = p.victim_idx;
+    return new_filter;
+}
+
+// ###################### FILTERS ######################
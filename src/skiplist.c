@@ -0,0 +1,432 @@
+/*
+ *  skip lists
+ *  arena
+ *      > blocks of SKIP_BLOCK_BYTES, nodes are bumped off the newest one,
+ *        a full block is replaced with a compare and swap so concurrent
+ *        writers never take a lock, all blocks go when the list is freed
+ *
+ *  skip list
+ *      > search keeps the last node before key on every level, an insert
+ *        or remove relinks exactly those
+ *      > removed towers wait on spare[height - 1] for the next insert that
+ *        draws the same height
+ *
+ *  concurrent skip list
+ *      > Fraser's lock free list: links carry a removed mark in their low
+ *        bit, cfind unlinks marked nodes it passes (and starts over when a
+ *        neighbour changed under it), readers just step over them
+ *      > an insert links level 0 first (the node is in the list from then
+ *        on), then the levels above, giving up on them if it gets removed
+ */
+
+#include <stddef.h>
+#include "../include/aputils.h"
+
+
+#define LINK_MARK ((uintptr_t)1)
+
+struct skip_block {
+    struct skip_block *next;
+    _Atomic size_t used;
+    size_t cap;
+    _Alignas(16) unsigned char mem[];
+};
+
+
+// ###################### ARENA ######################
+
+static void *arena_alloc(_Atomic(struct skip_block*) *blocks, size_t bytes) {
+    bytes = (bytes + 15) & ~(size_t)15;
+    for (;;) {
+        struct skip_block *b = atomic_load_explicit(blocks, memory_order_acquire);
+        if (b) {
+            size_t at = atomic_fetch_add_explicit(&b->used, bytes, memory_order_relaxed);
+            if (at + bytes <= b->cap) return b->mem + at;
+        }
+
+        // full (or none yet): the first writer to swap its block in wins, the others retry on it
+        struct skip_block *fresh = malloc(SKIP_BLOCK_BYTES);
+        if (!fresh) return NULL;
+        fresh->next = b;
+        atomic_init(&fresh->used, 0);
+        fresh->cap = SKIP_BLOCK_BYTES - offsetof(struct skip_block, mem);
+        if (!atomic_compare_exchange_strong_explicit(blocks, &b, fresh, memory_order_acq_rel, memory_order_acquire)) free(fresh);
+    }
+}
+
+
+static void arena_free(_Atomic(struct skip_block*) *blocks) {
+    struct skip_block *b = atomic_load_explicit(blocks, memory_order_acquire);
+    while (b) {
+        struct skip_block *next = b->next;
+        free(b);
+        b = next;
+    }
+}
+
+
+static inline uint64_t xorshift(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// one more level per two zero bits, p = 1/4
+static inline uint32_t tower_height(uint64_t r) {
+    return 1 + (uint32_t)__builtin_ctzll(r | (uint64_t)1 << 62) / 2;
+}
+
+// ###################### ARENA ######################
+
+
+
+// ###################### SKIP LIST ######################
+
+static inline size_t node_bytes(uint32_t height) {
+    return offsetof(Skip_node, next) + height * sizeof(Skip_node*);
+}
+
+
+SkipList *skip_new(void (*free_data)(void*), int (*compare)(const void*, const void*)) {
+    if (!compare) return (SkipList*)0;  // caller checks NULL
+
+    SkipList *s = malloc(sizeof(*s));
+    if (!s) return (SkipList*)0;
+
+    atomic_init(&s->blocks, NULL);
+    s->head = arena_alloc(&s->blocks, node_bytes(SKIP_MAX_LEVEL));
+    if (!s->head) {
+        free(s);
+        return (SkipList*)0;
+    }
+    memset(s->head, 0, node_bytes(SKIP_MAX_LEVEL));
+    s->head->height = SKIP_MAX_LEVEL;
+    memset(s->spare, 0, sizeof(s->spare));
+    s->cnt = 0;
+    s->level = 1;
+    s->rng = hash_u64((uint64_t)(uintptr_t)s, HASH_DEFAULT_SEED) | 1;
+    s->free = free_data;
+    s->compare = compare;
+    return s;
+}
+
+
+void skip_free(SkipList *s, bool preserve) {
+    if (!s) return;
+    if (!preserve && s->free) {
+        for (Skip_node *x = s->head->next[0]; x; x = x->next[0]) {
+            if (x->data) s->free(x->data);
+        }
+    }
+    arena_free(&s->blocks);
+    free(s);
+}
+
+
+// last node before key on each level below s->level, returns the node after preds[0]
+static Skip_node *find_preds(const SkipList *s, const void *key, Skip_node **preds) {
+    Skip_node *x = s->head;
+    for (size_t l = s->level; l-- > 0;) {
+        Skip_node *n;
+        while ((n = x->next[l]) && s->compare(n->data, key) < 0) x = n;
+        preds[l] = x;
+    }
+    return x->next[0];
+}
+
+
+UTIL_ERR skip_insert(SkipList *s, void *data) {
+    if (!s) return E_EMPTY_OBJ;
+
+    Skip_node *preds[SKIP_MAX_LEVEL];
+    Skip_node *n = find_preds(s, data, preds);
+    if (n && s->compare(n->data, data) == 0) return E_NOOP;
+
+    uint32_t h = tower_height(xorshift(&s->rng));
+    Skip_node *x = s->spare[h - 1];
+    if (x) s->spare[h - 1] = x->next[0];
+    else if (!(x = arena_alloc(&s->blocks, node_bytes(h)))) return E_BAD_ALLOC;
+
+    for (size_t l = s->level; l < h; l++) preds[l] = s->head;
+    if (h > s->level) s->level = h;
+
+    x->data = data;
+    x->height = h;
+    for (uint32_t l = 0; l < h; l++) {
+        x->next[l] = preds[l]->next[l];
+        preds[l]->next[l] = x;
+    }
+    x->prev = preds[0] == s->head ? NULL : preds[0];
+    if (x->next[0]) x->next[0]->prev = x;
+    s->cnt++;
+    return E_SUCCESS;
+}
+
+
+void *skip_find(const SkipList *s, const void *key) {
+    if (!s || !key) return NULL;
+
+    Skip_node *x = s->head, *n = NULL;
+    for (size_t l = s->level; l-- > 0;) {
+        while ((n = x->next[l]) && s->compare(n->data, key) < 0) x = n;
+    }
+    return n && s->compare(n->data, key) == 0 ? n->data : NULL;
+}
+
+
+UTIL_ERR skip_remove(SkipList *s, const void *key, bool preserve) {
+    if (!s) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+
+    Skip_node *preds[SKIP_MAX_LEVEL];
+    Skip_node *x = find_preds(s, key, preds);
+    if (!x || s->compare(x->data, key) != 0) return E_DOESNT_EXIST;
+
+    for (uint32_t l = 0; l < x->height; l++) preds[l]->next[l] = x->next[l];
+    if (x->next[0]) x->next[0]->prev = x->prev;
+    while (s->level > 1 && !s->head->next[s->level - 1]) s->level--;
+    s->cnt--;
+
+    if (!preserve && s->free && x->data) s->free(x->data);
+    x->next[0] = s->spare[x->height - 1];
+    s->spare[x->height - 1] = x;
+    return E_SUCCESS;
+}
+
+
+Skip_node *skip_lower_bound(const SkipList *s, const void *key) {
+    if (!s) return NULL;
+    if (!key) return s->head->next[0];
+
+    Skip_node *x = s->head, *n = NULL;
+    for (size_t l = s->level; l-- > 0;) {
+        while ((n = x->next[l]) && s->compare(n->data, key) < 0) x = n;
+    }
+    return n;
+}
+
+
+Skip_node *skip_last(const SkipList *s) {
+    if (!s) return NULL;
+
+    Skip_node *x = s->head;
+    for (size_t l = s->level; l-- > 0;) {
+        while (x->next[l]) x = x->next[l];
+    }
+    return x == s->head ? NULL : x;
+}
+
+// ###################### SKIP LIST ######################
+
+
+
+// ###################### CONCURRENT SKIP LIST ######################
+
+static inline CSkip_node *ptr_of(uintptr_t link) {
+    return (CSkip_node*)(link & ~LINK_MARK);
+}
+
+static inline bool marked(uintptr_t link) {
+    return link & LINK_MARK;
+}
+
+static inline size_t cnode_bytes(uint32_t height) {
+    return offsetof(CSkip_node, next) + height * sizeof(uintptr_t);
+}
+
+
+// per thread tower heights, seeded from the state's own address
+static uint64_t thread_rand(void) {
+    static _Thread_local uint64_t state;
+    if (!state) state = hash_u64((uint64_t)(uintptr_t)&state, HASH_DEFAULT_SEED) | 1;
+    return xorshift(&state);
+}
+
+
+CSkipList *cskip_new(void (*free_data)(void*), int (*compare)(const void*, const void*)) {
+    if (!compare) return (CSkipList*)0;  // caller checks NULL
+
+    CSkipList *s = malloc(sizeof(*s));
+    if (!s) return (CSkipList*)0;
+
+    atomic_init(&s->blocks, NULL);
+    s->head = arena_alloc(&s->blocks, cnode_bytes(SKIP_MAX_LEVEL));
+    if (!s->head) {
+        free(s);
+        return (CSkipList*)0;
+    }
+    s->head->data = NULL;
+    s->head->height = SKIP_MAX_LEVEL;
+    for (size_t l = 0; l < SKIP_MAX_LEVEL; l++) atomic_init(&s->head->next[l], 0);
+    atomic_init(&s->level, 1);
+    atomic_init(&s->cnt, 0);
+    s->free = free_data;
+    s->compare = compare;
+    return s;
+}
+
+
+void cskip_free(CSkipList *s, bool preserve) {
+    if (!s) return;
+
+    // marked nodes still linked were removed, their data was handed out
+    if (!preserve && s->free) {
+        for (CSkip_node *x = ptr_of(atomic_load(&s->head->next[0])); x; ) {
+            uintptr_t next = atomic_load(&x->next[0]);
+            if (!marked(next) && x->data) s->free(x->data);
+            x = ptr_of(next);
+        }
+    }
+    arena_free(&s->blocks);
+    free(s);
+}
+
+
+/*
+    preds / succs around key on every level below the list's level, unlinking
+    marked nodes on the way. a failed unlink means pred changed (or is being
+    removed itself), the search starts over from the head
+*/
+static CSkip_node *cfind(const CSkipList *s, const void *key, CSkip_node **preds, CSkip_node **succs) {
+retry:;
+    CSkip_node *pred = s->head;
+    for (size_t l = atomic_load(&s->level); l-- > 0;) {
+        CSkip_node *curr = ptr_of(atomic_load(&pred->next[l]));
+        while (curr) {
+            uintptr_t succ = atomic_load(&curr->next[l]);
+            if (marked(succ)) {
+                uintptr_t expect = (uintptr_t)curr;
+                if (!atomic_compare_exchange_strong(&pred->next[l], &expect, succ & ~LINK_MARK)) goto retry;
+                curr = ptr_of(succ);
+                continue;
+            }
+            if (s->compare(curr->data, key) >= 0) break;
+            pred = curr;
+            curr = ptr_of(succ);
+        }
+        preds[l] = pred;
+        succs[l] = curr;
+    }
+    return succs[0];
+}
+
+
+UTIL_ERR cskip_insert(CSkipList *s, void *data) {
+    if (!s) return E_EMPTY_OBJ;
+
+    // raise the level first so the search below fills preds for the whole tower
+    uint32_t h = tower_height(thread_rand());
+    size_t top = atomic_load(&s->level);
+    while (top < h && !atomic_compare_exchange_weak(&s->level, &top, h)) {}
+
+    CSkip_node *preds[SKIP_MAX_LEVEL], *succs[SKIP_MAX_LEVEL], *x = NULL;
+    for (;;) {
+        CSkip_node *n = cfind(s, data, preds, succs);
+        if (n && s->compare(n->data, data) == 0) return E_NOOP;   // an allocated x stays in the arena
+
+        if (!x) {
+            if (!(x = arena_alloc(&s->blocks, cnode_bytes(h)))) return E_BAD_ALLOC;
+            x->data = data;
+            x->height = h;
+        }
+        for (uint32_t l = 0; l < h; l++) atomic_store_explicit(&x->next[l], (uintptr_t)succs[l], memory_order_relaxed);
+
+        uintptr_t expect = (uintptr_t)succs[0];
+        if (atomic_compare_exchange_strong(&preds[0]->next[0], &expect, (uintptr_t)x)) break;
+    }
+    atomic_fetch_add(&s->cnt, 1);
+
+    for (uint32_t l = 1; l < h; l++) {
+        for (;;) {
+            uintptr_t old = atomic_load(&x->next[l]);
+            if (marked(old)) return E_SUCCESS;
+            if (old != (uintptr_t)succs[l] && !atomic_compare_exchange_strong(&x->next[l], &old, (uintptr_t)succs[l])) continue;
+
+            uintptr_t expect = (uintptr_t)succs[l];
+            if (atomic_compare_exchange_strong(&preds[l]->next[l], &expect, (uintptr_t)x)) break;
+            if (cfind(s, data, preds, succs) != x) return E_SUCCESS;   // removed meanwhile
+        }
+    }
+    return E_SUCCESS;
+}
+
+
+// first node not less than key whose level 0 link is unmarked, without unlinking anything
+static CSkip_node *clower(const CSkipList *s, const void *key) {
+    CSkip_node *pred = s->head, *curr = NULL;
+    for (size_t l = atomic_load(&s->level); l-- > 0;) {
+        curr = ptr_of(atomic_load(&pred->next[l]));
+        while (curr) {
+            uintptr_t succ = atomic_load(&curr->next[l]);
+            if (marked(succ)) {
+                curr = ptr_of(succ);
+                continue;
+            }
+            if (s->compare(curr->data, key) >= 0) break;
+            pred = curr;
+            curr = ptr_of(succ);
+        }
+    }
+    return curr;
+}
+
+
+void *cskip_find(const CSkipList *s, const void *key) {
+    if (!s || !key) return NULL;
+
+    CSkip_node *x = clower(s, key);
+    return x && s->compare(x->data, key) == 0 ? x->data : NULL;
+}
+
+
+UTIL_ERR cskip_remove(CSkipList *s, const void *key, void **data_out) {
+    if (!s) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_ARG;
+
+    CSkip_node *preds[SKIP_MAX_LEVEL], *succs[SKIP_MAX_LEVEL];
+    CSkip_node *x = cfind(s, key, preds, succs);
+    if (!x || s->compare(x->data, key) != 0) return E_DOESNT_EXIST;
+
+    // freeze the upper links, then race for level 0
+    for (uint32_t l = x->height; l-- > 1;) {
+        uintptr_t succ = atomic_load(&x->next[l]);
+        while (!marked(succ) && !atomic_compare_exchange_weak(&x->next[l], &succ, succ | LINK_MARK)) {}
+    }
+    uintptr_t succ = atomic_load(&x->next[0]);
+    do {
+        if (marked(succ)) return E_DOESNT_EXIST;
+    } while (!atomic_compare_exchange_weak(&x->next[0], &succ, succ | LINK_MARK));
+
+    atomic_fetch_sub(&s->cnt, 1);
+    if (data_out) *data_out = x->data;
+    cfind(s, key, preds, succs);
+    return E_SUCCESS;
+}
+
+
+CSkip_node *cskip_lower_bound(const CSkipList *s, const void *key) {
+    if (!s) return NULL;
+    if (key) return clower(s, key);
+
+    CSkip_node *x = ptr_of(atomic_load(&s->head->next[0]));
+    while (x && marked(atomic_load(&x->next[0]))) x = ptr_of(atomic_load(&x->next[0]));
+    return x;
+}
+
+
+CSkip_node *cskip_next(const CSkip_node *node) {
+    if (!node) return NULL;
+
+    CSkip_node *x = ptr_of(atomic_load(&node->next[0]));
+    while (x && marked(atomic_load(&x->next[0]))) x = ptr_of(atomic_load(&x->next[0]));
+    return x;
+}
+
+
+size_t cskip_size(const CSkipList *s) {
+    if (!s) return 0;
+    return atomic_load(&s->cnt);
+}
+
+// ###################### CONCURRENT SKIP LIST ######################
@@ -3,7 +3,9 @@
  *
  */
 
+#include <stddef.h>
 #include "../include/aputils.h"
+#include "../include/sorting.h"
 
 // ############## BUBBLE SORT LLIST ##############
 void bubble_sort(APUTIL_LList *lst) {
@@ -205,3 +207,1574 @@ void merge_sort(APUTIL_LList *lst) {
 }
 
 // ############## MERGE SORT LLIST ##############
+
+
+// ############## SELECTION VECTOR ##############
+
+    /*
+
+     introselect: quickselect on median-of-3 pivots, recursing only into the
+     side that holds n. if the partitions degrade (depth budget of 2*log2(n)
+     used up) the remaining range is sorted outright, bounding the worst case
+     at O(n log n) while the expected cost stays O(n)
+
+    */
+
+#define SELECT_SMALL 16
+
+
+static size_t select_depth(size_t n) {
+    size_t depth = 0;
+    while (n > 1) {
+        depth += 2;
+        n >>= 1;
+    }
+    return depth;
+}
+
+
+static void elem_swap(char *a, char *b, size_t es) {
+    if (a == b) return;
+    char tmp[64];
+    while (es > 0) {
+        size_t chunk = es < sizeof(tmp) ? es : sizeof(tmp);
+        memcpy(tmp, a, chunk);
+        memcpy(a, b, chunk);
+        memcpy(b, tmp, chunk);
+        a += chunk;
+        b += chunk;
+        es -= chunk;
+    }
+}
+
+
+static void elem_insertion_sort(char *base, size_t lo, size_t hi, size_t es, int (*compare)(const void*, const void*)) {
+    for (size_t i = lo + 1; i <= hi; i++) {
+        for (size_t j = i; j > lo && compare(base + (j-1) * es, base + j * es) > 0; j--) {
+            elem_swap(base + (j-1) * es, base + j * es, es);
+        }
+    }
+}
+
+
+static void elem_select(char *base, size_t cnt, size_t es, size_t n, int (*compare)(const void*, const void*)) {
+    size_t lo = 0, hi = cnt - 1, depth = select_depth(cnt);
+
+    while (hi > lo) {
+        if (hi - lo < SELECT_SMALL) {
+            elem_insertion_sort(base, lo, hi, es, compare);
+            return;
+        }
+        if (depth-- == 0) {
+            qsort(base + lo * es, hi - lo + 1, es, compare);
+            return;
+        }
+
+        // order lo, mid, hi then park the median at hi-1 as the pivot
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare(base + mid * es, base + lo * es) < 0) elem_swap(base + mid * es, base + lo * es, es);
+        if (compare(base + hi * es, base + lo * es) < 0) elem_swap(base + hi * es, base + lo * es, es);
+        if (compare(base + hi * es, base + mid * es) < 0) elem_swap(base + hi * es, base + mid * es, es);
+        elem_swap(base + mid * es, base + (hi-1) * es, es);
+        char *pivot = base + (hi-1) * es;
+
+        // a[lo] and the pivot act as sentinels
+        size_t i = lo, j = hi - 1;
+        for (;;) {
+            while (compare(base + (++i) * es, pivot) < 0);
+            while (compare(base + (--j) * es, pivot) > 0);
+            if (i >= j) break;
+            elem_swap(base + i * es, base + j * es, es);
+        }
+        elem_swap(base + i * es, pivot, es);
+
+        if (n == i) return;
+        if (n < i) hi = i - 1;
+        else lo = i + 1;
+    }
+}
+
+
+UTIL_ERR vector_nth_element(Vector *v, size_t n, int (*compare)(const void*, const void*)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!compare) return E_EMPTY_FUNC;
+    if (n >= v->size) return E_OUTOFBOUNDS;
+
+    elem_select(v->data, v->size, v->elem_size, n, compare);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vector_partial_sort(Vector *v, size_t k, int (*compare)(const void*, const void*)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!compare) return E_EMPTY_FUNC;
+    if (k == 0) return E_NOOP;
+    if (k > v->size) k = v->size;
+
+    if (k < v->size) elem_select(v->data, v->size, v->elem_size, k - 1, compare);
+    qsort(v->data, k, v->elem_size, compare);
+    return E_SUCCESS;
+}
+
+
+Vector *vector_top_k(const Vector *v, size_t k, int (*compare)(const void*, const void*), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vector*)0;
+    }
+    if (!compare) {
+        *e = E_EMPTY_FUNC;
+        return (Vector*)0;
+    }
+    if (k == 0) {
+        *e = E_NOOP;
+        return (Vector*)0;
+    }
+    if (k > v->size) k = v->size;
+
+    // max-heap of the k smallest seen so far
+    Heap *h = heap_new(v->elem_size, k ? k : 1, compare, true, 4);
+    if (!h) {
+        *e = E_BAD_ALLOC;
+        return (Vector*)0;
+    }
+    for (size_t i = 0; i < v->size; i++) {
+        heap_push_bounded(h, (char*)v->data + i * v->elem_size, k);
+    }
+
+    // draining a max-heap yields descending order, fill from the back
+    size_t cnt = h->vec->size;
+    Vector *sorted = vector_new(v->elem_size, cnt ? cnt : 1);
+    if (!sorted) {
+        heap_free(h);
+        *e = E_BAD_ALLOC;
+        return (Vector*)0;
+    }
+    sorted->size = cnt;
+    for (size_t i = cnt; i > 0; i--) {
+        heap_pop(h, (char*)sorted->data + (i-1) * v->elem_size);
+    }
+
+    heap_free(h);
+    return sorted;
+}
+
+
+// i32 versions: same algorithm with direct loads, compare is optional
+static inline int i32_cmp(int32_t a, int32_t b, int (*compare)(const void*, const void*)) {
+    return compare ? compare(&a, &b) : (a > b) - (a < b);
+}
+
+static inline void i32_swap(int32_t *a, int32_t *b) {
+    int32_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+
+static void i32_insertion_sort(int32_t *a, size_t lo, size_t hi, int (*compare)(const void*, const void*)) {
+    for (size_t i = lo + 1; i <= hi; i++) {
+        int32_t cur = a[i];
+        size_t j = i;
+        while (j > lo && i32_cmp(a[j-1], cur, compare) > 0) {
+            a[j] = a[j-1];
+            j--;
+        }
+        a[j] = cur;
+    }
+}
+
+
+static int i32_qsort_cmp(const void *d1, const void *d2) {
+    int32_t a = *(const int32_t*)d1, b = *(const int32_t*)d2;
+    return (a > b) - (a < b);
+}
+
+
+static void i32_select(int32_t *a, size_t cnt, size_t n, int (*compare)(const void*, const void*)) {
+    size_t lo = 0, hi = cnt - 1, depth = select_depth(cnt);
+
+    while (hi > lo) {
+        if (hi - lo < SELECT_SMALL) {
+            i32_insertion_sort(a, lo, hi, compare);
+            return;
+        }
+        if (depth-- == 0) {
+            qsort(a + lo, hi - lo + 1, sizeof(int32_t), compare ? compare : i32_qsort_cmp);
+            return;
+        }
+
+        size_t mid = lo + (hi - lo) / 2;
+        if (i32_cmp(a[mid], a[lo], compare) < 0) i32_swap(&a[mid], &a[lo]);
+        if (i32_cmp(a[hi], a[lo], compare) < 0) i32_swap(&a[hi], &a[lo]);
+        if (i32_cmp(a[hi], a[mid], compare) < 0) i32_swap(&a[hi], &a[mid]);
+        i32_swap(&a[mid], &a[hi-1]);
+        int32_t pivot = a[hi-1];
+
+        size_t i = lo, j = hi - 1;
+        for (;;) {
+            while (i32_cmp(a[++i], pivot, compare) < 0);
+            while (i32_cmp(a[--j], pivot, compare) > 0);
+            if (i >= j) break;
+            i32_swap(&a[i], &a[j]);
+        }
+        i32_swap(&a[i], &a[hi-1]);
+
+        if (n == i) return;
+        if (n < i) hi = i - 1;
+        else lo = i + 1;
+    }
+}
+
+
+UTIL_ERR vec_i32_nth_element(Vec_i32 *v, size_t n, int (*compare)(const void*, const void*)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (n >= v->size) return E_OUTOFBOUNDS;
+
+    i32_select(v->data, v->size, n, compare);
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vec_i32_partial_sort(Vec_i32 *v, size_t k, int (*compare)(const void*, const void*)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (k == 0) return E_NOOP;
+    if (k > v->size) k = v->size;
+
+    if (k < v->size) i32_select(v->data, v->size, k - 1, compare);
+    qsort(v->data, k, sizeof(int32_t), compare ? compare : i32_qsort_cmp);
+    return E_SUCCESS;
+}
+
+
+Vec_i32 *vec_i32_top_k(const Vec_i32 *v, size_t k, int (*compare)(const void*, const void*), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_i32*)0;
+    }
+    if (k == 0) {
+        *e = E_NOOP;
+        return (Vec_i32*)0;
+    }
+    if (k > v->size) k = v->size;
+
+    Heap_i32 *h = heap_i32_new(k ? k : 1, compare, true, 4);
+    if (!h) {
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+    for (size_t i = 0; i < v->size; i++) {
+        heap_i32_push_bounded(h, v->data[i], k);
+    }
+
+    size_t cnt = h->vec->size;
+    Vec_i32 *sorted = vec_i32_new(cnt ? cnt : 1);
+    if (!sorted) {
+        heap_i32_free(h);
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+    sorted->size = cnt;
+    UTIL_ERR e_pop = E_SUCCESS;
+    for (size_t i = cnt; i > 0; i--) {
+        sorted->data[i-1] = heap_i32_pop(h, &e_pop);
+    }
+
+    heap_i32_free(h);
+    return sorted;
+}
+
+// ############## SELECTION VECTOR ##############
+
+
+// ############## STABLE SORT VECTOR ##############
+
+    /*
+
+     TimSort over elem_size byte elements
+
+     like merge_sort above the input is first split into natural runs,
+     strictly descending runs are reversed in place (stable), short runs are
+     extended to minrun with binary insertion sort. runs go on a stack whose
+     lengths are kept roughly fibonacci so merges stay balanced, and merges
+     switch to galloping (exponential search) when one side keeps winning,
+     which is where mostly sorted data gets close to O(n)
+
+     the merge buffer only ever needs min(left, right) elements and can be
+     supplied by the caller to be reused across sorts
+
+    */
+
+#define TS_MIN_GALLOP 7
+#define TS_MAX_RUNS 85
+
+typedef struct {
+    char *base;
+    size_t es;
+    int (*compare)(const void*, const void*);
+    Vec_char *scratch;                  // merge buffer (bytes)
+    size_t min_gallop;
+    size_t n_runs;
+    size_t run_base[TS_MAX_RUNS];
+    size_t run_len[TS_MAX_RUNS];
+} ts_state;
+
+#define TS_AT(ts, p, i) ((p) + (ptrdiff_t)(i) * (ptrdiff_t)(ts)->es)
+
+
+static bool ts_reserve(ts_state *ts, size_t elems) {
+    size_t need = (elems + 1) * ts->es;     // +1 for the insertion sort pivot
+    if (ts->scratch->cap >= need) return true;
+
+    char *data = realloc(ts->scratch->data, need);
+    if (!data) return false;
+    ts->scratch->data = data;
+    ts->scratch->cap = need;
+    return true;
+}
+
+
+static size_t ts_minrun(size_t n) {
+    size_t r = 0;
+    while (n >= 64) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+
+static void ts_reverse(ts_state *ts, char *lo, char *hi) {
+    // hi is inclusive
+    while (lo < hi) {
+        elem_swap(lo, hi, ts->es);
+        lo += ts->es;
+        hi -= ts->es;
+    }
+}
+
+
+// length of the run starting at lo, descending runs are reversed
+static size_t ts_count_run(ts_state *ts, char *lo, size_t n) {
+    if (n == 1) return 1;
+
+    size_t len = 2;
+    if (ts->compare(TS_AT(ts, lo, 1), lo) < 0) {
+        // strictly descending only, equal elements would lose their order
+        while (len < n && ts->compare(TS_AT(ts, lo, len), TS_AT(ts, lo, len - 1)) < 0) len++;
+        ts_reverse(ts, lo, TS_AT(ts, lo, len - 1));
+    } else {
+        while (len < n && ts->compare(TS_AT(ts, lo, len), TS_AT(ts, lo, len - 1)) >= 0) len++;
+    }
+    return len;
+}
+
+
+// [lo, lo + start) is sorted, insert the rest of [lo, lo + n)
+static void ts_binary_insertion(ts_state *ts, char *lo, size_t n, size_t start) {
+    char *pivot = ts->scratch->data;
+    for (; start < n; start++) {
+        memcpy(pivot, TS_AT(ts, lo, start), ts->es);
+
+        // rightmost position keeps equal elements in order
+        size_t l = 0, r = start;
+        while (l < r) {
+            size_t m = l + (r - l) / 2;
+            if (ts->compare(pivot, TS_AT(ts, lo, m)) < 0) r = m;
+            else l = m + 1;
+        }
+        memmove(TS_AT(ts, lo, l + 1), TS_AT(ts, lo, l), (start - l) * ts->es);
+        memcpy(TS_AT(ts, lo, l), pivot, ts->es);
+    }
+}
+
+
+// position of the first element in a[0..n) that is >= key, searching out from hint
+static size_t ts_gallop_left(ts_state *ts, const char *key, const char *a, size_t n, size_t hint) {
+    ptrdiff_t ofs = 1, lastofs = 0, maxofs;
+    ptrdiff_t h = (ptrdiff_t)hint;
+
+    if (ts->compare(TS_AT(ts, a, h), key) < 0) {
+        // a[h] < key, gallop right until a[h + lastofs] < key <= a[h + ofs]
+        maxofs = (ptrdiff_t)n - h;
+        while (ofs < maxofs && ts->compare(TS_AT(ts, a, h + ofs), key) < 0) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs) ofs = maxofs;
+        lastofs += h;
+        ofs += h;
+    } else {
+        // key <= a[h], gallop left until a[h - ofs] < key <= a[h - lastofs]
+        maxofs = h + 1;
+        while (ofs < maxofs && ts->compare(TS_AT(ts, a, h - ofs), key) >= 0) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs) ofs = maxofs;
+        ptrdiff_t k = lastofs;
+        lastofs = h - ofs;
+        ofs = h - k;
+    }
+
+    // a[lastofs] < key <= a[ofs], binary search the gap
+    lastofs++;
+    while (lastofs < ofs) {
+        ptrdiff_t m = lastofs + ((ofs - lastofs) >> 1);
+        if (ts->compare(TS_AT(ts, a, m), key) < 0) lastofs = m + 1;
+        else ofs = m;
+    }
+    return (size_t)ofs;
+}
+
+
+// position of the first element in a[0..n) that is > key, searching out from hint
+static size_t ts_gallop_right(ts_state *ts, const char *key, const char *a, size_t n, size_t hint) {
+    ptrdiff_t ofs = 1, lastofs = 0, maxofs;
+    ptrdiff_t h = (ptrdiff_t)hint;
+
+    if (ts->compare(key, TS_AT(ts, a, h)) < 0) {
+        // key < a[h], gallop left until a[h - ofs] <= key < a[h - lastofs]
+        maxofs = h + 1;
+        while (ofs < maxofs && ts->compare(key, TS_AT(ts, a, h - ofs)) < 0) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs) ofs = maxofs;
+        ptrdiff_t k = lastofs;
+        lastofs = h - ofs;
+        ofs = h - k;
+    } else {
+        // a[h] <= key, gallop right until a[h + lastofs] <= key < a[h + ofs]
+        maxofs = (ptrdiff_t)n - h;
+        while (ofs < maxofs && ts->compare(key, TS_AT(ts, a, h + ofs)) >= 0) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs) ofs = maxofs;
+        lastofs += h;
+        ofs += h;
+    }
+
+    lastofs++;
+    while (lastofs < ofs) {
+        ptrdiff_t m = lastofs + ((ofs - lastofs) >> 1);
+        if (ts->compare(key, TS_AT(ts, a, m)) < 0) ofs = m;
+        else lastofs = m + 1;
+    }
+    return (size_t)ofs;
+}
+
+
+// merge adjacent runs a and b, na <= nb, a is moved to the buffer and merged forward
+static void ts_merge_lo(ts_state *ts, char *pa_run, size_t na, char *pb, size_t nb) {
+    size_t es = ts->es;
+    char *pa = ts->scratch->data + es;     // slot 0 is the insertion pivot
+    memcpy(pa, pa_run, na * es);
+    char *dest = pa_run;
+    size_t min_gallop = ts->min_gallop;
+
+    memcpy(dest, pb, es);
+    dest += es;
+    pb += es;
+    if (--nb == 0) goto succeed;
+    if (na == 1) goto copy_b;
+
+    for (;;) {
+        size_t acount = 0, bcount = 0;
+
+        // one element at a time until one side wins min_gallop times in a row
+        for (;;) {
+            if (ts->compare(pb, pa) < 0) {
+                memcpy(dest, pb, es);
+                dest += es;
+                pb += es;
+                bcount++;
+                acount = 0;
+                if (--nb == 0) goto succeed;
+                if (bcount >= min_gallop) break;
+            } else {
+                memcpy(dest, pa, es);
+                dest += es;
+                pa += es;
+                acount++;
+                bcount = 0;
+                if (--na == 1) goto copy_b;
+                if (acount >= min_gallop) break;
+            }
+        }
+
+        // galloping, copy whole stretches while it pays off
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            ts->min_gallop = min_gallop;
+
+            size_t k = ts_gallop_right(ts, pb, pa, na, 0);
+            acount = k;
+            if (k) {
+                memcpy(dest, pa, k * es);
+                dest += k * es;
+                pa += k * es;
+                na -= k;
+                if (na == 1) goto copy_b;
+                if (na == 0) goto succeed;     // only with an inconsistent compare
+            }
+            memcpy(dest, pb, es);
+            dest += es;
+            pb += es;
+            if (--nb == 0) goto succeed;
+
+            k = ts_gallop_left(ts, pa, pb, nb, 0);
+            bcount = k;
+            if (k) {
+                memmove(dest, pb, k * es);
+                dest += k * es;
+                pb += k * es;
+                nb -= k;
+                if (nb == 0) goto succeed;
+            }
+            memcpy(dest, pa, es);
+            dest += es;
+            pa += es;
+            if (--na == 1) goto copy_b;
+        } while (acount >= TS_MIN_GALLOP || bcount >= TS_MIN_GALLOP);
+        min_gallop++;
+        ts->min_gallop = min_gallop;
+    }
+
+succeed:
+    if (na) memcpy(dest, pa, na * es);
+    return;
+
+copy_b:
+    // the last a element goes after everything left in b
+    memmove(dest, pb, nb * es);
+    memcpy(dest + nb * es, pa, es);
+}
+
+
+// merge adjacent runs a and b, na >= nb, b is moved to the buffer and merged backward
+static void ts_merge_hi(ts_state *ts, char *base_a, size_t na, char *pb_run, size_t nb) {
+    size_t es = ts->es;
+    char *base_b = ts->scratch->data + es;
+    memcpy(base_b, pb_run, nb * es);
+
+    char *dest = pb_run + (nb - 1) * es;
+    char *pa = base_a + (na - 1) * es;
+    char *pb = base_b + (nb - 1) * es;
+    size_t min_gallop = ts->min_gallop;
+
+    memcpy(dest, pa, es);
+    dest -= es;
+    pa -= es;
+    if (--na == 0) goto succeed;
+    if (nb == 1) goto copy_a;
+
+    for (;;) {
+        size_t acount = 0, bcount = 0;
+
+        for (;;) {
+            if (ts->compare(pb, pa) < 0) {
+                memcpy(dest, pa, es);
+                dest -= es;
+                pa -= es;
+                acount++;
+                bcount = 0;
+                if (--na == 0) goto succeed;
+                if (acount >= min_gallop) break;
+            } else {
+                memcpy(dest, pb, es);
+                dest -= es;
+                pb -= es;
+                bcount++;
+                acount = 0;
+                if (--nb == 1) goto copy_a;
+                if (bcount >= min_gallop) break;
+            }
+        }
+
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            ts->min_gallop = min_gallop;
+
+            size_t k = na - ts_gallop_right(ts, pb, base_a, na, na - 1);
+            acount = k;
+            if (k) {
+                dest -= k * es;
+                pa -= k * es;
+                memmove(dest + es, pa + es, k * es);
+                na -= k;
+                if (na == 0) goto succeed;
+            }
+            memcpy(dest, pb, es);
+            dest -= es;
+            pb -= es;
+            if (--nb == 1) goto copy_a;
+
+            k = nb - ts_gallop_left(ts, pa, base_b, nb, nb - 1);
+            bcount = k;
+            if (k) {
+                dest -= k * es;
+                pb -= k * es;
+                memcpy(dest + es, pb + es, k * es);
+                nb -= k;
+                if (nb == 1) goto copy_a;
+                if (nb == 0) goto succeed;     // only with an inconsistent compare
+            }
+            memcpy(dest, pa, es);
+            dest -= es;
+            pa -= es;
+            if (--na == 0) goto succeed;
+        } while (acount >= TS_MIN_GALLOP || bcount >= TS_MIN_GALLOP);
+        min_gallop++;
+        ts->min_gallop = min_gallop;
+    }
+
+succeed:
+    if (nb) memcpy(dest - (nb - 1) * es, base_b, nb * es);
+    return;
+
+copy_a:
+    // the first b element goes before everything left in a
+    dest -= na * es;
+    pa -= na * es;
+    memmove(dest + es, pa + es, na * es);
+    memcpy(dest, pb, es);
+}
+
+
+static bool ts_merge_at(ts_state *ts, size_t i) {
+    char *pa = TS_AT(ts, ts->base, ts->run_base[i]);
+    char *pb = TS_AT(ts, ts->base, ts->run_base[i+1]);
+    size_t na = ts->run_len[i], nb = ts->run_len[i+1];
+
+    ts->run_len[i] = na + nb;
+    if (i == ts->n_runs - 3) {
+        ts->run_base[i+1] = ts->run_base[i+2];
+        ts->run_len[i+1] = ts->run_len[i+2];
+    }
+    ts->n_runs--;
+
+    // elements of a already below b[0] and of b already above a[last] stay put
+    size_t k = ts_gallop_right(ts, pb, pa, na, 0);
+    pa += k * ts->es;
+    na -= k;
+    if (na == 0) return true;
+
+    nb = ts_gallop_left(ts, pa + (na - 1) * ts->es, pb, nb, nb - 1);
+    if (nb == 0) return true;
+
+    if (!ts_reserve(ts, na < nb ? na : nb)) return false;
+    if (na <= nb) ts_merge_lo(ts, pa, na, pb, nb);
+    else ts_merge_hi(ts, pa, na, pb, nb);
+    return true;
+}
+
+
+// keep run lengths decreasing faster than fibonacci
+static bool ts_merge_collapse(ts_state *ts) {
+    size_t *len = ts->run_len;
+    while (ts->n_runs > 1) {
+        size_t n = ts->n_runs - 2;
+        if ((n > 0 && len[n-1] <= len[n] + len[n+1]) || (n > 1 && len[n-2] <= len[n-1] + len[n])) {
+            if (len[n-1] < len[n+1]) n--;
+        } else if (len[n] > len[n+1]) {
+            break;
+        }
+        if (!ts_merge_at(ts, n)) return false;
+    }
+    return true;
+}
+
+
+static bool ts_merge_force_collapse(ts_state *ts) {
+    size_t *len = ts->run_len;
+    while (ts->n_runs > 1) {
+        size_t n = ts->n_runs - 2;
+        if (n > 0 && len[n-1] < len[n+1]) n--;
+        if (!ts_merge_at(ts, n)) return false;
+    }
+    return true;
+}
+
+
+static UTIL_ERR timsort(char *base, size_t n, size_t es, int (*compare)(const void*, const void*), Vec_char *scratch) {
+    if (n < 2) return E_SUCCESS;
+
+    ts_state ts = {
+        .base = base, .es = es, .compare = compare, .scratch = scratch,
+        .min_gallop = TS_MIN_GALLOP, .n_runs = 0
+    };
+    if (!ts_reserve(&ts, 1)) return E_BAD_ALLOC;
+
+    size_t minrun = ts_minrun(n), lo = 0, remaining = n;
+    while (remaining) {
+        size_t len = ts_count_run(&ts, TS_AT(&ts, base, lo), remaining);
+        if (len < minrun) {
+            size_t force = remaining < minrun ? remaining : minrun;
+            ts_binary_insertion(&ts, TS_AT(&ts, base, lo), force, len);
+            len = force;
+        }
+
+        ts.run_base[ts.n_runs] = lo;
+        ts.run_len[ts.n_runs] = len;
+        ts.n_runs++;
+        if (!ts_merge_collapse(&ts)) return E_BAD_ALLOC;
+
+        lo += len;
+        remaining -= len;
+    }
+
+    if (!ts_merge_force_collapse(&ts)) return E_BAD_ALLOC;
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vector_stable_sort_buf(void *vec, VECTYPE type, int (*compare)(const void*, const void*), Vec_char *scratch) {
+    if (!vec) return E_EMPTY_OBJ;
+    if (!compare) return E_EMPTY_FUNC;
+    if (!scratch) return E_EMPTY_ARG;
+
+    switch (type) {
+        case vector: {
+            Vector *v = vec;
+            return timsort(v->data, v->size, v->elem_size, compare, scratch);
+        }
+        case vec_i32: {
+            Vec_i32 *v = vec;
+            return timsort((char*)v->data, v->size, sizeof(int32_t), compare, scratch);
+        }
+        case vec_char: {
+            Vec_char *v = vec;
+            return timsort(v->data, v->size, sizeof(char), compare, scratch);
+        }
+        default: {
+            return E_BAD_TYPE;
+        }
+    }
+}
+
+
+UTIL_ERR vector_stable_sort(void *vec, VECTYPE type, int (*compare)(const void*, const void*)) {
+    Vec_char *scratch = vec_char_new(64);
+    if (!scratch) return E_BAD_ALLOC;
+
+    UTIL_ERR e = vector_stable_sort_buf(vec, type, compare, scratch);
+    vec_char_free(scratch);
+    return e;
+}
+
+// ############## STABLE SORT VECTOR ##############
+
+
+// ############## ARGSORT / KEY SORT VECTOR ##############
+
+    /*
+
+     large records are expensive to move and compare, so these sorts work on
+     a side array and touch the records once:
+        argsort: stable merge sort of int32 indices, compare reads records in place
+        key sort: extract a 32/64-bit key per record once, LSD radix sort the
+                  (key, index) pairs, then gather the records into a new buffer
+
+    */
+
+#define ARGSORT_SMALL 24
+
+
+static void argsort_insertion(int32_t *idx, size_t lo, size_t hi, const char *base, size_t es, int (*compare)(const void*, const void*)) {
+    for (size_t i = lo + 1; i < hi; i++) {
+        int32_t cur = idx[i];
+        size_t j = i;
+        while (j > lo && compare(base + (size_t)idx[j-1] * es, base + (size_t)cur * es) > 0) {
+            idx[j] = idx[j-1];
+            j--;
+        }
+        idx[j] = cur;
+    }
+}
+
+
+// bottom-up merge sort of idx, ping-ponging between idx and tmp
+static void argsort_merge(int32_t *idx, int32_t *tmp, size_t n, const char *base, size_t es, int (*compare)(const void*, const void*)) {
+    for (size_t lo = 0; lo < n; lo += ARGSORT_SMALL) {
+        size_t hi = lo + ARGSORT_SMALL < n ? lo + ARGSORT_SMALL : n;
+        argsort_insertion(idx, lo, hi, base, es, compare);
+    }
+
+    int32_t *src = idx, *dst = tmp;
+    for (size_t width = ARGSORT_SMALL; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+
+            // right side only wins when strictly smaller, keeps the sort stable
+            while (i < mid && j < hi) {
+                if (compare(base + (size_t)src[j] * es, base + (size_t)src[i] * es) < 0) dst[k++] = src[j++];
+                else dst[k++] = src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        int32_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != idx) memcpy(idx, src, n * sizeof(int32_t));
+}
+
+
+Vec_i32 *vector_argsort(const Vector *v, int (*compare)(const void*, const void*), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_i32*)0;
+    }
+    if (!compare) {
+        *e = E_EMPTY_FUNC;
+        return (Vec_i32*)0;
+    }
+    if (v->size > INT32_MAX) {
+        *e = E_OUTOFBOUNDS;
+        return (Vec_i32*)0;
+    }
+
+    Vec_i32 *perm = vec_i32_new(v->size ? v->size : 1);
+    int32_t *tmp = malloc(sizeof(int32_t) * (v->size ? v->size : 1));
+    if (!perm || !tmp) {
+        vec_i32_free(perm);
+        free(tmp);
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+
+    for (size_t i = 0; i < v->size; i++) perm->data[i] = (int32_t)i;
+    perm->size = v->size;
+    argsort_merge(perm->data, tmp, v->size, v->data, v->elem_size, compare);
+
+    free(tmp);
+    return perm;
+}
+
+
+UTIL_ERR vector_apply_perm(Vector *v, const Vec_i32 *perm) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!perm) return E_EMPTY_ARG;
+    if (perm->size != v->size) return E_OUTOFBOUNDS;
+    if (v->size < 2) return E_SUCCESS;
+
+    char *gathered = vec_data_alloc(&v->alloc, v->cap * v->elem_size);
+    if (!gathered) return E_BAD_ALLOC;
+
+    for (size_t i = 0; i < v->size; i++) {
+        size_t src = (size_t)perm->data[i];
+        if (src >= v->size) {
+            free(gathered);
+            return E_OUTOFBOUNDS;
+        }
+        memcpy(gathered + i * v->elem_size, (char*)v->data + src * v->elem_size, v->elem_size);
+    }
+
+    free(v->data);
+    v->data = gathered;
+    return E_SUCCESS;
+}
+
+
+typedef struct {
+    uint32_t key;
+    uint32_t idx;
+} key32_pair;
+
+typedef struct {
+    uint64_t key;
+    uint64_t idx;
+} key64_pair;
+
+
+// LSD radix sort, one byte per pass, passes where every key shares the byte are skipped
+#define RADIX_PAIRS(NAME, PAIR, KEYBYTES)                                          \
+static PAIR *NAME(PAIR *src, PAIR *dst, size_t n) {                                 \
+    size_t (*hist)[256] = calloc(KEYBYTES, sizeof(*hist));                          \
+    if (!hist) return NULL;                                                         \
+    for (size_t i = 0; i < n; i++) {                                                \
+        for (size_t b = 0; b < KEYBYTES; b++) hist[b][(src[i].key >> (8 * b)) & 0xff]++; \
+    }                                                                               \
+    for (size_t b = 0; b < KEYBYTES; b++) {                                         \
+        if (hist[b][(src[0].key >> (8 * b)) & 0xff] == n) continue;                 \
+        size_t sum = 0;                                                             \
+        for (size_t d = 0; d < 256; d++) {                                          \
+            size_t cnt = hist[b][d];                                                \
+            hist[b][d] = sum;                                                       \
+            sum += cnt;                                                             \
+        }                                                                           \
+        for (size_t i = 0; i < n; i++) {                                            \
+            dst[hist[b][(src[i].key >> (8 * b)) & 0xff]++] = src[i];                \
+        }                                                                           \
+        PAIR *swap = src;                                                           \
+        src = dst;                                                                  \
+        dst = swap;                                                                 \
+    }                                                                               \
+    free(hist);                                                                     \
+    return src;                                                                     \
+}
+
+RADIX_PAIRS(radix_key32, key32_pair, 4)
+RADIX_PAIRS(radix_key64, key64_pair, 8)
+
+
+// move records into sorted order with one gather pass
+static UTIL_ERR gather_records(Vector *v, const void *pairs, size_t pair_size) {
+    char *gathered = vec_data_alloc(&v->alloc, v->cap * v->elem_size);
+    if (!gathered) return E_BAD_ALLOC;
+
+    const char *p = pairs;
+    for (size_t i = 0; i < v->size; i++) {
+        size_t src = pair_size == sizeof(key32_pair)
+            ? ((const key32_pair*)p)[i].idx
+            : ((const key64_pair*)p)[i].idx;
+        memcpy(gathered + i * v->elem_size, (char*)v->data + src * v->elem_size, v->elem_size);
+    }
+
+    free(v->data);
+    v->data = gathered;
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vector_sort_key32(Vector *v, uint32_t (*key)(const void*)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_FUNC;
+    if (v->size > UINT32_MAX) return E_OUTOFBOUNDS;
+    if (v->size < 2) return E_SUCCESS;
+
+    key32_pair *a = malloc(sizeof(*a) * v->size), *b = malloc(sizeof(*b) * v->size);
+    if (!a || !b) {
+        free(a);
+        free(b);
+        return E_BAD_ALLOC;
+    }
+
+    for (size_t i = 0; i < v->size; i++) {
+        a[i].key = key((char*)v->data + i * v->elem_size);
+        a[i].idx = (uint32_t)i;
+    }
+
+    UTIL_ERR e = E_BAD_ALLOC;
+    key32_pair *sorted = radix_key32(a, b, v->size);
+    if (sorted) e = gather_records(v, sorted, sizeof(*sorted));
+
+    free(a);
+    free(b);
+    return e;
+}
+
+
+UTIL_ERR vector_sort_key64(Vector *v, uint64_t (*key)(const void*)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!key) return E_EMPTY_FUNC;
+    if (v->size < 2) return E_SUCCESS;
+
+    key64_pair *a = malloc(sizeof(*a) * v->size), *b = malloc(sizeof(*b) * v->size);
+    if (!a || !b) {
+        free(a);
+        free(b);
+        return E_BAD_ALLOC;
+    }
+
+    for (size_t i = 0; i < v->size; i++) {
+        a[i].key = key((char*)v->data + i * v->elem_size);
+        a[i].idx = i;
+    }
+
+    UTIL_ERR e = E_BAD_ALLOC;
+    key64_pair *sorted = radix_key64(a, b, v->size);
+    if (sorted) e = gather_records(v, sorted, sizeof(*sorted));
+
+    free(a);
+    free(b);
+    return e;
+}
+
+
+Vec_i32 *vector_argsort_key32(const Vector *v, uint32_t (*key)(const void*), UTIL_ERR *e) {
+    if (!v) {
+        *e = E_EMPTY_OBJ;
+        return (Vec_i32*)0;
+    }
+    if (!key) {
+        *e = E_EMPTY_FUNC;
+        return (Vec_i32*)0;
+    }
+    if (v->size > INT32_MAX) {
+        *e = E_OUTOFBOUNDS;
+        return (Vec_i32*)0;
+    }
+
+    size_t n = v->size ? v->size : 1;
+    Vec_i32 *perm = vec_i32_new(n);
+    key32_pair *a = malloc(sizeof(*a) * n), *b = malloc(sizeof(*b) * n);
+    if (!perm || !a || !b) {
+        vec_i32_free(perm);
+        free(a);
+        free(b);
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+
+    for (size_t i = 0; i < v->size; i++) {
+        a[i].key = key((char*)v->data + i * v->elem_size);
+        a[i].idx = (uint32_t)i;
+    }
+
+    key32_pair *sorted = v->size > 1 ? radix_key32(a, b, v->size) : a;
+    if (!sorted) {
+        vec_i32_free(perm);
+        perm = NULL;
+        *e = E_BAD_ALLOC;
+    } else {
+        for (size_t i = 0; i < v->size; i++) perm->data[i] = (int32_t)sorted[i].idx;
+        perm->size = v->size;
+    }
+
+    free(a);
+    free(b);
+    return perm;
+}
+
+// ############## ARGSORT / KEY SORT VECTOR ##############
+
+
+// ############## K-WAY MERGE ##############
+
+    /*
+
+     loser tree (tournament tree) over k sorted sources
+
+     leaves are the sources at tree positions [k, 2k), internal node p keeps
+     the loser of the match played at p, the overall winner is kept aside.
+     after the winner's source advances only its path to the root is
+     replayed: log2(k) compares per output element, vs ~2 log2(k) for a heap
+
+     exhausted sources lose every match, ties go to the lower source index so
+     the merge is stable
+
+    */
+
+static size_t lt_build(loser_tree *lt, size_t pos) {
+    if (pos >= lt->k) return pos - lt->k;
+    size_t l = lt_build(lt, 2 * pos), r = lt_build(lt, 2 * pos + 1);
+    if (lt->less(lt->ctx, r, l)) {
+        lt->tree[pos] = l;
+        return r;
+    }
+    lt->tree[pos] = r;
+    return l;
+}
+
+
+bool loser_tree_init(loser_tree *lt, size_t k, bool (*less)(void*, size_t, size_t), void *ctx) {
+    lt->k = k;
+    lt->less = less;
+    lt->ctx = ctx;
+    lt->tree = malloc(sizeof(size_t) * k);
+    if (!lt->tree) return false;
+    lt->winner = k == 1 ? 0 : lt_build(lt, 1);
+    return true;
+}
+
+
+void loser_tree_free(loser_tree *lt) {
+    if (!lt) return;
+    free(lt->tree);
+    lt->tree = NULL;
+}
+
+
+// the winner's source moved on, replay its path to the root
+void loser_tree_replay(loser_tree *lt) {
+    size_t s = lt->winner;
+    for (size_t pos = (s + lt->k) / 2; pos >= 1; pos /= 2) {
+        if (lt->less(lt->ctx, lt->tree[pos], s)) {
+            size_t tmp = lt->tree[pos];
+            lt->tree[pos] = s;
+            s = tmp;
+        }
+    }
+    lt->winner = s;
+}
+
+
+typedef struct {
+    char **cur;         // next element per source
+    char **end;
+    size_t es;
+    int (*compare)(const void*, const void*);
+} merge_arrays_ctx;
+
+static bool merge_arrays_less(void *ctx, size_t a, size_t b) {
+    merge_arrays_ctx *m = ctx;
+    if (m->cur[a] == m->end[a]) return false;
+    if (m->cur[b] == m->end[b]) return true;
+    int c = m->compare(m->cur[a], m->cur[b]);
+    return c < 0 || (c == 0 && a < b);
+}
+
+
+// merge k sorted arrays of es byte elements into out (room for the total)
+static UTIL_ERR merge_arrays(char *out, char **cur, char **end, size_t k, size_t total, size_t es, int (*compare)(const void*, const void*)) {
+    merge_arrays_ctx ctx = { .cur = cur, .end = end, .es = es, .compare = compare };
+    loser_tree lt;
+    if (!loser_tree_init(&lt, k, merge_arrays_less, &ctx)) return E_BAD_ALLOC;
+
+    for (size_t i = 0; i < total; i++) {
+        size_t w = lt.winner;
+        memcpy(out + i * es, cur[w], es);
+        cur[w] += es;
+        loser_tree_replay(&lt);
+    }
+
+    loser_tree_free(&lt);
+    return E_SUCCESS;
+}
+
+
+Vector *vector_merge_k(Vector *const *vs, size_t k, int (*compare)(const void*, const void*), UTIL_ERR *e) {
+    if (!vs || k == 0) {
+        *e = E_EMPTY_ARG;
+        return (Vector*)0;
+    }
+    if (!compare) {
+        *e = E_EMPTY_FUNC;
+        return (Vector*)0;
+    }
+
+    size_t total = 0, es = 0;
+    for (size_t i = 0; i < k; i++) {
+        if (!vs[i]) {
+            *e = E_EMPTY_ARG;
+            return (Vector*)0;
+        }
+        if (es && vs[i]->elem_size != es) {
+            *e = E_BAD_TYPE;
+            return (Vector*)0;
+        }
+        es = vs[i]->elem_size;
+        total += vs[i]->size;
+    }
+
+    Vector *out = vector_new(es, total ? total : 1);
+    char **cur = malloc(sizeof(char*) * k), **end = malloc(sizeof(char*) * k);
+    if (!out || !cur || !end) {
+        vector_free(out);
+        free(cur);
+        free(end);
+        *e = E_BAD_ALLOC;
+        return (Vector*)0;
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        cur[i] = vs[i]->data;
+        end[i] = (char*)vs[i]->data + vs[i]->size * es;
+    }
+
+    UTIL_ERR err = merge_arrays(out->data, cur, end, k, total, es, compare);
+    free(cur);
+    free(end);
+    if (err) {
+        vector_free(out);
+        *e = err;
+        return (Vector*)0;
+    }
+
+    out->size = total;
+    return out;
+}
+
+
+typedef struct {
+    const int32_t **cur;
+    const int32_t **end;
+    int (*compare)(const void*, const void*);
+} merge_i32_ctx;
+
+static bool merge_i32_less(void *ctx, size_t a, size_t b) {
+    merge_i32_ctx *m = ctx;
+    if (m->cur[a] == m->end[a]) return false;
+    if (m->cur[b] == m->end[b]) return true;
+    int32_t x = *m->cur[a], y = *m->cur[b];
+    int c = m->compare ? m->compare(&x, &y) : (x > y) - (x < y);
+    return c < 0 || (c == 0 && a < b);
+}
+
+
+Vec_i32 *vec_i32_merge_k(Vec_i32 *const *vs, size_t k, int (*compare)(const void*, const void*), UTIL_ERR *e) {
+    if (!vs || k == 0) {
+        *e = E_EMPTY_ARG;
+        return (Vec_i32*)0;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < k; i++) {
+        if (!vs[i]) {
+            *e = E_EMPTY_ARG;
+            return (Vec_i32*)0;
+        }
+        total += vs[i]->size;
+    }
+
+    Vec_i32 *out = vec_i32_new(total ? total : 1);
+    const int32_t **cur = malloc(sizeof(int32_t*) * k), **end = malloc(sizeof(int32_t*) * k);
+    if (!out || !cur || !end) {
+        vec_i32_free(out);
+        free(cur);
+        free(end);
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        cur[i] = vs[i]->data;
+        end[i] = vs[i]->data + vs[i]->size;
+    }
+
+    merge_i32_ctx ctx = { .cur = cur, .end = end, .compare = compare };
+    loser_tree lt;
+    if (!loser_tree_init(&lt, k, merge_i32_less, &ctx)) {
+        vec_i32_free(out);
+        free(cur);
+        free(end);
+        *e = E_BAD_ALLOC;
+        return (Vec_i32*)0;
+    }
+
+    for (size_t i = 0; i < total; i++) {
+        out->data[i] = *cur[lt.winner]++;
+        loser_tree_replay(&lt);
+    }
+    out->size = total;
+
+    loser_tree_free(&lt);
+    free(cur);
+    free(end);
+    return out;
+}
+
+
+typedef struct {
+    APUTIL_Node **cur;
+    int (*compare)(const void*, const void*);
+} merge_llist_ctx;
+
+static bool merge_llist_less(void *ctx, size_t a, size_t b) {
+    merge_llist_ctx *m = ctx;
+    if (!m->cur[a]) return false;
+    if (!m->cur[b]) return true;
+    int c = m->compare(m->cur[a]->data, m->cur[b]->data);
+    return c < 0 || (c == 0 && a < b);
+}
+
+
+APUTIL_LList *aputil_llist_merge_k(APUTIL_LList **lsts, size_t k, UTIL_ERR *e) {
+    if (!lsts || k == 0 || !lsts[0]) {
+        *e = E_EMPTY_ARG;
+        return (APUTIL_LList*)0;
+    }
+    if (!lsts[0]->compare) {
+        *e = E_EMPTY_FUNC;
+        return (APUTIL_LList*)0;
+    }
+    for (size_t i = 1; i < k; i++) {
+        if (!lsts[i]) {
+            *e = E_EMPTY_ARG;
+            return (APUTIL_LList*)0;
+        }
+    }
+
+    APUTIL_LList *merged = aputil_llist_new(lsts[0]->free, lsts[0]->copydata, lsts[0]->compare, "merged", e);
+    APUTIL_Node **cur = malloc(sizeof(APUTIL_Node*) * k);
+    if (!merged || !cur) {
+        aputil_llist_free(merged, true);
+        free(cur);
+        *e = E_BAD_ALLOC;
+        return (APUTIL_LList*)0;
+    }
+
+    for (size_t i = 0; i < k; i++) cur[i] = lsts[i]->head;
+
+    merge_llist_ctx ctx = { .cur = cur, .compare = lsts[0]->compare };
+    loser_tree lt;
+    if (!loser_tree_init(&lt, k, merge_llist_less, &ctx)) {
+        aputil_llist_free(merged, true);
+        free(cur);
+        *e = E_BAD_ALLOC;
+        return (APUTIL_LList*)0;
+    }
+
+    // relink the existing nodes, nothing is allocated per element
+    APUTIL_Node *tail = NULL;
+    while (cur[lt.winner]) {
+        APUTIL_Node *n = cur[lt.winner];
+        cur[lt.winner] = n->next;
+
+        n->prev = tail;
+        n->next = NULL;
+        if (tail) tail->next = n;
+        else merged->head = n;
+        tail = n;
+        merged->cnt++;
+
+        loser_tree_replay(&lt);
+    }
+    merged->tail = tail;
+
+    // the sources no longer own any nodes
+    for (size_t i = 0; i < k; i++) {
+        lsts[i]->head = lsts[i]->tail = NULL;
+        lsts[i]->cnt = 0;
+    }
+
+    loser_tree_free(&lt);
+    free(cur);
+    return merged;
+}
+
+// ############## K-WAY MERGE ##############
+
+
+// ############## PARALLEL MERGE SORT ##############
+    /*
+
+     stable merge sort expressed as fork-join tasks on the work-stealing
+     scheduler (src/sched.c)
+
+     psort(n):  spawn psort(left half), psort(right half), sync, pmerge
+     pmerge:    take the middle of the longer input, binary search its split
+                point in the other, spawn the two independent sub-merges
+     leaves:    below PSORT_GRAIN elements the TimSort from vector_stable_sort
+
+     data and one scratch buffer of the same size are used ping-pong: each
+     level merges from the buffer its children sorted into, to_b says which
+     buffer a task must leave its result in, so nothing is copied back
+
+     ties: the left input wins at every merge and both split searches keep
+     equal keys on the side they came from, so the sort is stable
+
+    */
+
+#define PSORT_GRAIN 4096            // elements sorted by a single task
+#define PMERGE_GRAIN 8192           // elements merged by a single task
+
+typedef struct {
+    size_t es;
+    int (*compare)(const void*, const void*);
+    bool deref;                     // elements are pointers to the compared data
+    _Atomic int err;
+} psort_cfg;
+
+typedef struct {
+    psort_cfg *cfg;
+    char *a;
+    char *b;
+    size_t n;
+    bool to_b;                      // leave the result in b instead of a
+} psort_args;
+
+typedef struct {
+    psort_cfg *cfg;
+    const char *a;
+    size_t na;
+    const char *b;
+    size_t nb;
+    char *out;
+} pmerge_args;
+
+
+// leaves sort through vector_stable_sort, which takes a plain compare
+static _Thread_local int (*tls_deref_compare)(const void*, const void*);
+
+static int deref_compare(const void *a, const void *b) {
+    return tls_deref_compare(*(void *const*)a, *(void *const*)b);
+}
+
+
+static inline int psort_cmp(const psort_cfg *c, const char *a, const char *b) {
+    return c->deref
+        ? c->compare(*(void *const*)a, *(void *const*)b)
+        : c->compare(a, b);
+}
+
+
+// first index in arr whose element is not less than key
+static size_t psort_lower(const psort_cfg *c, const char *arr, size_t n, const char *key) {
+    size_t lo = 0;
+    while (n) {
+        size_t half = n / 2;
+        if (psort_cmp(c, arr + (lo + half) * c->es, key) < 0) {
+            lo += half + 1;
+            n -= half + 1;
+        } else n = half;
+    }
+    return lo;
+}
+
+
+// first index in arr whose element is greater than key
+static size_t psort_upper(const psort_cfg *c, const char *arr, size_t n, const char *key) {
+    size_t lo = 0;
+    while (n) {
+        size_t half = n / 2;
+        if (psort_cmp(c, key, arr + (lo + half) * c->es) >= 0) {
+            lo += half + 1;
+            n -= half + 1;
+        } else n = half;
+    }
+    return lo;
+}
+
+
+static void pmerge_task(void *arg) {
+    pmerge_args *m = arg;
+    psort_cfg *c = m->cfg;
+    size_t es = c->es;
+
+    if (m->na + m->nb <= PMERGE_GRAIN) {
+        const char *a = m->a, *b = m->b;
+        size_t na = m->na, nb = m->nb;
+        char *out = m->out;
+        while (na && nb) {
+            if (psort_cmp(c, b, a) < 0) {
+                memcpy(out, b, es);
+                b += es;
+                nb--;
+            } else {
+                memcpy(out, a, es);
+                a += es;
+                na--;
+            }
+            out += es;
+        }
+        memcpy(out, a, na * es);
+        memcpy(out + na * es, b, nb * es);
+        return;
+    }
+
+    // equal keys stay behind a's pivot / before b's pivot
+    size_t i, j;
+    if (m->na >= m->nb) {
+        i = m->na / 2;
+        j = psort_lower(c, m->b, m->nb, m->a + i * es);
+    } else {
+        j = m->nb / 2;
+        i = psort_upper(c, m->a, m->na, m->b + j * es);
+    }
+
+    pmerge_args lo = { .cfg = c, .a = m->a, .na = i, .b = m->b, .nb = j, .out = m->out };
+    pmerge_args hi = {
+        .cfg = c, .a = m->a + i * es, .na = m->na - i, .b = m->b + j * es, .nb = m->nb - j,
+        .out = m->out + (i + j) * es
+    };
+    APUTIL_Sync g = APUTIL_SYNC_INIT;
+    sched_spawn(&g, pmerge_task, &lo);
+    pmerge_task(&hi);
+    sched_sync(&g);
+}
+
+
+static void psort_task(void *arg) {
+    psort_args *p = arg;
+    psort_cfg *c = p->cfg;
+    size_t es = c->es;
+
+    if (p->n <= PSORT_GRAIN) {
+        Vector leaf = { .data = p->a, .size = p->n, .cap = p->n, .elem_size = es };
+        UTIL_ERR err;
+        if (c->deref) {
+            tls_deref_compare = c->compare;
+            err = vector_stable_sort(&leaf, vector, deref_compare);
+        } else {
+            err = vector_stable_sort(&leaf, vector, c->compare);
+        }
+        if (err != E_SUCCESS) atomic_store(&c->err, err);
+        if (p->to_b) memcpy(p->b, p->a, p->n * es);
+        return;
+    }
+
+    size_t h = p->n / 2;
+    psort_args lo = { .cfg = c, .a = p->a, .b = p->b, .n = h, .to_b = !p->to_b };
+    psort_args hi = { .cfg = c, .a = p->a + h * es, .b = p->b + h * es, .n = p->n - h, .to_b = !p->to_b };
+    APUTIL_Sync g = APUTIL_SYNC_INIT;
+    sched_spawn(&g, psort_task, &lo);
+    psort_task(&hi);
+    sched_sync(&g);
+
+    // children left their halves in the other buffer
+    char *src = p->to_b ? p->a : p->b, *dst = p->to_b ? p->b : p->a;
+    pmerge_args m = { .cfg = c, .a = src, .na = h, .b = src + h * es, .nb = p->n - h, .out = dst };
+    pmerge_task(&m);
+}
+
+
+static UTIL_ERR psort(APUTIL_Sched *s, char *data, size_t n, psort_cfg *c) {
+    if (n < 2) return E_SUCCESS;
+
+    char *tmp = malloc(n * c->es);
+    if (!tmp) return E_BAD_ALLOC;
+
+    atomic_init(&c->err, E_SUCCESS);
+    psort_args root = { .cfg = c, .a = data, .b = tmp, .n = n, .to_b = false };
+    if (s) sched_run(s, psort_task, &root);
+    else psort_task(&root);
+
+    free(tmp);
+    return (UTIL_ERR)atomic_load(&c->err);
+}
+
+
+UTIL_ERR vector_sort_par(APUTIL_Sched *s, void *vec, VECTYPE type, int (*compare)(const void*, const void*)) {
+    if (!vec) return E_EMPTY_OBJ;
+    if (!compare) return E_EMPTY_FUNC;
+
+    psort_cfg c = { .compare = compare, .deref = false };
+    switch (type) {
+        case vector:
+            c.es = ((Vector*)vec)->elem_size;
+            return psort(s, ((Vector*)vec)->data, ((Vector*)vec)->size, &c);
+        case vec_i32:
+            c.es = sizeof(int32_t);
+            return psort(s, (char*)((Vec_i32*)vec)->data, ((Vec_i32*)vec)->size, &c);
+        case vec_char:
+            c.es = sizeof(char);
+            return psort(s, ((Vec_char*)vec)->data, ((Vec_char*)vec)->size, &c);
+        default:
+            return E_BAD_TYPE;
+    }
+}
+
+
+UTIL_ERR merge_sort_par(APUTIL_Sched *s, APUTIL_LList *lst) {
+    if (!lst) return E_EMPTY_OBJ;
+    if (!lst->compare) return E_EMPTY_FUNC;
+    if (lst->cnt < 2) return E_SUCCESS;
+
+    // sort the data pointers, then hand them back to the nodes in order
+    void **ptrs = malloc(sizeof(void*) * lst->cnt);
+    if (!ptrs) return E_BAD_ALLOC;
+    size_t n = 0;
+    for (APUTIL_Node *cur = lst->head; cur; cur = cur->next) ptrs[n++] = cur->data;
+
+    psort_cfg c = { .es = sizeof(void*), .compare = lst->compare, .deref = true };
+    UTIL_ERR err = psort(s, (char*)ptrs, n, &c);
+    if (err == E_SUCCESS) {
+        n = 0;
+        for (APUTIL_Node *cur = lst->head; cur; cur = cur->next) cur->data = ptrs[n++];
+    }
+
+    free(ptrs);
+    return err;
+}
+
+// ############## PARALLEL MERGE SORT ##############
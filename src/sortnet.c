@@ -0,0 +1,335 @@
+/*
+ *  sorting networks
+ *  fixed compare-exchange sequences for small arrays of integer keys
+ *      > scalar: Batcher odd-even merge networks, one instance per size up
+ *        to 32 so the compiler can unroll them, compare-exchange is min/max
+ *        (cmov), no data dependent branches
+ *      > AVX2: bitonic network in registers for 9 to SORTNET_MAX elements,
+ *        input padded to a power of two with the type's maximum. beats the
+ *        scalar networks from 16 elements on, so with AVX2 only the tiny
+ *        sizes stay scalar
+ *      > batched entry points sort many independent segments in one call
+ *        and skip the per call qsort setup
+ *
+ *  scalar networks (i32, u32, i64, u64)
+ *  AVX2 bitonic (x86 only, picked at run time)
+ *  dispatch / vector wrappers
+ */
+
+#include "../include/aputils_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SORTNET_X86 1
+#else
+#define SORTNET_X86 0
+#endif
+
+
+// ############## SCALAR NETWORKS ##############
+    /*
+
+     Batcher odd-even merge sort in Knuth's iterative form. comparators that
+     would reach past n are dropped, which is the same as padding with +inf,
+     so the network is valid for any n and needs no copy.
+
+     which comparators run only depends on the indices, the element values
+     only feed min/max
+
+    */
+
+#define SN_NETWORK(T, SFX)                                                          \
+static inline __attribute__((always_inline)) void batcher_##SFX(T *d, size_t n) {   \
+    for (size_t p = 1; p < n; p <<= 1) {                                            \
+        for (size_t k = p; k >= 1; k >>= 1) {                                       \
+            for (size_t j = k % p; j + k < n; j += 2 * k) {                         \
+                size_t lim = k < n - j - k ? k : n - j - k;                         \
+                for (size_t i = 0; i < lim; i++) {                                  \
+                    if (((i + j) ^ (i + j + k)) >= 2 * p) continue;  /* other block */ \
+                    T x = d[i + j], y = d[i + j + k];                               \
+                    d[i + j] = x < y ? x : y;                                       \
+                    d[i + j + k] = x < y ? y : x;                                   \
+                }                                                                   \
+            }                                                                       \
+        }                                                                           \
+    }                                                                               \
+}                                                                                   \
+                                                                                    \
+static int cmp_##SFX(const void *a, const void *b) {                                \
+    T x = *(const T*)a, y = *(const T*)b;                                           \
+    return (x > y) - (x < y);                                                       \
+}
+
+SN_NETWORK(int32_t, i32)
+SN_NETWORK(uint32_t, u32)
+SN_NETWORK(int64_t, i64)
+SN_NETWORK(uint64_t, u64)
+
+
+// one unrolled network per size, larger sizes run the generic loop
+#define SN_CASE(SFX, N) case N: batcher_##SFX(d, N); break;
+#define SN_SIZED(T, SFX)                                                            \
+static void net_##SFX(T *d, size_t n) {                                             \
+    switch (n) {                                                                    \
+        SN_CASE(SFX, 2)  SN_CASE(SFX, 3)  SN_CASE(SFX, 4)  SN_CASE(SFX, 5)          \
+        SN_CASE(SFX, 6)  SN_CASE(SFX, 7)  SN_CASE(SFX, 8)  SN_CASE(SFX, 9)          \
+        SN_CASE(SFX, 10) SN_CASE(SFX, 11) SN_CASE(SFX, 12) SN_CASE(SFX, 13)         \
+        SN_CASE(SFX, 14) SN_CASE(SFX, 15) SN_CASE(SFX, 16) SN_CASE(SFX, 17)         \
+        SN_CASE(SFX, 18) SN_CASE(SFX, 19) SN_CASE(SFX, 20) SN_CASE(SFX, 21)         \
+        SN_CASE(SFX, 22) SN_CASE(SFX, 23) SN_CASE(SFX, 24) SN_CASE(SFX, 25)         \
+        SN_CASE(SFX, 26) SN_CASE(SFX, 27) SN_CASE(SFX, 28) SN_CASE(SFX, 29)         \
+        SN_CASE(SFX, 30) SN_CASE(SFX, 31) SN_CASE(SFX, 32)                          \
+        default: batcher_##SFX(d, n);                                               \
+    }                                                                               \
+}
+
+SN_SIZED(int32_t, i32)
+SN_SIZED(uint32_t, u32)
+SN_SIZED(int64_t, i64)
+SN_SIZED(uint64_t, u64)
+
+// ############## SCALAR NETWORKS ##############
+
+
+// ############## AVX2 BITONIC ##############
+    /*
+
+     bitonic sort over p = 16 ... 256 elements. stage (k, j) pairs
+     element i with i ^ j, the pair is ascending when (i & k) == 0
+
+     j >= lanes: partners sit in different registers, whole registers are
+                 min/max'ed and the direction is the same for every lane
+     j <  lanes: partners sit in the same register, one permute brings the
+                 partner over and a per lane mask picks min or max
+
+     AVX2 has no 64-bit min/max, those go through cmpgt + blend, unsigned
+     keys are compared with the sign bit flipped
+
+    */
+
+#if SORTNET_X86
+
+#define BITONIC_AVX2_32(T, SFX, MIN, MAX)                                           \
+__attribute__((target("avx2")))                                                     \
+static void bitonic_avx2_##SFX(T *d, size_t p) {                                    \
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);                 \
+    for (size_t k = 2; k <= p; k <<= 1) {                                           \
+        for (size_t j = k >> 1; j > 0; j >>= 1) {                                   \
+            if (j >= 8) {                                                           \
+                for (size_t b = 0; b < p; b += 2 * j) {                             \
+                    for (size_t o = b; o < b + j; o += 8) {                         \
+                        __m256i x = _mm256_loadu_si256((__m256i*)(d + o));          \
+                        __m256i y = _mm256_loadu_si256((__m256i*)(d + o + j));      \
+                        __m256i lo = MIN(x, y), hi = MAX(x, y);                     \
+                        if (o & k) { __m256i t = lo; lo = hi; hi = t; }             \
+                        _mm256_storeu_si256((__m256i*)(d + o), lo);                 \
+                        _mm256_storeu_si256((__m256i*)(d + o + j), hi);             \
+                    }                                                               \
+                }                                                                   \
+                continue;                                                           \
+            }                                                                       \
+            const __m256i jv = _mm256_set1_epi32((int)j), kv = _mm256_set1_epi32((int)k); \
+            const __m256i perm = _mm256_xor_si256(lane, jv);                        \
+            for (size_t o = 0; o < p; o += 8) {                                     \
+                __m256i idx = _mm256_add_epi32(_mm256_set1_epi32((int)o), lane);    \
+                __m256i upper = _mm256_cmpeq_epi32(_mm256_and_si256(idx, jv), jv);  \
+                __m256i desc = _mm256_cmpeq_epi32(_mm256_and_si256(idx, kv), kv);   \
+                __m256i x = _mm256_loadu_si256((__m256i*)(d + o));                  \
+                __m256i y = _mm256_permutevar8x32_epi32(x, perm);                   \
+                __m256i r = _mm256_blendv_epi8(MIN(x, y), MAX(x, y), _mm256_xor_si256(upper, desc)); \
+                _mm256_storeu_si256((__m256i*)(d + o), r);                          \
+            }                                                                       \
+        }                                                                           \
+    }                                                                               \
+}
+
+BITONIC_AVX2_32(int32_t, i32, _mm256_min_epi32, _mm256_max_epi32)
+BITONIC_AVX2_32(uint32_t, u32, _mm256_min_epu32, _mm256_max_epu32)
+
+
+// x > y per 64-bit lane, bias flips the sign bit for unsigned keys
+__attribute__((target("avx2")))
+static inline __m256i gt_epi64(__m256i x, __m256i y, __m256i bias) {
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(x, bias), _mm256_xor_si256(y, bias));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i swap_pairs_epi64(__m256i x, size_t j) {
+    return j == 1 ? _mm256_permute4x64_epi64(x, 0xB1) : _mm256_permute4x64_epi64(x, 0x4E);
+}
+
+__attribute__((target("avx2")))
+static void bitonic_avx2_64(uint64_t *d, size_t p, bool is_signed) {
+    const __m256i bias = _mm256_set1_epi64x(is_signed ? 0 : (long long)0x8000000000000000ull);
+    const __m256i lane = _mm256_setr_epi64x(0, 1, 2, 3);
+    for (size_t k = 2; k <= p; k <<= 1) {
+        for (size_t j = k >> 1; j > 0; j >>= 1) {
+            if (j >= 4) {
+                for (size_t b = 0; b < p; b += 2 * j) {
+                    for (size_t o = b; o < b + j; o += 4) {
+                        __m256i x = _mm256_loadu_si256((__m256i*)(d + o));
+                        __m256i y = _mm256_loadu_si256((__m256i*)(d + o + j));
+                        __m256i gt = gt_epi64(x, y, bias);
+                        __m256i lo = _mm256_blendv_epi8(x, y, gt), hi = _mm256_blendv_epi8(y, x, gt);
+                        if (o & k) { __m256i t = lo; lo = hi; hi = t; }
+                        _mm256_storeu_si256((__m256i*)(d + o), lo);
+                        _mm256_storeu_si256((__m256i*)(d + o + j), hi);
+                    }
+                }
+                continue;
+            }
+            const __m256i jv = _mm256_set1_epi64x((long long)j), kv = _mm256_set1_epi64x((long long)k);
+            for (size_t o = 0; o < p; o += 4) {
+                __m256i idx = _mm256_add_epi64(_mm256_set1_epi64x((long long)o), lane);
+                __m256i upper = _mm256_cmpeq_epi64(_mm256_and_si256(idx, jv), jv);
+                __m256i desc = _mm256_cmpeq_epi64(_mm256_and_si256(idx, kv), kv);
+                __m256i x = _mm256_loadu_si256((__m256i*)(d + o));
+                __m256i y = swap_pairs_epi64(x, j);
+                __m256i gt = gt_epi64(x, y, bias);
+                __m256i lo = _mm256_blendv_epi8(x, y, gt), hi = _mm256_blendv_epi8(y, x, gt);
+                _mm256_storeu_si256((__m256i*)(d + o), _mm256_blendv_epi8(lo, hi, _mm256_xor_si256(upper, desc)));
+            }
+        }
+    }
+}
+
+#endif
+
+// ############## AVX2 BITONIC ##############
+
+
+// ############## DISPATCH ##############
+
+// pad to a power of two with the maximum key, sort, copy back the first n
+#define SN_PADDED(T, SFX, MAXV, SORT)                                               \
+static void padded_##SFX(T *d, size_t n) {                                          \
+    _Alignas(32) T buf[SORTNET_MAX];                                                \
+    size_t p = pow2_at_least(n);                                                    \
+    memcpy(buf, d, n * sizeof(T));                                                  \
+    for (size_t i = n; i < p; i++) buf[i] = MAXV;                                   \
+    SORT;                                                                           \
+    memcpy(d, buf, n * sizeof(T));                                                  \
+}
+
+#if SORTNET_X86
+static size_t pow2_at_least(size_t n) {
+    size_t p = 16;      // smallest network filling two 32-bit registers
+    while (p < n) p <<= 1;
+    return p;
+}
+
+SN_PADDED(int32_t, i32, INT32_MAX, bitonic_avx2_i32(buf, p))
+SN_PADDED(uint32_t, u32, UINT32_MAX, bitonic_avx2_u32(buf, p))
+SN_PADDED(int64_t, i64, INT64_MAX, bitonic_avx2_64((uint64_t*)buf, p, true))
+SN_PADDED(uint64_t, u64, UINT64_MAX, bitonic_avx2_64(buf, p, false))
+#endif
+
+
+// above this the padded AVX2 network beats the scalar one
+#define SORTNET_SCALAR_AVX2 8
+
+#define SN_SORT_ONE(T, SFX)                                                         \
+static void sort_one_##SFX(T *d, size_t n, bool avx2) {                             \
+    if (n < 2) return;                                                              \
+    if (n > SORTNET_MAX) qsort(d, n, sizeof(T), cmp_##SFX);                         \
+    else if (avx2 && n > SORTNET_SCALAR_AVX2) padded_##SFX(d, n);                   \
+    else if (n <= 32) net_##SFX(d, n);                                              \
+    else batcher_##SFX(d, n);                                                       \
+}
+
+#if !SORTNET_X86
+// never called without AVX2 support
+#define padded_i32(d, n) batcher_i32(d, n)
+#define padded_u32(d, n) batcher_u32(d, n)
+#define padded_i64(d, n) batcher_i64(d, n)
+#define padded_u64(d, n) batcher_u64(d, n)
+#endif
+
+SN_SORT_ONE(int32_t, i32)
+SN_SORT_ONE(uint32_t, u32)
+SN_SORT_ONE(int64_t, i64)
+SN_SORT_ONE(uint64_t, u64)
+
+
+static void sort_one(void *data, size_t n, SNTYPE type, bool avx2) {
+    switch (type) {
+        case sn_i32: sort_one_i32(data, n, avx2); break;
+        case sn_u32: sort_one_u32(data, n, avx2); break;
+        case sn_i64: sort_one_i64(data, n, avx2); break;
+        case sn_u64: sort_one_u64(data, n, avx2); break;
+        default: break;
+    }
+}
+
+
+static size_t sn_elem_size(SNTYPE type) {
+    switch (type) {
+        case sn_i32:
+        case sn_u32: return 4;
+        case sn_i64:
+        case sn_u64: return 8;
+        default: return 0;
+    }
+}
+
+
+UTIL_ERR sortnet_sort(void *data, size_t n, SNTYPE type) {
+    if (!data) return E_EMPTY_OBJ;
+    if (!sn_elem_size(type)) return E_BAD_TYPE;
+
+    sort_one(data, n, type, aputil_have_avx2());
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR sortnet_sort_segments(void *data, const size_t *bounds, size_t nseg, SNTYPE type) {
+    if (!data) return E_EMPTY_OBJ;
+    if (!bounds) return E_EMPTY_ARG;
+    size_t es = sn_elem_size(type);
+    if (!es) return E_BAD_TYPE;
+
+    for (size_t i = 0; i < nseg; i++) {
+        if (bounds[i] > bounds[i + 1]) return E_OUTOFBOUNDS;
+    }
+
+    // one cpu check for the whole batch
+    bool avx2 = aputil_have_avx2();
+    char *base = data;
+    for (size_t i = 0; i < nseg; i++) {
+        sort_one(base + bounds[i] * es, bounds[i + 1] - bounds[i], type, avx2);
+    }
+
+    return E_SUCCESS;
+}
+
+
+UTIL_ERR vec_i32_sort_net(Vec_i32 *v) {
+    if (!v) return E_EMPTY_OBJ;
+    return sortnet_sort(v->data, v->size, sn_i32);
+}
+
+
+UTIL_ERR vec_i32_sort_segments(Vec_i32 *v, const size_t *bounds, size_t nseg) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!bounds) return E_EMPTY_ARG;
+    if (nseg && bounds[nseg] > v->size) return E_OUTOFBOUNDS;
+    return sortnet_sort_segments(v->data, bounds, nseg, sn_i32);
+}
+
+
+UTIL_ERR vector_sort_net(Vector *v, SNTYPE type) {
+    if (!v) return E_EMPTY_OBJ;
+    if (v->elem_size != sn_elem_size(type)) return E_BAD_TYPE;
+    return sortnet_sort(v->data, v->size, type);
+}
+
+
+UTIL_ERR vector_sort_segments(Vector *v, SNTYPE type, const size_t *bounds, size_t nseg) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!bounds) return E_EMPTY_ARG;
+    if (v->elem_size != sn_elem_size(type)) return E_BAD_TYPE;
+    if (nseg && bounds[nseg] > v->size) return E_OUTOFBOUNDS;
+    return sortnet_sort_segments(v->data, bounds, nseg, type);
+}
+
+// ############## DISPATCH ##############
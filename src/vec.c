@@ -6,10 +6,17 @@
  * 
  *  i32 vector
  *  char vector (bytes), also a poor man's string
+ *
+ *  storage
+ *      > Vector and Vec_i32 carry a Vec_alloc: data can be aligned (posix_memalign)
+ *        and, once large, huge page aligned with a MADV_HUGEPAGE hint
+ *      > growth and copies keep the alignment, aligned data is grown by
+ *        alloc + copy since realloc doesn't preserve it
  *      
  *      ToDo:
  */
 
+#include <sys/mman.h>
 #include "../include/aputils.h"
 
 
@@ -20,19 +27,76 @@ static void vector_fatal(const char* err) {
 
 
 
+// ###################### STORAGE ######################
+
+// posix_memalign only takes powers of two, anything else is refused up front
+static bool align_ok(const Vec_alloc *a) {
+    return !a || !(a->align & (a->align - 1));
+}
+
+
+// alignment needed for bytes of data, 0 when malloc will do
+static size_t data_align(const Vec_alloc *a, size_t bytes) {
+    if (!a) return 0;
+    size_t align = a->align;
+    if (a->huge && bytes >= VEC_HUGE_MIN && align < VEC_HUGE_MIN) align = VEC_HUGE_MIN;
+    if (align && align < sizeof(void*)) align = sizeof(void*);
+    return align;
+}
+
+
+void *vec_data_alloc(const Vec_alloc *a, size_t bytes) {
+    if (!align_ok(a)) return NULL;
+    size_t align = data_align(a, bytes);
+    if (!align) return malloc(bytes);
+
+    void *data;
+    if (posix_memalign(&data, align, bytes ? bytes : 1)) return NULL;
+#ifdef MADV_HUGEPAGE
+    // only a hint, without THP support the data simply stays on small pages
+    if (a->huge && bytes >= VEC_HUGE_MIN) madvise(data, bytes, MADV_HUGEPAGE);
+#endif
+    return data;
+}
+
+
+void *vec_data_realloc(const Vec_alloc *a, void *data, size_t old_bytes, size_t bytes) {
+    if (!align_ok(a)) return NULL;
+    if (!data_align(a, bytes)) return realloc(data, bytes);
+
+    void *grown = vec_data_alloc(a, bytes);
+    if (!grown) return NULL;
+    memcpy(grown, data, old_bytes < bytes ? old_bytes : bytes);
+    free(data);
+    return grown;
+}
+
+// ###################### STORAGE ######################
+
+
+
 // ###################### GENERIC VECTOR ######################
 
 Vector *vector_new(size_t elem_size, size_t cap) {
+    return vector_new_opts(elem_size, cap, NULL);
+}
+
+
+Vector *vector_new_opts(size_t elem_size, size_t cap, const Vec_alloc *a) {
     if (elem_size < 1 || cap < 1) {
         return (Vector*)0;  // caller checks NULL
     }
+    if (!align_ok(a)) {
+        return (Vector*)0;
+    }
 
     Vector *new_vec = malloc(sizeof(*new_vec));
     if (!new_vec) {
         return (Vector*)0;
     }
 
-    new_vec->data = malloc(elem_size * cap);
+    new_vec->alloc = a ? *a : (Vec_alloc){0};
+    new_vec->data = vec_data_alloc(&new_vec->alloc, elem_size * cap);
     if (!new_vec->data) {
         free(new_vec);
         return (Vector*)0;
@@ -58,31 +122,67 @@ static void vector_resize(Vector *v) {
     if (!v) return;
     if (v->size < v->cap) return;
     
+    size_t old_bytes = v->cap * v->elem_size;
     v->cap *= 2;
-    v->data = realloc(v->data, v->cap * v->elem_size);
+    v->data = vec_data_realloc(&v->alloc, v->data, old_bytes, v->cap * v->elem_size);
     if (!v->data) {
         vector_fatal("failed to realloc vector");
     }
 }
 
 
+// grow capacity (doubling) to hold at least need elements, false if the alloc fails
+static bool vector_reserve(Vector *v, size_t need) {
+    if (need <= v->cap) return true;
+    if (need > SIZE_MAX / v->elem_size) return false;
+
+    size_t cap = v->cap;
+    while (cap < need) cap = cap > SIZE_MAX / 2 ? need : cap * 2;
+    void *data = vec_data_realloc(&v->alloc, v->data, v->cap * v->elem_size, cap * v->elem_size);
+    if (!data) return false;
+    v->data = data;
+    v->cap = cap;
+    return true;
+}
+
+
 Vector *vector_copy(const Vector *v) {
-    Vector *new_vec = vector_new(v->elem_size, v->cap);
+    Vector *new_vec = vector_new_opts(v->elem_size, v->cap, &v->alloc);
     if (!new_vec) return (Vector*)0;
 
-    for (size_t i = 0; i<v->size; i++) {
-        if (!memcpy(
-            (char*)new_vec->data + i * new_vec->elem_size,
-            (char*)v->data + i * new_vec->elem_size,
-            new_vec->elem_size
-        )) vector_fatal("failed to copy vector");
-    }
+    memcpy(new_vec->data, v->data, v->size * v->elem_size);
     new_vec->size = v->size;
 
     return new_vec;
 }
 
 
+Vector *vector_from_array(const void *arr, size_t n, size_t elem_size) {
+    if (!arr && n) return (Vector*)0;   // caller checks NULL
+
+    Vector *new_vec = vector_new(elem_size, n ? n : 1);
+    if (!new_vec) return (Vector*)0;
+
+    if (n) memcpy(new_vec->data, arr, n * elem_size);
+    new_vec->size = n;
+
+    return new_vec;
+}
+
+
+UTIL_ERR vector_append_array(Vector *v, const void *arr, size_t n) {
+    if (!v) return E_EMPTY_OBJ;
+    if (n == 0) return E_SUCCESS;
+    if (!arr) return E_EMPTY_ARG;
+    if (v->size + n < v->size || !vector_reserve(v, v->size + n)) return E_BAD_ALLOC;
+
+    memcpy((char*)v->data + v->size * v->elem_size, arr, n * v->elem_size);
+    v->size += n;
+
+    return E_SUCCESS;
+}
+
+
 
 UTIL_ERR vector_add_back(Vector *v, void *elem) {
     if (!v) return E_EMPTY_OBJ;
@@ -256,10 +356,10 @@ Vector *vector_filter(const Vector *v, bool(*filter)(void*), UTIL_ERR *e) {
         return (Vector*)0;
     }
 
-    UTIL_ERR err = E_SUCCESS, e_get = E_SUCCESS;
+    UTIL_ERR err = E_SUCCESS;
     for (size_t i = 0; i<v->size; i++) {
-        if (filter(vector_get(v, i, &e_get))) {
-            err = vector_add_back(new_vec, vector_get(v, i, &e_get));
+        if (filter(vector_at(v, i))) {
+            err = vector_add_back(new_vec, vector_at(v, i));
             if (err != E_SUCCESS) {
                 *e = err;
                 vector_free(new_vec);
@@ -273,6 +373,19 @@ Vector *vector_filter(const Vector *v, bool(*filter)(void*), UTIL_ERR *e) {
 }
 
 
+UTIL_ERR vector_reduce(const Vector *v, void *acc, void (*reduce)(void *acc, const void *elem)) {
+    if (!v) return E_EMPTY_OBJ;
+    if (!reduce) return E_EMPTY_FUNC;
+    if (!acc) return E_EMPTY_ARG;
+
+    for (size_t i = 0; i < v->size; i++) {
+        reduce(acc, (char*)v->data + i * v->elem_size);
+    }
+
+    return E_SUCCESS;
+}
+
+
 intmax_t vector_in(const Vector *v, void *elem, bool(*equal)(void*, void*), UTIL_ERR *e) {
     if (!v) {
         *e = E_EMPTY_OBJ;
@@ -289,10 +402,8 @@ intmax_t vector_in(const Vector *v, void *elem, bool(*equal)(void*, void*), UTIL
         return -1;
     }
 
-    UTIL_ERR err_get = E_SUCCESS;
     for (size_t i = 0; i < v->size; i++) {
-        void *cmp_elem = vector_get(v, i, &err_get);
-        if (err_get != E_SUCCESS) continue;
+        void *cmp_elem = vector_at(v, i);
         if (equal(elem, cmp_elem)) return i;
     }
 
@@ -353,16 +464,25 @@ UTIL_ERR vector_reverse(Vector *v) {
 // ###################### i32 VECTOR ######################
 
 Vec_i32 *vec_i32_new(size_t cap) {
+    return vec_i32_new_opts(cap, NULL);
+}
+
+
+Vec_i32 *vec_i32_new_opts(size_t cap, const Vec_alloc *a) {
     if (cap < 1) {
         return (Vec_i32*)0;  // caller checks NULL
     }
+    if (!align_ok(a)) {
+        return (Vec_i32*)0;
+    }
 
     Vec_i32 *new_vec = malloc(sizeof(*new_vec));
     if (!new_vec) {
         return (Vec_i32*)0;
     }
 
-    new_vec->data = malloc(sizeof(int32_t) * cap);
+    new_vec->alloc = a ? *a : (Vec_alloc){0};
+    new_vec->data = vec_data_alloc(&new_vec->alloc, sizeof(int32_t) * cap);
     if (!new_vec->data) {
         free(new_vec);
         return (Vec_i32*)0;
@@ -387,21 +507,34 @@ static void vec_i32_resize(Vec_i32 *v) {
     if (!v) return;
     if (v->size < v->cap) return;
     
+    size_t old_bytes = v->cap * sizeof(int32_t);
     v->cap *= 2;
-    v->data = realloc(v->data, v->cap * sizeof(int32_t));
+    v->data = vec_data_realloc(&v->alloc, v->data, old_bytes, v->cap * sizeof(int32_t));
     if (!v->data) {
         vector_fatal("failed to realloc vector");
     }
 }
 
 
+static bool vec_i32_reserve(Vec_i32 *v, size_t need) {
+    if (need <= v->cap) return true;
+    if (need > SIZE_MAX / sizeof(int32_t)) return false;
+
+    size_t cap = v->cap;
+    while (cap < need) cap = cap > SIZE_MAX / 2 ? need : cap * 2;
+    int32_t *data = vec_data_realloc(&v->alloc, v->data, v->cap * sizeof(int32_t), cap * sizeof(int32_t));
+    if (!data) return false;
+    v->data = data;
+    v->cap = cap;
+    return true;
+}
+
+
 Vec_i32 *vec_i32_copy(const Vec_i32 *v) {
-    Vec_i32 *new_vec = vec_i32_new(v->cap);
+    Vec_i32 *new_vec = vec_i32_new_opts(v->cap, &v->alloc);
     if (!new_vec) return (Vec_i32*)0;
 
-    for (size_t i = 0; i<v->size; i++) {
-        new_vec->data[i] = v->data[i];
-    }
+    memcpy(new_vec->data, v->data, v->size * sizeof(int32_t));
     new_vec->size = v->size;
 
     return new_vec;
@@ -419,6 +552,19 @@ UTIL_ERR vec_i32_add_back(Vec_i32 *v, int32_t elem) {
 }
 
 
+UTIL_ERR vec_i32_append_n(Vec_i32 *v, const int32_t *arr, size_t n) {
+    if (!v) return E_EMPTY_OBJ;
+    if (n == 0) return E_SUCCESS;
+    if (!arr) return E_EMPTY_ARG;
+    if (v->size + n < v->size || !vec_i32_reserve(v, v->size + n)) return E_BAD_ALLOC;
+
+    memcpy(v->data + v->size, arr, n * sizeof(int32_t));
+    v->size += n;
+
+    return E_SUCCESS;
+}
+
+
 UTIL_ERR vec_i32_add_front(Vec_i32 *v, int32_t elem) {
     if (!v) return E_EMPTY_OBJ;
     if (!elem) return E_EMPTY_ARG;
@@ -557,10 +703,10 @@ Vec_i32 *vec_i32_filter(const Vec_i32 *v, bool(*filter)(int32_t), UTIL_ERR *e) {
         return (Vec_i32*)0;
     }
 
-    UTIL_ERR err = E_SUCCESS, e_get = E_SUCCESS;
+    UTIL_ERR err = E_SUCCESS;
     for (size_t i = 0; i<v->size; i++) {
-        if (filter(vec_i32_get(v, i, &e_get))) {
-            err = vec_i32_add_back(new_vec, vec_i32_get(v, i, &e_get));
+        if (filter(vec_i32_at(v, i))) {
+            err = vec_i32_add_back(new_vec, vec_i32_at(v, i));
             if (err != E_SUCCESS) {
                 *e = err;
                 vec_i32_free(new_vec);
@@ -579,10 +725,8 @@ intmax_t vec_i32_in(const Vec_i32 *v, int32_t elem, bool(*equal)(int32_t, int32_
         return -1;
     }
 
-    UTIL_ERR err_get = E_SUCCESS;
     for (size_t i = 0; i < v->size; i++) {
-        int32_t cmp_elem = vec_i32_get(v, i, &err_get);
-        if (err_get != E_SUCCESS) continue;
+        int32_t cmp_elem = vec_i32_at(v, i);
 
         if (!equal) {
             if (elem == cmp_elem) return i;  // default int compare if no function passed
@@ -668,13 +812,25 @@ static void vec_char_resize(Vec_char *v) {
 }
 
 
+static bool vec_char_reserve(Vec_char *v, size_t need) {
+    if (need <= v->cap) return true;
+    if (need > SIZE_MAX / sizeof(char)) return false;
+
+    size_t cap = v->cap;
+    while (cap < need) cap = cap > SIZE_MAX / 2 ? need : cap * 2;
+    char *data = realloc(v->data, cap * sizeof(char));
+    if (!data) return false;
+    v->data = data;
+    v->cap = cap;
+    return true;
+}
+
+
 Vec_char *vec_char_copy(const Vec_char *v) {
     Vec_char *new_vec = vec_char_new(v->cap);
     if (!new_vec) return (Vec_char*)0;
 
-    for (size_t i = 0; i<v->size; i++) {
-        new_vec->data[i] = v->data[i];
-    }
+    memcpy(new_vec->data, v->data, v->size * sizeof(char));
     new_vec->size = v->size;
 
     return new_vec;
@@ -692,6 +848,19 @@ UTIL_ERR vec_char_add_back(Vec_char *v, char elem) {
 }
 
 
+UTIL_ERR vec_char_append_n(Vec_char *v, const char *arr, size_t n) {
+    if (!v) return E_EMPTY_OBJ;
+    if (n == 0) return E_SUCCESS;
+    if (!arr) return E_EMPTY_ARG;
+    if (v->size + n < v->size || !vec_char_reserve(v, v->size + n)) return E_BAD_ALLOC;
+
+    memcpy(v->data + v->size, arr, n * sizeof(char));
+    v->size += n;
+
+    return E_SUCCESS;
+}
+
+
 UTIL_ERR vec_char_add_front(Vec_char *v, char elem) {
     if (!v) return E_EMPTY_OBJ;
     if (!elem) return E_EMPTY_ARG;
@@ -830,10 +999,10 @@ Vec_char *vec_char_filter(const Vec_char *v, bool(*mapfunc)(char), UTIL_ERR *e)
         return (Vec_char*)0;
     }
 
-    UTIL_ERR err = E_SUCCESS, e_get = E_SUCCESS;
+    UTIL_ERR err = E_SUCCESS;
     for (size_t i = 0; i<v->size; i++) {
-        if (mapfunc(vec_char_get(v, i, &e_get))) {
-            err = vec_char_add_back(new_vec, vec_char_get(v, i, &e_get));
+        if (mapfunc(vec_char_at(v, i))) {
+            err = vec_char_add_back(new_vec, vec_char_at(v, i));
             if (err != E_SUCCESS) {
                 *e = err;
                 vec_char_free(new_vec);
@@ -852,10 +1021,8 @@ intmax_t vec_char_in(const Vec_char *v, char elem, bool(*mapfunc)(char, char), U
         return -1;
     }
 
-    UTIL_ERR err_get = E_SUCCESS;
     for (size_t i = 0; i < v->size; i++) {
-        char cmp_elem = vec_char_get(v, i, &err_get);
-        if (err_get != E_SUCCESS) continue;
+        char cmp_elem = vec_char_at(v, i);
 
         if (!mapfunc) {
             if (elem == cmp_elem) return i;  // default char compare if no function passed
@@ -0,0 +1,366 @@
+/*
+ *    test src/art.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+typedef struct {
+    unsigned char bytes[64];
+    size_t len;
+} skey;
+
+static size_t freed;
+static void count_free(void *d) {
+    freed++;
+    free(d);
+}
+
+static int64_t *boxed(int64_t x) {
+    int64_t *p = malloc(sizeof(*p));
+    *p = x;
+    return p;
+}
+
+// byte order, shorter first on a tie
+static int cmp_bytes(const void *a, size_t na, const void *b, size_t nb) {
+    int c = memcmp(a, b, na < nb ? na : nb);
+    if (c) return c;
+    return (na > nb) - (na < nb);
+}
+
+static int cmp_skey(const void *a, const void *b) {
+    const skey *x = a, *y = b;
+    return cmp_bytes(x->bytes, x->len, y->bytes, y->len);
+}
+
+/*
+    keys that share a lot: a few letters and zero bytes, some behind a
+    prefix longer than ART_PREFIX_MAX, some prefixes of others
+*/
+static skey random_key(void) {
+    static const char *stems[] = { "", "a", "https://example.com/some/path/", "ab\0cd\0ef\0gh\0ij\0kl\0mn" };
+    skey k;
+    int s = rand() % 4;
+    size_t stem = s == 3 ? 20 : strlen(stems[s]);
+    memcpy(k.bytes, stems[s], stem);
+    k.len = stem + (size_t)(rand() % 6);
+    for (size_t i = stem; i<k.len; i++) k.bytes[i] = "ab\0z"[rand() % 4];
+    return k;
+}
+
+typedef struct {
+    skey *keys;
+    size_t n;
+    bool ordered;
+} collect;
+
+static void collect_visit(const void *key, size_t len, void *data, void *arg) {
+    collect *c = arg;
+    (void)data;
+    if (c->n) c->ordered &= cmp_bytes(c->keys[c->n - 1].bytes, c->keys[c->n - 1].len, key, len) < 0;
+    memcpy(c->keys[c->n].bytes, key, len);
+    c->keys[c->n++].len = len;
+}
+
+static void count_visit(const void *key, size_t len, void *data, void *arg) {
+    (void)key;
+    (void)len;
+    (void)data;
+    (*(size_t*)arg)++;
+}
+
+
+//################ Put / get / remove ################
+void test_function_art_random(void) {
+
+    // reference: an unsorted array of the keys in the tree
+    enum { MAXKEYS = 4096 };
+    static skey ref[MAXKEYS];
+    static skey seen[MAXKEYS];
+    size_t n = 0;
+
+    freed = 0;
+    Art *t = art_new(count_free);
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_NULL(art_get(t, "a", 1));
+
+    for (size_t step = 0; step<60000; step++) {
+        skey k = random_key();
+        size_t at = 0;
+        while (at < n && cmp_skey(&ref[at], &k)) at++;
+
+        if (rand() % 3 && n < MAXKEYS) {
+            int64_t *d = boxed((int64_t)k.len);
+            TEST_ASSERT_TRUE(art_put(t, k.bytes, k.len, d) == (at < n ? E_NOOP : E_SUCCESS));
+            if (at == n) ref[n++] = k;
+        } else {
+            TEST_ASSERT_TRUE(art_remove(t, k.bytes, k.len, false) == (at < n ? E_SUCCESS : E_DOESNT_EXIST));
+            if (at < n) ref[at] = ref[--n];
+        }
+        TEST_ASSERT_TRUE(t->size == n);
+
+        if (step % 5000 == 0) {
+            for (size_t i = 0; i<n; i++) {
+                int64_t *p = art_get(t, ref[i].bytes, ref[i].len);
+                TEST_ASSERT_TRUE(p && *p == (int64_t)ref[i].len);
+            }
+        }
+    }
+
+    // in order, same keys as the reference sorted
+    collect c = { .keys = seen, .n = 0, .ordered = true };
+    TEST_ASSERT_TRUE(art_prefix_iter(t, NULL, 0, collect_visit, &c) == n);
+    TEST_ASSERT_TRUE(c.ordered);
+    qsort(ref, n, sizeof(skey), cmp_skey);
+    for (size_t i = 0; i<n; i++) TEST_ASSERT_TRUE(cmp_skey(&ref[i], &seen[i]) == 0);
+
+    // every prefix of every key: the count under it and the longest stored prefix
+    for (size_t i = 0; i<n; i += 3) {
+        for (size_t len = 0; len <= ref[i].len; len++) {
+            size_t want = 0, best = SIZE_MAX;
+            for (size_t j = 0; j<n; j++) {
+                if (ref[j].len >= len && memcmp(ref[j].bytes, ref[i].bytes, len) == 0) want++;
+            }
+            for (size_t j = 0; j<n; j++) {
+                if (ref[j].len <= len && memcmp(ref[j].bytes, ref[i].bytes, ref[j].len) == 0 && (best == SIZE_MAX || ref[j].len > best)) best = ref[j].len;
+            }
+            size_t got = 0, got_len = SIZE_MAX;
+            TEST_ASSERT_TRUE(art_prefix_iter(t, ref[i].bytes, len, count_visit, &got) == want && got == want);
+            int64_t *p = art_longest_prefix(t, ref[i].bytes, len, &got_len);
+            if (best == SIZE_MAX) TEST_ASSERT_NULL(p);
+            else TEST_ASSERT_TRUE(p && got_len == best && *p == (int64_t)best);
+        }
+    }
+
+    // drain it
+    for (size_t i = 0; i<n; i++) TEST_ASSERT_TRUE(art_remove(t, ref[i].bytes, ref[i].len, false) == E_SUCCESS);
+    TEST_ASSERT_TRUE(t->size == 0 && t->root == NULL);
+    art_free(t, false);
+
+}
+
+
+//################ Node sizes ################
+void test_function_art_nodes(void) {
+
+    Art *t = art_new(NULL);
+    Art_mem m = art_memory(t);
+    TEST_ASSERT_TRUE(m.leaves == 0 && m.node_bytes == 0);
+
+    // one byte keys under a shared stem: one node through every size
+    unsigned char key[3] = { 'x', 'y', 0 };
+    size_t sizes[] = { 4, 16, 48, 256 };
+    for (size_t b = 0; b<256; b++) {
+        key[2] = (unsigned char)b;
+        art_put(t, key, 3, (void*)(uintptr_t)(b + 1));
+        for (int s = 0; s<4; s++) {
+            if (b + 1 == sizes[s]) {
+                m = art_memory(t);
+                TEST_ASSERT_TRUE(m.nodes[s] == 1 && m.leaves == b + 1);
+                TEST_ASSERT_TRUE(m.key_bytes == 3 * (b + 1));
+            }
+        }
+    }
+    art_put(t, key, 2, (void*)(uintptr_t)1000);     // "xy" ends at the node
+    m = art_memory(t);
+    TEST_ASSERT_TRUE(m.nodes[3] == 1 && m.nodes[0] == 0 && m.leaves == 257);
+    for (size_t b = 0; b<256; b++) {
+        key[2] = (unsigned char)b;
+        TEST_ASSERT_TRUE(art_get(t, key, 3) == (void*)(uintptr_t)(b + 1));
+    }
+
+    // and back down, Node256 -> 48 -> 16 -> 4, then folded away
+    for (size_t b = 255; b>0; b--) {
+        key[2] = (unsigned char)b;
+        TEST_ASSERT_TRUE(art_remove(t, key, 3, true) == E_SUCCESS);
+    }
+    m = art_memory(t);
+    TEST_ASSERT_TRUE(m.nodes[0] == 1 && m.nodes[1] == 0 && m.nodes[2] == 0 && m.nodes[3] == 0);
+    TEST_ASSERT_TRUE(art_remove(t, key, 2, true) == E_SUCCESS);
+    m = art_memory(t);
+    TEST_ASSERT_TRUE(m.leaves == 1 && m.node_bytes == 0);
+    key[2] = 0;
+    TEST_ASSERT_TRUE(art_get(t, key, 3) == (void*)(uintptr_t)1);
+
+    // long shared prefixes are folded into one node, not a chain
+    art_free(t, true);
+    t = art_new(NULL);
+    char buf[200];
+    memset(buf, 'q', sizeof(buf));
+    for (int i = 0; i<10; i++) {
+        buf[150] = (char)('0' + i);
+        art_put(t, buf, 151, (void*)(uintptr_t)(i + 1));
+    }
+    m = art_memory(t);
+    TEST_ASSERT_TRUE(m.nodes[1] == 1 && m.node_bytes < 300);
+    TEST_ASSERT_TRUE(art_get(t, buf, 151) == (void*)(uintptr_t)10);
+    buf[100] = 'r';
+    TEST_ASSERT_NULL(art_get(t, buf, 151));
+    TEST_ASSERT_TRUE(art_put(t, buf, 151, NULL) == E_SUCCESS);      // splits the long prefix at byte 100
+    TEST_ASSERT_TRUE(art_memory(t).nodes[0] == 1);
+    buf[100] = 'q';
+    TEST_ASSERT_TRUE(art_get(t, buf, 151) == (void*)(uintptr_t)10);
+    size_t cnt = 0;
+    TEST_ASSERT_TRUE(art_prefix_iter(t, buf, 120, count_visit, &cnt) == 10);
+    art_free(t, true);
+
+}
+
+
+//################ Prefixes ################
+void test_function_art_prefix(void) {
+
+    freed = 0;
+    Art *t = art_new(count_free);
+    const char *routes[] = { "", "10.", "10.1.", "10.1.2.", "10.1.2.3", "10.2.", "192.168.", "192.168.0.1" };
+    for (int64_t i = 0; i<8; i++) TEST_ASSERT_TRUE(art_put(t, routes[i], strlen(routes[i]), boxed(i)) == E_SUCCESS);
+
+    size_t len = 0;
+    TEST_ASSERT_TRUE(*(int64_t*)art_longest_prefix(t, "10.1.2.9", 8, &len) == 3 && len == 7);
+    TEST_ASSERT_TRUE(*(int64_t*)art_longest_prefix(t, "10.1.2.3", 8, &len) == 4 && len == 8);
+    TEST_ASSERT_TRUE(*(int64_t*)art_longest_prefix(t, "10.3.0.0", 8, &len) == 1 && len == 3);
+    TEST_ASSERT_TRUE(*(int64_t*)art_longest_prefix(t, "8.8.8.8", 7, &len) == 0 && len == 0);
+    TEST_ASSERT_TRUE(*(int64_t*)art_longest_prefix(t, "192.168.0.12", 12, &len) == 7);
+
+    size_t cnt = 0;
+    TEST_ASSERT_TRUE(art_prefix_iter(t, "10.", 3, count_visit, &cnt) == 5);
+    TEST_ASSERT_TRUE(art_prefix_iter(t, "10.1", 4, count_visit, &cnt) == 3);
+    TEST_ASSERT_TRUE(art_prefix_iter(t, "192", 3, count_visit, &cnt) == 2);
+    TEST_ASSERT_TRUE(art_prefix_iter(t, "11", 2, count_visit, &cnt) == 0);
+    TEST_ASSERT_TRUE(art_prefix_iter(t, "", 0, count_visit, &cnt) == 8);
+
+    // char vectors, overwrite and preserve
+    Vec_char *v = vec_char_new(16);
+    vec_char_append_n(v, "10.2.", 5);
+    TEST_ASSERT_TRUE(*(int64_t*)art_get_vec(t, v) == 5);
+    TEST_ASSERT_TRUE(art_put_vec(t, v, boxed(50)) == E_NOOP);
+    TEST_ASSERT_TRUE(freed == 1 && *(int64_t*)art_get_vec(t, v) == 50);
+    int64_t *keep = art_get_vec(t, v);
+    TEST_ASSERT_TRUE(art_remove_vec(t, v, true) == E_SUCCESS);
+    TEST_ASSERT_TRUE(art_remove_vec(t, v, true) == E_DOESNT_EXIST);
+    free(keep);
+    vec_char_free(v);
+
+    TEST_ASSERT_TRUE(art_remove(t, "", 0, false) == E_SUCCESS);
+    TEST_ASSERT_NULL(art_longest_prefix(t, "8.8.8.8", 7, &len));
+    art_free(t, false);
+    TEST_ASSERT_TRUE(freed == 8);
+
+    TEST_ASSERT_TRUE(art_put(NULL, "a", 1, NULL) == E_EMPTY_OBJ);
+    TEST_ASSERT_TRUE(art_put_vec(t, NULL, NULL) == E_EMPTY_ARG);
+    TEST_ASSERT_NULL(art_get(NULL, "a", 1));
+
+}
+
+
+//################ benchmarks ################
+/*
+    string lookups: a Vector of Vec_char scanned with vector_in, a B+-tree
+    comparing keys with memcmp and the radix tree
+*/
+static bool eq_vec(void *a, void *b) {
+    const Vec_char *x = *(Vec_char**)a, *y = *(Vec_char**)b;
+    return x->size == y->size && memcmp(x->data, y->data, x->size) == 0;
+}
+
+static int cmp_vec(const void *a, const void *b) {
+    const Vec_char *x = *(Vec_char*const*)a, *y = *(Vec_char*const*)b;
+    return cmp_bytes(x->data, x->size, y->data, y->size);
+}
+
+void test_function_art_bench(void) {
+
+    size_t sizes[] = { 1000, 1 << 20 }, q = 1000000;
+    for (size_t s = 0; s<2; s++) {
+        size_t n = sizes[s];
+        Vec_char **keys = malloc(n * sizeof(*keys));
+        char buf[64];
+        for (size_t i = 0; i<n; i++) {
+            int len = snprintf(buf, sizeof(buf), "user/%zu/session/%zu", (i * 2654435761u) % 100000, i);
+            keys[i] = vec_char_new((size_t)len);
+            vec_char_append_n(keys[i], buf, (size_t)len);
+        }
+        size_t *look = malloc(q * sizeof(size_t));
+        for (size_t i = 0; i<q; i++) look[i] = ((size_t)rand() * 7919 + (size_t)rand()) % n;
+
+        UTIL_ERR e = E_SUCCESS;
+        if (n <= 1000) {
+            Vector *v = vector_new(sizeof(Vec_char*), n);
+            for (size_t i = 0; i<n; i++) vector_add_back(v, &keys[i]);
+            size_t hits = 0;
+            double start = wall();
+            for (size_t i = 0; i<q / 10; i++) hits += vector_in(v, &keys[look[i]], eq_vec, &e) >= 0;
+            fprintf(stdout, "n %zu vector_in: %f ns/lookup\n", n, (wall() - start) / (q / 10) * 1e9);
+            TEST_ASSERT_TRUE(hits == q / 10);
+            vector_free(v);
+        }
+
+        double start = wall();
+        BTree *bt = btree_new(sizeof(Vec_char*), cmp_vec, NULL);
+        for (size_t i = 0; i<n; i++) btree_put(bt, &keys[i], keys[i]);
+        fprintf(stdout, "n %zu btree_put x n: %f s\n", n, wall() - start);
+        start = wall();
+        Art *t = art_new(NULL);
+        for (size_t i = 0; i<n; i++) art_put_vec(t, keys[i], keys[i]);
+        fprintf(stdout, "n %zu art_put x n: %f s\n", n, wall() - start);
+
+        size_t hits = 0;
+        start = wall();
+        for (size_t i = 0; i<q; i++) hits += btree_get(bt, &keys[look[i]]) == keys[look[i]];
+        fprintf(stdout, "n %zu btree_get (memcmp): %f ns/lookup\n", n, (wall() - start) / q * 1e9);
+        start = wall();
+        for (size_t i = 0; i<q; i++) hits += art_get_vec(t, keys[look[i]]) == keys[look[i]];
+        fprintf(stdout, "n %zu art_get_vec: %f ns/lookup\n", n, (wall() - start) / q * 1e9);
+        TEST_ASSERT_TRUE(hits == 2 * q);
+
+        Art_mem m = art_memory(t);
+        fprintf(stdout, "n %zu art: Node4 %zu, Node16 %zu, Node48 %zu, Node256 %zu, %zu node bytes, %zu leaf bytes (%zu key bytes)\n",
+                n, m.nodes[0], m.nodes[1], m.nodes[2], m.nodes[3], m.node_bytes, m.leaf_bytes, m.key_bytes);
+        TEST_ASSERT_TRUE(m.leaves == n);
+
+        art_free(t, true);
+        btree_free(bt, true);
+        for (size_t i = 0; i<n; i++) vec_char_free(keys[i]);
+        free(look);
+        free(keys);
+    }
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // put / get / remove
+    RUN_TEST(test_function_art_random);
+
+    // node sizes
+    RUN_TEST(test_function_art_nodes);
+
+    // prefixes
+    RUN_TEST(test_function_art_prefix);
+
+    // benchmarks
+    RUN_BENCH(test_function_art_bench);
+
+    return UNITY_END();
+}
@@ -0,0 +1,407 @@
+/*
+ *    test src/bitvec.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+// random bits with about one in every `one_in` set, mirrored as bytes in ref
+static Vec_bit *random_bits(size_t n, int one_in, char *ref) {
+    Vec_bit *v = vec_bit_new(1);
+    for (size_t i = 0; i<n; i++) {
+        ref[i] = rand() % one_in == 0;
+        vec_bit_add_back(v, ref[i]);
+    }
+    return v;
+}
+
+// every bit matches ref and the padding past size is zero
+static void check_bits(const Vec_bit *v, const char *ref, size_t n) {
+    TEST_ASSERT_TRUE(v->size == n);
+    for (size_t i = 0; i<n; i++) TEST_ASSERT_TRUE(vec_bit_test(v, i) == (ref[i] != 0));
+    for (size_t i = n; i<v->cap; i++) TEST_ASSERT_FALSE((v->data[i / 64] >> (i % 64)) & 1);
+}
+
+static bool is_even(int32_t x) {
+    return x % 2 == 0;
+}
+
+static bool over_500(int32_t x) {
+    return x > 500;
+}
+
+static bool vec_over_500(void *x) {
+    return *(int32_t*)x > 500;
+}
+
+
+//################ Bits ################
+void test_function_bitvec_basic(void) {
+
+    size_t n = 5000;
+    char *ref = calloc(n, 1);
+    Vec_bit *v = vec_bit_filled(n, false);
+    TEST_ASSERT_NOT_NULL(v);
+    TEST_ASSERT_TRUE(v->cap % 256 == 0);
+    TEST_ASSERT_TRUE(((uintptr_t)v->data & (APUTIL_CACHE_LINE - 1)) == 0);
+
+    // random single bit ops against a byte per bit reference
+    for (int r = 0; r<20000; r++) {
+        size_t i = (size_t)rand() % n;
+        switch (rand() % 3) {
+            case 0: TEST_ASSERT_TRUE(vec_bit_set(v, i) == E_SUCCESS); ref[i] = 1; break;
+            case 1: TEST_ASSERT_TRUE(vec_bit_unset(v, i) == E_SUCCESS); ref[i] = 0; break;
+            default: TEST_ASSERT_TRUE(vec_bit_flip(v, i) == E_SUCCESS); ref[i] = !ref[i]; break;
+        }
+    }
+    check_bits(v, ref, n);
+
+    UTIL_ERR e = E_SUCCESS;
+    TEST_ASSERT_TRUE(vec_bit_get(v, 17, &e) == (ref[17] != 0));
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+    vec_bit_get(v, n, &e);
+    TEST_ASSERT_TRUE(e == E_OUTOFBOUNDS);
+    TEST_ASSERT_TRUE(vec_bit_set(v, n) == E_OUTOFBOUNDS);
+    TEST_ASSERT_TRUE(vec_bit_unset(NULL, 0) == E_EMPTY_OBJ);
+
+    // copy is independent
+    Vec_bit *c = vec_bit_copy(v);
+    check_bits(c, ref, n);
+    vec_bit_flip(c, 0);
+    TEST_ASSERT_TRUE(vec_bit_test(v, 0) == (ref[0] != 0));
+
+    // shrinking zeroes what is dropped, growing brings back zeros
+    vec_bit_fill(v, true);
+    TEST_ASSERT_TRUE(vec_bit_resize(v, 1000) == E_SUCCESS);
+    memset(ref, 1, 1000);
+    memset(ref + 1000, 0, n - 1000);
+    check_bits(v, ref, 1000);
+    TEST_ASSERT_TRUE(vec_bit_resize(v, 100000) == E_SUCCESS);
+    TEST_ASSERT_TRUE(vec_bit_count(v) == 1000);
+    TEST_ASSERT_TRUE(vec_bit_resize(v, 37) == E_SUCCESS);
+    TEST_ASSERT_TRUE(vec_bit_count(v) == 37);
+    TEST_ASSERT_TRUE(vec_bit_add_back(v, false) == E_SUCCESS);
+    TEST_ASSERT_TRUE(vec_bit_add_back(v, true) == E_SUCCESS);
+    TEST_ASSERT_TRUE(v->size == 39 && vec_bit_count(v) == 38 && !vec_bit_test(v, 37));
+
+    vec_bit_clear(v);
+    TEST_ASSERT_TRUE(v->size == 0 && vec_bit_count(v) == 0);
+    TEST_ASSERT_NULL(vec_bit_new(0));
+    Vec_bit *empty = vec_bit_filled(0, true);
+    TEST_ASSERT_TRUE(empty->size == 0 && vec_bit_count(empty) == 0);
+
+    vec_bit_free(empty);
+    vec_bit_free(c);
+    vec_bit_free(v);
+    free(ref);
+
+}
+
+
+void test_function_bitvec_next_set(void) {
+
+    int dens[] = { 1, 2, 50, 5000 };
+    size_t sizes[] = { 1, 63, 64, 65, 255, 256, 257, 10000 };
+    for (size_t d = 0; d<sizeof(dens) / sizeof(dens[0]); d++) {
+        for (size_t s = 0; s<sizeof(sizes) / sizeof(sizes[0]); s++) {
+            size_t n = sizes[s];
+            char *ref = malloc(n);
+            Vec_bit *v = random_bits(n, dens[d], ref);
+
+            // walking next_set visits exactly the set bits, in order
+            size_t want = 0;
+            intmax_t at = vec_bit_next_set(v, 0);
+            for (size_t i = 0; i<n; i++) {
+                if (!ref[i]) continue;
+                TEST_ASSERT_TRUE(at == (intmax_t)i);
+                at = vec_bit_next_set(v, i + 1);
+                want++;
+            }
+            TEST_ASSERT_TRUE(at == -1);
+            TEST_ASSERT_TRUE(vec_bit_count(v) == want);
+
+            vec_bit_free(v);
+            free(ref);
+        }
+    }
+
+}
+
+
+//################ Bulk ################
+void test_function_bitvec_bulk(void) {
+
+    size_t sizes[] = { 1, 64, 100, 256, 1000, 4099 };
+    for (size_t s = 0; s<sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        char *ra = malloc(n), *rb = malloc(n), *want = malloc(n);
+        Vec_bit *a = random_bits(n, 2, ra), *b = random_bits(n, 3, rb);
+
+        Vec_bit *r = vec_bit_copy(a);
+        TEST_ASSERT_TRUE(vec_bit_and(r, b) == E_SUCCESS);
+        for (size_t i = 0; i<n; i++) want[i] = ra[i] & rb[i];
+        check_bits(r, want, n);
+        vec_bit_free(r);
+
+        r = vec_bit_copy(a);
+        TEST_ASSERT_TRUE(vec_bit_or(r, b) == E_SUCCESS);
+        for (size_t i = 0; i<n; i++) want[i] = ra[i] | rb[i];
+        check_bits(r, want, n);
+        vec_bit_free(r);
+
+        r = vec_bit_copy(a);
+        TEST_ASSERT_TRUE(vec_bit_xor(r, b) == E_SUCCESS);
+        for (size_t i = 0; i<n; i++) want[i] = ra[i] ^ rb[i];
+        check_bits(r, want, n);
+        vec_bit_free(r);
+
+        r = vec_bit_copy(a);
+        TEST_ASSERT_TRUE(vec_bit_andnot(r, b) == E_SUCCESS);
+        size_t ones = 0;
+        for (size_t i = 0; i<n; i++) {
+            want[i] = ra[i] & !rb[i];
+            ones += (size_t)want[i];
+        }
+        check_bits(r, want, n);
+        TEST_ASSERT_TRUE(vec_bit_count(r) == ones);
+        vec_bit_free(r);
+
+        // a full vector xor itself leaves nothing, not even padding
+        Vec_bit *full = vec_bit_filled(n, true);
+        TEST_ASSERT_TRUE(vec_bit_count(full) == n);
+        vec_bit_xor(full, full);
+        TEST_ASSERT_TRUE(vec_bit_count(full) == 0);
+        vec_bit_free(full);
+
+        vec_bit_free(a);
+        vec_bit_free(b);
+        free(ra);
+        free(rb);
+        free(want);
+    }
+
+    Vec_bit *a = vec_bit_filled(10, true), *b = vec_bit_filled(11, true);
+    TEST_ASSERT_TRUE(vec_bit_and(a, b) == E_OUTOFBOUNDS);
+    TEST_ASSERT_TRUE(vec_bit_or(NULL, b) == E_EMPTY_OBJ);
+    TEST_ASSERT_TRUE(vec_bit_xor(a, NULL) == E_EMPTY_ARG);
+    vec_bit_free(a);
+    vec_bit_free(b);
+
+}
+
+
+//################ Rank / Select ################
+void test_function_bitvec_rank_select(void) {
+
+    int dens[] = { 1, 2, 7, 300, 100000 };
+    size_t sizes[] = { 1, 511, 512, 513, 20000, 300000 };
+    for (size_t d = 0; d<sizeof(dens) / sizeof(dens[0]); d++) {
+        for (size_t s = 0; s<sizeof(sizes) / sizeof(sizes[0]); s++) {
+            size_t n = sizes[s];
+            char *ref = malloc(n);
+            Vec_bit *v = random_bits(n, dens[d], ref);
+            Vec_bit_rank *r = vec_bit_rank_new(v);
+            TEST_ASSERT_NOT_NULL(r);
+
+            size_t ones = 0;
+            for (size_t i = 0; i<n; i++) {
+                TEST_ASSERT_TRUE(vec_bit_rank(r, i) == ones);
+                if (ref[i]) {
+                    TEST_ASSERT_TRUE(vec_bit_select(r, ones) == (intmax_t)i);
+                    ones++;
+                }
+            }
+            TEST_ASSERT_TRUE(r->ones == ones);
+            TEST_ASSERT_TRUE(vec_bit_rank(r, n) == ones);
+            TEST_ASSERT_TRUE(vec_bit_rank(r, n + 1000) == ones);
+            TEST_ASSERT_TRUE(vec_bit_select(r, ones) == -1);
+
+            vec_bit_rank_free(r);
+            vec_bit_free(v);
+            free(ref);
+        }
+    }
+    TEST_ASSERT_NULL(vec_bit_rank_new(NULL));
+
+}
+
+
+//################ Masks ################
+void test_function_bitvec_masks(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    Vec_i32 *v = vec_i32_new(1);
+    for (int32_t i = 0; i<1000; i++) vec_i32_add_back(v, rand() % 1000);
+
+    // selecting through the mask gives what vec_i32_filter gives
+    Vec_bit *even = vec_i32_mask(v, is_even, &e), *big = vec_i32_mask(v, over_500, &e);
+    TEST_ASSERT_TRUE(even->size == v->size);
+    Vec_i32 *f = vec_i32_filter(v, is_even, &e), *s = vec_i32_select_mask(v, even, &e);
+    TEST_ASSERT_TRUE(f->size == s->size && vec_bit_count(even) == s->size);
+    TEST_ASSERT_EQUAL_MEMORY(f->data, s->data, f->size * sizeof(int32_t));
+    vec_i32_free(f);
+    vec_i32_free(s);
+
+    // masks combine: even and over 500
+    vec_bit_and(even, big);
+    s = vec_i32_select_mask(v, even, &e);
+    size_t want = 0;
+    for (size_t i = 0; i<v->size; i++) want += is_even(v->data[i]) && over_500(v->data[i]);
+    TEST_ASSERT_TRUE(s->size == want);
+    VEC_I32_FOREACH(s, it) TEST_ASSERT_TRUE(is_even(*it) && over_500(*it));
+    vec_i32_free(s);
+
+    // generic vectors
+    Vector *g = vector_from_array(v->data, v->size, sizeof(int32_t));
+    Vec_bit *gm = vector_mask(g, vec_over_500, &e);
+    TEST_ASSERT_TRUE(vec_bit_count(gm) == vec_bit_count(big));
+    Vector *gs = vector_select_mask(g, gm, &e);
+    f = vec_i32_filter(v, over_500, &e);
+    TEST_ASSERT_TRUE(gs->size == f->size);
+    TEST_ASSERT_EQUAL_MEMORY(f->data, gs->data, f->size * sizeof(int32_t));
+
+    e = E_SUCCESS;
+    vec_bit_resize(gm, 10);
+    TEST_ASSERT_NULL(vector_select_mask(g, gm, &e));
+    TEST_ASSERT_TRUE(e == E_OUTOFBOUNDS);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(vec_i32_mask(v, NULL, &e));
+    TEST_ASSERT_TRUE(e == E_EMPTY_FUNC);
+
+    // byte flags to bits and back, every length around the 64 byte step
+    for (size_t n = 0; n<300; n++) {
+        Vec_char *flags = vec_char_new(n ? n : 1);
+        for (size_t i = 0; i<n; i++) vec_char_add_back(flags, (char)(rand() % 3 ? 0 : rand() % 255 - 127));
+        Vec_bit *b = vec_bit_from_chars(flags, &e);
+        TEST_ASSERT_TRUE(b->size == n);
+        for (size_t i = 0; i<n; i++) TEST_ASSERT_TRUE(vec_bit_test(b, i) == (flags->data[i] != 0));
+        check_bits(b, flags->data, n);
+        Vec_char *back = vec_bit_to_chars(b, &e);
+        TEST_ASSERT_TRUE(back->size == n);
+        for (size_t i = 0; i<n; i++) TEST_ASSERT_TRUE(back->data[i] == (flags->data[i] != 0));
+        vec_char_free(back);
+        vec_bit_free(b);
+        vec_char_free(flags);
+    }
+
+    vector_free(gs);
+    vector_free(g);
+    vec_i32_free(f);
+    vec_bit_free(gm);
+    vec_bit_free(even);
+    vec_bit_free(big);
+    vec_i32_free(v);
+
+}
+
+
+//################ benchmarks ################
+void test_function_bitvec_bench(void) {
+
+    size_t n = 1 << 26, reps = 10;
+    char *ref = malloc(n);
+    Vec_char *flags = vec_char_new(n);
+    for (size_t i = 0; i<n; i++) ref[i] = rand() % 4 == 0;
+    vec_char_append_n(flags, ref, n);
+    UTIL_ERR e = E_SUCCESS;
+
+    double start = wall();
+    Vec_bit *a = vec_bit_from_chars(flags, &e);
+    double secs = wall() - start;
+    fprintf(stdout, "pack %zu byte flags: %f s (%zu MiB -> %zu MiB)\n", n, secs, n >> 20, (a->cap / 8) >> 20);
+    Vec_bit *b = vec_bit_copy(a);
+    vec_bit_flip(b, 0);
+
+    // byte per flag baseline
+    start = wall();
+    size_t cnt = 0;
+    for (size_t r = 0; r<reps; r++) {
+        for (size_t i = 0; i<n; i++) cnt += flags->data[i] != 0;
+    }
+    secs = wall() - start;
+    fprintf(stdout, "count Vec_char flags: %f GB/s of flags (%zu)\n", (double)n * reps / secs / 1e9, cnt / reps);
+
+    start = wall();
+    size_t bits = 0;
+    for (size_t r = 0; r<reps; r++) bits += vec_bit_count(a);
+    secs = wall() - start;
+    TEST_ASSERT_TRUE(bits == cnt);
+    fprintf(stdout, "vec_bit_count: %f Gbit/s\n", (double)n * reps / secs / 1e9);
+
+    start = wall();
+    for (size_t r = 0; r<reps; r++) {
+        for (size_t i = 0; i<n; i++) flags->data[i] = (char)(flags->data[i] & ref[i]);
+    }
+    secs = wall() - start;
+    fprintf(stdout, "and Vec_char flags: %f GB/s of flags\n", (double)n * reps / secs / 1e9);
+
+    start = wall();
+    for (size_t r = 0; r<reps; r++) vec_bit_and(b, a);
+    secs = wall() - start;
+    fprintf(stdout, "vec_bit_and: %f Gbit/s\n", (double)n * reps / secs / 1e9);
+
+    // rank / select directory
+    start = wall();
+    Vec_bit_rank *rk = vec_bit_rank_new(a);
+    secs = wall() - start;
+    fprintf(stdout, "rank directory over %zu bits: %f s, %zu extra bytes\n", n, secs, rk->n_blocks * 16 + rk->n_samples * sizeof(size_t));
+
+    size_t q = 10000000, acc = 0;
+    start = wall();
+    for (size_t i = 0; i<q; i++) acc += vec_bit_rank(rk, (i * 2654435761u) % n);
+    secs = wall() - start;
+    fprintf(stdout, "vec_bit_rank: %f ns (%zu)\n", secs / q * 1e9, acc & 1);
+
+    start = wall();
+    for (size_t i = 0; i<q; i++) acc += (size_t)vec_bit_select(rk, (i * 2654435761u) % rk->ones);
+    secs = wall() - start;
+    fprintf(stdout, "vec_bit_select: %f ns (%zu)\n", secs / q * 1e9, acc & 1);
+
+    vec_bit_rank_free(rk);
+    vec_bit_free(a);
+    vec_bit_free(b);
+    vec_char_free(flags);
+    free(ref);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // bits
+    RUN_TEST(test_function_bitvec_basic);
+    RUN_TEST(test_function_bitvec_next_set);
+
+    // bulk
+    RUN_TEST(test_function_bitvec_bulk);
+
+    // rank / select
+    RUN_TEST(test_function_bitvec_rank_select);
+
+    // masks
+    RUN_TEST(test_function_bitvec_masks);
+
+    // benchmarks
+    RUN_BENCH(test_function_bitvec_bench);
+
+    return UNITY_END();
+}
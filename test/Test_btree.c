@@ -0,0 +1,426 @@
+/*
+ *    test src/btree.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+typedef struct {
+    int64_t hi;
+    int64_t lo;
+} wide;
+
+static size_t freed;
+static void count_free(void *d) {
+    freed++;
+    free(d);
+}
+
+static int64_t *boxed(int64_t x) {
+    int64_t *p = malloc(sizeof(*p));
+    *p = x;
+    return p;
+}
+
+static int cmp_i32(const void *a, const void *b) {
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static bool eq_i32(const void *a, const void *b) {
+    return *(const int32_t*)a == *(const int32_t*)b;
+}
+
+// keys unaligned in the leaf, compare through copies
+static int cmp_wide(const void *a, const void *b) {
+    wide x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    if (x.hi != y.hi) return (x.hi > y.hi) - (x.hi < y.hi);
+    return (x.lo > y.lo) - (x.lo < y.lo);
+}
+
+static wide wide_key(int32_t k) {
+    return (wide){ .hi = k / 7, .lo = k % 7 };
+}
+
+static void key_visit(const void *key, void *data, void *arg) {
+    (void)data;
+    int32_t k;
+    memcpy(&k, key, sizeof(k));
+    *(int64_t*)arg += k;
+}
+
+static void sum_visit(const void *key, void *data, void *arg) {
+    int32_t k;
+    memcpy(&k, key, sizeof(k));
+    ((int64_t*)arg)[0] += k;
+    ((int64_t*)arg)[1] += data ? *(int64_t*)data : 0;
+}
+
+// every leaf in order and linked both ways, key count matches size
+static void check_chain(const BTree *t) {
+    size_t cnt = 0;
+    const void *prev = NULL;
+    for (BTree_iter it = btree_lower_bound(t, NULL); btree_iter_valid(&it); btree_iter_next(&it)) {
+        const void *key = btree_iter_key(&it);
+        if (prev) {
+            if (t->compare) TEST_ASSERT_TRUE(t->compare(prev, key) < 0);
+            else TEST_ASSERT_TRUE(cmp_i32(prev, key) < 0);
+        }
+        prev = key;
+        cnt++;
+    }
+    TEST_ASSERT_TRUE(cnt == t->size);
+}
+
+
+//################ Put / get / remove ################
+void test_function_btree_i32(void) {
+
+    freed = 0;
+    BTree *t = btree_i32_new(count_free);
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_TRUE(t->node_bytes == BTREE_NODE_BYTES);
+    TEST_ASSERT_TRUE(((uintptr_t)t->root & (APUTIL_CACHE_LINE - 1)) == 0);
+    TEST_ASSERT_NULL(btree_i32_get(t, 5));
+    TEST_ASSERT_FALSE(btree_iter_valid(&(BTree_iter){ 0 }));
+    TEST_ASSERT_TRUE(btree_i32_remove(t, 5, false) == E_DOESNT_EXIST);
+
+    // random puts and removes against a presence table
+    enum { RANGE = 20000 };
+    static bool in[RANGE];
+    memset(in, 0, sizeof(in));
+    size_t n = 0, puts = 0;
+    for (size_t step = 0; step<200000; step++) {
+        int32_t k = rand() % RANGE - RANGE / 2;
+        bool put = step < 100000 ? rand() % 4 != 0 : rand() % 4 == 0;
+        if (put) {
+            UTIL_ERR e = btree_i32_put(t, k, boxed(k));
+            puts++;
+            TEST_ASSERT_TRUE(e == (in[k + RANGE / 2] ? E_NOOP : E_SUCCESS));
+            n += !in[k + RANGE / 2];
+            in[k + RANGE / 2] = true;
+        } else {
+            UTIL_ERR e = btree_i32_remove(t, k, false);
+            TEST_ASSERT_TRUE(e == (in[k + RANGE / 2] ? E_SUCCESS : E_DOESNT_EXIST));
+            n -= in[k + RANGE / 2];
+            in[k + RANGE / 2] = false;
+        }
+        TEST_ASSERT_TRUE(t->size == n);
+        if (step % 20000 == 0) check_chain(t);
+    }
+    check_chain(t);
+    TEST_ASSERT_TRUE(freed == puts - n);
+
+    for (int32_t k = -RANGE / 2; k < RANGE / 2; k++) {
+        int64_t *p = btree_i32_get(t, k);
+        TEST_ASSERT_TRUE(in[k + RANGE / 2] ? p && *p == k : !p);
+        TEST_ASSERT_TRUE(btree_contains(t, &k) == in[k + RANGE / 2]);
+        TEST_ASSERT_TRUE(btree_get(t, &k) == (void*)p);
+    }
+
+    // drain it, the root collapses back to one leaf
+    for (int32_t k = -RANGE / 2; k < RANGE / 2; k++) {
+        if (in[k + RANGE / 2]) TEST_ASSERT_TRUE(btree_i32_remove(t, k, false) == E_SUCCESS);
+    }
+    TEST_ASSERT_TRUE(t->size == 0 && t->height == 1);
+    TEST_ASSERT_TRUE(freed == puts);
+    BTree_iter it = btree_i32_lower_bound(t, 0);
+    TEST_ASSERT_FALSE(btree_iter_valid(&it));
+
+    // ascending and descending runs, extremes of the range
+    for (int32_t k = 0; k<5000; k++) btree_i32_put(t, k, NULL);
+    for (int32_t k = -1; k>-5000; k--) btree_i32_put(t, k, NULL);
+    btree_i32_put(t, INT32_MIN, NULL);
+    btree_i32_put(t, INT32_MAX, NULL);
+    check_chain(t);
+    TEST_ASSERT_TRUE(t->size == 10001);
+    int32_t lo = INT32_MIN, hi = INT32_MAX;
+    TEST_ASSERT_TRUE(btree_contains(t, &lo) && btree_contains(t, &hi));
+    it = btree_lower_bound(t, NULL);
+    TEST_ASSERT_TRUE(*(const int32_t*)btree_iter_key(&it) == INT32_MIN);
+
+    btree_free(t, false);
+
+    TEST_ASSERT_NULL(btree_new(8, NULL, NULL));
+    TEST_ASSERT_NULL(btree_new(0, cmp_i32, NULL));
+    TEST_ASSERT_TRUE(btree_put(NULL, &lo, NULL) == E_EMPTY_OBJ);
+    TEST_ASSERT_NULL(btree_i32_get(NULL, 1));
+
+}
+
+
+void test_function_btree_generic(void) {
+
+    // 16 byte keys, fewer per node
+    freed = 0;
+    BTree *t = btree_new(sizeof(wide), cmp_wide, count_free);
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_TRUE(t->node_keys >= 4 && t->node_keys < 39);
+    TEST_ASSERT_TRUE(btree_i32_put(t, 1, NULL) == E_BAD_TYPE);
+    TEST_ASSERT_NULL(btree_i32_get(t, 1));
+
+    enum { RANGE = 6000 };
+    static bool in[RANGE];
+    memset(in, 0, sizeof(in));
+    size_t n = 0;
+    for (size_t step = 0; step<60000; step++) {
+        int32_t k = rand() % RANGE;
+        wide key = wide_key(k);
+        if (rand() % 3) {
+            btree_put(t, &key, boxed(k));
+            n += !in[k];
+            in[k] = true;
+        } else {
+            TEST_ASSERT_TRUE(btree_remove(t, &key, false) == (in[k] ? E_SUCCESS : E_DOESNT_EXIST));
+            n -= in[k];
+            in[k] = false;
+        }
+    }
+    TEST_ASSERT_TRUE(t->size == n);
+    check_chain(t);
+
+    for (int32_t k = 0; k<RANGE; k++) {
+        wide key = wide_key(k);
+        int64_t *p = btree_get(t, &key);
+        TEST_ASSERT_TRUE(in[k] ? p && *p == k : !p);
+
+        // lower bound lands on the next present key
+        BTree_iter it = btree_lower_bound(t, &key);
+        int32_t next = k;
+        while (next < RANGE && !in[next]) next++;
+        if (next == RANGE) TEST_ASSERT_FALSE(btree_iter_valid(&it));
+        else TEST_ASSERT_TRUE(*(int64_t*)btree_iter_data(&it) == next);
+    }
+
+    // preserve keeps the data
+    wide key = wide_key(RANGE + 1);
+    int64_t *keep = boxed(7);
+    btree_put(t, &key, keep);
+    TEST_ASSERT_TRUE(btree_remove(t, &key, true) == E_SUCCESS);
+    TEST_ASSERT_TRUE(*keep == 7);
+    free(keep);
+
+    btree_free(t, false);
+
+}
+
+
+//################ Bulk load ################
+void test_function_btree_bulk(void) {
+
+    // every size through a few levels, lookups and the shape of the tree
+    for (size_t n = 0; n<3000; n += n < 100 ? 1 : 37) {
+        Vec_i32 *keys = vec_i32_new(n ? n : 1);
+        void **data = malloc(sizeof(void*) * (n ? n : 1));
+        for (size_t i = 0; i<n; i++) {
+            vec_i32_add_back(keys, (int32_t)(i * 3));
+            data[i] = (void*)(uintptr_t)(i + 1);
+        }
+
+        UTIL_ERR e = E_SUCCESS;
+        BTree *t = btree_i32_from_sorted(keys, data, NULL, &e);
+        TEST_ASSERT_NOT_NULL(t);
+        TEST_ASSERT_TRUE(e == E_SUCCESS && t->size == n);
+        check_chain(t);
+        for (size_t i = 0; i<n; i++) {
+            TEST_ASSERT_TRUE(btree_i32_get(t, (int32_t)(i * 3)) == data[i]);
+            TEST_ASSERT_NULL(btree_i32_get(t, (int32_t)(i * 3 + 1)));
+        }
+
+        // a bulk loaded tree takes puts and removes like any other
+        for (size_t i = 0; i<n; i += 2) TEST_ASSERT_TRUE(btree_i32_remove(t, (int32_t)(i * 3), true) == E_SUCCESS);
+        for (size_t i = 0; i<n; i++) TEST_ASSERT_TRUE(btree_i32_put(t, (int32_t)(i * 3 + 1), NULL) == E_SUCCESS);
+        TEST_ASSERT_TRUE(t->size == n + n / 2);
+        check_chain(t);
+
+        btree_free(t, true);
+        free(data);
+        vec_i32_free(keys);
+    }
+
+    // generic keys, out of order and repeated keys
+    Vector *keys = vector_new(sizeof(wide), 500);
+    for (int32_t k = 0; k<500; k++) {
+        wide w = wide_key(k * 2);
+        vector_add_back(keys, &w);
+    }
+    UTIL_ERR e = E_SUCCESS;
+    BTree *t = btree_from_sorted(keys, NULL, cmp_wide, NULL, &e);
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_TRUE(t->size == 500 && t->height > 1);
+    check_chain(t);
+    wide w = wide_key(998);
+    TEST_ASSERT_TRUE(btree_contains(t, &w));
+    w = wide_key(999);
+    TEST_ASSERT_FALSE(btree_contains(t, &w));
+    btree_free(t, true);
+
+    w = wide_key(0);
+    vector_add_back(keys, &w);
+    TEST_ASSERT_NULL(btree_from_sorted(keys, NULL, cmp_wide, NULL, &e));
+    TEST_ASSERT_TRUE(e == E_BAD_TYPE);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(btree_from_sorted(keys, NULL, NULL, NULL, &e));
+    TEST_ASSERT_TRUE(e == E_EMPTY_FUNC);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(btree_i32_from_sorted(NULL, NULL, NULL, &e));
+    TEST_ASSERT_TRUE(e == E_EMPTY_OBJ);
+    vector_free(keys);
+
+}
+
+
+//################ Ranges ################
+void test_function_btree_range(void) {
+
+    freed = 0;
+    BTree *t = btree_i32_new(count_free);
+    for (int32_t k = 0; k<10000; k += 2) btree_i32_put(t, k, boxed(k * 10));
+
+    // [lo, hi) against the arithmetic sum of the even keys
+    for (size_t r = 0; r<200; r++) {
+        int32_t lo = rand() % 10100 - 50, hi = lo + rand() % 3000;
+        int64_t sum[2] = { 0, 0 }, want = 0;
+        size_t cnt = 0;
+        for (int32_t k = lo < 0 ? 0 : lo; k < hi && k < 10000; k++) {
+            if (k % 2 == 0) {
+                want += k;
+                cnt++;
+            }
+        }
+        TEST_ASSERT_TRUE(btree_range(t, &lo, &hi, sum_visit, sum) == cnt);
+        TEST_ASSERT_TRUE(sum[0] == want && sum[1] == want * 10);
+    }
+
+    // open ends
+    int64_t sum[2] = { 0, 0 };
+    int32_t mid = 5000;
+    TEST_ASSERT_TRUE(btree_range(t, NULL, &mid, sum_visit, sum) == 2500);
+    TEST_ASSERT_TRUE(btree_range(t, &mid, NULL, sum_visit, sum) == 2500);
+    TEST_ASSERT_TRUE(btree_range(t, NULL, NULL, sum_visit, sum) == 5000);
+    TEST_ASSERT_TRUE(btree_range(t, &mid, &mid, sum_visit, sum) == 0);
+
+    BTree_iter it = btree_i32_lower_bound(t, 9999);
+    TEST_ASSERT_FALSE(btree_iter_valid(&it));
+    TEST_ASSERT_NULL(btree_iter_key(&it));
+    btree_iter_next(&it);
+    it = btree_i32_lower_bound(t, 4999);
+    TEST_ASSERT_TRUE(*(const int32_t*)btree_iter_key(&it) == 5000);
+    btree_iter_next(&it);
+    TEST_ASSERT_TRUE(*(int64_t*)btree_iter_data(&it) == 50020);
+
+    // overwrite hands the old data to the hook
+    TEST_ASSERT_TRUE(btree_i32_put(t, 42, boxed(1)) == E_NOOP);
+    TEST_ASSERT_TRUE(freed == 1);
+    TEST_ASSERT_TRUE(*(int64_t*)btree_i32_get(t, 42) == 1);
+
+    btree_free(t, false);
+    TEST_ASSERT_TRUE(freed == 5001);
+
+}
+
+
+//################ benchmarks ################
+/*
+    random lookups: a sorted list walked by aputil_llist_in, the tree with a
+    compare function and the int32_t tree's SIMD node search, then a range scan
+*/
+void test_function_btree_bench(void) {
+
+    size_t sizes[] = { 1000, 1 << 20 }, q = 2000000;
+    for (size_t s = 0; s<sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        Vec_i32 *keys = vec_i32_new(n);
+        for (size_t i = 0; i<n; i++) vec_i32_add_back(keys, (int32_t)(i * 2));
+        int32_t *look = malloc(q * sizeof(int32_t));
+        for (size_t i = 0; i<q; i++) look[i] = (int32_t)(((size_t)rand() * 7919 + (size_t)rand()) % (2 * n));
+
+        UTIL_ERR e = E_SUCCESS;
+        size_t hits = 0, check = 0;
+        if (n <= 1000) {
+            APUTIL_LList *lst = aputil_llist_new(NULL, NULL, cmp_i32, "sorted", &e);
+            for (size_t i = 0; i<n; i++) aputil_llist_push_back(lst, keys->data + i);
+            double start = wall();
+            for (size_t i = 0; i<q / 10; i++) hits += aputil_llist_in(lst, look + i, eq_i32, &e) != NULL;
+            double secs = wall() - start;
+            fprintf(stdout, "n %zu aputil_llist_in: %f ns/lookup\n", n, secs / (q / 10) * 1e9);
+            aputil_llist_free(lst, true);
+        }
+
+        double start = wall();
+        Vector g = { .data = keys->data, .size = n, .cap = n, .elem_size = sizeof(int32_t) };
+        BTree *gt = btree_from_sorted(&g, NULL, cmp_i32, NULL, &e);
+        BTree *t = btree_i32_new(NULL);
+        for (size_t i = 0; i<n; i++) btree_i32_put(t, keys->data[i], keys->data + i);
+        fprintf(stdout, "n %zu btree_i32_put x n: %f s\n", n, wall() - start);
+
+        start = wall();
+        for (size_t i = 0; i<q; i++) check += btree_contains(gt, look + i);
+        double secs = wall() - start;
+        fprintf(stdout, "n %zu btree_contains (compare): %f ns/lookup\n", n, secs / q * 1e9);
+
+        size_t fast = 0;
+        start = wall();
+        for (size_t i = 0; i<q; i++) fast += btree_i32_get(t, look[i]) != NULL;
+        secs = wall() - start;
+        fprintf(stdout, "n %zu btree_i32_get: %f ns/lookup\n", n, secs / q * 1e9);
+        TEST_ASSERT_TRUE(fast == check);
+        if (n <= 1000) {
+            size_t want = 0;
+            for (size_t i = 0; i<q / 10; i++) want += btree_i32_get(t, look[i]) != NULL;
+            TEST_ASSERT_TRUE(hits == want);
+        }
+
+        int64_t sum = 0;
+        start = wall();
+        size_t seen = btree_range(t, NULL, NULL, key_visit, &sum);
+        fprintf(stdout, "n %zu btree_range full scan: %f ns/key\n", n, (wall() - start) / n * 1e9);
+        TEST_ASSERT_TRUE(seen == n && sum == (int64_t)n * (int64_t)(n - 1));
+
+        btree_free(gt, true);
+        btree_free(t, true);
+        free(look);
+        vec_i32_free(keys);
+    }
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // put / get / remove
+    RUN_TEST(test_function_btree_i32);
+    RUN_TEST(test_function_btree_generic);
+
+    // bulk load
+    RUN_TEST(test_function_btree_bulk);
+
+    // ranges
+    RUN_TEST(test_function_btree_range);
+
+    // benchmarks
+    RUN_BENCH(test_function_btree_bench);
+
+    return UNITY_END();
+}
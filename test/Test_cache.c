@@ -0,0 +1,377 @@
+/*
+ *    test src/cache.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+static size_t freed;
+static void count_free(void *d) {
+    freed++;
+    free(d);
+}
+
+static int64_t *boxed(int64_t x) {
+    int64_t *p = malloc(sizeof(*p));
+    *p = x;
+    return p;
+}
+
+static void *copy_i64(const void *d) {
+    return boxed(*(const int64_t*)d);
+}
+
+static int64_t cached(APUTIL_Cache *c, int64_t k) {
+    int64_t *p = aputil_cache_get(c, &k);
+    return p ? *p : -1;
+}
+
+typedef struct {
+    char name[12];
+    int32_t version;
+} doc_key;
+
+// version doesn't take part
+static uint64_t doc_hash(const void *d) {
+    return hash_bytes(((const doc_key*)d)->name, strnlen(((const doc_key*)d)->name, 12));
+}
+
+static bool doc_equal(const void *a, const void *b) {
+    return strncmp(((const doc_key*)a)->name, ((const doc_key*)b)->name, 12) == 0;
+}
+
+
+//################ Policies ################
+void test_function_cache_lru(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    freed = 0;
+    APUTIL_Cache *c = aputil_cache_new(cache_lru, sizeof(int64_t), 3, 0, count_free, copy_i64, NULL, NULL, &e);
+    TEST_ASSERT_NOT_NULL(c);
+
+    for (int64_t k = 1; k<=3; k++) TEST_ASSERT_TRUE(aputil_cache_put(c, &k, boxed(k * 10), 1) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(10, cached(c, 1));              // 1 most recent, 2 least
+
+    int64_t k = 4;
+    aputil_cache_put(c, &k, boxed(40), 1);
+    TEST_ASSERT_EQUAL_INT32(1, freed);
+    TEST_ASSERT_EQUAL_INT32(-1, cached(c, 2));
+    TEST_ASSERT_EQUAL_INT32(3, c->cnt);
+
+    // peek leaves 3 the victim
+    k = 3;
+    TEST_ASSERT_EQUAL_INT32(30, *(int64_t*)aputil_cache_peek(c, &k));
+    k = 5;
+    aputil_cache_put(c, &k, boxed(50), 1);
+    TEST_ASSERT_EQUAL_INT32(-1, cached(c, 3));
+    TEST_ASSERT_EQUAL_INT32(10, cached(c, 1));
+
+    // replacing frees the old data and counts as a use
+    k = 4;
+    TEST_ASSERT_TRUE(aputil_cache_put(c, &k, boxed(41), 1) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(3, freed);
+    TEST_ASSERT_TRUE(aputil_cache_evict(c) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(-1, cached(c, 5));
+    TEST_ASSERT_EQUAL_INT32(41, cached(c, 4));
+
+    // preserved removal hands the data back
+    int64_t *keep = aputil_cache_peek(c, &k);
+    TEST_ASSERT_TRUE(aputil_cache_remove(c, &k, true) == E_SUCCESS);
+    TEST_ASSERT_TRUE(aputil_cache_remove(c, &k, true) == E_DOESNT_EXIST);
+    TEST_ASSERT_EQUAL_INT32(41, *keep);
+    free(keep);
+
+    TEST_ASSERT_EQUAL_INT32(1, c->cnt);
+    aputil_cache_clear(c, false);
+    TEST_ASSERT_EQUAL_INT32(0, c->cnt);
+    TEST_ASSERT_TRUE(aputil_cache_evict(c) == E_NODATA);
+    TEST_ASSERT_TRUE(aputil_cache_put(c, &k, NULL, 1) == E_EMPTY_ARG);
+    TEST_ASSERT_TRUE(aputil_cache_put(c, &k, boxed(7), 1) == E_SUCCESS);
+    aputil_cache_free(c, false);
+    TEST_ASSERT_EQUAL_INT32(6, freed);
+
+    TEST_ASSERT_NULL(aputil_cache_new(cache_lru, 0, 3, 0, NULL, NULL, NULL, NULL, &e));
+    TEST_ASSERT_TRUE(e == E_EMPTY_ARG);
+
+}
+
+
+void test_function_cache_lfu(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    freed = 0;
+    APUTIL_Cache *c = aputil_cache_new(cache_lfu, sizeof(int64_t), 4, 0, count_free, NULL, NULL, NULL, &e);
+
+    for (int64_t k = 1; k<=4; k++) aputil_cache_put(c, &k, boxed(k), 1);
+    // uses: 1 x3, 2 x1, 3 x2, 4 none
+    for (int i = 0; i<3; i++) cached(c, 1);
+    cached(c, 2);
+    cached(c, 3);
+    cached(c, 3);
+
+    int64_t k = 5;
+    aputil_cache_put(c, &k, boxed(5), 1);
+    TEST_ASSERT_EQUAL_INT32(-1, cached(c, 4));              // the miss isn't a use of anything
+    k = 6;
+    aputil_cache_put(c, &k, boxed(6), 1);                   // 5 is the only count 1
+    TEST_ASSERT_EQUAL_INT32(-1, cached(c, 5));
+
+    // 2 and 6 both at count 2 after this, 2 is the less recent
+    cached(c, 6);
+    k = 7;
+    aputil_cache_put(c, &k, boxed(7), 1);
+    TEST_ASSERT_EQUAL_INT32(-1, cached(c, 2));
+    TEST_ASSERT_EQUAL_INT32(6, cached(c, 6));
+    TEST_ASSERT_EQUAL_INT32(1, cached(c, 1));
+    TEST_ASSERT_EQUAL_INT32(3, cached(c, 3));
+    TEST_ASSERT_EQUAL_INT32(3, c->evictions);
+
+    // a hot key survives a scan of cold ones
+    for (int i = 0; i<50; i++) cached(c, 1);
+    for (k = 100; k<200; k++) aputil_cache_put(c, &k, boxed(k), 1);
+    TEST_ASSERT_EQUAL_INT32(1, cached(c, 1));
+    TEST_ASSERT_EQUAL_INT32(4, c->cnt);
+
+    for (k = 100; k<200; k++) aputil_cache_remove(c, &k, false);
+    TEST_ASSERT_EQUAL_INT32(3, c->cnt);
+    aputil_cache_free(c, false);
+    TEST_ASSERT_EQUAL_INT32(107, freed);
+
+}
+
+
+void test_function_cache_bytes(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    freed = 0;
+    APUTIL_Cache *c = aputil_cache_new(cache_lru, sizeof(doc_key), 0, 1000, count_free, NULL, doc_hash, doc_equal, &e);
+
+    doc_key d = { .version = 1 };
+    for (int i = 0; i<10; i++) {
+        snprintf(d.name, sizeof(d.name), "doc%d", i);
+        TEST_ASSERT_TRUE(aputil_cache_put(c, &d, boxed(i), 150) == E_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL_INT32(6, c->cnt);
+    TEST_ASSERT_EQUAL_INT32(900, c->bytes);
+
+    // version isn't part of the key
+    snprintf(d.name, sizeof(d.name), "doc9");
+    d.version = 2;
+    TEST_ASSERT_EQUAL_INT32(9, *(int64_t*)aputil_cache_get(c, &d));
+
+    // growing an entry evicts others, never itself
+    TEST_ASSERT_TRUE(aputil_cache_put(c, &d, boxed(99), 900) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(1, c->cnt);
+    TEST_ASSERT_EQUAL_INT32(900, c->bytes);
+    TEST_ASSERT_EQUAL_INT32(99, *(int64_t*)aputil_cache_get(c, &d));
+
+    int64_t *big = boxed(0);
+    TEST_ASSERT_TRUE(aputil_cache_put(c, &d, big, 1001) == E_FULL);
+    free(big);
+    TEST_ASSERT_EQUAL_INT32(1, c->cnt);
+
+    aputil_cache_free(c, false);
+    TEST_ASSERT_EQUAL_INT32(11, freed);
+
+}
+
+
+// against a plain list, linear lookups, same lru order
+void test_function_cache_vs_list(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    APUTIL_Cache *c = aputil_cache_new(cache_lru, sizeof(int64_t), 64, 0, free, NULL, NULL, NULL, &e);
+    APUTIL_LList *ref = aputil_llist_new(free, NULL, NULL, "lru", &e);
+
+    for (int i = 0; i<20000; i++) {
+        int64_t k = rand() % 200;
+        APUTIL_Node *n = ref->head;
+        while (n && *(int64_t*)n->data != k) n = n->next;
+        int64_t *got = aputil_cache_get(c, &k);
+        TEST_ASSERT_TRUE((n != NULL) == (got != NULL));
+        if (n) {
+            aputil_llist_move_front(ref, n);
+            continue;
+        }
+        aputil_cache_put(c, &k, boxed(k), 1);
+        aputil_llist_push(ref, boxed(k));
+        if (ref->cnt > 64) free(aputil_llist_pop_back(ref, &e));
+    }
+    TEST_ASSERT_EQUAL_INT32(ref->cnt, c->cnt);
+    for (APUTIL_Node *n = ref->head; n; n = n->next) TEST_ASSERT_NOT_NULL(aputil_cache_peek(c, n->data));
+
+    aputil_llist_free(ref, false);
+    aputil_cache_free(c, false);
+
+}
+
+
+//################ Sharded ################
+#define CACHE_THREADS 4
+
+typedef struct {
+    APUTIL_Cache_sharded *c;
+    size_t id;
+    size_t bad;
+} cache_worker;
+
+static void *cache_hammer(void *arg) {
+    cache_worker *w = arg;
+    UTIL_ERR e = E_SUCCESS;
+    for (int64_t i = 0; i<20000; i++) {
+        int64_t k = (i * 31 + (int64_t)w->id) % 1000;
+        int64_t *p = aputil_cache_sharded_get(w->c, &k, &e);
+        if (p) {
+            w->bad += *p != k * 2;
+            free(p);
+        } else {
+            aputil_cache_sharded_put(w->c, &k, boxed(k * 2), 1);
+        }
+    }
+    return NULL;
+}
+
+void test_function_cache_sharded(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    APUTIL_Cache_sharded *c = aputil_cache_sharded_new(8, cache_lru, sizeof(int64_t), 512, 0, free, copy_i64, NULL, NULL, &e);
+    TEST_ASSERT_NOT_NULL(c);
+    TEST_ASSERT_EQUAL_INT32(8, c->n_shards);
+    TEST_ASSERT_EQUAL_INT32(64, c->shards[0].cache->max_entries);
+
+    pthread_t tid[CACHE_THREADS];
+    cache_worker w[CACHE_THREADS];
+    for (size_t i = 0; i<CACHE_THREADS; i++) {
+        w[i] = (cache_worker){ .c = c, .id = i };
+        pthread_create(&tid[i], NULL, cache_hammer, &w[i]);
+    }
+    size_t total = 0;
+    for (size_t i = 0; i<CACHE_THREADS; i++) {
+        pthread_join(tid[i], NULL);
+        TEST_ASSERT_EQUAL_INT32(0, w[i].bad);
+    }
+    for (size_t i = 0; i<c->n_shards; i++) {
+        TEST_ASSERT_TRUE(c->shards[i].cache->cnt <= 64);
+        total += c->shards[i].cache->cnt;
+    }
+    TEST_ASSERT_TRUE(total > 0 && total <= 512);
+
+    int64_t k = 5000;
+    TEST_ASSERT_NULL(aputil_cache_sharded_get(c, &k, &e));
+    TEST_ASSERT_TRUE(e == E_DOESNT_EXIST);
+    aputil_cache_sharded_put(c, &k, boxed(1), 1);
+    TEST_ASSERT_TRUE(aputil_cache_sharded_remove(c, &k, false) == E_SUCCESS);
+    TEST_ASSERT_TRUE(aputil_cache_sharded_remove(c, &k, false) == E_DOESNT_EXIST);
+    aputil_cache_sharded_free(c, false);
+
+    // shard limits add up to the totals, never more
+    c = aputil_cache_sharded_new(8, cache_lru, sizeof(int64_t), 100, 1003, free, copy_i64, NULL, NULL, &e);
+    size_t entries = 0, bytes = 0;
+    for (size_t i = 0; i<c->n_shards; i++) {
+        entries += c->shards[i].cache->max_entries;
+        bytes += c->shards[i].cache->max_bytes;
+    }
+    TEST_ASSERT_EQUAL_INT32(100, entries);
+    TEST_ASSERT_EQUAL_INT32(1003, bytes);
+    aputil_cache_sharded_free(c, false);
+
+    // fewer entries than shards: fewer shards, one entry each
+    c = aputil_cache_sharded_new(8, cache_lru, sizeof(int64_t), 3, 0, free, copy_i64, NULL, NULL, &e);
+    TEST_ASSERT_EQUAL_INT32(2, c->n_shards);
+    TEST_ASSERT_EQUAL_INT32(2, c->shards[0].cache->max_entries);
+    TEST_ASSERT_EQUAL_INT32(1, c->shards[1].cache->max_entries);
+    aputil_cache_sharded_free(c, false);
+
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(aputil_cache_sharded_new(8, cache_lru, sizeof(int64_t), 512, 0, free, NULL, NULL, NULL, &e));
+    TEST_ASSERT_TRUE(e == E_EMPTY_FUNC);
+
+}
+
+
+//################ benchmarks ################
+static bool i64_equal(const void *a, const void *b) {
+    return *(const int64_t*)a == *(const int64_t*)b;
+}
+
+void test_function_cache_vs_llist_in(void) {
+
+    size_t ops = 200000, cap = 1000;
+    int64_t space = 1500;
+    UTIL_ERR e = E_SUCCESS;
+
+    // the hand rolled version: llist_in to find, delete + push to refresh
+    APUTIL_LList *lst = aputil_llist_new(free, NULL, NULL, "lru", &e);
+    srand(7);
+    size_t hits = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i<ops; i++) {
+        int64_t k = rand() % space;
+        APUTIL_Node *n = aputil_llist_in(lst, &k, i64_equal, &e);
+        if (n) {
+            hits++;
+            int64_t *d = n->data;
+            aputil_llist_delete(lst, n, true);
+            aputil_llist_push(lst, d);
+            continue;
+        }
+        aputil_llist_push(lst, boxed(k));
+        if (lst->cnt > cap) free(aputil_llist_pop_back(lst, &e));
+    }
+    clock_t stop = clock();
+    fprintf(stdout, "llist_in lru %zu ops: %f s\n", ops, ((double) (stop - start)) / CLOCKS_PER_SEC);
+    aputil_llist_free(lst, false);
+
+    APUTIL_Cache *c = aputil_cache_new(cache_lru, sizeof(int64_t), cap, 0, free, NULL, NULL, NULL, &e);
+    srand(7);
+    start = clock();
+    for (size_t i = 0; i<ops; i++) {
+        int64_t k = rand() % space;
+        if (!aputil_cache_get(c, &k)) aputil_cache_put(c, &k, boxed(k), 1);
+    }
+    stop = clock();
+    fprintf(stdout, "aputil_cache lru %zu ops: %f s\n", ops, ((double) (stop - start)) / CLOCKS_PER_SEC);
+    TEST_ASSERT_EQUAL_INT32(hits, c->hits);
+    aputil_cache_free(c, false);
+
+    srand( time(NULL) );
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // policies
+    RUN_TEST(test_function_cache_lru);
+    RUN_TEST(test_function_cache_lfu);
+    RUN_TEST(test_function_cache_bytes);
+    RUN_TEST(test_function_cache_vs_list);
+
+    // sharded
+    RUN_TEST(test_function_cache_sharded);
+
+    // benchmarks
+    RUN_BENCH(test_function_cache_vs_llist_in);
+
+    return UNITY_END();
+}
@@ -0,0 +1,213 @@
+/*
+ *    test src/deque.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+//################ Generic Deque ################
+void test_function_deque_new(void) {
+
+    Deque *d = deque_new(sizeof(long), 10);
+    TEST_ASSERT_NOT_NULL(d);
+    TEST_ASSERT_NOT_NULL(d->data);
+    TEST_ASSERT_EQUAL_INT32(10, d->cap);
+    TEST_ASSERT_EQUAL_INT32(0, d->size);
+    TEST_ASSERT_EQUAL_INT32(0, d->head);
+    TEST_ASSERT_EQUAL_INT32(sizeof(long), d->elem_size);
+
+    TEST_ASSERT_NULL(deque_new(0, 10));
+    TEST_ASSERT_NULL(deque_new(4, 0));
+
+    deque_free(d);
+
+}
+
+
+void test_function_deque_push_pop(void) {
+
+    Deque *d = deque_new(sizeof(int), 2);
+    UTIL_ERR e = E_SUCCESS;
+
+    // 4 3 2 1 0 | 0 1 2 3 4, forces several resizes while wrapped
+    for (int i = 0; i<5; i++) {
+        TEST_ASSERT_TRUE(deque_push_front(d, &i) == E_SUCCESS);
+        TEST_ASSERT_TRUE(deque_push_back(d, &i) == E_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL_INT32(10, d->size);
+
+    int expect[] = {4, 3, 2, 1, 0, 0, 1, 2, 3, 4};
+    for (int i = 0; i<10; i++) {
+        TEST_ASSERT_EQUAL_INT32(expect[i], *(int*)deque_get(d, i, &e));
+    }
+    TEST_ASSERT_NULL(deque_get(d, 10, &e));
+    TEST_ASSERT_TRUE(e == E_OUTOFBOUNDS);
+
+    int out = -1;
+    TEST_ASSERT_TRUE(deque_pop_front(d, &out) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(4, out);
+    TEST_ASSERT_TRUE(deque_pop_back(d, &out) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(4, out);
+    TEST_ASSERT_TRUE(deque_pop_back(d, NULL) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(7, d->size);
+
+    deque_clear(d);
+    TEST_ASSERT_TRUE(deque_pop_front(d, &out) == E_NODATA);
+    TEST_ASSERT_TRUE(deque_push_back(d, NULL) == E_EMPTY_ARG);
+
+    deque_free(d);
+
+}
+
+
+void test_function_deque_spans(void) {
+
+    Deque *d = deque_new(sizeof(int), 8);
+    void *first, *second;
+    size_t flen, slen;
+
+    TEST_ASSERT_EQUAL_INT32(0, deque_spans(d, &first, &flen, &second, &slen));
+
+    for (int i = 0; i<4; i++) deque_push_back(d, &i);
+    TEST_ASSERT_EQUAL_INT32(1, deque_spans(d, &first, &flen, &second, &slen));
+    TEST_ASSERT_EQUAL_INT32(4, flen);
+    TEST_ASSERT_EQUAL_INT32(0, slen);
+
+    // wrap: front elements go to the end of the buffer
+    for (int i = -1; i>-4; i--) deque_push_front(d, &i);
+    TEST_ASSERT_EQUAL_INT32(2, deque_spans(d, &first, &flen, &second, &slen));
+    TEST_ASSERT_EQUAL_INT32(3, flen);
+    TEST_ASSERT_EQUAL_INT32(4, slen);
+    TEST_ASSERT_EQUAL_INT32(-3, ((int*)first)[0]);
+    TEST_ASSERT_EQUAL_INT32(0, ((int*)second)[0]);
+
+    TEST_ASSERT_TRUE(deque_make_contiguous(d) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(0, d->head);
+    for (int i = 0; i<7; i++) TEST_ASSERT_EQUAL_INT32(i - 3, ((int*)d->data)[i]);
+
+    deque_free(d);
+
+}
+
+
+void test_function_deque_vector_conversion(void) {
+
+    Vector *v = vector_new(sizeof(int), 4);
+    for (int i = 0; i<4; i++) vector_add_back(v, &i);
+    void *buf = v->data;
+
+    Deque *d = deque_from_vector(v);
+    TEST_ASSERT_TRUE(d->data == buf);
+    TEST_ASSERT_EQUAL_INT32(4, d->size);
+
+    int val = 10;
+    deque_pop_front(d, NULL);
+    deque_push_back(d, &val);      // wraps into slot 0
+    val = 20;
+    deque_push_front(d, &val);     // full, forces a resize
+
+    v = deque_to_vector(d);
+    TEST_ASSERT_EQUAL_INT32(5, v->size);
+    int expect[] = {20, 1, 2, 3, 10};
+    UTIL_ERR e = E_SUCCESS;
+    for (int i = 0; i<5; i++) {
+        TEST_ASSERT_EQUAL_INT32(expect[i], *(int*)vector_get(v, i, &e));
+    }
+
+    vector_free(v);
+
+}
+
+
+//################ i32 Deque ################
+void test_function_deque_i32_push_pop(void) {
+
+    Deque_i32 *d = deque_i32_new(1);
+    UTIL_ERR e = E_SUCCESS;
+
+    for (int32_t i = 0; i<100; i++) {
+        if (i % 2) deque_i32_push_front(d, i);
+        else deque_i32_push_back(d, i);
+    }
+    TEST_ASSERT_EQUAL_INT32(100, d->size);
+    TEST_ASSERT_EQUAL_INT32(99, deque_i32_get(d, 0, &e));
+    TEST_ASSERT_EQUAL_INT32(98, deque_i32_get(d, 99, &e));
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+
+    TEST_ASSERT_EQUAL_INT32(99, deque_i32_pop_front(d, &e));
+    TEST_ASSERT_EQUAL_INT32(98, deque_i32_pop_back(d, &e));
+
+    Vec_i32 *v = deque_i32_to_vec(d);
+    TEST_ASSERT_EQUAL_INT32(98, v->size);
+    TEST_ASSERT_EQUAL_INT32(97, v->data[0]);
+    TEST_ASSERT_EQUAL_INT32(1, v->data[48]);
+    TEST_ASSERT_EQUAL_INT32(0, v->data[49]);
+    TEST_ASSERT_EQUAL_INT32(96, v->data[97]);
+
+    d = deque_i32_from_vec(v);
+    deque_i32_clear(d);
+    deque_i32_pop_back(d, &e);
+    TEST_ASSERT_TRUE(e == E_NODATA);
+
+    deque_i32_free(d);
+
+}
+
+
+void test_function_deque_i32_vs_add_front(void) {
+
+    int cnt = 50000;
+    clock_t start, stop;
+
+    Vec_i32 *v = vec_i32_new(1);
+    start = clock();
+    for (int i = 1; i<=cnt; i++) vec_i32_add_front(v, i);
+    stop = clock();
+    fprintf(stdout, "vec_i32_add_front x%d: %f s\n", cnt, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    Deque_i32 *d = deque_i32_new(1);
+    start = clock();
+    for (int i = 1; i<=cnt; i++) deque_i32_push_front(d, i);
+    stop = clock();
+    fprintf(stdout, "deque_i32_push_front x%d: %f s\n", cnt, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    Vec_i32 *dv = deque_i32_to_vec(d);
+    TEST_ASSERT_EQUAL_INT32(v->size, dv->size);
+    for (int i = 0; i<cnt; i++) TEST_ASSERT_EQUAL_INT32(v->data[i], dv->data[i]);
+
+    vec_i32_free(v);
+    vec_i32_free(dv);
+
+}
+
+
+
+int main(void) {
+
+    UNITY_BEGIN();
+
+    // generic deque
+    RUN_TEST(test_function_deque_new);
+    RUN_TEST(test_function_deque_push_pop);
+    RUN_TEST(test_function_deque_spans);
+    RUN_TEST(test_function_deque_vector_conversion);
+
+    // i32 deque
+    RUN_TEST(test_function_deque_i32_push_pop);
+    RUN_TEST(test_function_deque_i32_vs_add_front);
+
+    return UNITY_END();
+}
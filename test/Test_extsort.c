@@ -0,0 +1,210 @@
+/*
+ *    test src/extsort.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+#define IN_PATH "/tmp/aputil_test_extsort_in.bin"
+#define OUT_PATH "/tmp/aputil_test_extsort_out.bin"
+#define LINK_PATH "/tmp/aputil_test_extsort_link.bin"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {
+    remove(IN_PATH);
+    remove(OUT_PATH);
+    remove(LINK_PATH);
+}
+
+
+
+typedef struct {
+    uint32_t key;
+    uint32_t seq;       // input position, checks stability
+    char pad[8];
+} rec;
+
+static int rec_comp(const void *d1, const void *d2) {
+    uint32_t a = ((const rec*)d1)->key, b = ((const rec*)d2)->key;
+    return (a > b) - (a < b);
+}
+
+// write cnt records with keys in [0, range), returns the key sum
+static uint64_t write_recs(const char *path, size_t cnt, uint32_t range) {
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    uint64_t sum = 0;
+    rec r = {0};
+    for (size_t i = 0; i<cnt; i++) {
+        r.key = (uint32_t)rand() % range;
+        r.seq = (uint32_t)i;
+        sum += r.key;
+        fwrite(&r, sizeof(r), 1, f);
+    }
+    fclose(f);
+    return sum;
+}
+
+// check order (and stability), count and key sum of a sorted file
+static void check_sorted(const char *path, size_t cnt, uint64_t sum, bool stable) {
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    rec r, prev = {0};
+    size_t n = 0;
+    uint64_t got = 0;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (n) {
+            TEST_ASSERT_TRUE(prev.key <= r.key);
+            if (stable && prev.key == r.key) TEST_ASSERT_TRUE(prev.seq < r.seq);
+        }
+        got += r.key;
+        prev = r;
+        n++;
+    }
+    fclose(f);
+    TEST_ASSERT_EQUAL_INT32(cnt, n);
+    TEST_ASSERT_TRUE(got == sum);
+}
+
+
+//################ External Sort ################
+void test_function_extsort_in_memory(void) {
+
+    // budget holds the whole input, no runs are spilled
+    uint64_t sum = write_recs(IN_PATH, 10000, 1u << 30);
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, sizeof(rec), rec_comp, NULL) == E_SUCCESS);
+    check_sorted(OUT_PATH, 10000, sum, false);
+
+    // empty input gives an empty output
+    fclose(fopen(IN_PATH, "wb"));
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, sizeof(rec), rec_comp, NULL) == E_SUCCESS);
+    check_sorted(OUT_PATH, 0, 0, false);
+
+    // sorting a file onto itself, or onto a hard link of itself, reads the whole input first
+    sum = write_recs(IN_PATH, 10000, 1000);
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, IN_PATH, sizeof(rec), rec_comp, NULL) == E_SUCCESS);
+    check_sorted(IN_PATH, 10000, sum, false);
+
+    sum = write_recs(IN_PATH, 10000, 1000);
+    TEST_ASSERT_EQUAL_INT32(0, link(IN_PATH, LINK_PATH));
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, LINK_PATH, sizeof(rec), rec_comp, NULL) == E_SUCCESS);
+    check_sorted(LINK_PATH, 10000, sum, false);
+
+}
+
+
+void test_function_extsort_multi_pass(void) {
+
+    // 64k budget: ~40 runs of 4096 records, fan-in 2, several merge passes
+    size_t cnt = 150000;
+    uint64_t sum = write_recs(IN_PATH, cnt, 1000);
+    Extsort_opts o = { .mem_budget = 64 << 10, .tmp_dir = "/tmp", .stable = false };
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, sizeof(rec), rec_comp, &o) == E_SUCCESS);
+    check_sorted(OUT_PATH, cnt, sum, false);
+
+    // wider fan-in, single merge pass, stable chunks keep input order of equal keys
+    o.mem_budget = 1 << 20;
+    o.stable = true;
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, sizeof(rec), rec_comp, &o) == E_SUCCESS);
+    check_sorted(OUT_PATH, cnt, sum, true);
+
+    o.mem_budget = 64 << 10;
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, sizeof(rec), rec_comp, &o) == E_SUCCESS);
+    check_sorted(OUT_PATH, cnt, sum, true);
+
+}
+
+
+void test_function_extsort_errors(void) {
+
+    TEST_ASSERT_TRUE(extsort_file("/nonexistent/in", OUT_PATH, sizeof(rec), rec_comp, NULL) == E_IO);
+    TEST_ASSERT_TRUE(extsort_file(NULL, OUT_PATH, sizeof(rec), rec_comp, NULL) == E_EMPTY_ARG);
+
+    write_recs(IN_PATH, 100, 10);
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, 0, rec_comp, NULL) == E_EMPTY_ARG);
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, sizeof(rec), NULL, NULL) == E_EMPTY_FUNC);
+
+    // 100 * 16 bytes is not a whole number of 24 byte records, no output is left
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, 24, rec_comp, NULL) == E_IO);
+    TEST_ASSERT_NULL(fopen(OUT_PATH, "rb"));
+
+    // an existing output survives a failed sort
+    uint64_t sum = write_recs(OUT_PATH, 50, 10);
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, 24, rec_comp, NULL) == E_IO);
+    FILE *f = fopen(OUT_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    rec recs[64];
+    TEST_ASSERT_EQUAL_INT32(50, fread(recs, sizeof(rec), 64, f));
+    fclose(f);
+    for (int i = 0; i<50; i++) {
+        TEST_ASSERT_EQUAL_INT32(i, recs[i].seq);
+        sum -= recs[i].key;
+    }
+    TEST_ASSERT_TRUE(sum == 0);
+
+    Extsort_opts o = { .mem_budget = 1024, .tmp_dir = "/nonexistent", .stable = false };
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, sizeof(rec), rec_comp, &o) == E_IO);
+
+}
+
+
+//################ benchmarks ################
+void test_function_extsort_vs_vector_sort(void) {
+
+    size_t cnt = 1000000;
+    clock_t start, stop;
+    uint64_t sum = write_recs(IN_PATH, cnt, 1u << 30);
+
+    // load everything and sort in memory
+    start = clock();
+    FILE *f = fopen(IN_PATH, "rb");
+    Vector *v = vector_new(sizeof(rec), cnt);
+    v->size = fread(v->data, sizeof(rec), cnt, f);
+    fclose(f);
+    vector_sort(v, vector, rec_comp);
+    f = fopen(OUT_PATH, "wb");
+    fwrite(v->data, sizeof(rec), v->size, f);
+    fclose(f);
+    stop = clock();
+    fprintf(stdout, "in memory vector_sort %zu MiB: %f s\n", cnt * sizeof(rec) >> 20, ((double) (stop - start)) / CLOCKS_PER_SEC);
+    vector_free(v);
+
+    // 1/8 of the data in memory at once
+    Extsort_opts o = { .mem_budget = cnt * sizeof(rec) / 8, .tmp_dir = NULL, .stable = false };
+    start = clock();
+    TEST_ASSERT_TRUE(extsort_file(IN_PATH, OUT_PATH, sizeof(rec), rec_comp, &o) == E_SUCCESS);
+    stop = clock();
+    fprintf(stdout, "extsort %zu KiB budget: %f s\n", o.mem_budget >> 10, ((double) (stop - start)) / CLOCKS_PER_SEC);
+    check_sorted(OUT_PATH, cnt, sum, false);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // external sort
+    RUN_TEST(test_function_extsort_in_memory);
+    RUN_TEST(test_function_extsort_multi_pass);
+    RUN_TEST(test_function_extsort_errors);
+
+    // benchmarks
+    RUN_BENCH(test_function_extsort_vs_vector_sort);
+
+    return UNITY_END();
+}
@@ -0,0 +1,398 @@
+/*
+ *    test src/filter.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+#define BLOOM_PATH "/tmp/aputil_test_filter_bloom.bin"
+#define CUCKOO_PATH "/tmp/aputil_test_filter_cuckoo.bin"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {
+    remove(BLOOM_PATH);
+    remove(CUCKOO_PATH);
+}
+
+
+
+// keys [0, n) are added, keys from n up are never added
+static double bloom_measured(const BloomFilter *f, uint64_t from, size_t probes) {
+    size_t hits = 0;
+    for (uint64_t k = from; k<from + probes; k++) hits += bloom_contains(f, &k, sizeof(k));
+    return (double)hits / probes;
+}
+
+static double cuckoo_measured(const CuckooFilter *f, uint64_t from, size_t probes) {
+    size_t hits = 0;
+    for (uint64_t k = from; k<from + probes; k++) hits += cuckoo_contains(f, &k, sizeof(k));
+    return (double)hits / probes;
+}
+
+static bool i32_equal(void *a, void *b) {
+    return *(int32_t*)a == *(int32_t*)b;
+}
+
+// flip one byte in place
+static void corrupt_file(const char *path, long offset) {
+    FILE *f = fopen(path, "r+b");
+    fseek(f, offset, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(c ^ 0x5a, f);
+    fclose(f);
+}
+
+
+//################ Bloom ################
+void test_function_bloom(void) {
+
+    double targets[] = { 0.1, 0.01, 0.001 };
+    size_t n = 50000, probes = 400000;
+    for (size_t t = 0; t<sizeof(targets) / sizeof(targets[0]); t++) {
+        BloomFilter *f = bloom_new(n, targets[t], 17);
+        TEST_ASSERT_NOT_NULL(f);
+        TEST_ASSERT_TRUE(((uintptr_t)f->blocks & (APUTIL_CACHE_LINE - 1)) == 0);
+        for (uint64_t k = 0; k<n; k++) TEST_ASSERT_TRUE(bloom_add(f, &k, sizeof(k)) == E_SUCCESS);
+        TEST_ASSERT_TRUE(f->count == n);
+
+        // no false negatives, false positives close to the model
+        for (uint64_t k = 0; k<n; k++) TEST_ASSERT_TRUE(bloom_contains(f, &k, sizeof(k)));
+        double got = bloom_measured(f, n, probes), want = bloom_fpp(f->n_blocks, n);
+        fprintf(stdout, "bloom target %f: model %f measured %f, %f bits/key\n", targets[t], want, got, f->n_blocks * 256.0 / n);
+        TEST_ASSERT_TRUE(want <= targets[t]);
+        TEST_ASSERT_TRUE(got < targets[t] * 1.3);
+        TEST_ASSERT_TRUE(got > want * 0.7);
+
+        bloom_clear(f);
+        TEST_ASSERT_TRUE(f->count == 0);
+        TEST_ASSERT_TRUE(bloom_measured(f, 0, 1000) <= 0);
+        bloom_free(f);
+    }
+
+    // merge: the union of both key sets, only between filters of equal shape
+    BloomFilter *a = bloom_new(1000, 0.01, 1), *b = bloom_new(1000, 0.01, 1);
+    BloomFilter *c = bloom_new(1000, 0.01, 2), *d = bloom_new(100000, 0.01, 1);
+    for (uint64_t k = 0; k<500; k++) bloom_add(a, &k, sizeof(k));
+    for (uint64_t k = 500; k<1000; k++) bloom_add(b, &k, sizeof(k));
+    TEST_ASSERT_TRUE(bloom_merge(a, b) == E_SUCCESS);
+    for (uint64_t k = 0; k<1000; k++) TEST_ASSERT_TRUE(bloom_contains(a, &k, sizeof(k)));
+    TEST_ASSERT_TRUE(a->count == 1000);
+    TEST_ASSERT_TRUE(bloom_merge(a, c) == E_BAD_TYPE);
+    TEST_ASSERT_TRUE(bloom_merge(a, d) == E_BAD_TYPE);
+    TEST_ASSERT_TRUE(bloom_merge(NULL, a) == E_EMPTY_OBJ);
+    TEST_ASSERT_TRUE(bloom_merge(a, NULL) == E_EMPTY_ARG);
+
+    // the hash variants agree with hashing under the filter's seed
+    uint64_t key = 123456789;
+    TEST_ASSERT_TRUE(bloom_contains_hash(a, hash_bytes_seed(&key, sizeof(key), a->seed)) == bloom_contains(a, &key, sizeof(key)));
+    bloom_add_hash(c, hash_bytes_seed(&key, sizeof(key), c->seed));
+    TEST_ASSERT_TRUE(bloom_contains(c, &key, sizeof(key)));
+
+    TEST_ASSERT_TRUE(bloom_add(NULL, &key, sizeof(key)) == E_EMPTY_OBJ);
+    TEST_ASSERT_TRUE(bloom_add(a, NULL, 4) == E_EMPTY_ARG);
+    TEST_ASSERT_TRUE(bloom_add(a, NULL, 0) == E_SUCCESS);
+    TEST_ASSERT_TRUE(bloom_contains(a, NULL, 0));
+    TEST_ASSERT_FALSE(bloom_contains(NULL, &key, sizeof(key)));
+
+    bloom_free(a);
+    bloom_free(b);
+    bloom_free(c);
+    bloom_free(d);
+
+}
+
+
+void test_function_filter_sizing(void) {
+
+    // more blocks never raise the rate, more keys never lower it
+    for (size_t blocks = 1; blocks<2000; blocks += 37) {
+        TEST_ASSERT_TRUE(bloom_fpp(blocks + 1, 10000) <= bloom_fpp(blocks, 10000));
+        TEST_ASSERT_TRUE(bloom_fpp(blocks, 10001) >= bloom_fpp(blocks, 10000));
+    }
+    TEST_ASSERT_TRUE(bloom_fpp(10, 0) <= 0);
+    TEST_ASSERT_TRUE(bloom_fpp(0, 10) >= 1);
+    TEST_ASSERT_TRUE(bloom_fpp(1, 1000000) >= 1);
+
+    // the fewest blocks that meet the target
+    double targets[] = { 0.5, 0.05, 0.01, 1e-4, 1e-6 };
+    for (size_t t = 0; t<sizeof(targets) / sizeof(targets[0]); t++) {
+        size_t blocks = bloom_blocks_for(1000000, targets[t]);
+        TEST_ASSERT_TRUE(blocks > 0);
+        TEST_ASSERT_TRUE(bloom_fpp(blocks, 1000000) <= targets[t]);
+        TEST_ASSERT_TRUE(bloom_fpp(blocks - 1, 1000000) > targets[t]);
+    }
+    TEST_ASSERT_TRUE(bloom_blocks_for(0, 0.01) == 1);
+    TEST_ASSERT_TRUE(bloom_blocks_for(100, 0) == 0);
+    TEST_ASSERT_TRUE(bloom_blocks_for(100, 1) == 0);
+    TEST_ASSERT_NULL(bloom_new(100, 1.5, 0));
+
+    // cuckoo: fingerprint bits for the bound 2b / 2^f, buckets under the load limit
+    TEST_ASSERT_TRUE(cuckoo_fp_bits_for(0.5) == 4);
+    TEST_ASSERT_TRUE(cuckoo_fp_bits_for(0.01) == 10);
+    TEST_ASSERT_TRUE(cuckoo_fp_bits_for(0.001) == 13);
+    TEST_ASSERT_TRUE(cuckoo_fp_bits_for(1e-9) == 16);
+    size_t sizes[] = { 0, 1, 3, 4, 100, 1000, 123457 };
+    for (size_t i = 0; i<sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t b = cuckoo_buckets_for(sizes[i]);
+        TEST_ASSERT_TRUE(b && !(b & (b - 1)));
+        TEST_ASSERT_TRUE(sizes[i] < b * CUCKOO_SLOTS * CUCKOO_MAX_LOAD);
+        TEST_ASSERT_TRUE(b == 1 || sizes[i] >= b / 2 * CUCKOO_SLOTS * CUCKOO_MAX_LOAD);
+    }
+    TEST_ASSERT_NULL(cuckoo_new(100, 0, 0));
+
+}
+
+
+//################ Cuckoo ################
+void test_function_cuckoo(void) {
+
+    size_t n = 100000, probes = 400000;
+    CuckooFilter *f = cuckoo_new(n, 0.001, 99);
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_TRUE(f->fp_bits == 13);
+    for (uint64_t k = 0; k<n; k++) TEST_ASSERT_TRUE(cuckoo_add(f, &k, sizeof(k)) == E_SUCCESS);
+    TEST_ASSERT_TRUE(f->count == n);
+    TEST_ASSERT_FALSE(f->has_victim);
+    for (uint64_t k = 0; k<n; k++) TEST_ASSERT_TRUE(cuckoo_contains(f, &k, sizeof(k)));
+
+    double got = cuckoo_measured(f, n, probes);
+    fprintf(stdout, "cuckoo target 0.001: measured %f at load %f\n", got, (double)n / (f->n_buckets * CUCKOO_SLOTS));
+    TEST_ASSERT_TRUE(got < 0.001);
+
+    // remove the even keys: the odd ones stay, the even ones mostly read as absent
+    for (uint64_t k = 0; k<n; k += 2) TEST_ASSERT_TRUE(cuckoo_remove(f, &k, sizeof(k)) == E_SUCCESS);
+    TEST_ASSERT_TRUE(f->count == n / 2);
+    size_t left = 0;
+    for (uint64_t k = 0; k<n; k++) {
+        if (k & 1) TEST_ASSERT_TRUE(cuckoo_contains(f, &k, sizeof(k)));
+        else left += cuckoo_contains(f, &k, sizeof(k));
+    }
+    TEST_ASSERT_TRUE(left < n / 2 / 500);
+
+    // duplicates are counted copies, each remove takes one
+    uint64_t key = 7;
+    TEST_ASSERT_TRUE(cuckoo_add(f, &key, sizeof(key)) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cuckoo_add(f, &key, sizeof(key)) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cuckoo_remove(f, &key, sizeof(key)) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cuckoo_contains(f, &key, sizeof(key)));
+    TEST_ASSERT_TRUE(cuckoo_remove(f, &key, sizeof(key)) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cuckoo_remove(f, &key, sizeof(key)) == E_SUCCESS);  // the original odd key
+    TEST_ASSERT_FALSE(cuckoo_contains(f, &key, sizeof(key)));
+
+    size_t before = f->count;
+    UTIL_ERR err = cuckoo_remove(f, &key, sizeof(key));
+    TEST_ASSERT_TRUE(err == E_DOESNT_EXIST);
+    TEST_ASSERT_TRUE(f->count == before);
+
+    TEST_ASSERT_TRUE(cuckoo_add(NULL, &key, sizeof(key)) == E_EMPTY_OBJ);
+    TEST_ASSERT_TRUE(cuckoo_add(f, NULL, 8) == E_EMPTY_ARG);
+    TEST_ASSERT_TRUE(cuckoo_remove(NULL, &key, sizeof(key)) == E_EMPTY_OBJ);
+    TEST_ASSERT_FALSE(cuckoo_contains(NULL, &key, sizeof(key)));
+    cuckoo_free(f);
+
+}
+
+
+void test_function_cuckoo_full(void) {
+
+    // far past the sized capacity: adds fail only once a kick chain gave up
+    CuckooFilter *f = cuckoo_new(1000, 0.01, 5);
+    size_t cap = f->n_buckets * CUCKOO_SLOTS;
+    uint64_t k = 0;
+    while (cuckoo_add(f, &k, sizeof(k)) == E_SUCCESS) k++;
+    fprintf(stdout, "cuckoo full at load %f (%llu of %zu)\n", (double)k / cap, (unsigned long long)k, cap);
+    TEST_ASSERT_TRUE(f->has_victim);
+    TEST_ASSERT_TRUE(f->count == k);
+    TEST_ASSERT_TRUE(k > cap * 0.9 && k <= cap + 1);
+
+    // nothing added is lost, the victim included
+    for (uint64_t i = 0; i<k; i++) TEST_ASSERT_TRUE(cuckoo_contains(f, &i, sizeof(i)));
+    TEST_ASSERT_TRUE(cuckoo_add(f, &k, sizeof(k)) == E_FULL);
+    TEST_ASSERT_TRUE(f->count == k);
+
+    // freeing slots puts the victim back, adds work again
+    for (uint64_t i = 0; i<k / 4; i++) TEST_ASSERT_TRUE(cuckoo_remove(f, &i, sizeof(i)) == E_SUCCESS);
+    TEST_ASSERT_FALSE(f->has_victim);
+    for (uint64_t i = k / 4; i<k; i++) TEST_ASSERT_TRUE(cuckoo_contains(f, &i, sizeof(i)));
+    TEST_ASSERT_TRUE(cuckoo_add(f, &k, sizeof(k)) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cuckoo_contains(f, &k, sizeof(k)));
+    cuckoo_free(f);
+
+}
+
+
+//################ Save / Load ################
+void test_function_filter_save_load(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    BloomFilter *b = bloom_new(20000, 0.01, 3);
+    for (uint64_t k = 0; k<20000; k++) bloom_add(b, &k, sizeof(k));
+    TEST_ASSERT_TRUE(bloom_save(b, BLOOM_PATH) == E_SUCCESS);
+    BloomFilter *b2 = bloom_load(BLOOM_PATH, &e);
+    TEST_ASSERT_NOT_NULL(b2);
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+    TEST_ASSERT_TRUE(b2->n_blocks == b->n_blocks && b2->count == b->count && b2->seed == b->seed);
+    TEST_ASSERT_TRUE(((uintptr_t)b2->blocks & (APUTIL_CACHE_LINE - 1)) == 0);
+    TEST_ASSERT_EQUAL_MEMORY(b->blocks, b2->blocks, b->n_blocks * BLOOM_LANES * sizeof(uint32_t));
+    for (uint64_t k = 0; k<100000; k++) TEST_ASSERT_TRUE(bloom_contains(b, &k, sizeof(k)) == bloom_contains(b2, &k, sizeof(k)));
+    TEST_ASSERT_TRUE(bloom_merge(b2, b) == E_SUCCESS);
+
+    // a victim and the kick rng survive the round trip
+    CuckooFilter *c = cuckoo_new(500, 0.01, 4);
+    uint64_t k = 0;
+    while (cuckoo_add(c, &k, sizeof(k)) == E_SUCCESS) k++;
+    TEST_ASSERT_TRUE(cuckoo_save(c, CUCKOO_PATH) == E_SUCCESS);
+    CuckooFilter *c2 = cuckoo_load(CUCKOO_PATH, &e);
+    TEST_ASSERT_NOT_NULL(c2);
+    TEST_ASSERT_TRUE(c2->n_buckets == c->n_buckets && c2->count == c->count && c2->fp_bits == c->fp_bits);
+    TEST_ASSERT_TRUE(c2->has_victim && c2->victim_fp == c->victim_fp && c2->victim_idx == c->victim_idx);
+    for (uint64_t i = 0; i<20000; i++) TEST_ASSERT_TRUE(cuckoo_contains(c, &i, sizeof(i)) == cuckoo_contains(c2, &i, sizeof(i)));
+    for (uint64_t i = 0; i<k / 2; i++) {
+        TEST_ASSERT_TRUE(cuckoo_remove(c, &i, sizeof(i)) == E_SUCCESS);
+        TEST_ASSERT_TRUE(cuckoo_remove(c2, &i, sizeof(i)) == E_SUCCESS);
+    }
+    for (uint64_t i = 100000; i<100500; i++) {
+        TEST_ASSERT_TRUE(cuckoo_add(c, &i, sizeof(i)) == cuckoo_add(c2, &i, sizeof(i)));
+    }
+    TEST_ASSERT_EQUAL_MEMORY(c->slots, c2->slots, c->n_buckets * CUCKOO_SLOTS * sizeof(uint16_t));
+
+    // damaged table, damaged params, the other filter's file
+    corrupt_file(BLOOM_PATH, sizeof(Serial_header) + 100);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(bloom_load(BLOOM_PATH, &e));
+    TEST_ASSERT_TRUE(e == E_CORRUPT);
+    cuckoo_save(c, CUCKOO_PATH);
+    corrupt_file(CUCKOO_PATH, sizeof(Serial_header) + 1);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(cuckoo_load(CUCKOO_PATH, &e));
+    TEST_ASSERT_TRUE(e == E_CORRUPT);
+    cuckoo_save(c, CUCKOO_PATH);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(bloom_load(CUCKOO_PATH, &e));
+    TEST_ASSERT_TRUE(e == E_BAD_TYPE);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(cuckoo_load("/tmp/aputil_test_filter_missing.bin", &e));
+    TEST_ASSERT_TRUE(e == E_IO);
+    TEST_ASSERT_TRUE(bloom_save(NULL, BLOOM_PATH) == E_EMPTY_OBJ);
+    TEST_ASSERT_TRUE(cuckoo_save(c, NULL) == E_EMPTY_ARG);
+
+    bloom_free(b);
+    bloom_free(b2);
+    cuckoo_free(c);
+    cuckoo_free(c2);
+
+}
+
+
+//################ benchmarks ################
+/*
+    lookups of absent keys, the case a pre-check is for: a linear vector_in scan
+    and a list scan against the filters (which answer from one or two cache lines)
+*/
+void test_function_filter_bench(void) {
+
+    size_t n = 20000, scans = 2000, checks = 4000000;
+    UTIL_ERR e = E_SUCCESS;
+    Vector *v = vector_new(sizeof(int32_t), n);
+    APUTIL_LList *lst = aputil_llist_new(free, NULL, NULL, "bench", &e);
+    BloomFilter *b = bloom_new(n, 0.01, 11);
+    CuckooFilter *c = cuckoo_new(n, 0.01, 11);
+    for (int32_t i = 0; i<(int32_t)n; i++) {
+        vector_add_back(v, &i);
+        int32_t *p = malloc(sizeof(int32_t));
+        *p = i;
+        aputil_llist_push_back(lst, p);
+        bloom_add(b, &i, sizeof(i));
+        cuckoo_add(c, &i, sizeof(i));
+    }
+
+    double start = wall();
+    intmax_t found = 0;
+    for (int32_t i = 0; i<(int32_t)scans; i++) {
+        int32_t key = (int32_t)n + i;
+        found += vector_in(v, &key, i32_equal, &e) >= 0;
+    }
+    double secs = wall() - start;
+    TEST_ASSERT_TRUE(found == 0);
+    fprintf(stdout, "vector_in miss, %zu elements: %f us/lookup\n", n, secs / scans * 1e6);
+
+    start = wall();
+    for (int32_t i = 0; i<(int32_t)scans; i++) {
+        int32_t key = (int32_t)n + i;
+        found += aputil_llist_in(lst, &key, (bool(*)(const void*, const void*))i32_equal, &e) != NULL;
+    }
+    secs = wall() - start;
+    TEST_ASSERT_TRUE(found == 0);
+    fprintf(stdout, "aputil_llist_in miss, %zu elements: %f us/lookup\n", n, secs / scans * 1e6);
+
+    start = wall();
+    for (int32_t i = 0; i<(int32_t)checks; i++) {
+        int32_t key = (int32_t)n + i;
+        found += bloom_contains(b, &key, sizeof(key));
+    }
+    secs = wall() - start;
+    fprintf(stdout, "bloom_contains miss: %f ns/lookup (%f passed)\n", secs / checks * 1e9, (double)found / checks);
+
+    found = 0;
+    start = wall();
+    for (int32_t i = 0; i<(int32_t)checks; i++) {
+        int32_t key = (int32_t)n + i;
+        found += cuckoo_contains(c, &key, sizeof(key));
+    }
+    secs = wall() - start;
+    fprintf(stdout, "cuckoo_contains miss: %f ns/lookup (%f passed)\n", secs / checks * 1e9, (double)found / checks);
+
+    // probe cost alone, hash precomputed, out of cache filter
+    BloomFilter *big = bloom_new(8000000, 0.01, 1);
+    for (uint64_t k = 0; k<8000000; k += 2) bloom_add_hash(big, hash_u64(k, 0));
+    found = 0;
+    start = wall();
+    for (uint64_t k = 0; k<checks; k++) found += bloom_contains_hash(big, hash_u64(k, 0));
+    secs = wall() - start;
+    fprintf(stdout, "bloom_contains_hash, %zu KiB filter: %f ns/probe\n", big->n_blocks * 32 / 1024, secs / checks * 1e9);
+    TEST_ASSERT_TRUE(found >= (intmax_t)checks / 2);
+
+    bloom_free(big);
+    bloom_free(b);
+    cuckoo_free(c);
+    aputil_llist_free(lst, false);
+    vector_free(v);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // bloom
+    RUN_TEST(test_function_bloom);
+    RUN_TEST(test_function_filter_sizing);
+
+    // cuckoo
+    RUN_TEST(test_function_cuckoo);
+    RUN_TEST(test_function_cuckoo_full);
+
+    // save / load
+    RUN_TEST(test_function_filter_save_load);
+
+    // benchmarks
+    RUN_BENCH(test_function_filter_bench);
+
+    return UNITY_END();
+}
@@ -0,0 +1,280 @@
+/*
+ *    test src/hash.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+static void fill_random(unsigned char *buf, size_t n) {
+    for (size_t i = 0; i<n; i++) buf[i] = (unsigned char)rand();
+}
+
+// chi-square of n hashes over 1024 buckets (low bits), expected ~1023 with sd ~45
+static double chi_square(const uint64_t *h, size_t n) {
+    size_t cnt[1024] = {0};
+    for (size_t i = 0; i<n; i++) cnt[h[i] & 1023]++;
+    double expect = (double)n / 1024, chi = 0;
+    for (size_t i = 0; i<1024; i++) chi += (cnt[i] - expect) * (cnt[i] - expect) / expect;
+    return chi;
+}
+
+
+//################ Bytes ################
+void test_function_hash_bytes(void) {
+
+    unsigned char buf[1024];
+    fill_random(buf, sizeof(buf));
+
+    // every length, the stable seed is deterministic and seeds matter
+    for (size_t n = 0; n<=300; n++) {
+        uint64_t h = hash_bytes(buf, n);
+        TEST_ASSERT_TRUE(h == hash_bytes_seed(buf, n, HASH_DEFAULT_SEED));
+        TEST_ASSERT_TRUE(h != hash_bytes_seed(buf, n, 1));
+        if (n) TEST_ASSERT_TRUE(h != hash_bytes(buf, n - 1));
+    }
+
+    // runs of zero bytes differ by length, so do shifted windows
+    unsigned char zero[200] = {0};
+    for (size_t n = 1; n<200; n++) {
+        TEST_ASSERT_TRUE(hash_bytes(zero, n) != hash_bytes(zero, n - 1));
+        TEST_ASSERT_TRUE(hash_bytes(buf, n) != hash_bytes(buf + 1, n));
+    }
+
+    // the tail can't be ignored: change only the last byte
+    for (size_t n = 1; n<=300; n++) {
+        uint64_t h = hash_bytes(buf, n);
+        buf[n - 1] ^= 1;
+        TEST_ASSERT_TRUE(h != hash_bytes(buf, n));
+        buf[n - 1] ^= 1;
+    }
+
+    // vectors hash their contents
+    Vec_char *c = vec_char_new(4);
+    vec_char_append_n(c, "hello, world", 12);
+    TEST_ASSERT_TRUE(vec_char_hash(c, 7) == hash_bytes_seed("hello, world", 12, 7));
+    Vec_i32 *v = vec_i32_new(4);
+    for (int32_t i = 0; i<100; i++) vec_i32_add_back(v, i);
+    TEST_ASSERT_TRUE(vec_i32_hash(v, 0) == hash_bytes_seed(v->data, 400, 0));
+    Vector *g = vector_from_array(v->data, v->size, sizeof(int32_t));
+    TEST_ASSERT_TRUE(vector_hash(g, 0) == vec_i32_hash(v, 0));
+    TEST_ASSERT_TRUE(vector_elem_hash(g, 42, 3) == hash_bytes_seed(&v->data[42], 4, 3));
+    TEST_ASSERT_TRUE(vector_elem_hash(g, 100, 3) == 0);
+
+    vector_free(g);
+    vec_i32_free(v);
+    vec_char_free(c);
+
+}
+
+
+void test_function_hash_stream(void) {
+
+    static unsigned char buf[4096];
+    fill_random(buf, sizeof(buf));
+
+    // every split into three updates around the stripe boundaries, then random splits
+    for (size_t n = 0; n<=200; n++) {
+        uint64_t want = hash_bytes_seed(buf, n, 99);
+        for (size_t a = 0; a<=n; a++) {
+            size_t b = a + (n - a) / 2;
+            Hash_state st;
+            hash_init(&st, 99);
+            hash_update(&st, buf, a);
+            hash_update(&st, buf + a, b - a);
+            hash_update(&st, buf + b, n - b);
+            TEST_ASSERT_TRUE(want == hash_final(&st));
+        }
+    }
+    for (int r = 0; r<200; r++) {
+        size_t n = (size_t)rand() % sizeof(buf), done = 0;
+        Hash_state st;
+        hash_init(&st, 5);
+        while (done < n) {
+            size_t step = (size_t)rand() % 130;
+            if (step > n - done) step = n - done;
+            hash_update(&st, buf + done, step);
+            done += step;
+        }
+        TEST_ASSERT_TRUE(hash_bytes_seed(buf, n, 5) == hash_final(&st));
+    }
+
+    // final doesn't end the stream
+    Hash_state st;
+    hash_init(&st, 0);
+    hash_update(&st, buf, 100);
+    TEST_ASSERT_TRUE(hash_final(&st) == hash_bytes_seed(buf, 100, 0));
+    hash_update(&st, buf + 100, 100);
+    TEST_ASSERT_TRUE(hash_final(&st) == hash_bytes_seed(buf, 200, 0));
+
+}
+
+
+//################ Integers ################
+void test_function_hash_int(void) {
+
+    // bijective: no collisions over a dense range
+    HashSet *seen = hashset_new(sizeof(uint64_t), 200000, NULL, NULL);
+    for (int32_t i = -100000; i<100000; i++) {
+        uint64_t h = hash_i32(i, 12345);
+        TEST_ASSERT_TRUE(hashset_insert(seen, &h) == E_SUCCESS);
+        TEST_ASSERT_TRUE(h == hash_u64((uint32_t)i, 12345));
+    }
+    TEST_ASSERT_TRUE(hash_i32(1, 0) != hash_i32(1, 1));
+    hashset_free(seen);
+
+    uint64_t a = hash_random_seed(), b = hash_random_seed();
+    TEST_ASSERT_TRUE(a != b);
+
+}
+
+
+//################ Quality ################
+/*
+    flip every input bit of random keys: each output bit should flip half the time
+    (strict avalanche), reported as the worst bias over all input / output bit pairs
+*/
+static double avalanche(size_t len, size_t trials) {
+    static uint32_t flips[256 * 8][64];
+    memset(flips, 0, sizeof(flips));
+    unsigned char key[256];
+    for (size_t t = 0; t<trials; t++) {
+        fill_random(key, len);
+        uint64_t h = hash_bytes(key, len);
+        for (size_t bit = 0; bit<len * 8; bit++) {
+            key[bit / 8] ^= (unsigned char)(1u << (bit % 8));
+            uint64_t d = h ^ hash_bytes(key, len);
+            key[bit / 8] ^= (unsigned char)(1u << (bit % 8));
+            for (int o = 0; o<64; o++) flips[bit][o] += (d >> o) & 1;
+        }
+    }
+    double worst = 0;
+    for (size_t bit = 0; bit<len * 8; bit++) {
+        for (int o = 0; o<64; o++) {
+            double bias = (double)flips[bit][o] / trials - 0.5;
+            if (bias < 0) bias = -bias;
+            if (bias > worst) worst = bias;
+        }
+    }
+    return worst;
+}
+
+void test_function_hash_quality(void) {
+
+    size_t lens[] = { 3, 8, 16, 24, 64, 100 };
+    for (size_t i = 0; i<sizeof(lens) / sizeof(lens[0]); i++) {
+        double worst = avalanche(lens[i], 4000);
+        fprintf(stdout, "avalanche %zu byte keys: worst bias %f\n", lens[i], worst);
+        TEST_ASSERT_TRUE(worst < 0.05);
+    }
+
+    // sequential keys into 1024 buckets, the case where weak hashes cluster
+    size_t n = 1 << 20;
+    uint64_t *h = malloc(n * sizeof(uint64_t));
+    for (size_t i = 0; i<n; i++) {
+        uint64_t k = i;
+        h[i] = hash_bytes(&k, sizeof(k));
+    }
+    double chi = chi_square(h, n);
+    fprintf(stdout, "chi-square sequential u64 keys, hash_bytes: %f\n", chi);
+    TEST_ASSERT_TRUE(chi < 1400);
+
+    for (size_t i = 0; i<n; i++) h[i] = hash_i32((int32_t)(i << 10), 0);
+    chi = chi_square(h, n);
+    fprintf(stdout, "chi-square strided i32 keys, hash_i32: %f\n", chi);
+    TEST_ASSERT_TRUE(chi < 1400);
+
+    for (size_t i = 0; i<n; i++) {
+        char s[32];
+        int len = snprintf(s, sizeof(s), "user:%zu", i);
+        h[i] = hash_bytes(s, (size_t)len);
+    }
+    chi = chi_square(h, n);
+    fprintf(stdout, "chi-square \"user:N\" strings: %f\n", chi);
+    TEST_ASSERT_TRUE(chi < 1400);
+    free(h);
+
+}
+
+
+//################ benchmarks ################
+void test_function_hash_throughput(void) {
+
+    size_t n = 64 << 20;
+    unsigned char *buf = malloc(n);
+    fill_random(buf, n);
+
+    double start = wall();
+    uint64_t h = hash_bytes(buf, n);
+    double secs = wall() - start;
+    fprintf(stdout, "hash_bytes %zu MiB: %f GB/s (%016llx)\n", n >> 20, n / secs / 1e9, (unsigned long long)h);
+
+    start = wall();
+    Hash_state st;
+    hash_init(&st, HASH_DEFAULT_SEED);
+    for (size_t off = 0; off<n; off += 4096) hash_update(&st, buf + off, 4096);
+    TEST_ASSERT_TRUE(hash_final(&st) == h);
+    secs = wall() - start;
+    fprintf(stdout, "hash_update 4 KiB chunks: %f GB/s\n", n / secs / 1e9);
+
+    start = wall();
+    h = serial_checksum(buf, n);
+    secs = wall() - start;
+    fprintf(stdout, "serial_checksum %zu MiB: %f GB/s\n", n >> 20, n / secs / 1e9);
+
+    // small keys, per call cost dominates
+    size_t sizes[] = { 4, 8, 16, 32, 64 }, calls = 10000000;
+    for (size_t s = 0; s<sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint64_t acc = 0;
+        start = wall();
+        for (size_t i = 0; i<calls; i++) acc += hash_bytes(buf + (i & 4095), sizes[s]);
+        secs = wall() - start;
+        fprintf(stdout, "hash_bytes %zu byte keys: %f ns/hash (%llx)\n", sizes[s], secs / calls * 1e9, (unsigned long long)(acc & 0xf));
+    }
+
+    uint64_t acc = 0;
+    start = wall();
+    for (size_t i = 0; i<calls; i++) acc += hash_i32((int32_t)i, 0);
+    secs = wall() - start;
+    fprintf(stdout, "hash_i32: %f ns/hash (%llx)\n", secs / calls * 1e9, (unsigned long long)(acc & 0xf));
+
+    free(buf);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // bytes
+    RUN_TEST(test_function_hash_bytes);
+    RUN_TEST(test_function_hash_stream);
+
+    // integers
+    RUN_TEST(test_function_hash_int);
+
+    // quality
+    RUN_TEST(test_function_hash_quality);
+
+    // benchmarks
+    RUN_BENCH(test_function_hash_throughput);
+
+    return UNITY_END();
+}
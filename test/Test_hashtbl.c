@@ -0,0 +1,560 @@
+/*
+ *    test src/hashtbl.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+static int int_comp(const void *d1, const void *d2) {
+    int32_t a = *(const int32_t*)d1, b = *(const int32_t*)d2;
+    return (a > b) - (a < b);
+}
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+    char name[16];
+} point;
+
+// only x and y take part, name is payload
+static uint64_t point_hash(const void *d) {
+    const point *p = d;
+    return ((uint64_t)(uint32_t)p->x << 32 | (uint32_t)p->y) * 0xff51afd7ed558ccdull;
+}
+
+static bool point_equal(const void *a, const void *b) {
+    const point *p = a, *q = b;
+    return p->x == q->x && p->y == q->y;
+}
+
+// every key in one bucket, long probe runs
+static uint64_t bad_hash(const void *d) {
+    (void)d;
+    return 42;
+}
+
+
+static uint64_t xorshift(uint64_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+
+//################ int32 Set ################
+void test_function_hashset_i32_basic(void) {
+
+    HashSet_i32 *s = hashset_i32_new(0);
+    TEST_ASSERT_NOT_NULL(s);
+
+    for (int32_t i = -500; i<500; i++) TEST_ASSERT_TRUE(hashset_i32_insert(s, i * 7) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(1000, s->size);
+    TEST_ASSERT_TRUE(hashset_i32_insert(s, 7) == E_NOOP);
+    TEST_ASSERT_TRUE(hashset_i32_insert(s, INT32_MIN) == E_SUCCESS);
+    TEST_ASSERT_TRUE(hashset_i32_insert(s, 0) == E_NOOP);
+
+    for (int32_t i = -500; i<500; i++) {
+        TEST_ASSERT_TRUE(hashset_i32_contains(s, i * 7));
+        TEST_ASSERT_FALSE(hashset_i32_contains(s, i * 7 + 1));
+    }
+    TEST_ASSERT_TRUE(hashset_i32_contains(s, INT32_MIN));
+    TEST_ASSERT_TRUE(s->size <= s->cap / HASHSET_MAX_LOAD_DEN * HASHSET_MAX_LOAD_NUM);
+
+    // remove every other key, the rest stays reachable after the shifts
+    for (int32_t i = -500; i<500; i += 2) TEST_ASSERT_TRUE(hashset_i32_remove(s, i * 7) == E_SUCCESS);
+    TEST_ASSERT_TRUE(hashset_i32_remove(s, -500 * 7) == E_DOESNT_EXIST);
+    for (int32_t i = -500; i<500; i++) {
+        TEST_ASSERT_TRUE(hashset_i32_contains(s, i * 7) == ((i + 500) % 2 == 1));
+    }
+    TEST_ASSERT_EQUAL_INT32(501, s->size);
+
+    Vec_i32 *v = hashset_i32_to_vec(s, NULL);
+    TEST_ASSERT_EQUAL_INT32(501, v->size);
+    for (size_t i = 0; i<v->size; i++) TEST_ASSERT_TRUE(hashset_i32_contains(s, v->data[i]));
+    vec_i32_free(v);
+
+    hashset_i32_clear(s);
+    TEST_ASSERT_EQUAL_INT32(0, s->size);
+    TEST_ASSERT_FALSE(hashset_i32_contains(s, 7));
+    TEST_ASSERT_TRUE(hashset_i32_insert(NULL, 1) == E_EMPTY_OBJ);
+
+    hashset_i32_free(s);
+
+}
+
+
+void test_function_hashset_i32_random(void) {
+
+    // against a sorted reference, mixed inserts and removes
+    HashSet_i32 *s = hashset_i32_new(16);
+    char *ref = calloc(20000, 1);
+    for (int round = 0; round<200000; round++) {
+        int32_t k = rand() % 20000;
+        if (rand() % 3) {
+            UTIL_ERR e = hashset_i32_insert(s, k);
+            TEST_ASSERT_TRUE(e == (ref[k] ? E_NOOP : E_SUCCESS));
+            ref[k] = 1;
+        } else {
+            UTIL_ERR e = hashset_i32_remove(s, k);
+            TEST_ASSERT_TRUE(e == (ref[k] ? E_SUCCESS : E_DOESNT_EXIST));
+            ref[k] = 0;
+        }
+    }
+    size_t cnt = 0;
+    for (int32_t k = 0; k<20000; k++) {
+        TEST_ASSERT_TRUE(hashset_i32_contains(s, k) == (bool)ref[k]);
+        cnt += ref[k];
+    }
+    TEST_ASSERT_EQUAL_INT32(cnt, s->size);
+
+    free(ref);
+    hashset_i32_free(s);
+
+}
+
+
+void test_function_hashset_i32_unique(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    int32_t vals[] = {5, 3, 5, 9, 3, 3, -1, 9, 0, 5};
+    Vec_i32 *v = vec_i32_new(1);
+    vec_i32_append_n(v, vals, 10);
+
+    Vec_i32 *u = vec_i32_unique(v, &e);
+    int32_t want[] = {5, 3, 9, -1, 0};
+    TEST_ASSERT_EQUAL_INT32(5, u->size);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(want, u->data, 5);
+    vec_i32_free(u);
+
+    HashSet_i32 *s = hashset_i32_new(0);
+    TEST_ASSERT_TRUE(hashset_i32_insert_from_vec(s, v) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(5, s->size);
+    hashset_i32_free(s);
+
+    vec_i32_clear(v);
+    u = vec_i32_unique(v, &e);
+    TEST_ASSERT_EQUAL_INT32(0, u->size);
+    vec_i32_free(u);
+    vec_i32_free(v);
+
+    TEST_ASSERT_NULL(vec_i32_unique(NULL, &e));
+    TEST_ASSERT_TRUE(e == E_EMPTY_OBJ);
+
+}
+
+
+//################ Generic Set ################
+void test_function_hashset_generic(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    HashSet *s = hashset_new(sizeof(point), 0, point_hash, point_equal);
+    TEST_ASSERT_NOT_NULL(s);
+
+    for (int32_t i = 0; i<3000; i++) {
+        point p = { .x = i % 60, .y = i / 60 };
+        snprintf(p.name, sizeof(p.name), "p%d", i);
+        TEST_ASSERT_TRUE(hashset_insert(s, &p) == E_SUCCESS);
+    }
+    point dup = { .x = 3, .y = 4, .name = "other name" };
+    TEST_ASSERT_TRUE(hashset_insert(s, &dup) == E_NOOP);
+    TEST_ASSERT_TRUE(hashset_contains(s, &dup));
+    point miss = { .x = 60, .y = 0 };
+    TEST_ASSERT_FALSE(hashset_contains(s, &miss));
+
+    TEST_ASSERT_TRUE(hashset_remove(s, &dup) == E_SUCCESS);
+    TEST_ASSERT_FALSE(hashset_contains(s, &dup));
+    TEST_ASSERT_TRUE(hashset_remove(s, &dup) == E_DOESNT_EXIST);
+    TEST_ASSERT_EQUAL_INT32(2999, s->size);
+
+    Vector *v = hashset_to_vec(s, &e);
+    TEST_ASSERT_EQUAL_INT32(2999, v->size);
+    for (size_t i = 0; i<v->size; i++) TEST_ASSERT_TRUE(hashset_contains(s, vector_at(v, i)));
+    vector_free(v);
+    hashset_free(s);
+
+    // raw bytes without callbacks, and a degenerate hash forcing long probes and grows
+    HashSet *raw = hashset_new(sizeof(int64_t), 0, NULL, NULL);
+    HashSet *bad = hashset_new(sizeof(int64_t), 0, bad_hash, NULL);
+    for (int64_t i = 0; i<2000; i++) {
+        int64_t k = i * 1000003;
+        TEST_ASSERT_TRUE(hashset_insert(raw, &k) == E_SUCCESS);
+        if (i < 600) TEST_ASSERT_TRUE(hashset_insert(bad, &k) == E_SUCCESS);
+    }
+    for (int64_t i = 0; i<2000; i++) {
+        int64_t k = i * 1000003, k1 = k + 1;
+        TEST_ASSERT_TRUE(hashset_contains(raw, &k));
+        TEST_ASSERT_FALSE(hashset_contains(raw, &k1));
+        TEST_ASSERT_TRUE(hashset_contains(bad, &k) == (i < 600));
+    }
+    for (int64_t i = 0; i<600; i += 3) {
+        int64_t k = i * 1000003;
+        TEST_ASSERT_TRUE(hashset_remove(bad, &k) == E_SUCCESS);
+    }
+    for (int64_t i = 0; i<600; i++) {
+        int64_t k = i * 1000003;
+        TEST_ASSERT_TRUE(hashset_contains(bad, &k) == (i % 3 != 0));
+    }
+    hashset_free(raw);
+    hashset_free(bad);
+
+    TEST_ASSERT_NULL(hashset_new(0, 10, NULL, NULL));
+
+}
+
+
+void test_function_hashset_vector_unique(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    Vector *v = vector_new(sizeof(point), 1);
+    for (int i = 0; i<1000; i++) {
+        point p = { .x = rand() % 10, .y = rand() % 10 };
+        vector_add_back(v, &p);
+    }
+
+    Vector *u = vector_unique(v, point_hash, point_equal, &e);
+    TEST_ASSERT_TRUE(u->size <= 100);
+    // first occurrence order
+    size_t next = 0;
+    for (size_t i = 0; i<v->size && next < u->size; i++) {
+        point *p = vector_at(v, i), *q = vector_at(u, next);
+        if (point_equal(p, q)) next++;
+    }
+    TEST_ASSERT_EQUAL_INT32(u->size, next);
+
+    HashSet *s = hashset_new(sizeof(point), 0, point_hash, point_equal);
+    TEST_ASSERT_TRUE(hashset_insert_from_vec(s, v) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(u->size, s->size);
+    Vector *wrong = vector_new(sizeof(int32_t), 1);
+    TEST_ASSERT_TRUE(hashset_insert_from_vec(s, wrong) == E_BAD_TYPE);
+
+    vector_free(wrong);
+    hashset_free(s);
+    vector_free(u);
+    vector_free(v);
+
+}
+
+
+//################ Concurrent Map ################
+typedef struct {
+    int32_t id;
+    char tag[5];
+} odd_key;                      // 12 bytes with padding, not a whole number of words
+
+static UTIL_ERR make_square(const void *key, void *val, void *arg) {
+    int64_t k = *(const int64_t*)key;
+    *(int64_t*)val = k * k;
+    if (arg) (*(int*)arg)++;
+    return E_SUCCESS;
+}
+
+static UTIL_ERR make_fail(const void *key, void *val, void *arg) {
+    (void)key; (void)val; (void)arg;
+    return E_BAD_ALLOC;
+}
+
+static void add_one(void *val, bool present, void *arg) {
+    (void)arg;
+    *(int64_t*)val = present ? *(int64_t*)val + 1 : 1;
+}
+
+void test_function_cmap_basic(void) {
+
+    ConcMap *m = cmap_new(sizeof(int64_t), sizeof(int64_t), 4, NULL);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL_INT32(4, m->n_shards);
+
+    // enough keys to grow every shard a few times
+    for (int64_t i = 0; i<20000; i++) {
+        int64_t v = -i;
+        TEST_ASSERT_TRUE(cmap_put(m, &i, &v) == E_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL_INT32(20000, cmap_size(m));
+    for (int64_t i = 0; i<20000; i++) {
+        int64_t v = 1;
+        TEST_ASSERT_TRUE(cmap_get(m, &i, &v));
+        TEST_ASSERT_TRUE(v == -i);
+    }
+    int64_t k = 20000, v = 7;
+    TEST_ASSERT_FALSE(cmap_get(m, &k, NULL));
+    k = 5;
+    TEST_ASSERT_TRUE(cmap_put(m, &k, &v) == E_NOOP);
+    TEST_ASSERT_TRUE(cmap_get(m, &k, &v) && v == 7);
+
+    for (int64_t i = 0; i<20000; i += 2) TEST_ASSERT_TRUE(cmap_remove(m, &i) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cmap_remove(m, &k) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cmap_remove(m, &k) == E_DOESNT_EXIST);
+    TEST_ASSERT_EQUAL_INT32(9999, cmap_size(m));
+    for (int64_t i = 0; i<20000; i++) TEST_ASSERT_TRUE(cmap_get(m, &i, NULL) == (i % 2 && i != 5));
+
+    // compute_if_absent only makes missing values
+    int made = 0;
+    k = 4;
+    TEST_ASSERT_TRUE(cmap_compute_if_absent(m, &k, make_square, &made, &v) == E_SUCCESS);
+    TEST_ASSERT_TRUE(v == 16 && made == 1);
+    k = 3;
+    TEST_ASSERT_TRUE(cmap_compute_if_absent(m, &k, make_square, &made, &v) == E_NOOP);
+    TEST_ASSERT_TRUE(v == -3 && made == 1);
+    k = 6;
+    TEST_ASSERT_TRUE(cmap_compute_if_absent(m, &k, make_fail, NULL, NULL) == E_BAD_ALLOC);
+    TEST_ASSERT_FALSE(cmap_get(m, &k, NULL));
+
+    // upsert
+    TEST_ASSERT_TRUE(cmap_upsert(m, &k, add_one, NULL) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cmap_upsert(m, &k, add_one, NULL) == E_SUCCESS);
+    TEST_ASSERT_TRUE(cmap_get(m, &k, &v) && v == 2);
+    TEST_ASSERT_TRUE(cmap_upsert(m, &k, NULL, NULL) == E_EMPTY_FUNC);
+    TEST_ASSERT_TRUE(cmap_put(NULL, &k, &v) == E_EMPTY_OBJ);
+    cmap_free(m);
+
+    // keys and values that are not whole words, all in one bucket
+    m = cmap_new(sizeof(odd_key), 3, 0, bad_hash);
+    TEST_ASSERT_EQUAL_INT32(CMAP_DEFAULT_SHARDS, m->n_shards);
+    for (int32_t i = 0; i<300; i++) {
+        odd_key key = { .id = i };
+        snprintf(key.tag, sizeof(key.tag), "k%d", i % 100);
+        char val[3] = { (char)i, (char)(i >> 8), 'x' };
+        TEST_ASSERT_TRUE(cmap_put(m, &key, val) == E_SUCCESS);
+    }
+    for (int32_t i = 0; i<300; i++) {
+        odd_key key = { .id = i };
+        snprintf(key.tag, sizeof(key.tag), "k%d", i % 100);
+        char val[4] = { 0, 0, 0, 'z' };
+        TEST_ASSERT_TRUE(cmap_get(m, &key, val));
+        TEST_ASSERT_EQUAL_CHAR((char)i, val[0]);
+        TEST_ASSERT_EQUAL_CHAR('x', val[2]);
+        TEST_ASSERT_EQUAL_CHAR('z', val[3]);
+        key.tag[0] = 'j';
+        TEST_ASSERT_FALSE(cmap_get(m, &key, NULL));
+    }
+    for (int32_t i = 0; i<300; i += 3) {
+        odd_key key = { .id = i };
+        snprintf(key.tag, sizeof(key.tag), "k%d", i % 100);
+        TEST_ASSERT_TRUE(cmap_remove(m, &key) == E_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL_INT32(200, cmap_size(m));
+    cmap_free(m);
+
+    TEST_ASSERT_NULL(cmap_new(0, 8, 0, NULL));
+
+}
+
+
+#define CMAP_THREADS 4
+#define CMAP_KEYS 4096
+
+typedef struct {
+    ConcMap *m;
+    size_t id;
+    size_t ops;
+    int read_pct;
+    _Atomic bool *stop;
+    size_t bad;
+} cmap_worker;
+
+// keys count up with upsert, everyone hits every key
+static void *cmap_counter(void *arg) {
+    cmap_worker *w = arg;
+    for (size_t i = 0; i<w->ops; i++) {
+        int64_t k = (int64_t)((i * 7 + w->id) % CMAP_KEYS);
+        cmap_upsert(w->m, &k, add_one, NULL);
+    }
+    return NULL;
+}
+
+// writers insert k -> 3k + 1, readers must never see anything else
+static void *cmap_writer(void *arg) {
+    cmap_worker *w = arg;
+    for (int64_t k = (int64_t)w->id; k < 50000; k += 2) {
+        int64_t v = 3 * k + 1;
+        cmap_put(w->m, &k, &v);
+        if (k % 5 == 0) cmap_remove(w->m, &k);
+    }
+    return NULL;
+}
+
+static void *cmap_reader(void *arg) {
+    cmap_worker *w = arg;
+    uint64_t x = 88172645463325252ull + w->id;
+    while (!atomic_load(w->stop)) {
+        int64_t k = (int64_t)(xorshift(&x) % 50000), v;
+        if (cmap_get(w->m, &k, &v) && v != 3 * k + 1) w->bad++;
+    }
+    return NULL;
+}
+
+void test_function_cmap_threads(void) {
+
+    ConcMap *m = cmap_new(sizeof(int64_t), sizeof(int64_t), 8, NULL);
+    pthread_t tid[CMAP_THREADS];
+    cmap_worker w[CMAP_THREADS];
+    for (size_t i = 0; i<CMAP_THREADS; i++) {
+        w[i] = (cmap_worker){ .m = m, .id = i, .ops = 100000 };
+        pthread_create(&tid[i], NULL, cmap_counter, &w[i]);
+    }
+    for (size_t i = 0; i<CMAP_THREADS; i++) pthread_join(tid[i], NULL);
+
+    int64_t total = 0;
+    for (int64_t k = 0; k<CMAP_KEYS; k++) {
+        int64_t v = 0;
+        TEST_ASSERT_TRUE(cmap_get(m, &k, &v));
+        total += v;
+    }
+    TEST_ASSERT_TRUE(total == CMAP_THREADS * 100000);
+    TEST_ASSERT_EQUAL_INT32(CMAP_KEYS, cmap_size(m));
+    cmap_free(m);
+
+    // lock free readers next to writers growing and shrinking the shards
+    m = cmap_new(sizeof(int64_t), sizeof(int64_t), 2, NULL);
+    _Atomic bool stop = false;
+    for (size_t i = 0; i<CMAP_THREADS; i++) {
+        w[i] = (cmap_worker){ .m = m, .id = i, .stop = &stop };
+        pthread_create(&tid[i], NULL, i < 2 ? cmap_writer : cmap_reader, &w[i]);
+    }
+    pthread_join(tid[0], NULL);
+    pthread_join(tid[1], NULL);
+    atomic_store(&stop, true);
+    for (size_t i = 2; i<CMAP_THREADS; i++) {
+        pthread_join(tid[i], NULL);
+        TEST_ASSERT_EQUAL_INT32(0, w[i].bad);
+    }
+    TEST_ASSERT_EQUAL_INT32(40000, cmap_size(m));
+    for (int64_t k = 0; k<50000; k++) TEST_ASSERT_TRUE(cmap_get(m, &k, NULL) == (k % 5 != 0));
+    cmap_free(m);
+
+}
+
+
+//################ benchmarks ################
+void test_function_hashset_vs_sort(void) {
+
+    size_t cnt = 2000000;
+    UTIL_ERR e = E_SUCCESS;
+    Vec_i32 *v = vec_i32_new(cnt);
+    for (size_t i = 0; i<cnt; i++) vec_i32_add_back(v, rand() % (int)(cnt / 2));
+
+    // sort + scan dedup
+    clock_t start = clock();
+    Vec_i32 *sorted = vec_i32_copy(v);
+    vector_sort(sorted, vec_i32, int_comp);
+    size_t w = 0;
+    for (size_t i = 0; i<sorted->size; i++) {
+        if (i == 0 || sorted->data[i] != sorted->data[w-1]) sorted->data[w++] = sorted->data[i];
+    }
+    sorted->size = w;
+    clock_t stop = clock();
+    fprintf(stdout, "sort + scan unique %zu: %f s\n", cnt, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    start = clock();
+    Vec_i32 *u = vec_i32_unique(v, &e);
+    stop = clock();
+    fprintf(stdout, "vec_i32_unique %zu: %f s\n", cnt, ((double) (stop - start)) / CLOCKS_PER_SEC);
+    TEST_ASSERT_EQUAL_INT32(sorted->size, u->size);
+
+    HashSet_i32 *s = hashset_i32_new(0);
+    hashset_i32_insert_from_vec(s, v);
+    start = clock();
+    size_t hits = 0;
+    for (size_t i = 0; i<cnt; i++) hits += hashset_i32_contains(s, (int32_t)i);
+    stop = clock();
+    fprintf(stdout, "hashset_i32_contains %zu: %f s\n", cnt, ((double) (stop - start)) / CLOCKS_PER_SEC);
+    TEST_ASSERT_EQUAL_INT32(u->size, hits);
+
+    hashset_i32_free(s);
+    vec_i32_free(u);
+    vec_i32_free(sorted);
+    vec_i32_free(v);
+
+}
+
+
+// random gets and puts over a prefilled key space
+static void *cmap_mixed(void *arg) {
+    cmap_worker *w = arg;
+    uint64_t x = 0x2545f4914f6cdd1dull * (w->id + 1);
+    for (size_t i = 0; i<w->ops; i++) {
+        uint64_t r = xorshift(&x);
+        int64_t k = (int64_t)((r >> 8) % (CMAP_KEYS * 16)), v = k;
+        if ((int)(r % 100) < w->read_pct) w->bad += !cmap_get(w->m, &k, &v);
+        else cmap_put(w->m, &k, &v);
+    }
+    return NULL;
+}
+
+void test_function_cmap_throughput(void) {
+
+    size_t ops = 1000000;
+    int mixes[] = { 100, 90, 50 };
+    size_t threads[] = { 1, 2, 4 };
+    size_t shards[] = { 1, CMAP_DEFAULT_SHARDS };
+
+    for (size_t s = 0; s<2; s++) {
+        for (size_t r = 0; r<3; r++) {
+            for (size_t t = 0; t<3; t++) {
+                ConcMap *m = cmap_new(sizeof(int64_t), sizeof(int64_t), shards[s], NULL);
+                for (int64_t k = 0; k<CMAP_KEYS * 16; k++) cmap_put(m, &k, &k);
+
+                pthread_t tid[CMAP_THREADS];
+                cmap_worker w[CMAP_THREADS];
+                double start = wall();
+                for (size_t i = 0; i<threads[t]; i++) {
+                    w[i] = (cmap_worker){ .m = m, .id = i, .ops = ops / threads[t], .read_pct = mixes[r] };
+                    pthread_create(&tid[i], NULL, cmap_mixed, &w[i]);
+                }
+                for (size_t i = 0; i<threads[t]; i++) {
+                    pthread_join(tid[i], NULL);
+                    TEST_ASSERT_EQUAL_INT32(0, w[i].bad);
+                }
+                double secs = wall() - start;
+                fprintf(stdout, "cmap %zu shards, %d%% reads, %zu threads: %f Mops/s\n",
+                        m->n_shards, mixes[r], threads[t], ops / secs / 1e6);
+                cmap_free(m);
+            }
+        }
+    }
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // int32 set
+    RUN_TEST(test_function_hashset_i32_basic);
+    RUN_TEST(test_function_hashset_i32_random);
+    RUN_TEST(test_function_hashset_i32_unique);
+
+    // generic set
+    RUN_TEST(test_function_hashset_generic);
+    RUN_TEST(test_function_hashset_vector_unique);
+
+    // concurrent map
+    RUN_TEST(test_function_cmap_basic);
+    RUN_TEST(test_function_cmap_threads);
+
+    // benchmarks
+    RUN_BENCH(test_function_hashset_vs_sort);
+    RUN_BENCH(test_function_cmap_throughput);
+
+    return UNITY_END();
+}
@@ -0,0 +1,290 @@
+/*
+ *    test src/heap.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+static int int_comp(const void *d1, const void *d2) {
+    int a = *(const int*)d1, b = *(const int*)d2;
+    return (a > b) - (a < b);
+}
+
+typedef struct {
+    int32_t due;
+    char payload[28];
+} job;
+
+static int job_comp(const void *d1, const void *d2) {
+    int32_t a = ((const job*)d1)->due, b = ((const job*)d2)->due;
+    return (a > b) - (a < b);
+}
+
+
+//################ Generic Heap ################
+void test_function_heap_push_pop(void) {
+
+    size_t arities[] = {2, 4};
+    for (int a = 0; a<2; a++) {
+        Heap *h = heap_new(sizeof(int), 1, int_comp, false, arities[a]);
+        TEST_ASSERT_NOT_NULL(h);
+
+        int vals[] = {5, 3, 9, 1, 7, 3, 8, 0, 2, 6};
+        for (int i = 0; i<10; i++) {
+            TEST_ASSERT_TRUE(heap_push(h, &vals[i]) == E_SUCCESS);
+        }
+        TEST_ASSERT_EQUAL_INT32(10, heap_size(h));
+
+        UTIL_ERR e = E_SUCCESS;
+        TEST_ASSERT_EQUAL_INT32(0, *(int*)heap_peek(h, &e));
+
+        int expect[] = {0, 1, 2, 3, 3, 5, 6, 7, 8, 9}, out;
+        for (int i = 0; i<10; i++) {
+            TEST_ASSERT_TRUE(heap_pop(h, &out) == E_SUCCESS);
+            TEST_ASSERT_EQUAL_INT32(expect[i], out);
+        }
+        TEST_ASSERT_TRUE(heap_pop(h, &out) == E_NODATA);
+        TEST_ASSERT_NULL(heap_peek(h, &e));
+        TEST_ASSERT_TRUE(e == E_NODATA);
+
+        heap_free(h);
+    }
+
+    TEST_ASSERT_NULL(heap_new(sizeof(int), 1, NULL, false, 2));
+    TEST_ASSERT_NULL(heap_new(sizeof(int), 1, int_comp, false, 1));
+
+}
+
+
+void test_function_heap_from_vector(void) {
+
+    Vector *v = vector_new(sizeof(int), 8);
+    for (int i = 0; i<100; i++) {
+        int val = (i * 37) % 100;
+        vector_add_back(v, &val);
+    }
+
+    Heap *h = heap_from_vector(v, int_comp, true, 4);
+    int out, prev = 100;
+    while (heap_size(h)) {
+        heap_pop(h, &out);
+        TEST_ASSERT_TRUE(out < prev);
+        prev = out;
+    }
+    TEST_ASSERT_EQUAL_INT32(0, prev);
+
+    // replace top keeps the heap size
+    int vals[] = {4, 8, 6};
+    for (int i = 0; i<3; i++) heap_push(h, &vals[i]);
+    int in = 5;
+    TEST_ASSERT_TRUE(heap_replace_top(h, &in, &out) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(8, out);
+    TEST_ASSERT_EQUAL_INT32(3, heap_size(h));
+    heap_pop(h, &out);
+    TEST_ASSERT_EQUAL_INT32(6, out);
+
+    heap_free(h);
+
+}
+
+
+//################ i32 Heap ################
+void test_function_heap_i32_push_pop(void) {
+
+    Heap_i32 *h = heap_i32_new(4, NULL, false, 4);
+    UTIL_ERR e = E_SUCCESS;
+
+    for (int32_t i = 0; i<1000; i++) heap_i32_push(h, (i * 7919) % 1000);
+    TEST_ASSERT_EQUAL_INT32(0, heap_i32_peek(h, &e));
+
+    for (int32_t i = 0; i<1000; i++) {
+        TEST_ASSERT_EQUAL_INT32(i, heap_i32_pop(h, &e));
+    }
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+    heap_i32_pop(h, &e);
+    TEST_ASSERT_TRUE(e == E_NODATA);
+
+    heap_i32_free(h);
+
+    // max heap through heapify
+    Vec_i32 *v = vec_i32_new(16);
+    int32_t vals[] = {3, -1, 12, 7, 7, 0};
+    for (int i = 0; i<6; i++) vec_i32_add_back(v, vals[i]);
+    h = heap_i32_from_vec(v, int_comp, true, 2);
+    e = E_SUCCESS;
+    TEST_ASSERT_EQUAL_INT32(12, heap_i32_pop(h, &e));
+    TEST_ASSERT_EQUAL_INT32(7, heap_i32_replace_top(h, 1, &e));
+    TEST_ASSERT_EQUAL_INT32(7, heap_i32_pop(h, &e));
+    TEST_ASSERT_EQUAL_INT32(3, heap_i32_pop(h, &e));
+
+    heap_i32_free(h);
+
+}
+
+
+//################ Indexed Heap ################
+void test_function_heap_idx(void) {
+
+    Heap_idx *h = heap_idx_new(10, false, 4);
+    UTIL_ERR e = E_SUCCESS;
+    int32_t prio = 0;
+
+    for (size_t id = 0; id<10; id++) {
+        TEST_ASSERT_TRUE(heap_idx_push(h, id, 100 - (int32_t)id) == E_SUCCESS);
+    }
+    TEST_ASSERT_TRUE(heap_idx_push(h, 3, 0) == E_NOOP);
+    TEST_ASSERT_TRUE(heap_idx_push(h, 10, 0) == E_OUTOFBOUNDS);
+    TEST_ASSERT_EQUAL_INT32(9, heap_idx_peek(h, &prio, &e));
+    TEST_ASSERT_EQUAL_INT32(91, prio);
+
+    TEST_ASSERT_TRUE(heap_idx_decrease_key(h, 2, 50) == E_SUCCESS);
+    TEST_ASSERT_TRUE(heap_idx_decrease_key(h, 4, 200) == E_NOOP);
+    TEST_ASSERT_EQUAL_INT32(2, heap_idx_peek(h, &prio, &e));
+    TEST_ASSERT_EQUAL_INT32(50, prio);
+
+    TEST_ASSERT_TRUE(heap_idx_update(h, 2, 1000) == E_SUCCESS);
+    TEST_ASSERT_TRUE(heap_idx_remove(h, 9) == E_SUCCESS);
+    TEST_ASSERT_FALSE(heap_idx_contains(h, 9));
+    TEST_ASSERT_TRUE(heap_idx_remove(h, 9) == E_DOESNT_EXIST);
+
+    size_t expect[] = {8, 7, 6, 5, 4, 3, 1, 0, 2};
+    for (int i = 0; i<9; i++) {
+        TEST_ASSERT_EQUAL_INT32(expect[i], heap_idx_pop(h, NULL, &e));
+    }
+    TEST_ASSERT_EQUAL_INT32(0, heap_idx_size(h));
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+
+    heap_idx_free(h);
+
+}
+
+
+//################ benchmarks ################
+void test_function_heap_topk_vs_resort(void) {
+
+    int cnt = 20000, k = 100;
+    clock_t start, stop;
+    int32_t *stream = malloc(sizeof(int32_t) * cnt);
+    for (int i = 0; i<cnt; i++) stream[i] = rand();
+
+    // re-sort after every insert, keep the first k
+    Vec_i32 *v = vec_i32_new(k + 1);
+    start = clock();
+    for (int i = 0; i<cnt; i++) {
+        vec_i32_add_back(v, stream[i]);
+        vector_sort(v, vec_i32, int_comp);
+        if (v->size > (size_t)k) v->size = k;
+    }
+    stop = clock();
+    fprintf(stdout, "top-%d re-sort: %f s\n", k, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    // bounded max-heap of the k smallest
+    size_t arities[] = {2, 4};
+    for (int a = 0; a<2; a++) {
+        Heap_i32 *h = heap_i32_new(k, NULL, true, arities[a]);
+        UTIL_ERR e = E_SUCCESS;
+        start = clock();
+        for (int i = 0; i<cnt; i++) {
+            if (heap_i32_size(h) < (size_t)k) heap_i32_push(h, stream[i]);
+            else if (stream[i] < heap_i32_peek(h, &e)) heap_i32_replace_top(h, stream[i], &e);
+        }
+        stop = clock();
+        fprintf(stdout, "top-%d %zu-ary heap: %f s\n", k, arities[a], ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+        // same k elements, heap drains largest first
+        for (int i = k-1; i>=0; i--) {
+            TEST_ASSERT_EQUAL_INT32(v->data[i], heap_i32_pop(h, &e));
+        }
+        heap_i32_free(h);
+    }
+
+    vec_i32_free(v);
+    free(stream);
+
+}
+
+
+void test_function_heap_schedule_vs_resort(void) {
+
+    int cnt = 5000;
+    clock_t start, stop;
+    job j = {0};
+
+    // earliest-due scheduler: push a job, every other step run the next one
+    Vector *v = vector_new(sizeof(job), 16);
+    int32_t sum_sort = 0;
+    srand(7);
+    start = clock();
+    for (int i = 0; i<cnt; i++) {
+        j.due = rand() % 100000;
+        vector_add_back(v, &j);
+        vector_sort(v, vector, job_comp);
+        if (i % 2) {
+            sum_sort += ((job*)v->data)->due;
+            vector_delete_idx(v, 0);
+        }
+    }
+    stop = clock();
+    fprintf(stdout, "scheduler re-sort: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    Heap *h = heap_new(sizeof(job), 16, job_comp, false, 4);
+    int32_t sum_heap = 0;
+    srand(7);
+    start = clock();
+    for (int i = 0; i<cnt; i++) {
+        j.due = rand() % 100000;
+        heap_push(h, &j);
+        if (i % 2) {
+            heap_pop(h, &j);
+            sum_heap += j.due;
+        }
+    }
+    stop = clock();
+    fprintf(stdout, "scheduler 4-ary heap: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    TEST_ASSERT_EQUAL_INT32(sum_sort, sum_heap);
+    TEST_ASSERT_EQUAL_INT32(v->size, heap_size(h));
+
+    vector_free(v);
+    heap_free(h);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // generic heap
+    RUN_TEST(test_function_heap_push_pop);
+    RUN_TEST(test_function_heap_from_vector);
+
+    // i32 heap
+    RUN_TEST(test_function_heap_i32_push_pop);
+
+    // indexed heap
+    RUN_TEST(test_function_heap_idx);
+
+    // benchmarks
+    RUN_BENCH(test_function_heap_topk_vs_resort);
+    RUN_BENCH(test_function_heap_schedule_vs_resort);
+
+    return UNITY_END();
+}
@@ -148,6 +148,52 @@ void test_function_llist_push_back(void) {
 
 }
 
+void test_function_llist_push_back_n(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    APUTIL_LList *lst = aputil_llist_new(llist_free, llist_data, NULL,  "test list with strings", &e);
+    aputil_llist_push_back(lst, llist_data("the head!"));
+
+    void *batch[8];
+    for (int i = 0; i<8; i++) {
+        char tmp[64] = {0};
+        sprintf(tmp, "the %dth string!", i + 1);
+        batch[i] = llist_data(tmp);
+    }
+    TEST_ASSERT_TRUE(aputil_llist_push_back_n(lst, batch, 8) == E_SUCCESS);
+    TEST_ASSERT_TRUE(aputil_llist_push_back_n(lst, batch, 0) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(9, lst->cnt);
+    TEST_ASSERT_EQUAL_CHAR_ARRAY("the head!", (char*)lst->head->data, strlen("the head!"));
+    TEST_ASSERT_TRUE(lst->tail->data == batch[7]);
+    TEST_ASSERT_TRUE(lst->head->next->data == batch[0]);
+    TEST_ASSERT_TRUE(lst->head->next->prev == lst->head);
+
+    // batch nodes are released one at a time, the block with the last one
+    free(aputil_llist_pop_back(lst, &e));
+    free(aputil_llist_pop(lst, &e));
+    TEST_ASSERT_TRUE(aputil_llist_delete(lst, lst->head->next, false) == E_SUCCESS);
+    aputil_llist_push_back(lst, llist_data("single"));
+    TEST_ASSERT_EQUAL_INT32(7, lst->cnt);
+    TEST_ASSERT_EQUAL_CHAR_ARRAY("single", (char*)lst->tail->data, strlen("single"));
+
+    // into an empty list
+    APUTIL_LList *empty = aputil_llist_new(NULL, NULL, NULL, "empty", &e);
+    int vals[3] = {1, 2, 3};
+    void *ptrs[3] = {&vals[0], &vals[1], &vals[2]};
+    TEST_ASSERT_TRUE(aputil_llist_push_back_n(empty, ptrs, 3) == E_SUCCESS);
+    TEST_ASSERT_TRUE(empty->head->data == ptrs[0] && empty->tail->data == ptrs[2]);
+    TEST_ASSERT_NULL(empty->head->prev);
+    ptrs[1] = NULL;
+    TEST_ASSERT_TRUE(aputil_llist_push_back_n(empty, ptrs, 3) == E_EMPTY_ARG);
+    TEST_ASSERT_EQUAL_INT32(3, empty->cnt);
+    TEST_ASSERT_TRUE(aputil_llist_push_back_n(NULL, ptrs, 3) == E_EMPTY_OBJ);
+
+    aputil_llist_free(empty, true);
+    aputil_llist_free(lst, false);
+
+}
+
+
 void test_function_llist_pop_back(void) {
 
     UTIL_ERR e = E_SUCCESS;
@@ -281,6 +327,40 @@ void test_function_llist_delete(void) {
 
 }
 
+void test_function_llist_relink(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    APUTIL_LList *lst = aputil_llist_new(NULL, NULL, NULL, "relinked", &e);
+    int vals[4] = {1, 2, 3, 4};
+    for (int i = 0; i<4; i++) aputil_llist_push_back(lst, &vals[i]);
+
+    // 1 2 3 4 -> 3 1 2 4 -> 4 3 1 2
+    TEST_ASSERT_TRUE(aputil_llist_move_front(lst, lst->head->next->next) == E_SUCCESS);
+    TEST_ASSERT_TRUE(aputil_llist_move_front(lst, lst->tail) == E_SUCCESS);
+    TEST_ASSERT_TRUE(aputil_llist_move_front(lst, lst->head) == E_SUCCESS);
+    int order[4] = {4, 3, 1, 2};
+    APUTIL_Node *n = lst->head;
+    for (int i = 0; i<4; i++, n = n->next) TEST_ASSERT_EQUAL_INT32(order[i], *(int*)n->data);
+    TEST_ASSERT_TRUE(lst->tail->data == &vals[1] && lst->tail->prev->next == lst->tail);
+
+    // a caller made node, released by the list like its own
+    APUTIL_Node *tail = lst->tail;
+    TEST_ASSERT_TRUE(aputil_llist_unlink(lst, tail) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(3, lst->cnt);
+    TEST_ASSERT_NULL(lst->tail->next);
+    APUTIL_Node *own = calloc(1, sizeof(*own));
+    own->data = tail->data;
+    free(tail);
+    TEST_ASSERT_TRUE(aputil_llist_link_front(lst, own) == E_SUCCESS);
+    TEST_ASSERT_TRUE(lst->head == own && own->next->prev == own);
+    TEST_ASSERT_EQUAL_INT32(4, lst->cnt);
+    TEST_ASSERT_TRUE(aputil_llist_link_front(NULL, own) == E_EMPTY_OBJ);
+
+    aputil_llist_free(lst, true);
+
+}
+
+
 void test_function_llist_clear(void) {
 
     UTIL_ERR e = E_SUCCESS;
@@ -569,9 +649,11 @@ int main(void) {
     RUN_TEST(test_function_llist_push);
     RUN_TEST(test_function_llist_pop);
     RUN_TEST(test_function_llist_push_back);
+    RUN_TEST(test_function_llist_push_back_n);
     RUN_TEST(test_function_llist_pop_back);
     RUN_TEST(test_function_llist_in);
     RUN_TEST(test_function_llist_delete);
+    RUN_TEST(test_function_llist_relink);
     RUN_TEST(test_function_llist_clear);
     RUN_TEST(test_function_llist_copy_node);
     RUN_TEST(test_function_llist_copy);
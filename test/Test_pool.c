@@ -0,0 +1,319 @@
+/*
+ *    test src/pool.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+static void triple(void *d) {
+    *(int64_t*)d *= 3;
+}
+
+static void triple_i32(int32_t *d) {
+    *d *= 3;
+}
+
+static bool is_odd(void *d) {
+    return *(int64_t*)d % 2;
+}
+
+static bool is_odd_i32(int32_t d) {
+    return d % 2;
+}
+
+static void sum_reduce(void *acc, const void *elem) {
+    *(int64_t*)acc += *(const int64_t*)elem;
+}
+
+static void sum_combine(void *acc, const void *part) {
+    *(int64_t*)acc += *(const int64_t*)part;
+}
+
+// order sensitive fold: polynomial hash, a part carries its own base power
+typedef struct {
+    uint64_t h;
+    uint64_t pow;
+} poly;
+
+static void poly_reduce(void *acc, const void *elem) {
+    poly *p = acc;
+    p->h = p->h * 31 + (uint64_t)*(const int64_t*)elem;
+    p->pow *= 31;
+}
+
+static void poly_combine(void *acc, const void *part) {
+    poly *p = acc;
+    const poly *q = part;
+    p->h = p->h * q->pow + q->h;
+    p->pow *= q->pow;
+}
+
+
+//################ Pool ################
+typedef struct {
+    _Atomic int *hits;
+    _Atomic int bad_worker;
+    size_t n_threads;
+} hit_ctx;
+
+static void hit_task(void *ctx, size_t idx, size_t worker) {
+    hit_ctx *h = ctx;
+    atomic_fetch_add(&h->hits[idx], 1);
+    if (worker >= h->n_threads) atomic_store(&h->bad_worker, 1);
+}
+
+typedef struct {
+    APUTIL_Pool *pool;
+    hit_ctx *inner;
+    _Atomic int bad_ret;
+} nest_ctx;
+
+// each outer task runs a whole batch on the same pool
+static void nest_task(void *ctx, size_t idx, size_t worker) {
+    (void)idx; (void)worker;
+    nest_ctx *c = ctx;
+    if (pool_run(c->pool, 50, hit_task, c->inner) != E_SUCCESS) atomic_store(&c->bad_ret, 1);
+}
+
+void test_function_pool_run(void) {
+
+    APUTIL_Pool *p = pool_new(4);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_INT32(4, pool_threads(p));
+
+    // every index runs exactly once, batch after batch
+    size_t n = 1000;
+    _Atomic int *hits = calloc(n, sizeof(*hits));
+    hit_ctx h = { .hits = hits, .bad_worker = 0, .n_threads = 4 };
+    for (int round = 0; round<20; round++) {
+        TEST_ASSERT_TRUE(pool_run(p, n, hit_task, &h) == E_SUCCESS);
+    }
+    for (size_t i = 0; i<n; i++) TEST_ASSERT_EQUAL_INT32(20, hits[i]);
+    TEST_ASSERT_EQUAL_INT32(0, h.bad_worker);
+
+    TEST_ASSERT_TRUE(pool_run(p, 0, hit_task, &h) == E_NOOP);
+    TEST_ASSERT_TRUE(pool_run(p, 1, NULL, &h) == E_EMPTY_FUNC);
+    TEST_ASSERT_TRUE(pool_run(NULL, 1, hit_task, &h) == E_EMPTY_OBJ);
+
+    // nested batches on the same pool run inline instead of deadlocking
+    memset(hits, 0, n * sizeof(*hits));
+    nest_ctx c = { .pool = p, .inner = &h, .bad_ret = 0 };
+    TEST_ASSERT_TRUE(pool_run(p, 16, nest_task, &c) == E_SUCCESS);
+    for (size_t i = 0; i<50; i++) TEST_ASSERT_EQUAL_INT32(16, hits[i]);
+    TEST_ASSERT_EQUAL_INT32(0, c.bad_ret);
+    TEST_ASSERT_EQUAL_INT32(0, h.bad_worker);
+
+    free(hits);
+    pool_free(p);
+
+    p = pool_new(0);
+    TEST_ASSERT_TRUE(pool_threads(p) >= 1);
+    pool_free(p);
+
+}
+
+
+//################ Parallel Vector Ops ################
+void test_function_pool_map_filter(void) {
+
+    APUTIL_Pool *p = pool_new(3);
+    UTIL_ERR e = E_SUCCESS;
+
+    // sizes below, at and well above one chunk
+    size_t sizes[] = {0, 7, 512, 100003};
+    for (int s = 0; s<4; s++) {
+        Vector *a = vector_new(sizeof(int64_t), sizes[s] + 1);
+        Vec_i32 *ai = vec_i32_new(sizes[s] + 1);
+        for (size_t i = 0; i<sizes[s]; i++) {
+            int64_t val = rand() % 1000;
+            vector_add_back(a, &val);
+            vec_i32_add_back(ai, (int32_t)val);
+        }
+        Vector *b = vector_copy(a);
+        Vec_i32 *bi = vec_i32_copy(ai);
+
+        TEST_ASSERT_TRUE(vector_map(a, triple) == E_SUCCESS);
+        TEST_ASSERT_TRUE(vector_map_par(p, b, triple) == E_SUCCESS);
+        if (a->size) TEST_ASSERT_EQUAL_MEMORY(a->data, b->data, a->size * a->elem_size);
+        vec_i32_map(ai, triple_i32);
+        TEST_ASSERT_TRUE(vec_i32_map_par(p, bi, triple_i32) == E_SUCCESS);
+        if (ai->size) TEST_ASSERT_EQUAL_MEMORY(ai->data, bi->data, ai->size * sizeof(int32_t));
+
+        // same elements in the same order as the serial filter
+        Vector *fa = vector_filter(a, is_odd, &e);
+        Vector *fb = vector_filter_par(p, b, is_odd, &e);
+        TEST_ASSERT_EQUAL_INT32(fa->size, fb->size);
+        if (fa->size) TEST_ASSERT_EQUAL_MEMORY(fa->data, fb->data, fa->size * fa->elem_size);
+        Vec_i32 *fai = vec_i32_filter(ai, is_odd_i32, &e);
+        Vec_i32 *fbi = vec_i32_filter_par(p, bi, is_odd_i32, &e);
+        TEST_ASSERT_EQUAL_INT32(fai->size, fbi->size);
+        if (fai->size) TEST_ASSERT_EQUAL_MEMORY(fai->data, fbi->data, fai->size * sizeof(int32_t));
+        TEST_ASSERT_TRUE(e == E_SUCCESS);
+
+        vector_free(a);
+        vector_free(b);
+        vector_free(fa);
+        vector_free(fb);
+        vec_i32_free(ai);
+        vec_i32_free(bi);
+        vec_i32_free(fai);
+        vec_i32_free(fbi);
+    }
+
+    TEST_ASSERT_TRUE(vector_map_par(NULL, NULL, triple) == E_EMPTY_OBJ);
+    TEST_ASSERT_NULL(vector_filter_par(p, NULL, is_odd, &e));
+    TEST_ASSERT_TRUE(e == E_EMPTY_OBJ);
+
+    pool_free(p);
+
+}
+
+
+void test_function_pool_reduce(void) {
+
+    APUTIL_Pool *p = pool_new(4);
+    Vector *v = vector_new(sizeof(int64_t), 1);
+    for (int64_t i = 0; i<200000; i++) vector_add_back(v, &i);
+
+    int64_t serial = 0, par = 0;
+    vector_reduce(v, &serial, sum_reduce);
+    TEST_ASSERT_TRUE(vector_reduce_par(p, v, &par, sizeof(par), sum_reduce, sum_combine) == E_SUCCESS);
+    TEST_ASSERT_TRUE(serial == par);
+    TEST_ASSERT_TRUE(par == (int64_t)199999 * 200000 / 2);
+
+    // only associative, chunk order must be kept
+    poly ps = {0, 1}, pp = {0, 1};
+    vector_reduce(v, &ps, poly_reduce);
+    vector_reduce_par(p, v, &pp, sizeof(pp), poly_reduce, poly_combine);
+    TEST_ASSERT_TRUE(ps.h == pp.h);
+
+    TEST_ASSERT_TRUE(vector_reduce_par(p, v, &par, sizeof(par), NULL, sum_combine) == E_EMPTY_FUNC);
+    TEST_ASSERT_TRUE(vector_reduce_par(p, v, NULL, sizeof(par), sum_reduce, sum_combine) == E_EMPTY_ARG);
+
+    vector_free(v);
+    pool_free(p);
+
+}
+
+
+void test_function_pool_touch(void) {
+
+    APUTIL_Pool *p = pool_new(4);
+
+    // existing elements are kept, the rest is zero
+    Vector *v = vector_new(sizeof(int64_t), 4);
+    for (int64_t i = 1; i<=3; i++) vector_add_back(v, &i);
+    TEST_ASSERT_TRUE(vector_touch_par(p, v, 100003) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(100003, v->size);
+    TEST_ASSERT_TRUE(v->cap >= v->size);
+    int64_t *d = v->data;
+    TEST_ASSERT_TRUE(d[0] == 1 && d[2] == 3);
+    int64_t sum = 0;
+    for (size_t i = 3; i<v->size; i++) sum |= d[i];
+    TEST_ASSERT_TRUE(sum == 0);
+    TEST_ASSERT_TRUE(vector_touch_par(p, v, 10) == E_NOOP);
+    vector_free(v);
+
+    // keeps the alignment of the storage options
+    Vec_alloc line = { .align = APUTIL_CACHE_LINE };
+    Vec_i32 *vi = vec_i32_new_opts(1, &line);
+    vec_i32_add_back(vi, 7);
+    TEST_ASSERT_TRUE(vec_i32_touch_par(p, vi, 50000) == E_SUCCESS);
+    TEST_ASSERT_TRUE((uintptr_t)vi->data % APUTIL_CACHE_LINE == 0);
+    TEST_ASSERT_EQUAL_INT32(7, vi->data[0]);
+    TEST_ASSERT_EQUAL_INT32(0, vi->data[49999]);
+    TEST_ASSERT_TRUE(vec_i32_touch_par(NULL, vi, 60000) == E_EMPTY_ARG);
+    vec_i32_free(vi);
+
+    pool_free(p);
+
+}
+
+
+//################ benchmarks ################
+static void heavy(void *d) {
+    double x = *(double*)d;
+    for (int i = 0; i<200; i++) x = x * 0.999 + 1.0 / (x + 1.0);
+    *(double*)d = x;
+}
+
+static void dsum_reduce(void *acc, const void *elem) {
+    *(double*)acc += *(const double*)elem;
+}
+
+static void dsum_combine(void *acc, const void *part) {
+    *(double*)acc += *(const double*)part;
+}
+
+void test_function_pool_vs_serial(void) {
+
+    size_t cnt = 200000;
+    Vector *a = vector_new(sizeof(double), cnt);
+    for (size_t i = 0; i<cnt; i++) {
+        double val = (double)(rand() % 1000);
+        vector_add_back(a, &val);
+    }
+    Vector *b = vector_copy(a);
+
+    double start = wall();
+    vector_map(a, heavy);
+    double serial = wall() - start;
+    fprintf(stdout, "vector_map: %f s\n", serial);
+
+    APUTIL_Pool *p = pool_new(0);
+    start = wall();
+    vector_map_par(p, b, heavy);
+    double par = wall() - start;
+    fprintf(stdout, "vector_map_par %zu threads: %f s (speedup %.2fx)\n", pool_threads(p), par, serial / par);
+    TEST_ASSERT_EQUAL_MEMORY(a->data, b->data, cnt * sizeof(double));
+
+    double s1 = 0, s2 = 0;
+    start = wall();
+    vector_reduce(a, &s1, dsum_reduce);
+    serial = wall() - start;
+    start = wall();
+    vector_reduce_par(p, a, &s2, sizeof(s2), dsum_reduce, dsum_combine);
+    par = wall() - start;
+    fprintf(stdout, "vector_reduce: %f s, vector_reduce_par: %f s (speedup %.2fx)\n", serial, par, serial / par);
+
+    pool_free(p);
+    vector_free(a);
+    vector_free(b);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // pool
+    RUN_TEST(test_function_pool_run);
+
+    // parallel vector ops
+    RUN_TEST(test_function_pool_map_filter);
+    RUN_TEST(test_function_pool_reduce);
+    RUN_TEST(test_function_pool_touch);
+
+    // benchmarks
+    RUN_BENCH(test_function_pool_vs_serial);
+
+    return UNITY_END();
+}
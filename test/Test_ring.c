@@ -0,0 +1,237 @@
+/*
+ *    test src/ring.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "../include/aputils.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+//################ Generic Ring ################
+void test_function_ring_new(void) {
+
+    Ring *r = ring_new(sizeof(double), 100);
+    TEST_ASSERT_NOT_NULL(r);
+    TEST_ASSERT_NOT_NULL(r->data);
+    TEST_ASSERT_EQUAL_INT32(128, r->cap);
+    TEST_ASSERT_EQUAL_INT32(127, r->mask);
+    TEST_ASSERT_EQUAL_INT32(sizeof(double), r->elem_size);
+    TEST_ASSERT_EQUAL_INT32(0, ring_size(r));
+
+    // head and tail must not share a cache line
+    TEST_ASSERT_TRUE(
+        (char*)&r->head - (char*)&r->tail >= APUTIL_CACHE_LINE
+    );
+
+    TEST_ASSERT_NULL(ring_new(0, 10));
+    TEST_ASSERT_NULL(ring_new(4, 0));
+
+    ring_free(r);
+
+}
+
+
+void test_function_ring_push_pop(void) {
+
+    Ring *r = ring_new(sizeof(int), 4);
+    int out = 0;
+
+    TEST_ASSERT_TRUE(ring_pop(r, &out) == E_NODATA);
+    for (int i = 0; i<4; i++) {
+        TEST_ASSERT_TRUE(ring_push(r, &i) == E_SUCCESS);
+    }
+    int extra = 99;
+    TEST_ASSERT_TRUE(ring_push(r, &extra) == E_FULL);
+    TEST_ASSERT_EQUAL_INT32(4, ring_size(r));
+
+    // wrap around several times
+    for (int i = 0; i<20; i++) {
+        TEST_ASSERT_TRUE(ring_pop(r, &out) == E_SUCCESS);
+        TEST_ASSERT_EQUAL_INT32(i, out);
+        int next = i + 4;
+        TEST_ASSERT_TRUE(ring_push(r, &next) == E_SUCCESS);
+    }
+
+    TEST_ASSERT_TRUE(ring_push(NULL, &out) == E_EMPTY_OBJ);
+    TEST_ASSERT_TRUE(ring_push(r, NULL) == E_EMPTY_ARG);
+
+    ring_free(r);
+
+}
+
+
+void test_function_ring_push_pop_n(void) {
+
+    Ring *r = ring_new(sizeof(int), 8);
+    int in[12], out[12] = {0};
+    for (int i = 0; i<12; i++) in[i] = i;
+
+    // partial push when full
+    TEST_ASSERT_EQUAL_INT32(8, ring_push_n(r, in, 12));
+    TEST_ASSERT_EQUAL_INT32(0, ring_push_n(r, in, 1));
+
+    TEST_ASSERT_EQUAL_INT32(5, ring_pop_n(r, out, 5));
+    for (int i = 0; i<5; i++) TEST_ASSERT_EQUAL_INT32(i, out[i]);
+
+    // this batch wraps the end of the buffer
+    TEST_ASSERT_EQUAL_INT32(4, ring_push_n(r, in + 8, 4));
+    TEST_ASSERT_EQUAL_INT32(7, ring_pop_n(r, out, 12));
+    for (int i = 0; i<7; i++) TEST_ASSERT_EQUAL_INT32(i + 5, out[i]);
+
+    TEST_ASSERT_EQUAL_INT32(0, ring_pop_n(r, out, 12));
+    TEST_ASSERT_EQUAL_INT32(0, ring_size(r));
+
+    ring_free(r);
+
+}
+
+
+//################ i32 Ring ################
+void test_function_ring_i32_push_pop(void) {
+
+    Ring_i32 *r = ring_i32_new(3);
+    TEST_ASSERT_EQUAL_INT32(4, r->cap);
+
+    UTIL_ERR e = E_SUCCESS;
+    ring_i32_pop(r, &e);
+    TEST_ASSERT_TRUE(e == E_NODATA);
+
+    for (int32_t i = 0; i<4; i++) {
+        TEST_ASSERT_TRUE(ring_i32_push(r, i * 10) == E_SUCCESS);
+    }
+    TEST_ASSERT_TRUE(ring_i32_push(r, 1) == E_FULL);
+
+    e = E_SUCCESS;
+    for (int32_t i = 0; i<4; i++) {
+        TEST_ASSERT_EQUAL_INT32(i * 10, ring_i32_pop(r, &e));
+        TEST_ASSERT_TRUE(e == E_SUCCESS);
+    }
+
+    int32_t in[6] = {1, 2, 3, 4, 5, 6}, out[6] = {0};
+    TEST_ASSERT_EQUAL_INT32(3, ring_i32_push_n(r, in, 3));
+    TEST_ASSERT_EQUAL_INT32(2, ring_i32_pop_n(r, out, 2));
+    TEST_ASSERT_EQUAL_INT32(3, ring_i32_push_n(r, in + 3, 3));
+    TEST_ASSERT_EQUAL_INT32(4, ring_i32_pop_n(r, out + 2, 6));
+    for (int i = 0; i<6; i++) TEST_ASSERT_EQUAL_INT32(in[i], out[i]);
+
+    ring_i32_free(r);
+
+}
+
+
+//################ threaded ################
+#define SPSC_CNT 1000000
+
+static void *spsc_producer(void *arg) {
+    Ring_i32 *r = arg;
+    int32_t batch[64];
+    int32_t next = 0;
+    while (next < SPSC_CNT) {
+        size_t n = 0;
+        while (n < 64 && next + (int32_t)n < SPSC_CNT) {
+            batch[n] = next + (int32_t)n;
+            n++;
+        }
+        size_t sent = 0;
+        while (sent < n) {
+            size_t pushed = ring_i32_push_n(r, batch + sent, n - sent);
+            if (!pushed) sched_yield();
+            sent += pushed;
+        }
+        next += (int32_t)n;
+    }
+    return NULL;
+}
+
+void test_function_ring_i32_spsc_threads(void) {
+
+    Ring_i32 *r = ring_i32_new(1024);
+    pthread_t prod;
+    pthread_create(&prod, NULL, spsc_producer, r);
+
+    clock_t start = clock();
+    int32_t expect = 0, buf[128];
+    bool ordered = true;
+    while (expect < SPSC_CNT) {
+        size_t n = ring_i32_pop_n(r, buf, 128);
+        if (!n) sched_yield();
+        for (size_t i = 0; i<n; i++) {
+            if (buf[i] != expect++) ordered = false;
+        }
+    }
+    pthread_join(prod, NULL);
+    clock_t stop = clock();
+    fprintf(stdout, "spsc ring %d elements: %f s (cpu)\n", SPSC_CNT, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_INT32(0, ring_i32_size(r));
+
+    ring_i32_free(r);
+
+}
+
+
+void test_function_ring_vs_vector_queue(void) {
+
+    int cnt = 20000;
+    clock_t start, stop;
+
+    // old approach, pop from the front of a vector
+    Vec_i32 *v = vec_i32_new(cnt);
+    for (int i = 0; i<cnt; i++) vec_i32_add_back(v, i);
+    start = clock();
+    UTIL_ERR e = E_SUCCESS;
+    while (v->size) {
+        vec_i32_get(v, 0, &e);
+        vec_i32_delete_idx(v, 0);
+    }
+    stop = clock();
+    fprintf(stdout, "vec_i32 front pop queue: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    Ring_i32 *r = ring_i32_new(cnt);
+    for (int i = 0; i<cnt; i++) ring_i32_push(r, i);
+    start = clock();
+    int32_t last = -1;
+    while (ring_i32_size(r)) last = ring_i32_pop(r, &e);
+    stop = clock();
+    fprintf(stdout, "ring_i32 pop queue: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+    TEST_ASSERT_EQUAL_INT32(cnt - 1, last);
+
+    vec_i32_free(v);
+    ring_i32_free(r);
+
+}
+
+
+
+int main(void) {
+
+    UNITY_BEGIN();
+
+    // generic ring
+    RUN_TEST(test_function_ring_new);
+    RUN_TEST(test_function_ring_push_pop);
+    RUN_TEST(test_function_ring_push_pop_n);
+
+    // i32 ring
+    RUN_TEST(test_function_ring_i32_push_pop);
+
+    // threaded
+    RUN_TEST(test_function_ring_i32_spsc_threads);
+    RUN_TEST(test_function_ring_vs_vector_queue);
+
+    return UNITY_END();
+}
@@ -0,0 +1,256 @@
+/*
+ *    test src/sched.c and the parallel sorts built on it
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+static int int_comp(const void *d1, const void *d2) {
+    int a = *(const int*)d1, b = *(const int*)d2;
+    return (a > b) - (a < b);
+}
+
+typedef struct {
+    int32_t key;
+    int32_t seq;
+} rec;
+
+static int rec_comp(const void *d1, const void *d2) {
+    int32_t a = ((const rec*)d1)->key, b = ((const rec*)d2)->key;
+    return (a > b) - (a < b);
+}
+
+
+//################ Scheduler ################
+typedef struct {
+    int n;
+    long result;
+} fib_args;
+
+// naive fib, spawns one branch and computes the other
+static void fib_task(void *arg) {
+    fib_args *f = arg;
+    if (f->n < 2) {
+        f->result = f->n;
+        return;
+    }
+    fib_args a = { .n = f->n - 1 }, b = { .n = f->n - 2 };
+    APUTIL_Sync g = APUTIL_SYNC_INIT;
+    sched_spawn(&g, fib_task, &a);
+    fib_task(&b);
+    sched_sync(&g);
+    f->result = a.result + b.result;
+}
+
+typedef struct {
+    const int64_t *data;
+    size_t n;
+    int64_t sum;
+    _Atomic int *seen;              // per worker id, checks id range
+    size_t n_workers;
+} sum_args;
+
+static void sum_task(void *arg) {
+    sum_args *s = arg;
+    size_t id = sched_worker_id();
+    if (id < s->n_workers) atomic_fetch_add(&s->seen[id], 1);
+
+    if (s->n <= 1000) {
+        s->sum = 0;
+        for (size_t i = 0; i<s->n; i++) s->sum += s->data[i];
+        return;
+    }
+
+    // four way split, several children in one group
+    sum_args parts[4];
+    size_t q = s->n / 4;
+    APUTIL_Sync g = APUTIL_SYNC_INIT;
+    for (int i = 0; i<4; i++) {
+        parts[i] = *s;
+        parts[i].data = s->data + i * q;
+        parts[i].n = i == 3 ? s->n - 3 * q : q;
+        if (i < 3) sched_spawn(&g, sum_task, &parts[i]);
+    }
+    sum_task(&parts[3]);
+    sched_sync(&g);
+    s->sum = parts[0].sum + parts[1].sum + parts[2].sum + parts[3].sum;
+}
+
+void test_function_sched_spawn_sync(void) {
+
+    size_t workers[] = {1, 4};
+    for (int w = 0; w<2; w++) {
+        APUTIL_Sched *s = sched_new(workers[w]);
+        TEST_ASSERT_NOT_NULL(s);
+        TEST_ASSERT_EQUAL_INT32(workers[w], sched_workers(s));
+
+        fib_args f = { .n = 22 };
+        TEST_ASSERT_TRUE(sched_run(s, fib_task, &f) == E_SUCCESS);
+        TEST_ASSERT_EQUAL_INT32(17711, f.result);
+
+        // several runs on the same scheduler
+        size_t n = 300000;
+        int64_t *data = malloc(sizeof(int64_t) * n);
+        for (size_t i = 0; i<n; i++) data[i] = (int64_t)i;
+        _Atomic int *seen = calloc(workers[w], sizeof(*seen));
+        for (int r = 0; r<3; r++) {
+            sum_args sa = { .data = data, .n = n, .seen = seen, .n_workers = workers[w] };
+            sched_run(s, sum_task, &sa);
+            TEST_ASSERT_TRUE(sa.sum == (int64_t)((n - 1) * n / 2));
+        }
+        TEST_ASSERT_TRUE(seen[0] > 0);
+
+        free(seen);
+        free(data);
+        sched_free(s);
+    }
+
+    // spawn outside a run executes inline
+    fib_args f = { .n = 10 };
+    fib_task(&f);
+    TEST_ASSERT_EQUAL_INT32(55, f.result);
+    TEST_ASSERT_TRUE(sched_run(NULL, fib_task, &f) == E_EMPTY_OBJ);
+
+}
+
+
+//################ Parallel Sorts ################
+void test_function_sched_vector_sort_par(void) {
+
+    APUTIL_Sched *s = sched_new(4);
+    size_t sizes[] = {0, 1, 100, 4097, 50000, 300000};
+
+    for (int t = 0; t<6; t++) {
+        Vector *v = vector_new(sizeof(rec), sizes[t] + 1);
+        for (size_t i = 0; i<sizes[t]; i++) {
+            rec r = { .key = rand() % 1000, .seq = (int32_t)i };
+            vector_add_back(v, &r);
+        }
+        TEST_ASSERT_TRUE(vector_sort_par(s, v, vector, rec_comp) == E_SUCCESS);
+
+        // ordered and stable
+        rec *d = v->data;
+        for (size_t i = 1; i<v->size; i++) {
+            TEST_ASSERT_TRUE(d[i-1].key <= d[i].key);
+            if (d[i-1].key == d[i].key) TEST_ASSERT_TRUE(d[i-1].seq < d[i].seq);
+        }
+        vector_free(v);
+    }
+
+    // i32 vector, also without a scheduler
+    Vec_i32 *a = vec_i32_new(100000), *b = vec_i32_new(100000);
+    for (int i = 0; i<100000; i++) {
+        int32_t r = rand();
+        vec_i32_add_back(a, r);
+        vec_i32_add_back(b, r);
+    }
+    vector_sort(a, vec_i32, int_comp);
+    TEST_ASSERT_TRUE(vector_sort_par(NULL, b, vec_i32, int_comp) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_MEMORY(a->data, b->data, a->size * sizeof(int32_t));
+
+    TEST_ASSERT_TRUE(vector_sort_par(s, b, vec_i32, NULL) == E_EMPTY_FUNC);
+    TEST_ASSERT_TRUE(vector_sort_par(s, b, (VECTYPE)7, int_comp) == E_BAD_TYPE);
+
+    vec_i32_free(a);
+    vec_i32_free(b);
+    sched_free(s);
+
+}
+
+
+void test_function_sched_merge_sort_par(void) {
+
+    APUTIL_Sched *s = sched_new(3);
+    UTIL_ERR e = E_SUCCESS;
+    APUTIL_LList *a = aputil_llist_new(free, NULL, int_comp, "serial", &e);
+    APUTIL_LList *b = aputil_llist_new(free, NULL, int_comp, "parallel", &e);
+    for (int i = 0; i<20000; i++) {
+        int r = rand() % 5000;
+        int *x = malloc(sizeof(int)), *y = malloc(sizeof(int));
+        *x = *y = r;
+        aputil_llist_push_back(a, x);
+        aputil_llist_push_back(b, y);
+    }
+
+    merge_sort(a);
+    TEST_ASSERT_TRUE(merge_sort_par(s, b) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(a->cnt, b->cnt);
+
+    APUTIL_Node *x = a->head, *y = b->head;
+    while (x && y) {
+        TEST_ASSERT_EQUAL_INT32(*(int*)x->data, *(int*)y->data);
+        x = x->next;
+        y = y->next;
+    }
+    TEST_ASSERT_TRUE(!x && !y);
+
+    aputil_llist_free(a, false);
+    aputil_llist_free(b, false);
+    sched_free(s);
+
+}
+
+
+//################ benchmarks ################
+void test_function_sched_sort_vs_serial(void) {
+
+    size_t cnt = 2000000;
+    Vec_i32 *a = vec_i32_new(cnt), *b = vec_i32_new(cnt);
+    for (size_t i = 0; i<cnt; i++) {
+        int32_t r = rand();
+        vec_i32_add_back(a, r);
+        vec_i32_add_back(b, r);
+    }
+
+    double start = wall();
+    vector_sort(a, vec_i32, int_comp);
+    double serial = wall() - start;
+    fprintf(stdout, "vector_sort %zu: %f s\n", cnt, serial);
+
+    APUTIL_Sched *s = sched_new(0);
+    start = wall();
+    vector_sort_par(s, b, vec_i32, int_comp);
+    double par = wall() - start;
+    fprintf(stdout, "vector_sort_par %zu workers: %f s (speedup %.2fx)\n", sched_workers(s), par, serial / par);
+    TEST_ASSERT_EQUAL_MEMORY(a->data, b->data, cnt * sizeof(int32_t));
+
+    sched_free(s);
+    vec_i32_free(a);
+    vec_i32_free(b);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // scheduler
+    RUN_TEST(test_function_sched_spawn_sync);
+
+    // parallel sorts
+    RUN_TEST(test_function_sched_vector_sort_par);
+    RUN_TEST(test_function_sched_merge_sort_par);
+
+    // benchmarks
+    RUN_BENCH(test_function_sched_sort_vs_serial);
+
+    return UNITY_END();
+}
@@ -0,0 +1,248 @@
+/*
+ *    test src/search.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+typedef struct {
+    int64_t id;
+    char name[24];
+} rec;
+
+static int cmp_i32(const void *a, const void *b) {
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_rec(const void *a, const void *b) {
+    int64_t x = ((const rec*)a)->id, y = ((const rec*)b)->id;
+    return (x > y) - (x < y);
+}
+
+static size_t linear_lower(const int32_t *a, size_t n, int32_t key) {
+    size_t i = 0;
+    while (i < n && a[i] < key) i++;
+    return i;
+}
+
+static size_t linear_upper(const int32_t *a, size_t n, int32_t key) {
+    size_t i = 0;
+    while (i < n && a[i] <= key) i++;
+    return i;
+}
+
+// n sorted values in [0, range), duplicates when range is small
+static Vec_i32 *sorted_i32(size_t n, int32_t range) {
+    Vec_i32 *v = vec_i32_new(n ? n : 1);
+    for (size_t i = 0; i<n; i++) vec_i32_add_back(v, rand() % range);
+    vec_i32_sort_net(v);
+    return v;
+}
+
+
+//################ Binary search ################
+void test_function_search_bounds(void) {
+
+    // every size through the first few tree heights, keys below, inside and above
+    for (size_t n = 0; n<300; n++) {
+        int32_t range = n % 3 ? (int32_t)n * 2 + 1 : 7;
+        Vec_i32 *v = sorted_i32(n, range);
+        UTIL_ERR e = E_SUCCESS;
+        for (int32_t key = -2; key <= range + 1; key++) {
+            size_t lo = linear_lower(v->data, n, key), hi = linear_upper(v->data, n, key);
+            TEST_ASSERT_TRUE(vec_i32_lower_bound(v, key) == lo);
+            TEST_ASSERT_TRUE(vec_i32_upper_bound(v, key) == hi);
+            TEST_ASSERT_TRUE(vec_i32_bsearch(v, key, &e) == (lo < hi ? (intmax_t)lo : -1));
+
+            Vector g = { .data = v->data, .size = n, .cap = n, .elem_size = sizeof(int32_t) };
+            TEST_ASSERT_TRUE(vector_lower_bound(&g, &key, cmp_i32) == lo);
+            TEST_ASSERT_TRUE(vector_upper_bound(&g, &key, cmp_i32) == hi);
+            TEST_ASSERT_TRUE(vector_bsearch(&g, &key, cmp_i32, &e) == (lo < hi ? (intmax_t)lo : -1));
+        }
+        TEST_ASSERT_TRUE(e == E_SUCCESS);
+        vec_i32_free(v);
+    }
+
+    // extremes of the int range
+    int32_t edge[] = { INT32_MIN, INT32_MIN, -1, 0, INT32_MAX };
+    Vec_i32 *v = vec_i32_new(8);
+    vec_i32_append_n(v, edge, 5);
+    TEST_ASSERT_TRUE(vec_i32_lower_bound(v, INT32_MIN) == 0);
+    TEST_ASSERT_TRUE(vec_i32_upper_bound(v, INT32_MIN) == 2);
+    TEST_ASSERT_TRUE(vec_i32_upper_bound(v, INT32_MAX) == 5);
+    TEST_ASSERT_TRUE(vec_i32_lower_bound(v, INT32_MAX) == 4);
+
+    UTIL_ERR e = E_SUCCESS;
+    TEST_ASSERT_TRUE(vec_i32_bsearch(NULL, 1, &e) == -1);
+    TEST_ASSERT_TRUE(e == E_EMPTY_OBJ);
+    Vector *g = vector_from_array(edge, 5, sizeof(int32_t));
+    e = E_SUCCESS;
+    TEST_ASSERT_TRUE(vector_bsearch(g, edge, NULL, &e) == -1);
+    TEST_ASSERT_TRUE(e == E_EMPTY_FUNC);
+    e = E_SUCCESS;
+    TEST_ASSERT_TRUE(vector_bsearch(g, NULL, cmp_i32, &e) == -1);
+    TEST_ASSERT_TRUE(e == E_EMPTY_ARG);
+    TEST_ASSERT_TRUE(vector_lower_bound(NULL, edge, cmp_i32) == 0);
+
+    vector_free(g);
+    vec_i32_free(v);
+
+}
+
+
+//################ Eytzinger ################
+void test_function_search_eytz(void) {
+
+    for (size_t n = 0; n<600; n++) {
+        int32_t range = n % 2 ? (int32_t)n * 3 + 1 : 11;
+        Vec_i32 *v = sorted_i32(n, range);
+        Eytz_i32 *t = eytz_i32_new(v);
+        TEST_ASSERT_NOT_NULL(t);
+        TEST_ASSERT_TRUE(((uintptr_t)t->tree & (APUTIL_CACHE_LINE - 1)) == 0);
+
+        Vector g = { .data = v->data, .size = n, .cap = n, .elem_size = sizeof(int32_t) };
+        Eytz *gt = eytz_new(&g, cmp_i32);
+        TEST_ASSERT_NOT_NULL(gt);
+        TEST_ASSERT_TRUE(gt->prefetch == 4);
+
+        UTIL_ERR e = E_SUCCESS;
+        for (int32_t key = -1; key <= range; key++) {
+            size_t lo = vec_i32_lower_bound(v, key), hi = vec_i32_upper_bound(v, key);
+            intmax_t at = vec_i32_bsearch(v, key, &e);
+            TEST_ASSERT_TRUE(eytz_i32_lower_bound(t, key) == lo);
+            TEST_ASSERT_TRUE(eytz_i32_upper_bound(t, key) == hi);
+            TEST_ASSERT_TRUE(eytz_i32_bsearch(t, key) == at);
+            TEST_ASSERT_TRUE(eytz_lower_bound(gt, &key) == lo);
+            TEST_ASSERT_TRUE(eytz_upper_bound(gt, &key) == hi);
+            TEST_ASSERT_TRUE(eytz_bsearch(gt, &key) == at);
+        }
+
+        eytz_free(gt);
+        eytz_i32_free(t);
+        vec_i32_free(v);
+    }
+
+    // records keyed by id, wider than the prefetched line
+    Vector *recs = vector_new(sizeof(rec), 1000);
+    for (int64_t i = 0; i<1000; i++) {
+        rec r = { .id = i * 10 };
+        snprintf(r.name, sizeof(r.name), "rec %lld", (long long)i);
+        vector_add_back(recs, &r);
+    }
+    Eytz *t = eytz_new(recs, cmp_rec);
+    TEST_ASSERT_TRUE(t->prefetch == 1);
+    for (int64_t id = -5; id<10010; id += 5) {
+        rec key = { .id = id };
+        intmax_t at = eytz_bsearch(t, &key);
+        TEST_ASSERT_TRUE(at == (id >= 0 && id < 10000 && id % 10 == 0 ? id / 10 : -1));
+        TEST_ASSERT_TRUE(eytz_lower_bound(t, &key) == vector_lower_bound(recs, &key, cmp_rec));
+    }
+    rec key = { .id = 420 };
+    TEST_ASSERT_EQUAL_STRING("rec 42", ((rec*)vector_at(recs, (size_t)eytz_bsearch(t, &key)))->name);
+
+    TEST_ASSERT_NULL(eytz_new(recs, NULL));
+    TEST_ASSERT_NULL(eytz_i32_new(NULL));
+    TEST_ASSERT_TRUE(eytz_i32_bsearch(NULL, 3) == -1);
+    eytz_free(t);
+    vector_free(recs);
+
+}
+
+
+//################ benchmarks ################
+/*
+    random lookups in a sorted vector past the caches: std-style branchy
+    binary search, the branchless one and the Eytzinger index
+*/
+static size_t branchy_lower(const int32_t *a, size_t n, int32_t key) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void test_function_search_bench(void) {
+
+    size_t sizes[] = { 1000, 1 << 20, 1 << 25 }, q = 4000000;
+    for (size_t s = 0; s<sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        Vec_i32 *v = vec_i32_new(n);
+        for (size_t i = 0; i<n; i++) vec_i32_add_back(v, (int32_t)(i * 2));
+        int32_t *keys = malloc(q * sizeof(int32_t));
+        for (size_t i = 0; i<q; i++) keys[i] = (int32_t)(((size_t)rand() * 7919 + (size_t)rand()) % (2 * n));
+
+        size_t acc = 0;
+        double start = wall();
+        for (size_t i = 0; i<q; i++) acc += branchy_lower(v->data, n, keys[i]);
+        double secs = wall() - start;
+        fprintf(stdout, "n %zu branchy binary search: %f ns/lookup\n", n, secs / q * 1e9);
+
+        size_t check = 0;
+        start = wall();
+        for (size_t i = 0; i<q; i++) check += vec_i32_lower_bound(v, keys[i]);
+        secs = wall() - start;
+        fprintf(stdout, "n %zu vec_i32_lower_bound: %f ns/lookup\n", n, secs / q * 1e9);
+        TEST_ASSERT_TRUE(check == acc);
+
+        start = wall();
+        Eytz_i32 *t = eytz_i32_new(v);
+        fprintf(stdout, "n %zu eytz_i32_new: %f s\n", n, wall() - start);
+        check = 0;
+        start = wall();
+        for (size_t i = 0; i<q; i++) check += eytz_i32_lower_bound(t, keys[i]);
+        secs = wall() - start;
+        fprintf(stdout, "n %zu eytz_i32_lower_bound: %f ns/lookup\n", n, secs / q * 1e9);
+        TEST_ASSERT_TRUE(check == acc);
+
+        if (n <= 1000) {
+            UTIL_ERR e = E_SUCCESS;
+            start = wall();
+            for (size_t i = 0; i<q / 10; i++) check += (size_t)vec_i32_in(v, keys[i], NULL, &e);
+            secs = wall() - start;
+            fprintf(stdout, "n %zu vec_i32_in: %f ns/lookup\n", n, secs / (q / 10) * 1e9);
+        }
+
+        eytz_i32_free(t);
+        free(keys);
+        vec_i32_free(v);
+    }
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // binary search
+    RUN_TEST(test_function_search_bounds);
+
+    // eytzinger
+    RUN_TEST(test_function_search_eytz);
+
+    // benchmarks
+    RUN_BENCH(test_function_search_bench);
+
+    return UNITY_END();
+}
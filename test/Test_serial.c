@@ -0,0 +1,306 @@
+/*
+ *    test src/serial.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+#define VEC_PATH "/tmp/aputil_test_serial_vec.bin"
+#define LIST_PATH "/tmp/aputil_test_serial_list.bin"
+#define DIR_PATH "/tmp/aputil_test_serial_dir"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {
+    remove(VEC_PATH);
+    remove(LIST_PATH);
+}
+
+
+
+typedef struct {
+    int64_t id;
+    double score;
+    char tag[8];
+} rec;
+
+// flip one payload byte in place
+static void corrupt_file(const char *path, long offset) {
+    FILE *f = fopen(path, "r+b");
+    fseek(f, offset, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(c ^ 0x5a, f);
+    fclose(f);
+}
+
+
+//################ Vectors ################
+void test_function_serial_vector(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    Vector *v = vector_new(sizeof(rec), 1);
+    for (int i = 0; i<1000; i++) {
+        rec r = { .id = i, .score = i * 0.25 };
+        snprintf(r.tag, sizeof(r.tag), "r%d", i % 100);
+        vector_add_back(v, &r);
+    }
+
+    TEST_ASSERT_TRUE(vector_save(v, VEC_PATH) == E_SUCCESS);
+    Vector *l = vector_load(VEC_PATH, &e);
+    TEST_ASSERT_NOT_NULL(l);
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(v->size, l->size);
+    TEST_ASSERT_EQUAL_INT32(v->elem_size, l->elem_size);
+    TEST_ASSERT_EQUAL_MEMORY(v->data, l->data, v->size * v->elem_size);
+
+    // the loaded vector is a normal vector
+    rec extra = { .id = -1 };
+    TEST_ASSERT_TRUE(vector_add_back(l, &extra) == E_SUCCESS);
+    vector_free(l);
+
+    // wrong container type
+    TEST_ASSERT_NULL(vec_i32_load(VEC_PATH, &e));
+    TEST_ASSERT_TRUE(e == E_BAD_TYPE);
+
+    // flipped payload byte
+    corrupt_file(VEC_PATH, sizeof(Serial_header) + 100);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(vector_load(VEC_PATH, &e));
+    TEST_ASSERT_TRUE(e == E_CORRUPT);
+
+    // truncated file
+    vector_save(v, VEC_PATH);
+    TEST_ASSERT_EQUAL_INT32(0, truncate(VEC_PATH, sizeof(Serial_header) + 10));
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(vector_load(VEC_PATH, &e));
+    TEST_ASSERT_TRUE(e == E_CORRUPT);
+
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(vector_load("/tmp/aputil_test_serial_missing.bin", &e));
+    TEST_ASSERT_TRUE(e == E_IO);
+    TEST_ASSERT_TRUE(vector_save(NULL, VEC_PATH) == E_EMPTY_OBJ);
+
+    // a failed save leaves the target as it was
+    TEST_ASSERT_TRUE(vector_save(v, VEC_PATH) == E_SUCCESS);
+    TEST_ASSERT_TRUE(vector_save(v, "/tmp/aputil_test_serial_missing/vec.bin") == E_IO);
+    TEST_ASSERT_EQUAL_INT32(0, mkdir(DIR_PATH, 0755));
+    TEST_ASSERT_TRUE(vector_save(v, DIR_PATH) == E_IO);
+    TEST_ASSERT_EQUAL_INT32(0, rmdir(DIR_PATH));
+    l = vector_load(VEC_PATH, &e);
+    TEST_ASSERT_NOT_NULL(l);
+    TEST_ASSERT_EQUAL_MEMORY(v->data, l->data, v->size * v->elem_size);
+    vector_free(l);
+
+    // a replaced file keeps its mode, a new one gets 0666 through the umask
+    struct stat st;
+    TEST_ASSERT_EQUAL_INT32(0, chmod(VEC_PATH, 0600));
+    TEST_ASSERT_TRUE(vector_save(v, VEC_PATH) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(0, stat(VEC_PATH, &st));
+    TEST_ASSERT_EQUAL_INT32(0600, st.st_mode & 0777);
+    remove(VEC_PATH);
+    mode_t mask = umask(027);
+    TEST_ASSERT_TRUE(vector_save(v, VEC_PATH) == E_SUCCESS);
+    umask(mask);
+    TEST_ASSERT_EQUAL_INT32(0, stat(VEC_PATH, &st));
+    TEST_ASSERT_EQUAL_INT32(0640, st.st_mode & 0777);
+
+    vector_free(v);
+
+}
+
+
+void test_function_serial_vec_i32(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    Vec_i32 *v = vec_i32_new(1);
+    for (int i = 0; i<100000; i++) vec_i32_add_back(v, rand());
+
+    TEST_ASSERT_TRUE(vec_i32_save(v, VEC_PATH) == E_SUCCESS);
+    Vec_i32 *l = vec_i32_load(VEC_PATH, &e);
+    TEST_ASSERT_NOT_NULL(l);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(v->data, l->data, v->size);
+    vec_i32_free(l);
+
+    // zero-copy view, sortable in place without touching the file
+    Vec_i32_mapped *m = vec_i32_mmap(VEC_PATH, true, &e);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL_INT32(v->size, m->vec.size);
+    TEST_ASSERT_TRUE((uintptr_t)m->vec.data % APUTIL_CACHE_LINE == 0);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(v->data, m->vec.data, v->size);
+    TEST_ASSERT_TRUE(vec_i32_sort_net(&m->vec) == E_SUCCESS);
+    for (size_t i = 1; i<m->vec.size; i++) TEST_ASSERT_TRUE(m->vec.data[i-1] <= m->vec.data[i]);
+    vec_i32_munmap(m);
+
+    l = vec_i32_load(VEC_PATH, &e);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(v->data, l->data, v->size);
+    vec_i32_free(l);
+
+    // empty vector
+    vec_i32_clear(v);
+    TEST_ASSERT_TRUE(vec_i32_save(v, VEC_PATH) == E_SUCCESS);
+    l = vec_i32_load(VEC_PATH, &e);
+    TEST_ASSERT_NOT_NULL(l);
+    TEST_ASSERT_EQUAL_INT32(0, l->size);
+    vec_i32_free(l);
+
+    // generic view, checksum only checked when asked
+    Vector *g = vector_new(sizeof(int64_t), 1);
+    for (int64_t i = 0; i<500; i++) vector_add_back(g, &i);
+    vector_save(g, VEC_PATH);
+    corrupt_file(VEC_PATH, sizeof(Serial_header) + 8);
+    e = E_SUCCESS;
+    TEST_ASSERT_NULL(vector_mmap(VEC_PATH, true, &e));
+    TEST_ASSERT_TRUE(e == E_CORRUPT);
+    Vector_mapped *gm = vector_mmap(VEC_PATH, false, &e);
+    TEST_ASSERT_NOT_NULL(gm);
+    TEST_ASSERT_EQUAL_INT32(499, *(int64_t*)vector_at(&gm->vec, 499));
+    vector_munmap(gm);
+    vector_free(g);
+
+    vec_i32_free(v);
+
+}
+
+
+//################ Lists ################
+static UTIL_ERR str_serialize(const void *data, Vec_char *out) {
+    return vec_char_append_n(out, data, strlen(data));
+}
+
+static void *str_deserialize(const void *bytes, size_t len) {
+    char *s = malloc(len + 1);
+    if (!s) return NULL;
+    memcpy(s, bytes, len);
+    s[len] = 0;
+    return s;
+}
+
+static int fail_after;
+static void *failing_deserialize(const void *bytes, size_t len) {
+    if (fail_after-- == 0) return NULL;
+    return str_deserialize(bytes, len);
+}
+
+void test_function_serial_llist(void) {
+
+    UTIL_ERR e = E_SUCCESS;
+    APUTIL_LList *lst = aputil_llist_new(free, NULL, NULL, "strings", &e);
+    for (int i = 0; i<500; i++) {
+        char tmp[64];
+        snprintf(tmp, sizeof(tmp), "string number %d%s", i, i % 3 ? "" : " with a tail");
+        aputil_llist_push_back(lst, str_deserialize(tmp, strlen(tmp)));
+    }
+    aputil_llist_push_back(lst, str_deserialize("", 0));
+
+    TEST_ASSERT_TRUE(aputil_llist_save(lst, LIST_PATH, str_serialize) == E_SUCCESS);
+
+    APUTIL_LList *l = aputil_llist_new(free, NULL, NULL, "loaded", &e);
+    TEST_ASSERT_TRUE(aputil_llist_load(l, LIST_PATH, str_deserialize) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(lst->cnt, l->cnt);
+    APUTIL_Node *x = lst->head, *y = l->head;
+    while (x && y) {
+        TEST_ASSERT_EQUAL_STRING(x->data, y->data);
+        x = x->next;
+        y = y->next;
+    }
+    TEST_ASSERT_TRUE(!x && !y);
+
+    // loaded nodes behave like any others
+    free(aputil_llist_pop(l, &e));
+    TEST_ASSERT_TRUE(aputil_llist_delete(l, l->head->next, false) == E_SUCCESS);
+    aputil_llist_free(l, false);
+
+    // a failing hook leaves the list as it was
+    l = aputil_llist_new(free, NULL, NULL, "failing", &e);
+    fail_after = 100;
+    TEST_ASSERT_TRUE(aputil_llist_load(l, LIST_PATH, failing_deserialize) == E_BAD_ALLOC);
+    TEST_ASSERT_EQUAL_INT32(0, l->cnt);
+    TEST_ASSERT_TRUE(aputil_llist_load(l, VEC_PATH, str_deserialize) == E_IO);
+    aputil_llist_free(l, false);
+
+    TEST_ASSERT_TRUE(aputil_llist_save(lst, LIST_PATH, NULL) == E_EMPTY_FUNC);
+    aputil_llist_free(lst, false);
+
+}
+
+
+//################ benchmarks ################
+static void print_i32(int32_t i, FILE *f) {
+    fprintf(f, "%d\n", i);
+}
+
+void test_function_serial_vs_text(void) {
+
+    size_t cnt = 5000000;
+    UTIL_ERR e = E_SUCCESS;
+    Vec_i32 *v = vec_i32_new(cnt);
+    for (size_t i = 0; i<cnt; i++) vec_i32_add_back(v, rand());
+
+    double start = wall();
+    FILE *f = fopen(VEC_PATH, "w");
+    vec_i32_print(v, f, print_i32);
+    fclose(f);
+    Vec_i32 *t = vec_i32_new(cnt);
+    f = fopen(VEC_PATH, "r");
+    int32_t x;
+    while (fscanf(f, "%d", &x) == 1) vec_i32_add_back(t, x);
+    fclose(f);
+    fprintf(stdout, "text print + scan %zu: %f s\n", cnt, wall() - start);
+    TEST_ASSERT_EQUAL_INT32(cnt, t->size);
+    vec_i32_free(t);
+
+    start = wall();
+    vec_i32_save(v, VEC_PATH);
+    double saved = wall();
+    Vec_i32 *l = vec_i32_load(VEC_PATH, &e);
+    double loaded = wall();
+    fprintf(stdout, "binary save: %f s, load: %f s\n", saved - start, loaded - saved);
+    TEST_ASSERT_EQUAL_INT32(cnt, l->size);
+
+    start = wall();
+    Vec_i32_mapped *m = vec_i32_mmap(VEC_PATH, false, &e);
+    fprintf(stdout, "mmap (no verify): %f s\n", wall() - start);
+    TEST_ASSERT_EQUAL_MEMORY(v->data, m->vec.data, cnt * sizeof(int32_t));
+    vec_i32_munmap(m);
+
+    start = wall();
+    uint64_t ck = serial_checksum(v->data, cnt * sizeof(int32_t));
+    fprintf(stdout, "checksum %zu MiB: %f s (%016llx)\n", cnt * sizeof(int32_t) >> 20, wall() - start, (unsigned long long)ck);
+
+    vec_i32_free(l);
+    vec_i32_free(v);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // vectors
+    RUN_TEST(test_function_serial_vector);
+    RUN_TEST(test_function_serial_vec_i32);
+
+    // lists
+    RUN_TEST(test_function_serial_llist);
+
+    // benchmarks
+    RUN_BENCH(test_function_serial_vs_text);
+
+    return UNITY_END();
+}
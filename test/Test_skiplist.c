@@ -0,0 +1,489 @@
+/*
+ *    test src/skiplist.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+#define KEYS 20000
+static int64_t vals[KEYS];
+
+static uint64_t xorshift(uint64_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+static size_t freed;
+static void count_free(void *d) {
+    freed++;
+    free(d);
+}
+
+static int64_t *boxed(int64_t x) {
+    int64_t *p = malloc(sizeof(*p));
+    *p = x;
+    return p;
+}
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static bool eq_i64(const void *a, const void *b) {
+    return *(const int64_t*)a == *(const int64_t*)b;
+}
+
+
+//################ Skip list ################
+void test_function_skip_basic(void) {
+
+    freed = 0;
+    SkipList *s = skip_new(count_free, cmp_i64);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_NULL(skip_lower_bound(s, NULL));
+    TEST_ASSERT_NULL(skip_last(s));
+    int64_t probe = 3;
+    TEST_ASSERT_TRUE(skip_remove(s, &probe, false) == E_DOESNT_EXIST);
+
+    // random inserts and removes against a presence table
+    static bool in[KEYS];
+    memset(in, 0, sizeof(in));
+    size_t n = 0, made = 0;
+    for (size_t step = 0; step<200000; step++) {
+        int64_t k = rand() % KEYS;
+        if (step < 100000 ? rand() % 4 != 0 : rand() % 4 == 0) {
+            int64_t *d = boxed(k);
+            UTIL_ERR e = skip_insert(s, d);
+            TEST_ASSERT_TRUE(e == (in[k] ? E_NOOP : E_SUCCESS));
+            if (e == E_NOOP) free(d);
+            else made++;
+            n += !in[k];
+            in[k] = true;
+        } else {
+            TEST_ASSERT_TRUE(skip_remove(s, &k, false) == (in[k] ? E_SUCCESS : E_DOESNT_EXIST));
+            n -= in[k];
+            in[k] = false;
+        }
+    }
+    TEST_ASSERT_TRUE(s->cnt == n);
+    TEST_ASSERT_TRUE(freed == made - n);
+
+    for (int64_t k = 0; k<KEYS; k++) {
+        int64_t *p = skip_find(s, &k);
+        TEST_ASSERT_TRUE(in[k] ? p && *p == k : !p);
+
+        Skip_node *x = skip_lower_bound(s, &k);
+        int64_t next = k;
+        while (next < KEYS && !in[next]) next++;
+        if (next == KEYS) TEST_ASSERT_NULL(x);
+        else TEST_ASSERT_TRUE(*(int64_t*)x->data == next);
+    }
+
+    // forward and back along level 0
+    size_t cnt = 0;
+    int64_t last = -1;
+    for (Skip_node *x = skip_lower_bound(s, NULL); x; x = x->next[0]) {
+        TEST_ASSERT_TRUE(*(int64_t*)x->data > last);
+        last = *(int64_t*)x->data;
+        cnt++;
+    }
+    TEST_ASSERT_TRUE(cnt == n);
+    for (Skip_node *x = skip_last(s); x; x = x->prev) {
+        TEST_ASSERT_TRUE(*(int64_t*)x->data == last);
+        last = x->prev ? *(int64_t*)x->prev->data : -1;
+        cnt--;
+    }
+    TEST_ASSERT_TRUE(cnt == 0);
+
+    // preserve hands the data back
+    int64_t *keep = boxed(KEYS + 5);
+    TEST_ASSERT_TRUE(skip_insert(s, keep) == E_SUCCESS);
+    TEST_ASSERT_TRUE(skip_last(s)->data == keep);
+    TEST_ASSERT_TRUE(skip_remove(s, keep, true) == E_SUCCESS);
+    free(keep);
+
+    skip_free(s, false);
+    TEST_ASSERT_TRUE(freed == made);
+
+    TEST_ASSERT_NULL(skip_new(NULL, NULL));
+    TEST_ASSERT_TRUE(skip_insert(NULL, &probe) == E_EMPTY_OBJ);
+    TEST_ASSERT_NULL(skip_find(NULL, &probe));
+
+}
+
+
+// removed towers are reused, churn at a steady size needs no more arena
+void test_function_skip_reuse(void) {
+
+    SkipList *s = skip_new(NULL, cmp_i64);
+    for (int64_t k = 0; k<KEYS; k++) vals[k] = k;
+    for (int64_t k = 0; k<4000; k++) skip_insert(s, &vals[k]);
+
+    for (int round = 0; round<20; round++) {
+        for (int64_t k = 0; k<4000; k++) {
+            skip_remove(s, &vals[k], true);
+            skip_insert(s, &vals[k]);
+        }
+    }
+    TEST_ASSERT_TRUE(s->cnt == 4000);
+
+    // a new tower is only cut when its height's spares run out, far fewer than the churn
+    size_t spare = 0;
+    for (int l = 0; l<SKIP_MAX_LEVEL; l++) {
+        for (Skip_node *x = s->spare[l]; x; x = x->next[0]) spare++;
+    }
+    TEST_ASSERT_TRUE(spare < s->cnt);
+
+    for (int64_t k = 0; k<4000; k++) TEST_ASSERT_TRUE(skip_find(s, &vals[k]) == &vals[k]);
+    skip_free(s, true);
+
+}
+
+
+//################ Concurrent skip list ################
+void test_function_cskip_basic(void) {
+
+    freed = 0;
+    CSkipList *s = cskip_new(count_free, cmp_i64);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_NULL(cskip_lower_bound(s, NULL));
+
+    static bool in[KEYS];
+    memset(in, 0, sizeof(in));
+    size_t n = 0;
+    for (size_t step = 0; step<100000; step++) {
+        int64_t k = rand() % KEYS;
+        if (rand() % 3) {
+            int64_t *d = boxed(k);
+            UTIL_ERR e = cskip_insert(s, d);
+            TEST_ASSERT_TRUE(e == (in[k] ? E_NOOP : E_SUCCESS));
+            if (e == E_NOOP) free(d);
+            n += !in[k];
+            in[k] = true;
+        } else {
+            void *d = NULL;
+            UTIL_ERR e = cskip_remove(s, &k, &d);
+            TEST_ASSERT_TRUE(e == (in[k] ? E_SUCCESS : E_DOESNT_EXIST));
+            if (d) {
+                TEST_ASSERT_TRUE(*(int64_t*)d == k);
+                free(d);
+            }
+            n -= in[k];
+            in[k] = false;
+        }
+    }
+    TEST_ASSERT_TRUE(cskip_size(s) == n);
+
+    size_t cnt = 0;
+    int64_t last = -1;
+    for (CSkip_node *x = cskip_lower_bound(s, NULL); x; x = cskip_next(x)) {
+        TEST_ASSERT_TRUE(*(int64_t*)x->data > last && in[*(int64_t*)x->data]);
+        last = *(int64_t*)x->data;
+        cnt++;
+    }
+    TEST_ASSERT_TRUE(cnt == n);
+    for (int64_t k = 0; k<KEYS; k += 7) {
+        int64_t *p = cskip_find(s, &k);
+        TEST_ASSERT_TRUE(in[k] ? p && *p == k : !p);
+    }
+
+    cskip_free(s, false);
+    TEST_ASSERT_TRUE(freed == n);
+    TEST_ASSERT_NULL(cskip_new(NULL, NULL));
+    TEST_ASSERT_TRUE(cskip_remove(NULL, &last, NULL) == E_EMPTY_OBJ);
+
+}
+
+
+#define CSKIP_THREADS 4
+
+typedef struct {
+    CSkipList *s;
+    size_t id;
+    size_t ops;
+    int read_pct;
+    _Atomic bool *stop;
+    _Atomic size_t *won;
+    size_t bad;
+} cskip_worker;
+
+// everyone inserts every key, exactly one insert of each may succeed
+static void *cskip_racer_put(void *arg) {
+    cskip_worker *w = arg;
+    for (size_t i = 0; i<KEYS; i++) {
+        size_t k = (i * 7919 + w->id * 13) % KEYS;
+        if (cskip_insert(w->s, &vals[k]) == E_SUCCESS) atomic_fetch_add(&w->won[k], 1);
+    }
+    return NULL;
+}
+
+static void *cskip_racer_remove(void *arg) {
+    cskip_worker *w = arg;
+    for (size_t i = 0; i<KEYS; i++) {
+        size_t k = (i * 104729 + w->id * 31) % KEYS;
+        void *d = NULL;
+        if (cskip_remove(w->s, &vals[k], &d) == E_SUCCESS) {
+            atomic_fetch_add(&w->won[k], 1);
+            if (d != &vals[k]) w->bad++;
+        }
+    }
+    return NULL;
+}
+
+// writers own the keys k % 2 == id, fives come back out
+static void *cskip_writer(void *arg) {
+    cskip_worker *w = arg;
+    for (size_t k = w->id; k < KEYS; k += 2) {
+        if (cskip_insert(w->s, &vals[k]) != E_SUCCESS) w->bad++;
+        if (k % 5 == 0 && cskip_remove(w->s, &vals[k], NULL) != E_SUCCESS) w->bad++;
+    }
+    return NULL;
+}
+
+// readers walk in order and look keys up while the writers work
+static void *cskip_reader(void *arg) {
+    cskip_worker *w = arg;
+    uint64_t x = 88172645463325252ull + w->id;
+    while (!atomic_load(w->stop)) {
+        int64_t last = -1;
+        for (CSkip_node *n = cskip_lower_bound(w->s, NULL); n; n = cskip_next(n)) {
+            if (*(int64_t*)n->data <= last) w->bad++;
+            last = *(int64_t*)n->data;
+        }
+        for (int i = 0; i<1000; i++) {
+            int64_t k = (int64_t)(xorshift(&x) % KEYS);
+            int64_t *p = cskip_find(w->s, &k);
+            if (p && p != &vals[k]) w->bad++;
+        }
+    }
+    return NULL;
+}
+
+void test_function_cskip_threads(void) {
+
+    for (int64_t k = 0; k<KEYS; k++) vals[k] = k;
+    static _Atomic size_t won[KEYS];
+    for (size_t k = 0; k<KEYS; k++) atomic_init(&won[k], 0);
+
+    CSkipList *s = cskip_new(NULL, cmp_i64);
+    pthread_t tid[CSKIP_THREADS];
+    cskip_worker w[CSKIP_THREADS];
+    for (size_t i = 0; i<CSKIP_THREADS; i++) {
+        w[i] = (cskip_worker){ .s = s, .id = i, .won = won };
+        pthread_create(&tid[i], NULL, cskip_racer_put, &w[i]);
+    }
+    for (size_t i = 0; i<CSKIP_THREADS; i++) pthread_join(tid[i], NULL);
+    TEST_ASSERT_TRUE(cskip_size(s) == KEYS);
+    for (size_t k = 0; k<KEYS; k++) {
+        TEST_ASSERT_TRUE(atomic_load(&won[k]) == 1);
+        atomic_store(&won[k], 0);
+    }
+
+    for (size_t i = 0; i<CSKIP_THREADS; i++) pthread_create(&tid[i], NULL, cskip_racer_remove, &w[i]);
+    for (size_t i = 0; i<CSKIP_THREADS; i++) {
+        pthread_join(tid[i], NULL);
+        TEST_ASSERT_EQUAL_INT32(0, w[i].bad);
+    }
+    TEST_ASSERT_TRUE(cskip_size(s) == 0);
+    TEST_ASSERT_NULL(cskip_lower_bound(s, NULL));
+    for (size_t k = 0; k<KEYS; k++) TEST_ASSERT_TRUE(atomic_load(&won[k]) == 1);
+    cskip_free(s, true);
+
+    // readers next to writers
+    s = cskip_new(NULL, cmp_i64);
+    _Atomic bool stop = false;
+    for (size_t i = 0; i<CSKIP_THREADS; i++) {
+        w[i] = (cskip_worker){ .s = s, .id = i, .stop = &stop };
+        pthread_create(&tid[i], NULL, i < 2 ? cskip_writer : cskip_reader, &w[i]);
+    }
+    pthread_join(tid[0], NULL);
+    pthread_join(tid[1], NULL);
+    atomic_store(&stop, true);
+    for (size_t i = 0; i<CSKIP_THREADS; i++) {
+        if (i >= 2) pthread_join(tid[i], NULL);
+        TEST_ASSERT_EQUAL_INT32(0, w[i].bad);
+    }
+    TEST_ASSERT_TRUE(cskip_size(s) == KEYS - KEYS / 5);
+    for (int64_t k = 0; k<KEYS; k++) TEST_ASSERT_TRUE((cskip_find(s, &k) != NULL) == (k % 5 != 0));
+    cskip_free(s, true);
+
+}
+
+
+//################ benchmarks ################
+/*
+    a sorted APUTIL_LList behind a mutex against the lock free list, keys
+    looked up, inserted and removed at random by 1 to 4 threads
+*/
+typedef struct {
+    APUTIL_LList *lst;
+    pthread_mutex_t *lock;
+    CSkipList *s;
+    size_t id;
+    size_t ops;
+    size_t n_keys;
+    int read_pct;
+} bench_worker;
+
+// splice into place, the list has no sorted insert of its own
+static void sorted_put(APUTIL_LList *lst, void *data) {
+    APUTIL_Node *at = lst->head;
+    while (at && cmp_i64(at->data, data) < 0) at = at->next;
+    if (at && cmp_i64(at->data, data) == 0) return;
+    if (!at) {
+        aputil_llist_push_back(lst, data);
+        return;
+    }
+    if (at == lst->head) {
+        aputil_llist_push(lst, data);
+        return;
+    }
+    APUTIL_Node *n = malloc(sizeof(*n));
+    *n = (APUTIL_Node){ .data = data, .next = at, .prev = at->prev, .slab = NULL };
+    at->prev->next = n;
+    at->prev = n;
+    lst->cnt++;
+}
+
+static void *bench_locked(void *arg) {
+    bench_worker *w = arg;
+    uint64_t x = 88172645463325252ull + w->id;
+    UTIL_ERR e = E_SUCCESS;
+    for (size_t i = 0; i<w->ops; i++) {
+        uint64_t r = xorshift(&x);
+        int64_t *k = &vals[r % w->n_keys];
+        pthread_mutex_lock(w->lock);
+        APUTIL_Node *at = aputil_llist_in(w->lst, k, eq_i64, &e);
+        if ((int)(r >> 40) % 100 >= w->read_pct) {
+            if (at) aputil_llist_delete(w->lst, at, true);
+            else sorted_put(w->lst, k);
+        }
+        pthread_mutex_unlock(w->lock);
+    }
+    return NULL;
+}
+
+static void *bench_lock_free(void *arg) {
+    bench_worker *w = arg;
+    uint64_t x = 88172645463325252ull + w->id;
+    for (size_t i = 0; i<w->ops; i++) {
+        uint64_t r = xorshift(&x);
+        int64_t *k = &vals[r % w->n_keys];
+        bool found = cskip_find(w->s, k) != NULL;
+        if ((int)(r >> 40) % 100 >= w->read_pct) {
+            if (found) cskip_remove(w->s, k, NULL);
+            else cskip_insert(w->s, k);
+        }
+    }
+    return NULL;
+}
+
+void test_function_skip_bench(void) {
+
+    for (int64_t k = 0; k<KEYS; k++) vals[k] = k;
+    size_t threads[] = { 1, 2, 4 }, n_keys = 2000, ops = 200000;
+    int mixes[] = { 90, 50 };
+
+    for (size_t m = 0; m<2; m++) {
+        for (size_t t = 0; t<3; t++) {
+            UTIL_ERR e = E_SUCCESS;
+            APUTIL_LList *lst = aputil_llist_new(NULL, NULL, cmp_i64, "sorted", &e);
+            pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+            CSkipList *s = cskip_new(NULL, cmp_i64);
+            for (size_t k = 0; k<n_keys; k += 2) {
+                aputil_llist_push_back(lst, &vals[k]);
+                cskip_insert(s, &vals[k]);
+            }
+
+            pthread_t tid[CSKIP_THREADS];
+            bench_worker w[CSKIP_THREADS];
+            double start = wall();
+            for (size_t i = 0; i<threads[t]; i++) {
+                w[i] = (bench_worker){ .lst = lst, .lock = &lock, .id = i, .ops = ops / 10 / threads[t], .n_keys = n_keys, .read_pct = mixes[m] };
+                pthread_create(&tid[i], NULL, bench_locked, &w[i]);
+            }
+            for (size_t i = 0; i<threads[t]; i++) pthread_join(tid[i], NULL);
+            double secs = wall() - start;
+            fprintf(stdout, "mutex sorted llist, %d%% reads, %zu threads: %f Mops/s\n", mixes[m], threads[t], ops / 10 / secs / 1e6);
+
+            start = wall();
+            for (size_t i = 0; i<threads[t]; i++) {
+                w[i] = (bench_worker){ .s = s, .id = i, .ops = ops / threads[t], .n_keys = n_keys, .read_pct = mixes[m] };
+                pthread_create(&tid[i], NULL, bench_lock_free, &w[i]);
+            }
+            for (size_t i = 0; i<threads[t]; i++) pthread_join(tid[i], NULL);
+            secs = wall() - start;
+            fprintf(stdout, "cskip, %d%% reads, %zu threads: %f Mops/s\n", mixes[m], threads[t], ops / secs / 1e6);
+
+            size_t cnt = 0;
+            for (CSkip_node *x = cskip_lower_bound(s, NULL); x; x = cskip_next(x)) cnt++;
+            TEST_ASSERT_TRUE(cnt == cskip_size(s));
+
+            cskip_free(s, true);
+            aputil_llist_free(lst, true);
+        }
+    }
+
+    // one thread, no lock: sequential list against the concurrent one
+    SkipList *s = skip_new(NULL, cmp_i64);
+    CSkipList *c = cskip_new(NULL, cmp_i64);
+    double start = wall();
+    for (size_t k = 0; k<KEYS; k++) skip_insert(s, &vals[(k * 7919) % KEYS]);
+    fprintf(stdout, "skip_insert x %d: %f s\n", KEYS, wall() - start);
+    start = wall();
+    for (size_t k = 0; k<KEYS; k++) cskip_insert(c, &vals[(k * 7919) % KEYS]);
+    fprintf(stdout, "cskip_insert x %d: %f s\n", KEYS, wall() - start);
+
+    size_t hits = 0;
+    start = wall();
+    for (size_t i = 0; i<1000000; i++) hits += skip_find(s, &vals[(i * 7919) % KEYS]) != NULL;
+    fprintf(stdout, "skip_find: %f ns/lookup\n", (wall() - start) / 1e6 * 1e9);
+    start = wall();
+    for (size_t i = 0; i<1000000; i++) hits += cskip_find(c, &vals[(i * 7919) % KEYS]) != NULL;
+    fprintf(stdout, "cskip_find: %f ns/lookup\n", (wall() - start) / 1e6 * 1e9);
+    TEST_ASSERT_TRUE(hits == 2000000);
+
+    cskip_free(c, true);
+    skip_free(s, true);
+
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // skip list
+    RUN_TEST(test_function_skip_basic);
+    RUN_TEST(test_function_skip_reuse);
+
+    // concurrent skip list
+    RUN_TEST(test_function_cskip_basic);
+    RUN_TEST(test_function_cskip_threads);
+
+    // benchmarks
+    RUN_BENCH(test_function_skip_bench);
+
+    return UNITY_END();
+}
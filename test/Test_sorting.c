@@ -265,6 +265,442 @@ void test_function_sort_merge_sort(void) {
 }
 
 
+//################ vector selection ################
+static int int_comp(const void *d1, const void *d2) {
+    int a = *(const int*)d1, b = *(const int*)d2;
+    return (a > b) - (a < b);
+}
+
+static Vector *make_rnd_vector(size_t cnt, int mod) {
+    Vector *v = vector_new(sizeof(int), cnt);
+    for (size_t i = 0; i<cnt; i++) {
+        int val = rand() % mod;
+        vector_add_back(v, &val);
+    }
+    return v;
+}
+
+void test_function_vector_nth_element(void) {
+    size_t sizes[] = {1, 2, 15, 17, 100, 5001};
+    int mods[] = {3, 1000000};
+    for (int s = 0; s<6; s++) {
+        for (int m = 0; m<2; m++) {
+            Vector *v = make_rnd_vector(sizes[s], mods[m]);
+            Vector *sorted = vector_copy(v);
+            vector_sort(sorted, vector, int_comp);
+
+            size_t picks[] = {0, sizes[s] / 2, sizes[s] - 1};
+            for (int p = 0; p<3; p++) {
+                size_t n = picks[p];
+                TEST_ASSERT_TRUE(vector_nth_element(v, n, int_comp) == E_SUCCESS);
+                int nth = ((int*)v->data)[n];
+                TEST_ASSERT_EQUAL_INT32(((int*)sorted->data)[n], nth);
+                for (size_t i = 0; i<v->size; i++) {
+                    if (i < n) TEST_ASSERT_TRUE(((int*)v->data)[i] <= nth);
+                    if (i > n) TEST_ASSERT_TRUE(((int*)v->data)[i] >= nth);
+                }
+            }
+            TEST_ASSERT_TRUE(vector_nth_element(v, sizes[s], int_comp) == E_OUTOFBOUNDS);
+
+            vector_free(v);
+            vector_free(sorted);
+        }
+    }
+}
+
+
+void test_function_vector_partial_sort_top_k(void) {
+    Vector *v = make_rnd_vector(10000, 50000);
+    Vector *sorted = vector_copy(v);
+    vector_sort(sorted, vector, int_comp);
+
+    UTIL_ERR e = E_SUCCESS;
+    Vector *top = vector_top_k(v, 25, int_comp, &e);
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(25, top->size);
+    TEST_ASSERT_EQUAL_CHAR_ARRAY(sorted->data, top->data, 25 * sizeof(int));
+
+    TEST_ASSERT_TRUE(vector_partial_sort(v, 25, int_comp) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_CHAR_ARRAY(sorted->data, v->data, 25 * sizeof(int));
+
+    // k larger than the vector sorts everything
+    vector_free(top);
+    top = vector_top_k(sorted, 20000, int_comp, &e);
+    TEST_ASSERT_EQUAL_INT32(10000, top->size);
+    TEST_ASSERT_EQUAL_CHAR_ARRAY(sorted->data, top->data, 10000 * sizeof(int));
+
+    vector_free(v);
+    vector_free(sorted);
+    vector_free(top);
+}
+
+
+void test_function_vec_i32_selection(void) {
+    int cnt = 200000, k = 100;
+    Vec_i32 *v = vec_i32_new(cnt);
+    for (int i = 0; i<cnt; i++) vec_i32_add_back(v, rand() - RAND_MAX / 2);
+    Vec_i32 *sorted = vec_i32_copy(v);
+    Vec_i32 *work = vec_i32_copy(v);
+
+    clock_t start, stop;
+    start = clock();
+    vector_sort(sorted, vec_i32, int_comp);
+    stop = clock();
+    fprintf(stdout, "full sort for median/top-%d: %f s\n", k, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    start = clock();
+    vec_i32_nth_element(work, cnt / 2, NULL);
+    stop = clock();
+    fprintf(stdout, "vec_i32_nth_element median: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+    TEST_ASSERT_EQUAL_INT32(sorted->data[cnt / 2], work->data[cnt / 2]);
+
+    UTIL_ERR e = E_SUCCESS;
+    start = clock();
+    Vec_i32 *top = vec_i32_top_k(v, k, NULL, &e);
+    stop = clock();
+    fprintf(stdout, "vec_i32_top_k: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+    TEST_ASSERT_EQUAL_INT32(k, top->size);
+    for (int i = 0; i<k; i++) TEST_ASSERT_EQUAL_INT32(sorted->data[i], top->data[i]);
+
+    start = clock();
+    vec_i32_partial_sort(work, k, int_comp);
+    stop = clock();
+    fprintf(stdout, "vec_i32_partial_sort: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+    for (int i = 0; i<k; i++) TEST_ASSERT_EQUAL_INT32(sorted->data[i], work->data[i]);
+
+    // already sorted and all-equal inputs
+    vec_i32_nth_element(sorted, 7, NULL);
+    TEST_ASSERT_EQUAL_INT32(top->data[7], sorted->data[7]);
+    for (int i = 0; i<cnt; i++) work->data[i] = 5;
+    vec_i32_nth_element(work, cnt - 3, NULL);
+    TEST_ASSERT_EQUAL_INT32(5, work->data[cnt - 3]);
+
+    vec_i32_free(v);
+    vec_i32_free(sorted);
+    vec_i32_free(work);
+    vec_i32_free(top);
+}
+
+
+//################ stable sort ################
+typedef struct {
+    int key;
+    int seq;
+    char payload[24];
+} rec;
+
+static int rec_comp(const void *d1, const void *d2) {
+    int a = ((const rec*)d1)->key, b = ((const rec*)d2)->key;
+    return (a > b) - (a < b);
+}
+
+static bool rec_stable_sorted(const Vector *v) {
+    for (size_t i = 1; i<v->size; i++) {
+        const rec *prev = (rec*)v->data + (i-1), *cur = (rec*)v->data + i;
+        if (prev->key > cur->key) return false;
+        if (prev->key == cur->key && prev->seq > cur->seq) return false;
+    }
+    return true;
+}
+
+void test_function_vector_stable_sort(void) {
+    size_t sizes[] = {0, 1, 2, 31, 64, 65, 1000, 20000};
+    int mods[] = {2, 50, 1000000};
+    Vec_char *scratch = vec_char_new(1);
+
+    for (int s = 0; s<8; s++) {
+        for (int m = 0; m<3; m++) {
+            Vector *v = vector_new(sizeof(rec), sizes[s] ? sizes[s] : 1);
+            rec r = {0};
+            for (size_t i = 0; i<sizes[s]; i++) {
+                r.key = rand() % mods[m];
+                r.seq = (int)i;
+                vector_add_back(v, &r);
+            }
+            TEST_ASSERT_TRUE(vector_stable_sort_buf(v, vector, rec_comp, scratch) == E_SUCCESS);
+            TEST_ASSERT_EQUAL_INT32(sizes[s], v->size);
+            TEST_ASSERT_TRUE(rec_stable_sorted(v));
+            vector_free(v);
+        }
+    }
+
+    // descending input with duplicates must keep equal keys in input order
+    Vector *v = vector_new(sizeof(rec), 1000);
+    rec r = {0};
+    for (int i = 0; i<1000; i++) {
+        r.key = (1000 - i) / 3;
+        r.seq = i;
+        vector_add_back(v, &r);
+    }
+    TEST_ASSERT_TRUE(vector_stable_sort(v, vector, rec_comp) == E_SUCCESS);
+    TEST_ASSERT_TRUE(rec_stable_sorted(v));
+
+    TEST_ASSERT_TRUE(vector_stable_sort(v, vector, NULL) == E_EMPTY_FUNC);
+    TEST_ASSERT_TRUE(vector_stable_sort(v, 7, rec_comp) == E_BAD_TYPE);
+
+    vector_free(v);
+    vec_char_free(scratch);
+}
+
+
+void test_function_vector_stable_sort_timing(void) {
+    int cnt = 200000;
+    clock_t start, stop;
+    Vec_i32 *rnd = vec_i32_new(cnt), *mostly = vec_i32_new(cnt);
+    for (int i = 0; i<cnt; i++) {
+        vec_i32_add_back(rnd, rand());
+        vec_i32_add_back(mostly, i);
+    }
+    // a sorted vector with 1% of the elements overwritten and a tail appended
+    for (int i = 0; i<cnt / 100; i++) mostly->data[rand() % cnt] = rand() % cnt;
+    for (int i = cnt - 1000; i<cnt; i++) mostly->data[i] = rand() % cnt;
+
+    Vec_i32 *vs[] = {rnd, mostly};
+    const char *names[] = {"random", "mostly sorted"};
+    for (int t = 0; t<2; t++) {
+        Vec_i32 *a = vec_i32_copy(vs[t]), *b = vec_i32_copy(vs[t]);
+
+        start = clock();
+        vector_sort(a, vec_i32, int_comp);
+        stop = clock();
+        fprintf(stdout, "%s qsort: %f s\n", names[t], ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+        start = clock();
+        vector_stable_sort(b, vec_i32, int_comp);
+        stop = clock();
+        fprintf(stdout, "%s stable sort: %f s\n", names[t], ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+        TEST_ASSERT_EQUAL_CHAR_ARRAY(a->data, b->data, cnt * sizeof(int32_t));
+        vec_i32_free(a);
+        vec_i32_free(b);
+    }
+
+    vec_i32_free(rnd);
+    vec_i32_free(mostly);
+}
+
+
+//################ argsort / key sort ################
+typedef struct {
+    int32_t key;
+    int32_t seq;
+    char payload[248];
+} big_rec;
+
+static int big_rec_comp(const void *d1, const void *d2) {
+    int32_t a = ((const big_rec*)d1)->key, b = ((const big_rec*)d2)->key;
+    return (a > b) - (a < b);
+}
+
+static uint32_t big_rec_key32(const void *d) {
+    return (uint32_t)((const big_rec*)d)->key ^ 0x80000000u;
+}
+
+static uint64_t big_rec_key64(const void *d) {
+    return (uint64_t)((const big_rec*)d)->key ^ 0x8000000000000000ull;
+}
+
+static Vector *make_big_rec_vector(size_t cnt, int mod) {
+    Vector *v = vector_new(sizeof(big_rec), cnt ? cnt : 1);
+    big_rec r;
+    memset(&r, 0, sizeof(r));
+    for (size_t i = 0; i<cnt; i++) {
+        r.key = rand() % mod - mod / 2;
+        r.seq = (int32_t)i;
+        r.payload[0] = (char)i;
+        vector_add_back(v, &r);
+    }
+    return v;
+}
+
+static bool big_rec_stable_sorted(const Vector *v) {
+    for (size_t i = 1; i<v->size; i++) {
+        const big_rec *prev = (big_rec*)v->data + (i-1), *cur = (big_rec*)v->data + i;
+        if (prev->key > cur->key) return false;
+        if (prev->key == cur->key && prev->seq > cur->seq) return false;
+        if (cur->payload[0] != (char)cur->seq) return false;
+    }
+    return true;
+}
+
+void test_function_vector_argsort(void) {
+    UTIL_ERR e = E_SUCCESS;
+    Vector *v = make_big_rec_vector(1000, 100);
+
+    Vec_i32 *perm = vector_argsort(v, big_rec_comp, &e);
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(1000, perm->size);
+    for (size_t i = 0; i<v->size; i++) {
+        TEST_ASSERT_EQUAL_INT32(i, ((big_rec*)v->data)[i].seq);   // untouched
+    }
+
+    Vec_i32 *perm_key = vector_argsort_key32(v, big_rec_key32, &e);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(perm->data, perm_key->data, perm->size);
+
+    TEST_ASSERT_TRUE(vector_apply_perm(v, perm) == E_SUCCESS);
+    TEST_ASSERT_TRUE(big_rec_stable_sorted(v));
+
+    perm->size--;
+    TEST_ASSERT_TRUE(vector_apply_perm(v, perm) == E_OUTOFBOUNDS);
+
+    vec_i32_free(perm);
+    vec_i32_free(perm_key);
+    vector_free(v);
+}
+
+
+void test_function_vector_sort_key(void) {
+    size_t sizes[] = {0, 1, 2, 100, 5000};
+    for (int s = 0; s<5; s++) {
+        Vector *v32 = make_big_rec_vector(sizes[s], 2000000);
+        Vector *v64 = vector_copy(v32);
+        TEST_ASSERT_TRUE(vector_sort_key32(v32, big_rec_key32) == E_SUCCESS);
+        TEST_ASSERT_TRUE(vector_sort_key64(v64, big_rec_key64) == E_SUCCESS);
+        TEST_ASSERT_TRUE(big_rec_stable_sorted(v32));
+        TEST_ASSERT_TRUE(big_rec_stable_sorted(v64));
+        vector_free(v32);
+        vector_free(v64);
+    }
+
+    // large records: qsort moves whole records on every swap
+    int cnt = 100000;
+    clock_t start, stop;
+    Vector *a = make_big_rec_vector(cnt, 1 << 30);
+    Vector *b = vector_copy(a), *c = vector_copy(a);
+
+    start = clock();
+    vector_sort(a, vector, big_rec_comp);
+    stop = clock();
+    fprintf(stdout, "256B records qsort: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    start = clock();
+    vector_sort_key32(b, big_rec_key32);
+    stop = clock();
+    fprintf(stdout, "256B records key32 radix sort: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    UTIL_ERR e = E_SUCCESS;
+    start = clock();
+    Vec_i32 *perm = vector_argsort(c, big_rec_comp, &e);
+    vector_apply_perm(c, perm);
+    stop = clock();
+    fprintf(stdout, "256B records argsort + gather: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    for (int i = 0; i<cnt; i++) {
+        TEST_ASSERT_EQUAL_INT32(((big_rec*)a->data)[i].key, ((big_rec*)b->data)[i].key);
+    }
+    TEST_ASSERT_TRUE(big_rec_stable_sorted(b));
+    TEST_ASSERT_TRUE(big_rec_stable_sorted(c));
+
+    vector_free(a);
+    vector_free(b);
+    vector_free(c);
+    vec_i32_free(perm);
+}
+
+
+//################ k-way merge ################
+void test_function_vector_merge_k(void) {
+    size_t k = 300;
+    Vector **shards = malloc(sizeof(Vector*) * k);
+    size_t total = 0;
+    for (size_t i = 0; i<k; i++) {
+        // some empty shards, some large
+        shards[i] = make_big_rec_vector(i % 7 == 0 ? 0 : rand() % 200, 1000);
+        vector_stable_sort(shards[i], vector, big_rec_comp);
+        for (size_t j = 0; j<shards[i]->size; j++) {
+            ((big_rec*)shards[i]->data)[j].seq = (int32_t)(total + j);   // global input order
+            ((big_rec*)shards[i]->data)[j].payload[0] = (char)(total + j);
+        }
+        total += shards[i]->size;
+    }
+
+    UTIL_ERR e = E_SUCCESS;
+    Vector *merged = vector_merge_k(shards, k, big_rec_comp, &e);
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(total, merged->size);
+    TEST_ASSERT_TRUE(big_rec_stable_sorted(merged));
+    vector_free(merged);
+
+    merged = vector_merge_k(shards, 1, big_rec_comp, &e);
+    TEST_ASSERT_EQUAL_INT32(0, merged->size);
+    vector_free(merged);
+
+    for (size_t i = 0; i<k; i++) vector_free(shards[i]);
+    free(shards);
+}
+
+
+void test_function_vec_i32_merge_k(void) {
+    size_t k = 256, per = 1000;
+    Vec_i32 **shards = malloc(sizeof(Vec_i32*) * k);
+    Vec_i32 *all = vec_i32_new(k * per);
+    for (size_t i = 0; i<k; i++) {
+        shards[i] = vec_i32_new(per);
+        for (size_t j = 0; j<per; j++) {
+            int32_t val = rand();
+            vec_i32_add_back(shards[i], val);
+            vec_i32_add_back(all, val);
+        }
+        vector_sort(shards[i], vec_i32, int_comp);
+    }
+
+    clock_t start, stop;
+    UTIL_ERR e = E_SUCCESS;
+    start = clock();
+    Vec_i32 *merged = vec_i32_merge_k(shards, k, NULL, &e);
+    stop = clock();
+    fprintf(stdout, "vec_i32_merge_k %zu shards: %f s\n", k, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    start = clock();
+    vector_sort(all, vec_i32, int_comp);
+    stop = clock();
+    fprintf(stdout, "concat + sort %zu shards: %f s\n", k, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    TEST_ASSERT_EQUAL_INT32(all->size, merged->size);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(all->data, merged->data, all->size);
+
+    for (size_t i = 0; i<k; i++) vec_i32_free(shards[i]);
+    free(shards);
+    vec_i32_free(all);
+    vec_i32_free(merged);
+}
+
+
+void test_function_llist_merge_k(void) {
+    UTIL_ERR e = E_SUCCESS;
+    int vals[3][5] = {{1, 4, 7, 10, 13}, {2, 2, 8}, {0, 5, 6, 20}};
+    int lens[] = {5, 3, 4};
+    APUTIL_LList *lsts[4];
+    for (int i = 0; i<3; i++) {
+        lsts[i] = aputil_llist_new(NULL, NULL, list_comp, "shard", &e);
+        for (int j = 0; j<lens[i]; j++) aputil_llist_push_back(lsts[i], &vals[i][j]);
+    }
+    lsts[3] = aputil_llist_new(NULL, NULL, list_comp, "empty shard", &e);
+
+    APUTIL_Node *first = lsts[2]->head;
+    APUTIL_LList *merged = aputil_llist_merge_k(lsts, 4, &e);
+    TEST_ASSERT_TRUE(e == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(12, merged->cnt);
+    TEST_ASSERT_TRUE(merged->head == first);     // nodes are relinked, not copied
+    TEST_ASSERT_TRUE(is_sorted(merged));
+    TEST_ASSERT_EQUAL_INT32(20, *(int*)merged->tail->data);
+    TEST_ASSERT_NULL(merged->tail->next);
+    TEST_ASSERT_NULL(merged->head->prev);
+
+    // walk back from the tail to check prev links
+    int cnt = 0;
+    for (APUTIL_Node *n = merged->tail; n; n = n->prev) cnt++;
+    TEST_ASSERT_EQUAL_INT32(12, cnt);
+
+    for (int i = 0; i<4; i++) {
+        TEST_ASSERT_NULL(lsts[i]->head);
+        TEST_ASSERT_EQUAL_INT32(0, lsts[i]->cnt);
+        aputil_llist_free(lsts[i], true);
+    }
+    aputil_llist_free(merged, true);
+}
+
+
 
 int main(void) {
 
@@ -278,7 +714,24 @@ int main(void) {
     RUN_TEST(test_function_sort_partition);
     RUN_TEST(test_function_sort_merge);
     RUN_TEST(test_function_sort_merge_sort);
-    
+
+    // vector selection
+    RUN_TEST(test_function_vector_nth_element);
+    RUN_TEST(test_function_vector_partial_sort_top_k);
+    RUN_TEST(test_function_vec_i32_selection);
+
+    // stable sort
+    RUN_TEST(test_function_vector_stable_sort);
+    RUN_TEST(test_function_vector_stable_sort_timing);
+
+    // argsort / key sort
+    RUN_TEST(test_function_vector_argsort);
+    RUN_TEST(test_function_vector_sort_key);
+
+    // k-way merge
+    RUN_TEST(test_function_vector_merge_k);
+    RUN_TEST(test_function_vec_i32_merge_k);
+    RUN_TEST(test_function_llist_merge_k);
 
     return UNITY_END();
 }
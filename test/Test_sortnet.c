@@ -0,0 +1,188 @@
+/*
+ *    test src/sortnet.c
+ */
+
+#include <unity/unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/aputils.h"
+#include "test_util.h"
+
+
+void setUp(void) {
+    /* This is run before EACH TEST */
+}
+
+void tearDown(void) {}
+
+
+
+static int i32_comp(const void *d1, const void *d2) {
+    int32_t a = *(const int32_t*)d1, b = *(const int32_t*)d2;
+    return (a > b) - (a < b);
+}
+
+static int u32_comp(const void *d1, const void *d2) {
+    uint32_t a = *(const uint32_t*)d1, b = *(const uint32_t*)d2;
+    return (a > b) - (a < b);
+}
+
+static int i64_comp(const void *d1, const void *d2) {
+    int64_t a = *(const int64_t*)d1, b = *(const int64_t*)d2;
+    return (a > b) - (a < b);
+}
+
+static int u64_comp(const void *d1, const void *d2) {
+    uint64_t a = *(const uint64_t*)d1, b = *(const uint64_t*)d2;
+    return (a > b) - (a < b);
+}
+
+// random bits over the whole range, narrow ranges give duplicates
+static uint64_t rnd64(uint64_t range) {
+    uint64_t r = ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+    return range ? r % range : r;
+}
+
+
+//################ Sorting Networks ################
+void test_function_sortnet_all_sizes(void) {
+
+    SNTYPE types[] = {sn_i32, sn_u32, sn_i64, sn_u64};
+    size_t sizes[] = {4, 4, 8, 8};
+    int (*comps[])(const void*, const void*) = {i32_comp, u32_comp, i64_comp, u64_comp};
+
+    char a[8 * 300], b[8 * 300];
+    for (int t = 0; t<4; t++) {
+        for (size_t n = 0; n<=300; n++) {
+            for (int rep = 0; rep<3; rep++) {
+                uint64_t range = rep == 2 ? 5 : 0;
+                for (size_t i = 0; i<n; i++) {
+                    uint64_t r = rnd64(range);
+                    memcpy(a + i * sizes[t], &r, sizes[t]);
+                }
+                memcpy(b, a, n * sizes[t]);
+                TEST_ASSERT_TRUE(sortnet_sort(a, n, types[t]) == E_SUCCESS);
+                qsort(b, n, sizes[t], comps[t]);
+                if (n) TEST_ASSERT_EQUAL_MEMORY(b, a, n * sizes[t]);
+            }
+        }
+    }
+
+    // extremes sort next to the padding
+    int32_t ext[70];
+    for (int i = 0; i<70; i++) ext[i] = i % 2 ? INT32_MAX : INT32_MIN + i;
+    sortnet_sort(ext, 70, sn_i32);
+    for (int i = 1; i<70; i++) TEST_ASSERT_TRUE(ext[i-1] <= ext[i]);
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, ext[69]);
+
+    TEST_ASSERT_TRUE(sortnet_sort(NULL, 4, sn_i32) == E_EMPTY_OBJ);
+    TEST_ASSERT_TRUE(sortnet_sort(ext, 4, (SNTYPE)9) == E_BAD_TYPE);
+
+}
+
+
+void test_function_sortnet_segments(void) {
+
+    Vec_i32 *v = vec_i32_new(1000);
+    for (int i = 0; i<1000; i++) vec_i32_add_back(v, rand() % 2000 - 1000);
+
+    // mixed lengths: network, AVX2 and qsort sized segments plus an empty one
+    size_t bounds[] = {0, 3, 35, 35, 200, 520, 1000};
+    size_t nseg = sizeof(bounds) / sizeof(bounds[0]) - 1;
+    TEST_ASSERT_TRUE(vec_i32_sort_segments(v, bounds, nseg) == E_SUCCESS);
+    for (size_t s = 0; s<nseg; s++) {
+        for (size_t i = bounds[s] + 1; i<bounds[s + 1]; i++) {
+            TEST_ASSERT_TRUE(v->data[i-1] <= v->data[i]);
+        }
+    }
+
+    size_t bad[] = {0, 10, 5};
+    TEST_ASSERT_TRUE(vec_i32_sort_segments(v, bad, 2) == E_OUTOFBOUNDS);
+    size_t past[] = {0, 1001};
+    TEST_ASSERT_TRUE(vec_i32_sort_segments(v, past, 1) == E_OUTOFBOUNDS);
+
+    TEST_ASSERT_TRUE(vec_i32_sort_net(v) == E_SUCCESS);
+    for (size_t i = 1; i<v->size; i++) TEST_ASSERT_TRUE(v->data[i-1] <= v->data[i]);
+
+    vec_i32_free(v);
+
+    // generic vector of 8 byte keys
+    Vector *g = vector_new(sizeof(uint64_t), 64);
+    for (int i = 0; i<64; i++) {
+        uint64_t r = rnd64(0);
+        vector_add_back(g, &r);
+    }
+    size_t gb[] = {0, 16, 32, 48, 64};
+    TEST_ASSERT_TRUE(vector_sort_segments(g, sn_i32, gb, 4) == E_BAD_TYPE);
+    TEST_ASSERT_TRUE(vector_sort_segments(g, sn_u64, gb, 4) == E_SUCCESS);
+    uint64_t *gd = g->data;
+    for (int i = 1; i<64; i++) {
+        if (i % 16) TEST_ASSERT_TRUE(gd[i-1] <= gd[i]);
+    }
+    TEST_ASSERT_TRUE(vector_sort_net(g, sn_u64) == E_SUCCESS);
+    for (int i = 1; i<64; i++) TEST_ASSERT_TRUE(gd[i-1] <= gd[i]);
+
+    vector_free(g);
+
+}
+
+
+//################ benchmarks ################
+static void bench_segments(size_t seg_len, size_t nseg) {
+
+    clock_t start, stop;
+    size_t cnt = seg_len * nseg;
+    Vec_i32 *a = vec_i32_new(cnt), *b = vec_i32_new(cnt);
+    for (size_t i = 0; i<cnt; i++) {
+        int32_t r = rand();
+        vec_i32_add_back(a, r);
+        vec_i32_add_back(b, r);
+    }
+    size_t *bounds = malloc(sizeof(size_t) * (nseg + 1));
+    for (size_t s = 0; s<=nseg; s++) bounds[s] = s * seg_len;
+
+    start = clock();
+    for (size_t s = 0; s<nseg; s++) qsort(a->data + bounds[s], seg_len, sizeof(int32_t), i32_comp);
+    stop = clock();
+    fprintf(stdout, "qsort %zu x %zu: %f s\n", nseg, seg_len, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    start = clock();
+    vec_i32_sort_segments(b, bounds, nseg);
+    stop = clock();
+    fprintf(stdout, "sortnet %zu x %zu: %f s\n", nseg, seg_len, ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    TEST_ASSERT_EQUAL_MEMORY(a->data, b->data, cnt * sizeof(int32_t));
+
+    free(bounds);
+    vec_i32_free(a);
+    vec_i32_free(b);
+
+}
+
+void test_function_sortnet_vs_qsort(void) {
+    bench_segments(8, 200000);
+    bench_segments(16, 100000);
+    bench_segments(24, 60000);
+    bench_segments(32, 50000);
+    bench_segments(256, 6000);
+}
+
+
+
+int main(void) {
+
+    srand( time(NULL) );
+
+    UNITY_BEGIN();
+
+    // sorting networks
+    RUN_TEST(test_function_sortnet_all_sizes);
+    RUN_TEST(test_function_sortnet_segments);
+
+    // benchmarks
+    RUN_BENCH(test_function_sortnet_vs_qsort);
+
+    return UNITY_END();
+}
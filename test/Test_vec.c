@@ -6,7 +6,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <time.h>
 #include "../include/aputils.h"
+#include "test_util.h"
 
 
 void setUp(void) {
@@ -102,6 +104,36 @@ void test_function_vector_add_back(void) {
 }
 
 
+void test_function_vector_append_array(void) {
+
+    int tmp[] = {1,2,3,4,5,6,7,8,9,10};
+
+    Vector *tstvec = vector_from_array(tmp, 10, sizeof(int));
+    TEST_ASSERT_NOT_NULL(tstvec);
+    TEST_ASSERT_EQUAL_INT32(10, tstvec->size);
+    TEST_ASSERT_EQUAL_MEMORY(tmp, tstvec->data, sizeof(tmp));
+
+    // grows once, past a doubling
+    TEST_ASSERT_TRUE(vector_append_array(tstvec, tmp, 10) == E_SUCCESS);
+    TEST_ASSERT_TRUE(vector_append_array(tstvec, tmp, 10) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(30, tstvec->size);
+    TEST_ASSERT_TRUE(tstvec->cap >= 30);
+    TEST_ASSERT_EQUAL_MEMORY(tmp, (int*)tstvec->data + 20, sizeof(tmp));
+
+    TEST_ASSERT_TRUE(vector_append_array(tstvec, NULL, 0) == E_SUCCESS);
+    TEST_ASSERT_TRUE(vector_append_array(tstvec, NULL, 3) == E_EMPTY_ARG);
+    TEST_ASSERT_TRUE(vector_append_array(NULL, tmp, 3) == E_EMPTY_OBJ);
+    vector_free(tstvec);
+
+    tstvec = vector_from_array(NULL, 0, sizeof(int));
+    TEST_ASSERT_NOT_NULL(tstvec);
+    TEST_ASSERT_EQUAL_INT32(0, tstvec->size);
+    vector_free(tstvec);
+    TEST_ASSERT_NULL(vector_from_array(NULL, 4, sizeof(int)));
+
+}
+
+
 void test_function_vector_add_front(void) {
 
     int tmp[] = {5, 1000};
@@ -464,6 +496,26 @@ void test_function_vec_i32_add_back(void) {
 }
 
 
+void test_function_vec_i32_append_n(void) {
+
+    int32_t tmp[] = {5, 1000, -3, 7};
+
+    Vec_i32 *tstvec = vec_i32_new(1);
+    vec_i32_add_back(tstvec, 42);
+    TEST_ASSERT_TRUE(vec_i32_append_n(tstvec, tmp, 4) == E_SUCCESS);
+    TEST_ASSERT_TRUE(vec_i32_append_n(tstvec, tmp, 4) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(9, tstvec->size);
+    TEST_ASSERT_EQUAL_INT32(42, tstvec->data[0]);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(tmp, tstvec->data + 1, 4);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(tmp, tstvec->data + 5, 4);
+
+    TEST_ASSERT_TRUE(vec_i32_append_n(tstvec, NULL, 1) == E_EMPTY_ARG);
+    TEST_ASSERT_TRUE(vec_i32_append_n(NULL, tmp, 1) == E_EMPTY_OBJ);
+    vec_i32_free(tstvec);
+
+}
+
+
 void test_function_vec_i32_add_front(void) {
 
     int tmp[] = {5, 1000};
@@ -807,6 +859,22 @@ void test_function_vec_char_add_back(void) {
 }
 
 
+void test_function_vec_char_append_n(void) {
+
+    const char *str = "append this";
+
+    Vec_char *tstvec = vec_char_new(1);
+    TEST_ASSERT_TRUE(vec_char_append_n(tstvec, str, strlen(str)) == E_SUCCESS);
+    TEST_ASSERT_TRUE(vec_char_append_n(tstvec, str, strlen(str) + 1) == E_SUCCESS);
+    TEST_ASSERT_EQUAL_INT32(2 * strlen(str) + 1, tstvec->size);
+    TEST_ASSERT_EQUAL_STRING("append thisappend this", tstvec->data);
+
+    TEST_ASSERT_TRUE(vec_char_append_n(tstvec, NULL, 1) == E_EMPTY_ARG);
+    vec_char_free(tstvec);
+
+}
+
+
 void test_function_vec_char_add_front(void) {
 
     char tmp[] = {'a', 'b'};
@@ -1070,6 +1138,210 @@ void test_function_vec_char_reverse(void) {
 }
 
 //################ char Vector ################
+//################ Unchecked Access ################
+
+typedef struct {
+    int64_t k;
+    double w;
+} vec_pair;
+
+void test_function_vector_at(void) {
+
+    Vector *v = vector_new(sizeof(vec_pair), 4);
+    for (int i = 0; i<10; i++) {
+        vec_pair p = { .k = i, .w = i * 0.5 };
+        vector_add_back(v, &p);
+    }
+    TEST_ASSERT_TRUE(vector_at(v, 3) == vector_get(v, 3, NULL));
+    VECTOR_AT(v, vec_pair, 3).k = 42;
+    TEST_ASSERT_EQUAL_INT32(42, ((vec_pair*)v->data)[3].k);
+
+    int64_t sum = 0;
+    size_t cnt = 0;
+    VECTOR_FOREACH(v, vec_pair, p) {
+        sum += p->k;
+        cnt++;
+    }
+    TEST_ASSERT_EQUAL_INT32(10, cnt);
+    TEST_ASSERT_TRUE(sum == 45 - 3 + 42);
+    vector_free(v);
+
+    Vec_i32 *vi = vec_i32_new(1);
+    for (int i = 0; i<10; i++) vec_i32_add_back(vi, i);
+    VEC_I32_AT(vi, 0) = -1;
+    TEST_ASSERT_EQUAL_INT32(-1, vec_i32_at(vi, 0));
+    TEST_ASSERT_EQUAL_INT32(9, vec_i32_at(vi, 9));
+    VEC_I32_FOREACH(vi, x) *x *= 2;
+    TEST_ASSERT_EQUAL_INT32(18, VEC_I32_AT(vi, 9));
+    vec_i32_free(vi);
+
+    Vec_char *vc = vec_char_new(1);
+    vec_char_append_n(vc, "abc", 3);
+    VEC_CHAR_AT(vc, 1) = 'B';
+    TEST_ASSERT_EQUAL_CHAR('B', vec_char_at(vc, 1));
+    cnt = 0;
+    VEC_CHAR_FOREACH(vc, c) cnt += *c != 0;
+    TEST_ASSERT_EQUAL_INT32(3, cnt);
+    vec_char_free(vc);
+
+    // empty vectors run the loop body zero times
+    Vec_i32 *empty = vec_i32_new(1);
+    cnt = 0;
+    VEC_I32_FOREACH(empty, x) cnt++;
+    TEST_ASSERT_EQUAL_INT32(0, cnt);
+    vec_i32_free(empty);
+
+}
+
+
+void test_function_vector_at_vs_get(void) {
+
+    size_t cnt = 5000000;
+    Vec_i32 *v = vec_i32_new(cnt);
+    for (size_t i = 0; i<cnt; i++) vec_i32_add_back(v, rand() % 100);
+
+    clock_t start = clock();
+    int64_t s1 = 0;
+    UTIL_ERR e = E_SUCCESS;
+    for (size_t i = 0; i<v->size; i++) s1 += vec_i32_get(v, i, &e);
+    clock_t stop = clock();
+    fprintf(stdout, "vec_i32_get sum: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    start = clock();
+    int64_t s2 = 0;
+    for (size_t i = 0; i<v->size; i++) s2 += VEC_I32_AT(v, i);
+    stop = clock();
+    fprintf(stdout, "VEC_I32_AT sum: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    start = clock();
+    int64_t s3 = 0;
+    VEC_I32_FOREACH(v, x) s3 += *x;
+    stop = clock();
+    fprintf(stdout, "VEC_I32_FOREACH sum: %f s\n", ((double) (stop - start)) / CLOCKS_PER_SEC);
+
+    TEST_ASSERT_TRUE(s1 == s2 && s2 == s3);
+    vec_i32_free(v);
+
+}
+
+//################ Unchecked Access ################
+//################ Storage ################
+
+static bool is_aligned(const void *p, size_t align) {
+    return (uintptr_t)p % align == 0;
+}
+
+void test_function_vector_alloc_opts(void) {
+
+    Vec_alloc line = { .align = APUTIL_CACHE_LINE };
+    Vector *v = vector_new_opts(sizeof(int64_t), 3, &line);
+    TEST_ASSERT_NOT_NULL(v);
+    TEST_ASSERT_TRUE(is_aligned(v->data, 64));
+
+    // alignment survives growth (doubling and reserve) and copies
+    for (int64_t i = 0; i<1000; i++) {
+        vector_add_back(v, &i);
+        TEST_ASSERT_TRUE(is_aligned(v->data, 64));
+    }
+    int64_t more[100] = {0};
+    vector_append_array(v, more, 100);
+    TEST_ASSERT_TRUE(is_aligned(v->data, 64));
+    TEST_ASSERT_EQUAL_INT32(999, *(int64_t*)vector_at(v, 999));
+
+    Vector *c = vector_copy(v);
+    TEST_ASSERT_TRUE(is_aligned(c->data, 64));
+    TEST_ASSERT_TRUE(c->alloc.align == 64);
+    TEST_ASSERT_EQUAL_MEMORY(v->data, c->data, v->size * v->elem_size);
+    vector_free(c);
+    vector_free(v);
+
+    // custom alignment on the i32 vector
+    Vec_alloc page = { .align = 4096 };
+    Vec_i32 *vi = vec_i32_new_opts(10, &page);
+    for (int i = 0; i<5000; i++) vec_i32_add_back(vi, i);
+    TEST_ASSERT_TRUE(is_aligned(vi->data, 4096));
+    Vec_i32 *ci = vec_i32_copy(vi);
+    TEST_ASSERT_TRUE(is_aligned(ci->data, 4096));
+    TEST_ASSERT_EQUAL_INT32(4999, VEC_I32_AT(ci, 4999));
+    vec_i32_free(ci);
+    vec_i32_free(vi);
+
+    // huge: small data stays on malloc, large data is huge page aligned
+    Vec_alloc huge = { .huge = true };
+    Vec_i32 *h = vec_i32_new_opts(16, &huge);
+    TEST_ASSERT_NOT_NULL(h);
+    for (int i = 0; i<(int)(VEC_HUGE_MIN / sizeof(int32_t)) + 1; i++) vec_i32_add_back(h, i);
+    TEST_ASSERT_TRUE(is_aligned(h->data, VEC_HUGE_MIN));
+    TEST_ASSERT_EQUAL_INT32(12345, h->data[12345]);
+    vec_i32_free(h);
+
+}
+
+
+void test_function_vector_alloc_bad_align(void) {
+
+    // alignments that are not a power of two never reach posix_memalign
+    size_t bad_aligns[] = {48, 3, 96, APUTIL_CACHE_LINE + 1};
+    for (size_t i = 0; i<sizeof(bad_aligns) / sizeof(*bad_aligns); i++) {
+        Vec_alloc bad = { .align = bad_aligns[i] };
+        TEST_ASSERT_NULL(vector_new_opts(8, 4, &bad));
+        TEST_ASSERT_NULL(vec_i32_new_opts(4, &bad));
+        TEST_ASSERT_NULL(vec_data_alloc(&bad, 64));
+
+        void *data = malloc(16);
+        TEST_ASSERT_NULL(vec_data_realloc(&bad, data, 16, 64));
+        free(data);
+    }
+
+    // 0 and powers of two are fine
+    Vec_alloc good = { .align = 0 };
+    Vec_i32 *v = vec_i32_new_opts(4, &good);
+    TEST_ASSERT_NOT_NULL(v);
+    vec_i32_free(v);
+    good.align = 16;
+    v = vec_i32_new_opts(4, &good);
+    TEST_ASSERT_NOT_NULL(v);
+    vec_i32_free(v);
+
+}
+
+
+void test_function_vector_huge_vs_plain(void) {
+
+    // random reads over 256 MiB, TLB bound on small pages
+    size_t cnt = ((size_t)256 << 20) / sizeof(int32_t);
+    Vec_alloc huge = { .align = APUTIL_CACHE_LINE, .huge = true };
+    Vec_i32 *plain = vec_i32_new(cnt), *big = vec_i32_new_opts(cnt, &huge);
+    TEST_ASSERT_NOT_NULL(plain);
+    TEST_ASSERT_NOT_NULL(big);
+    for (size_t i = 0; i<cnt; i++) {
+        vec_i32_add_back(plain, (int32_t)i);
+        vec_i32_add_back(big, (int32_t)i);
+    }
+
+    Vec_i32 *vs[] = {plain, big};
+    const char *names[] = {"plain", "huge"};
+    int64_t sums[2] = {0};
+    for (int k = 0; k<2; k++) {
+        uint64_t x = 88172645463325252ull;
+        clock_t start = clock();
+        for (size_t i = 0; i<10000000; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            sums[k] += VEC_I32_AT(vs[k], x % cnt);
+        }
+        clock_t stop = clock();
+        fprintf(stdout, "random reads %s: %f s\n", names[k], ((double) (stop - start)) / CLOCKS_PER_SEC);
+    }
+    TEST_ASSERT_TRUE(sums[0] == sums[1]);
+
+    vec_i32_free(plain);
+    vec_i32_free(big);
+
+}
+
+//################ Storage ################
 
 
 
@@ -1167,6 +1439,7 @@ int main(void) {
     RUN_TEST(test_function_vector_copy);
     RUN_TEST(test_function_vector_clear);
     RUN_TEST(test_function_vector_add_back);
+    RUN_TEST(test_function_vector_append_array);
     RUN_TEST(test_function_vector_add_front);
     RUN_TEST(test_function_vector_insert);
     RUN_TEST(test_function_vector_get);
@@ -1184,6 +1457,7 @@ int main(void) {
     RUN_TEST(test_function_vec_i32_copy);
     RUN_TEST(test_function_vec_i32_clear);
     RUN_TEST(test_function_vec_i32_add_back);
+    RUN_TEST(test_function_vec_i32_append_n);
     RUN_TEST(test_function_vec_i32_add_front);
     RUN_TEST(test_function_vec_i32_insert);
     RUN_TEST(test_function_vec_i32_get);
@@ -1201,6 +1475,7 @@ int main(void) {
     RUN_TEST(test_function_vec_char_copy);
     RUN_TEST(test_function_vec_char_clear);
     RUN_TEST(test_function_vec_char_add_back);
+    RUN_TEST(test_function_vec_char_append_n);
     RUN_TEST(test_function_vec_char_add_front);
     RUN_TEST(test_function_vec_char_insert);
     RUN_TEST(test_function_vec_char_get);
@@ -1213,6 +1488,15 @@ int main(void) {
     RUN_TEST(test_function_vec_char_swap);
     RUN_TEST(test_function_vec_char_reverse);
 
+    // unchecked access
+    RUN_TEST(test_function_vector_at);
+    RUN_BENCH(test_function_vector_at_vs_get);
+
+    // storage
+    RUN_TEST(test_function_vector_alloc_opts);
+    RUN_TEST(test_function_vector_alloc_bad_align);
+    RUN_BENCH(test_function_vector_huge_vs_plain);
+
     // sort
     RUN_TEST(test_function_vector_sort);
 
@@ -0,0 +1,29 @@
+/*
+ *    helpers shared by the tests
+ */
+
+#ifndef _TEST_UTIL_H
+#define _TEST_UTIL_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+
+// monotonic wall clock in seconds
+static inline double wall(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// benchmarks only run with APUTIL_BENCH set (and not "0"), e.g. APUTIL_BENCH=1 make test
+static inline bool bench_enabled(void) {
+    const char *b = getenv("APUTIL_BENCH");
+    return b && *b && strcmp(b, "0") != 0;
+}
+
+#define RUN_BENCH(fn) do { if (bench_enabled()) RUN_TEST(fn); } while (0)
+
+#endif